@@ -6,14 +6,14 @@ INCLUDE_DIR="include"
 LIB_DIR="lib"
 STATIC_LIB="libminikv.a"
 DYNAMIC_LIB="libminikv.so"
-SOURCE_FILES="$SRC_DIR/minikv.c $SRC_DIR/parser.c"
+SOURCE_FILES="$SRC_DIR/minikv.c $SRC_DIR/parser.c $SRC_DIR/compress.c $SRC_DIR/lsm.c $SRC_DIR/vlog.c $SRC_DIR/wal.c $SRC_DIR/replication.c $SRC_DIR/net.c $SRC_DIR/snapshot.c $SRC_DIR/export.c $SRC_DIR/hotkeys.c $SRC_DIR/slowlog.c $SRC_DIR/server.c $SRC_DIR/shm.c $SRC_DIR/mmap.c $SRC_DIR/shell.c"
 
 # 创建库目录
 mkdir -p $LIB_DIR
 
 # 编译生成目标文件（使用-fPIC选项创建动态库）
 echo "正在编译源代码..."
-gcc -I$INCLUDE_DIR -fPIC -c $SOURCE_FILES
+gcc -I$INCLUDE_DIR -fPIC -pthread -c $SOURCE_FILES
 
 # 创建静态库
 echo "正在创建静态库 $STATIC_LIB..."
@@ -21,12 +21,20 @@ ar rcs $LIB_DIR/$STATIC_LIB *.o
 
 # 创建动态库
 echo "正在创建动态库 $DYNAMIC_LIB..."
-gcc -shared -o $LIB_DIR/$DYNAMIC_LIB *.o
+gcc -shared -pthread -o $LIB_DIR/$DYNAMIC_LIB *.o
 
 # 清理目标文件
 echo "正在清理目标文件..."
 rm -f *.o
 
+# 创建客户端库（独立于libminikv）
+echo "正在创建客户端库..."
+gcc -I$INCLUDE_DIR -fPIC -pthread -c $SRC_DIR/client.c $SRC_DIR/net.c
+ar rcs $LIB_DIR/libminikv-client.a client.o net.o
+gcc -shared -pthread -o $LIB_DIR/libminikv-client.so client.o net.o
+rm -f client.o net.o
+
 echo "库文件创建完成！"
 echo "静态库：$LIB_DIR/$STATIC_LIB"
 echo "动态库：$LIB_DIR/$DYNAMIC_LIB"
+echo "客户端库：$LIB_DIR/libminikv-client.a $LIB_DIR/libminikv-client.so"
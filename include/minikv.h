@@ -5,14 +5,70 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "minikv_net.h"
 
 
 #define MK_HASH_SIZE 1024// 哈希桶大小（简易哈希表，链表法解决冲突）
 #define MAX_CMD_LEN 1024// 最大命令行长度
+#define MK_MALLOC_OVERHEAD sizeof(size_t)// 分配器为每块内存额外占用的块头大小
+#define MK_BIGKEYS_SAMPLES 256// memory bigkeys 默认抽样的哈希桶数量
+
+// value的存储编码
+#define MK_ENC_RAW 0// 原样存储
+#define MK_ENC_LZ  1// 使用内置LZ算法压缩存储
+#define MK_ENC_INT 2// 规范形式的整数只存为int64（value为NULL），取值时再格式化为十进制字符串
+#define MK_INT_BUF 21// 整数格式化缓冲区大小（最长的int64十进制字符串加'\0'）
+#define MK_ENC_VLOG 3// 存放在值日志中，节点只保存记录位置（value为NULL）
+
+// 节点标志
+#define MK_NODE_TOMBSTONE 0x01// 删除标记（开启磁盘层时用于遮住磁盘上的旧值）
+
+#define MK_LSM_L0_TRIGGER 4// L0磁盘表达到该数量时触发后台合并
+
+// 值日志（大value与key分离存储）
+#define MK_VLOG_SEGMENT_SIZE (64 * 1024 * 1024)// 值日志段的默认大小
+#define MK_VLOG_MAX_SEGMENTS 4096// 值日志最多同时存在的段数
+
+#define MK_LOCK_STRIPES 16// 分段锁数量，第i个哈希桶由locks[i % MK_LOCK_STRIPES]保护
+
+// 热点key统计（count-min sketch + top-K）
+#define MK_HOT_DEPTH 4// sketch的行数（哈希函数个数）
+#define MK_HOT_WIDTH 4096// sketch每行的计数器个数
+#define MK_HOT_TOPK_MAX 100// 最多跟踪的热点key个数
+#define MK_HOT_DECAY 65536// 每采样这么多次，所有计数减半（只反映近期的访问）
+
+// 慢操作日志
+#define MK_SLOWLOG_LEN 128// 环形缓冲区保存的记录条数
+#define MK_SLOWLOG_KEY_LEN 64// 记录中key的最大长度（含'\0'，8的倍数）
+
+// 写操作类型（复制日志中使用）
+#define MK_OP_PUT 1
+#define MK_OP_DEL 2
+#define MK_OP_BATCH 3// 批量写，value为依次排列的操作
+#define MK_BATCH_OP_HDR 13// 批量写中每个操作的头：[u32 保留][u8 op][u32 klen][u32 vlen]，之后是key、'\0'和value
+
+// 多线程共享的计数器使用原子操作
+#define MK_ATOMIC_ADD(var, n) __atomic_add_fetch(&(var), (n), __ATOMIC_RELAXED)
+#define MK_ATOMIC_SUB(var, n) __atomic_sub_fetch(&(var), (n), __ATOMIC_RELAXED)
+#define MK_ATOMIC_LOAD(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define MK_ATOMIC_STORE(var, v) __atomic_store_n(&(var), (v), __ATOMIC_RELAXED)
+
 // 键值对节点（哈希表桶的链表节点）
 typedef struct mk_node {
     char *key;                  // 键（动态分配）
-    char *value;                // 值（动态分配）
+    char *value;                // 值（动态分配，可包含'\0'，末尾额外补一个'\0'；整数编码和值日志编码时为NULL）
+    size_t value_len;           // 值的存储字节长度（不含末尾补的'\0'）
+    size_t raw_len;             // 值的原始字节长度（未压缩时等于value_len，整数编码时为十进制字符串长度）
+    union {
+        int64_t ival;           // 整数编码时的值
+        uint64_t vlog_off;      // 值日志编码时记录的位置
+    };
+    unsigned char enc;          // 值的存储编码（MK_ENC_RAW / MK_ENC_LZ / MK_ENC_INT / MK_ENC_VLOG）
+    unsigned char flags;        // 节点标志（MK_NODE_TOMBSTONE）
+    uint64_t version;           // 写入该版本时的全局序号，也是key的版本号（mk_cas比较的对象）
+    struct mk_node *older;      // 仍被快照需要的旧版本（新到旧，旧版本节点的key为NULL）
     struct mk_node *next;       // 下一个节点（冲突链）
 } mk_node_t;
 
@@ -21,28 +77,303 @@ typedef struct mk_node {
 typedef struct {
     char *key;
     char *value;
+    const mk_node_t *node;      // 所属节点（value可能是压缩后的字节）
 } kv_pair_t;
 
+// 缓冲输出（用于mk_export），输出到文件描述符或内存
+typedef struct {
+    int fd;                            // 输出的文件描述符，-1表示输出到内存
+    char *buf;                         // 缓冲区；输出到内存时就是导出的内容（按需扩容）
+    size_t len;                        // 缓冲区中的字节数
+    size_t cap;                        // 缓冲区容量
+    int error;                         // 写入出错后置1，之后的写入都会失败
+} mk_sink_t;
+
+// 压缩统计
+typedef struct {
+    size_t compressed_values;          // 当前压缩存储的value个数
+    uint64_t raw_bytes;                // 这些value的原始总字节数
+    uint64_t stored_bytes;             // 这些value压缩后的总字节数
+    uint64_t compress_calls;           // 累计压缩次数
+    uint64_t incompressible;           // 其中压缩后没有变小、改为原样存储的次数
+    uint64_t compress_ns;              // 累计压缩耗时（纳秒）
+    uint64_t decompress_calls;         // 累计解压次数
+    uint64_t decompress_ns;            // 累计解压耗时（纳秒）
+} mk_compress_stats_t;
+
+// 磁盘层统计
+typedef struct {
+    size_t l0_tables;                  // L0磁盘表数量
+    size_t l1_tables;                  // L1磁盘表数量
+    uint64_t disk_entries;             // 磁盘表中的记录总数（含旧版本和删除标记）
+    uint64_t disk_bytes;               // 磁盘表文件总大小
+    uint64_t lookups;                  // 内存表未命中、查询磁盘层的次数
+    uint64_t bloom_negatives;          // 被布隆过滤器直接排除、没有读盘的次数（按表计）
+    uint64_t block_reads;              // 读取数据块的次数
+    uint64_t flushes;                  // 内存表刷盘次数
+    uint64_t compactions;              // 合并次数
+} mk_lsm_stats_t;
+
+typedef struct mk_lsm mk_lsm_t;// 磁盘层（定义见lsm.c）
+typedef struct mk_vlog mk_vlog_t;// 值日志（定义见vlog.c）
+
+// 值日志统计
+typedef struct {
+    size_t segments;                   // 当前的段数
+    uint64_t file_bytes;               // 所有段的总大小
+    uint64_t live_bytes;               // 有效记录的字节数
+    uint64_t dead_bytes;               // 已失效、等待回收的字节数
+    uint64_t gc_segments;              // 累计回收的段数
+    uint64_t gc_moved_bytes;           // 回收时搬移的有效记录字节数
+} mk_vlog_stats_t;
+
+typedef struct mk_wal mk_wal_t;// 写日志与检查点（定义见wal.c）
+
+// 写日志统计
+typedef struct {
+    uint64_t position;                 // 写日志的当前位置（累计写入的字节数）
+    uint64_t synced;                   // 已落盘到的位置
+    uint64_t checkpoint_pos;           // 最新检查点对应的日志位置
+    uint64_t checkpoints;              // 本次开启后做过的检查点数
+    uint64_t checkpoint_ms;            // 最近一次检查点的耗时（毫秒）
+    uint64_t errors;                   // 写入或落盘失败的次数
+    uint64_t loaded_keys;              // 启动时从检查点载入的键值对数
+    uint64_t replayed_records;         // 启动时重放的日志记录数
+    uint64_t skipped_checkpoints;      // 启动时因损坏跳过的检查点数
+    uint64_t recovery_ms;              // 启动恢复耗时（毫秒）
+    uint64_t recovery_threads;         // 恢复使用的线程数
+} mk_wal_stats_t;
+typedef struct mk_repl mk_repl_t;// 主从复制（定义见replication.c）
+typedef struct mk_batch mk_batch_t;// 批量写（定义见minikv.c）
+typedef struct mk_snapshot mk_snapshot_t;// 只读快照（定义见snapshot.c）
+typedef struct mk_hot mk_hot_t;// 热点key统计（定义见hotkeys.c）
+typedef struct mk_slowlog mk_slowlog_t;// 慢操作日志（定义见slowlog.c）
+typedef struct mk_server mk_server_t;// 网络服务（定义见server.c）
+typedef struct mk_shm_server mk_shm_server_t;// 共享内存传输的服务端（定义见shm.c）
+typedef struct mk_shm_client mk_shm_client_t;// 共享内存传输的客户端（定义见shm.c）
+typedef struct mk_mmap mk_mmap_t;// 映射文件中的共享Hash表（定义见mmap.c）
+
+// 共享Hash表的空间统计
+typedef struct {
+    size_t count;                      // 键值对数量
+    uint64_t capacity;                 // 映射文件大小
+    uint64_t used;                     // 已分配的块的总字节数
+    uint64_t free;                     // 从未分配过的剩余字节数（不含空闲链表中可复用的块）
+    uint64_t buckets;                  // 哈希桶数量
+} mk_mmap_stats_t;
+
+// 复制状态
+typedef struct {
+    int role;                          // MK_REPL_NONE / MK_REPL_LEADER / MK_REPL_FOLLOWER
+    char replid[41];                   // 复制流ID（主节点启动时随机生成）
+    uint64_t offset;                   // 主节点：已写入复制日志的字节数；从节点：已应用的字节数
+    uint64_t backlog_start;            // 主节点：复制积压缓冲区中最早可续传的偏移
+    size_t followers;                  // 主节点：当前连接的从节点数
+    int link_up;                       // 从节点：与主节点的连接是否正常
+    uint64_t full_syncs;               // 全量同步次数
+    uint64_t partial_syncs;            // 断点续传次数
+} mk_repl_info_t;
+
+#define MK_REPL_NONE 0
+#define MK_REPL_LEADER 1
+#define MK_REPL_FOLLOWER 2
+
 // 存储数据的Hash表
 typedef struct {
     mk_node_t *buckets[MK_HASH_SIZE];  // 哈希桶数组
     size_t count;                      // 总键值对数量
+    size_t mem_used;                   // 占用的全部内存字节数（含节点、key/value、桶数组及分配器开销）
+    size_t compress_threshold;         // value压缩阈值（字节），0表示不压缩
+    mk_compress_stats_t cstats;        // 压缩统计
+    mk_lsm_t *lsm;                     // 磁盘层，未开启时为NULL（开启后Hash表作为内存表）
+    mk_vlog_t *vlog;                   // 值日志，未开启时为NULL
+    mk_repl_t *repl;                   // 主从复制，未开启时为NULL
+    mk_wal_t *wal;                     // 写日志，未开启时为NULL
+    mk_server_t *server;               // 网络服务，未开启时为NULL
+    mk_shm_server_t *shm;              // 共享内存传输，未开启时为NULL
+    mk_hot_t *hot;                     // 热点key统计，未开启时为NULL
+    uint64_t slowlog_ns;               // 慢操作阈值（纳秒），0表示不记录
+    mk_slowlog_t *slowlog;             // 慢操作日志，首次开启时创建
+    pthread_rwlock_t locks[MK_LOCK_STRIPES];// 分段读写锁
+    uint64_t seq;                      // 全局写序号，每次写操作加1
+    pthread_mutex_t snap_mu;           // 保护活动快照链表
+    mk_snapshot_t *snaps;              // 活动快照链表（按开始顺序，最老的在前）
+    size_t snap_count;                 // 活动快照数量
+    uint64_t snap_oldest;              // 最老的活动快照的序号
+    uint64_t snap_newest;              // 最新的活动快照的序号
+    size_t old_versions;               // 为快照保留的旧版本数量
 } mk_t;
 
+// 内存占用较大的key，用于 mk_memory_bigkeys
+typedef struct {
+    char key[128];                     // key（过长时截断）
+    size_t bytes;                      // 该key占用的内存字节数
+} mk_bigkey_t;
+
+// 访问频率较高的key，用于 mk_hotkeys
+typedef struct {
+    char key[128];                     // key（过长时截断）
+    uint64_t count;                    // 估计的近期访问次数（采样计数乘以采样间隔）
+} mk_hotkey_t;
+
+// 一条慢操作记录，用于 mk_slowlog_get
+typedef struct {
+    uint64_t id;                       // 记录编号（递增）
+    uint64_t timestamp_us;             // 操作开始时间（Unix时间，微秒）
+    uint64_t duration_us;              // 耗时（微秒）
+    char cmd[16];                      // 操作名（put/get/del/incrby/load/save/list）
+    char key[MK_SLOWLOG_KEY_LEN];      // key或文件路径（过长时截断，没有时为空）
+} mk_slowlog_entry_t;
+
 
 mk_t* mk_create(void);//创建Hash表
 int mk_destroy(mk_t *mk);//销毁Hash表
 int mk_load(mk_t *mk, const char *filepath);//从文件中读取Key,Value键值对
 int mk_save(mk_t *mk, const char *filepath);//保存Key,Value键值对到文件
-const char* mk_get(const mk_t *mk, const char *key);//根据key获取value
+int mk_foreach(const mk_t *mk, int (*cb)(const char *key, size_t klen, const char *value, size_t vlen, void *ctx), void *ctx);//遍历所有键值对，cb返回非0时提前结束并返回该值
+int mk_export(const mk_t *mk, mk_sink_t *sink);//按遍历顺序把所有键值对以mk_save的格式写入sink
+int mk_export_sorted(const mk_t *mk, mk_sink_t *sink, int desc);//按key排序（desc为1时降序）把所有键值对写入sink
+int mk_sink_fd(mk_sink_t *sink, int fd);//初始化输出到fd的缓冲输出
+int mk_sink_mem(mk_sink_t *sink);//初始化输出到内存的缓冲输出（内容为sink->buf，长度为sink->len）
+int mk_sink_write(mk_sink_t *sink, const void *data, size_t len);//向缓冲输出写入数据
+int mk_sink_flush(mk_sink_t *sink);//把缓冲的数据写出到fd
+void mk_sink_free(mk_sink_t *sink);//释放缓冲区（不关闭fd）
+const char* mk_get(const mk_t *mk, const char *key);//根据key获取value（原样存储时在该key下次被修改前有效，否则在本线程下次查询前有效）
+int mk_get_bin(const mk_t *mk, const char *key, const void **data, size_t *len);//根据key零拷贝获取value的字节和长度
+int mk_get_buf(const mk_t *mk, const char *key, void *buf, size_t cap, size_t *len);//根据key获取value并复制（解压）到buf中
 int mk_put(mk_t *mk, const char *key, const char *value);//新增一个key,value键值对
+int mk_put_bin(mk_t *mk, const char *key, const void *data, size_t len);//新增一个value为任意字节的键值对
+int mk_get_versioned(const mk_t *mk, const char *key, void *buf, size_t cap, size_t *len, uint64_t *version);//获取value的副本及其版本号
+int mk_cas(mk_t *mk, const char *key, uint64_t expected_version, const void *data, size_t len);//版本号等于expected_version时写入，版本不符返回1
+int mk_put_if_absent(mk_t *mk, const char *key, const void *data, size_t len);//key不存在时写入，已存在返回1
+int mk_put_if_present(mk_t *mk, const char *key, const void *data, size_t len);//key存在时写入，不存在返回1
+mk_batch_t *mk_batch_create(void);//创建空的批量写
+int mk_batch_put(mk_batch_t *b, const char *key, const void *data, size_t len);//向批量写追加一次写入（key不合法时返回-1，不加入）
+int mk_batch_del(mk_batch_t *b, const char *key);//向批量写追加一次删除
+size_t mk_batch_count(const mk_batch_t *b);//批量写中的操作数
+void mk_batch_clear(mk_batch_t *b);//清空批量写以便复用
+void mk_batch_free(mk_batch_t *b);//释放批量写
+int mk_batch_commit(mk_t *mk, const mk_batch_t *b);//原子地应用批量写中的全部操作
+int mk_batch_apply(mk_t *mk, const char *buf, size_t len);//原子地应用按批量写格式排列的操作（内部使用）
 int mk_del(mk_t *mk, const char *key);//删除key对应的键值对
-size_t mk_count(const mk_t *mk);//获取Hash表中元素的数量
+int mk_incrby(mk_t *mk, const char *key, int64_t delta, int64_t *result);//把key的整数值原子地加上delta，key不存在时从0开始
+int mk_decrby(mk_t *mk, const char *key, int64_t delta, int64_t *result);//把key的整数值原子地减去delta
+size_t mk_count(const mk_t *mk);//获取Hash表中元素的数量（开启磁盘层时只统计内存表）
+size_t mk_memory_usage(const mk_t *mk);//获取Hash表占用的全部内存字节数
+size_t mk_key_memory_usage(const mk_t *mk, const char *key);//获取单个key占用的内存字节数，不存在返回0
+size_t mk_memory_bigkeys(const mk_t *mk, size_t samples, mk_bigkey_t *out, size_t n);//抽样估计占用内存最大的n个key
+int mk_hotkeys_enable(mk_t *mk, uint32_t sample_rate, size_t k);//每sample_rate次读写采样一次，跟踪访问最多的k个key，0表示关闭
+size_t mk_hotkeys(const mk_t *mk, mk_hotkey_t *out, size_t n);//获取访问最多的n个key（按次数降序），返回个数
+void mk_hotkeys_touch(const mk_t *mk, const char *validKey);//记录一次访问，调用方需持有所在分段的锁（内部使用）
+void mk_hotkeys_free(mk_t *mk);//释放热点key统计（内部使用）
+int mk_slowlog_set(mk_t *mk, uint64_t threshold_us);//记录耗时不小于threshold_us微秒的操作，0表示关闭
+size_t mk_slowlog_get(const mk_t *mk, mk_slowlog_entry_t *out, size_t n);//获取最近的n条慢操作记录（新的在前），返回条数
+size_t mk_slowlog_len(const mk_t *mk);//当前保存的慢操作记录条数
+void mk_slowlog_reset(mk_t *mk);//清空慢操作记录
+void mk_slowlog_record(const mk_t *mk, const char *cmd, const char *key, uint64_t duration_ns);//写入一条慢操作记录（内部使用）
+void mk_slowlog_free(mk_t *mk);//释放慢操作日志（内部使用）
+int mk_set_compress_threshold(mk_t *mk, size_t threshold);//设置value压缩阈值，0表示关闭压缩
+int mk_compress_stats(const mk_t *mk, mk_compress_stats_t *stats);//获取压缩率和压缩耗时统计
+size_t mk_lz_compress(const void *in, size_t in_len, void *out, size_t out_cap);//LZ压缩，不可压缩时返回0
+size_t mk_lz_decompress(const void *in, size_t in_len, void *out, size_t out_cap);//LZ解压，返回解压后的长度，失败返回0
+const char *mk_node_value(const mk_t *mk, const mk_node_t *node, size_t *len);//取出节点value的原始字节（内部使用）
+int mk_node_decode(const mk_t *mk, const mk_node_t *node, char *buf, size_t cap);//把节点value解码到buf中（内部使用）
+uint64_t mk_now_ns(void);//单调时钟（纳秒）
+char *mk_tls_buffer(size_t need);//当前线程的临时缓冲区（内部使用）
+mk_node_t *mk_bucket_find(const mk_t *mk, size_t idx, const char *validKey);//在哈希桶中查找节点（内部使用）
+mk_node_t* mk_find_node(const mk_t *mk, const char *key);//查找key对应的节点，调用方需持有所在分段的锁（内部使用）
+size_t mk_hash(const char *key);//计算key所在的哈希桶（内部使用）
+uint64_t mk_hash64(const char *key, size_t len);//key的64位哈希（内部使用）
+void mk_lock_all(const mk_t *mk, int write);//按顺序获取全部分段锁（内部使用）
+void mk_unlock_all(const mk_t *mk);//释放全部分段锁（内部使用）
+void mk_clear_memtable(mk_t *mk);//清空内存表（内部使用）
+void mk_detach_memtable(mk_t *mk, mk_node_t **buckets);//把内存表的全部哈希桶摘下，内存表变为空（内部使用）
+void mk_free_detached(mk_t *mk, mk_node_t **buckets);//释放摘下的哈希桶中的节点（内部使用）
+void mk_attach_memtable(mk_t *mk, mk_node_t **buckets);//把摘下的节点放回内存表（内部使用）
+int mk_lsm_open(mk_t *mk, const char *dir, size_t memtable_limit);//开启磁盘层，内存表超过memtable_limit字节时刷盘
+int mk_lsm_flush(mk_t *mk);//立即把内存表刷成磁盘表
+int mk_lsm_compact(mk_t *mk);//立即合并所有磁盘表
+int mk_lsm_close(mk_t *mk);//刷盘并关闭磁盘层
+int mk_lsm_stats(const mk_t *mk, mk_lsm_stats_t *stats);//获取磁盘层统计
+int mk_lsm_maybe_flush(mk_t *mk);//内存表超过上限时刷盘（内部使用）
+int mk_lsm_get(const mk_t *mk, const char *key, const char **value, size_t *len, uint64_t *version);//在磁盘层中查找key及其版本号（内部使用）
+int mk_vlog_open(mk_t *mk, const char *dir, size_t threshold, size_t segment_size);//开启值日志，不小于threshold字节的value存入dir下的值日志（段文件不持久化，重启后不可重新打开，持久化依赖WAL/快照/磁盘层）
+int mk_vlog_gc(mk_t *mk);//立即回收值日志中所有含无效数据的段
+int mk_vlog_stats(const mk_t *mk, mk_vlog_stats_t *stats);//获取值日志统计
+int mk_vlog_wants(const mk_t *mk, size_t len);//长度为len的value是否写入值日志（内部使用）
+int mk_vlog_append(mk_t *mk, const char *validKey, const void *data, size_t len, uint64_t *off);//把value追加到值日志，之后须调用mk_vlog_unpin（内部使用）
+const char *mk_vlog_value(const mk_t *mk, uint64_t off);//值日志中记录的value（内部使用）
+void mk_vlog_release(const mk_t *mk, uint64_t off);//标记值日志中的记录失效（内部使用）
+void mk_vlog_unpin(const mk_t *mk, uint64_t off);//记录已挂到节点上或已放弃，允许回收它所在的段（内部使用）
+void mk_vlog_free(mk_t *mk);//停止回收并释放值日志（内部使用）
+int mk_vlog_pause_gc(const mk_t *mk);//暂停值日志回收，返回是否已暂停（内部使用）
+void mk_vlog_resume_gc(const mk_t *mk);//恢复值日志回收（内部使用）
+int mk_wal_open(mk_t *mk, const char *dir, size_t checkpoint_bytes);//从dir中的检查点和写日志恢复数据，之后的写操作记入写日志
+int mk_checkpoint(mk_t *mk);//立即做一个检查点
+int mk_wal_sync(mk_t *mk);//立即把写日志落盘
+int mk_wal_stats(const mk_t *mk, mk_wal_stats_t *stats);//获取写日志统计
+int mk_wal_reserve(mk_t *mk, size_t klen, size_t len);//获取分段写锁前为一条日志记录预留缓冲区（内部使用）
+void mk_wal_feed(mk_t *mk, int op, const char *key, const void *data, size_t len);//把一次写操作追加到写日志（内部使用）
+void mk_wal_free(mk_t *mk);//落盘并关闭写日志（内部使用）
+mk_snapshot_t *mk_snapshot_begin(const mk_t *mk);//创建当前时刻的只读快照，写操作不受影响
+mk_snapshot_t *mk_snapshot_begin_locked(mk_t *mk);//在已持有的全部读锁下创建快照（内部使用）
+const char *mk_snapshot_get(const mk_snapshot_t *snap, const char *key, size_t *len);//在快照中查询key
+int mk_snapshot_foreach(const mk_snapshot_t *snap, int (*cb)(const char *key, size_t klen, const char *value, size_t vlen, void *ctx), void *ctx);//遍历快照中的所有键值对
+void mk_snapshot_end(mk_snapshot_t *snap);//结束快照，回收只有它需要的旧版本
+const mk_node_t *mk_node_visible(const mk_node_t *node, uint64_t seq);//节点在序号seq时可见的版本（内部使用）
+void mk_mvcc_gc(mk_t *mk);//回收不再被任何快照需要的旧版本（内部使用）
+int mk_repl_leader_start(mk_t *mk, const char *addr, size_t backlog_size);//作为主节点在addr上等待从节点连接
+int mk_repl_follow(mk_t *mk, const char *addr);//作为从节点连接addr上的主节点并持续同步
+int mk_repl_stop(mk_t *mk);//停止复制（保留复制ID和偏移，再次follow时可断点续传）
+int mk_repl_info(const mk_t *mk, mk_repl_info_t *info);//获取复制状态
+void mk_repl_feed(mk_t *mk, int op, const char *key, const void *data, size_t len);//把一次写操作追加到复制日志（内部使用）
+void mk_repl_free(mk_t *mk);//停止复制并释放资源（内部使用）
+int mk_server_start(mk_t *mk, const char *addr);//在addr上提供网络服务（RESP协议），由后台线程处理所有连接
+int mk_server_stop(mk_t *mk);//停止网络服务并关闭所有连接
+int mk_shm_start(mk_t *mk, const char *path);//在unix套接字path上接受同一台机器上的共享内存客户端
+int mk_shm_stop(mk_t *mk);//停止共享内存服务并断开所有客户端
+mk_shm_client_t *mk_shm_connect(const char *path, size_t value_cap);//连接共享内存服务，value_cap为单个value的最大字节数（0为默认1MB）
+void mk_shm_close(mk_shm_client_t *c);//关闭共享内存连接
+int mk_shm_get(mk_shm_client_t *c, const char *key, const void **value, size_t *len);//通过共享内存查询key，value指向共享内存（下一次调用前有效）
+int mk_shm_put(mk_shm_client_t *c, const char *key, const void *data, size_t len);//通过共享内存写入键值对
+int mk_shm_del(mk_shm_client_t *c, const char *key);//通过共享内存删除key，key不存在返回1
+mk_mmap_t *mk_mmap_open(const char *path, size_t capacity);//打开（不存在时按capacity字节创建）映射文件中的共享Hash表，多个进程可同时打开
+int mk_mmap_close(mk_mmap_t *m);//关闭共享Hash表，数据保留在文件中
+int mk_mmap_sync(mk_mmap_t *m);//把共享Hash表的修改同步到磁盘
+int mk_mmap_put(mk_mmap_t *m, const char *key, const void *data, size_t len);//在共享Hash表中新增或覆盖键值对
+int mk_mmap_get(const mk_mmap_t *m, const char *key, void *buf, size_t cap, size_t *len);//从共享Hash表中查询key并复制value到buf中
+int mk_mmap_del(mk_mmap_t *m, const char *key);//从共享Hash表中删除key
+size_t mk_mmap_count(const mk_mmap_t *m);//共享Hash表中的键值对数量
+int mk_mmap_stats(const mk_mmap_t *m, mk_mmap_stats_t *stats);//获取共享Hash表的空间统计
+int mk_apply(mk_t *mk, int op, const char *key, const void *data, size_t len);//应用一次写操作，不输出提示信息（内部使用）
+int mk_del_checked(mk_t *mk, const char *key);//校验key后删除，删除了返回1，key不存在返回0，出错返回-1（内部使用）
+int mk_lsm_scan(const mk_t *mk, int (*cb)(const char *key, size_t klen, const char *value, size_t vlen, void *ctx), void *ctx);//按key升序遍历所有有效键值对（内部使用）
 char* mk_trim(const char *str);//去除字符串首尾空白字符，返回新分配的字符串
 int mk_is_valid_key(const char *key);//检查key是否合法，合法返回0，非法返回-1
 int mk_parse_line(const char *line, char **key, char **value);//将读到的一行拆分为键值对
+int mk_str2ll(const char *s, size_t len, int64_t *out);//解析规范形式的64位整数，成功返回1
+size_t mk_ll2str(char *buf, int64_t v);//把64位整数格式化为十进制字符串，返回长度
 int mk_print(const mk_t *mk);//打印Hash表中的所有键值对
 int mk_asc_print(const mk_t *mk);//按key升序打印Hash表中的所有键值对
 int mk_desc_print(const mk_t *mk);//按key降序打印Hash表中的所有键值对
 int start_minikv(void);//启动函数
+int start_minikv_batch(void);//批量模式启动函数（从标准输入读取命令，不输出提示信息）
+
+// 分段锁：第idx个哈希桶所在的锁
+static inline pthread_rwlock_t *mk_stripe(const mk_t *mk, size_t idx) {
+    return (pthread_rwlock_t *)&mk->locks[idx % MK_LOCK_STRIPES];
+}
+
+// 慢操作计时开始：未开启慢操作日志时返回0，不读时钟
+static inline uint64_t mk_slowlog_start(const mk_t *mk) {
+    return (mk != NULL && MK_ATOMIC_LOAD(mk->slowlog_ns) > 0) ? mk_now_ns() : 0;
+}
+
+// 慢操作计时结束：耗时达到阈值时写入慢操作日志
+static inline void mk_slowlog_end(const mk_t *mk, const char *cmd, const char *key, uint64_t start) {
+    if (start == 0) return;
+    uint64_t duration = mk_now_ns() - start;
+    uint64_t threshold = MK_ATOMIC_LOAD(mk->slowlog_ns);
+    if (threshold > 0 && duration >= threshold) mk_slowlog_record(mk, cmd, key, duration);
+}
 #endif
\ No newline at end of file
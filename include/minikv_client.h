@@ -0,0 +1,62 @@
+#ifndef MINIKV_CLIENT_H
+#define MINIKV_CLIENT_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+// MiniKV异步客户端（libminikv-client）
+// 连接是非阻塞的：请求先写入发送缓冲区，不等回复就可以继续发送（流水线），
+// 由调用方的事件循环在套接字可读/可写时调用mkc_process，回复按发送顺序触发回调。
+// 不使用事件循环时可以调用mkc_wait等待所有请求完成。
+// 一个连接只能在一个线程中使用；回调中可以发送新请求，但不能调用mkc_process、mkc_wait或mkc_close。
+
+// 回复类型
+#define MKC_REPLY_STATUS 1// 状态（如OK、PONG），str为状态文本
+#define MKC_REPLY_ERROR 2// 错误，str为错误信息（连接断开时为"ERR connection lost"）
+#define MKC_REPLY_INTEGER 3// 整数，integer为值
+#define MKC_REPLY_STRING 4// 字符串，str/len为value（可包含'\0'，末尾额外补一个'\0'）
+#define MKC_REPLY_NIL 5// key不存在
+#define MKC_REPLY_ARRAY 6// 数组（MGET），element/elements为各个元素
+
+// 一个回复（回调返回后失效，需要保留时使用mkc_future_t）
+typedef struct mkc_reply {
+    int type;                          // MKC_REPLY_*
+    int64_t integer;                   // MKC_REPLY_INTEGER的值
+    const char *str;                   // 状态、错误或字符串
+    size_t len;                        // str的字节数
+    const struct mkc_reply *element;   // 数组元素
+    size_t elements;                   // 数组元素个数
+} mkc_reply_t;
+
+typedef struct mkc mkc_t;// 客户端连接（定义见client.c）
+
+// 请求完成回调，reply只在回调期间有效
+typedef void (*mkc_callback_t)(mkc_t *c, const mkc_reply_t *reply, void *ctx);
+
+// future：把mkc_future_cb作为回调、future作为ctx，完成后done为1，reply保存回复的副本
+typedef struct {
+    int done;
+    mkc_reply_t reply;
+} mkc_future_t;
+
+mkc_t *mkc_connect(const char *addr);//发起非阻塞连接（"unix:/path"、包含'/'的路径或"host:port"），失败返回NULL
+void mkc_close(mkc_t *c);//关闭连接，未完成的请求以错误回复结束
+int mkc_fd(const mkc_t *c);//连接的套接字，用于加入调用方的事件循环
+short mkc_events(const mkc_t *c);//当前需要关注的poll事件（POLLIN，有待发送数据时加上POLLOUT）
+int mkc_process(mkc_t *c, short revents);//处理poll返回的事件：发送请求、读取回复并触发回调；连接断开返回-1
+int mkc_flush(mkc_t *c);//立即尝试发送缓冲区中的请求（不阻塞）
+size_t mkc_pending(const mkc_t *c);//还没有收到回复的请求数
+int mkc_wait(mkc_t *c, int timeout_ms);//阻塞直到所有请求完成，timeout_ms < 0 表示不超时；超时或断开返回-1
+
+int mkc_command(mkc_t *c, size_t argc, const char *const *argv, const size_t *lens, mkc_callback_t cb, void *ctx);//发送任意命令，lens为NULL时按字符串计算长度
+int mkc_get(mkc_t *c, const char *key, mkc_callback_t cb, void *ctx);//GET key
+int mkc_put(mkc_t *c, const char *key, const void *value, size_t len, mkc_callback_t cb, void *ctx);//PUT key value
+int mkc_del(mkc_t *c, const char *key, mkc_callback_t cb, void *ctx);//DEL key
+int mkc_incrby(mkc_t *c, const char *key, int64_t delta, mkc_callback_t cb, void *ctx);//INCRBY key delta
+int mkc_mget(mkc_t *c, size_t n, const char *const *keys, mkc_callback_t cb, void *ctx);//一次读取n个key，回复为数组
+int mkc_mset(mkc_t *c, size_t n, const char *const *keys, const void *const *values, const size_t *lens, mkc_callback_t cb, void *ctx);//一次写入n个键值对
+
+void mkc_future_cb(mkc_t *c, const mkc_reply_t *reply, void *future);//把回复复制到future（ctx为mkc_future_t*）
+void mkc_future_free(mkc_future_t *f);//释放future中保存的回复
+#endif
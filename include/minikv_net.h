@@ -0,0 +1,14 @@
+#ifndef MINIKV_NET_H
+#define MINIKV_NET_H
+
+
+#include <sys/socket.h>
+
+// 服务端（libminikv）和客户端（libminikv-client）共用的地址解析和监听（内部使用）
+// 地址格式："unix:/path" 或包含'/'的路径为unix套接字，否则为 "host:port"（host为空时取127.0.0.1）
+
+int mk_net_parse_addr(const char *addr, struct sockaddr_storage *ss, socklen_t *sslen);//解析地址，成功返回地址族，失败返回-1
+int mk_net_listen(const char *addr, char *unix_path);//在addr上监听，返回监听套接字
+
+
+#endif
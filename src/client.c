@@ -0,0 +1,518 @@
+#include "../include/minikv_client.h"
+#include "../include/minikv_net.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// MiniKV异步客户端
+// 请求编码为RESP数组追加到发送缓冲区，回调按发送顺序放入环形队列；
+// 收到的回复按顺序逐个解析，每解析出一个完整回复就从队列头取出对应的回调执行。
+
+#define MKC_READ_CHUNK 65536// 每次读取的字节数
+#define MKC_FLUSH_HIGH 65536// 待发送的请求超过该值时自动尝试发送
+
+// 连接状态
+#define MKC_CONNECTING 0
+#define MKC_CONNECTED 1
+#define MKC_CLOSED 2
+
+// 等待回复的请求
+typedef struct {
+    mkc_callback_t cb;
+    void *ctx;
+} mkc_pending_t;
+
+struct mkc {
+    int fd;
+    int state;                         // MKC_CONNECTING / MKC_CONNECTED / MKC_CLOSED
+    char *out;                         // 待发送的请求，out[out_pos, out_len)尚未发出
+    size_t out_len, out_pos, out_cap;
+    char *in;                          // 已读到、尚未解析的回复
+    size_t in_len, in_cap;
+    mkc_pending_t *pending;            // 等待回复的请求（环形队列）
+    size_t head, count, cap;
+    mkc_reply_t *elems;                // 数组回复的元素
+    size_t elems_cap;
+};
+
+// 发起非阻塞连接，连接建立前发送的请求先保存在缓冲区中
+mkc_t *mkc_connect(const char *addr) {
+    if (addr == NULL) {
+        fprintf(stderr, "mkc_connect 无效的参数 ❌\n");
+        return NULL;
+    }
+    struct sockaddr_storage ss;
+    socklen_t sslen;
+    int family = mk_net_parse_addr(addr, &ss, &sslen);
+    if (family < 0) {
+        fprintf(stderr, "无效的地址 %s ❌\n", addr);
+        return NULL;
+    }
+    mkc_t *c = calloc(1, sizeof(mkc_t));
+    if (c == NULL) {
+        perror("mkc_connect 内存分配失败");
+        return NULL;
+    }
+    c->fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c->fd < 0) {
+        perror("mkc_connect socket失败");
+        free(c);
+        return NULL;
+    }
+    if (family == AF_INET) {
+        int on = 1;
+        setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    if (connect(c->fd, (struct sockaddr *)&ss, sslen) == 0) {
+        c->state = MKC_CONNECTED;
+    } else if (errno == EINPROGRESS) {
+        c->state = MKC_CONNECTING;
+    } else {
+        perror("mkc_connect 连接失败");
+        close(c->fd);
+        free(c);
+        return NULL;
+    }
+    return c;
+}
+
+// 连接断开：所有等待中的请求以错误回复结束
+static void mkc_fail(mkc_t *c, const char *msg) {
+    if (c->state != MKC_CLOSED) {
+        close(c->fd);
+        c->fd = -1;
+        c->state = MKC_CLOSED;
+    }
+    mkc_reply_t err = {MKC_REPLY_ERROR, 0, msg, strlen(msg), NULL, 0};
+    while (c->count > 0) {
+        mkc_pending_t p = c->pending[c->head];
+        c->head = (c->head + 1) % c->cap;
+        c->count--;
+        if (p.cb != NULL) p.cb(c, &err, p.ctx);
+    }
+    c->out_len = c->out_pos = 0;
+}
+
+// 关闭连接并释放资源
+void mkc_close(mkc_t *c) {
+    if (c == NULL) return;
+    mkc_fail(c, "ERR connection closed");
+    free(c->out);
+    free(c->in);
+    free(c->pending);
+    free(c->elems);
+    free(c);
+}
+
+int mkc_fd(const mkc_t *c) {
+    return c->fd;
+}
+
+short mkc_events(const mkc_t *c) {
+    if (c->state == MKC_CLOSED) return 0;
+    return POLLIN | ((c->state == MKC_CONNECTING || c->out_pos < c->out_len) ? POLLOUT : 0);
+}
+
+size_t mkc_pending(const mkc_t *c) {
+    return c->count;
+}
+
+// 立即尝试发送缓冲区中的请求，套接字写满时留到下次可写
+int mkc_flush(mkc_t *c) {
+    if (c->state == MKC_CLOSED) return -1;
+    if (c->state == MKC_CONNECTING) return 0;
+    while (c->out_pos < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_pos, c->out_len - c->out_pos, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->out_pos += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        mkc_fail(c, "ERR connection lost");
+        return -1;
+    }
+    // 只在这里整理缓冲区，追加请求时已写入的位置不会移动
+    if (c->out_pos == c->out_len) {
+        c->out_pos = c->out_len = 0;
+    } else if (c->out_pos > c->out_cap / 2) {
+        memmove(c->out, c->out + c->out_pos, c->out_len - c->out_pos);
+        c->out_len -= c->out_pos;
+        c->out_pos = 0;
+    }
+    return 0;
+}
+
+// 解析十进制整数（可带负号）
+static int mkc_parse_int(const char *s, size_t len, int64_t *out) {
+    if (len == 0 || len > 20) return -1;
+    char buf[24];
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+    char *end = NULL;
+    errno = 0;
+    long long v = strtoll(buf, &end, 10);
+    if (errno != 0 || *end != '\0') return -1;
+    *out = v;
+    return 0;
+}
+
+// 解析一个非数组回复，返回消耗的字节数，不完整返回0，格式错误返回-1
+static long mkc_parse_simple(const char *buf, size_t len, mkc_reply_t *r) {
+    const char *nl = memchr(buf, '\n', len);
+    if (nl == NULL) return 0;
+    if (nl == buf || nl[-1] != '\r') return -1;
+    const char *text = buf + 1;
+    size_t tlen = (size_t)(nl - 1 - text);
+    memset(r, 0, sizeof(*r));
+    r->str = text;
+    r->len = tlen;
+    switch (buf[0]) {
+        case '+':
+            r->type = MKC_REPLY_STATUS;
+            return (long)(nl + 1 - buf);
+        case '-':
+            r->type = MKC_REPLY_ERROR;
+            return (long)(nl + 1 - buf);
+        case ':':
+            r->type = MKC_REPLY_INTEGER;
+            r->str = NULL;
+            r->len = 0;
+            return mkc_parse_int(text, tlen, &r->integer) == 0 ? (long)(nl + 1 - buf) : -1;
+        case '$': {
+            int64_t blen = 0;
+            if (mkc_parse_int(text, tlen, &blen) != 0 || blen < -1) return -1;
+            if (blen == -1) {
+                r->type = MKC_REPLY_NIL;
+                r->str = NULL;
+                r->len = 0;
+                return (long)(nl + 1 - buf);
+            }
+            const char *data = nl + 1;
+            if ((size_t)(buf + len - data) < (size_t)blen + 2) return 0;
+            if (data[blen] != '\r' || data[blen + 1] != '\n') return -1;
+            r->type = MKC_REPLY_STRING;
+            r->str = data;
+            r->len = (size_t)blen;
+            return (long)(data + blen + 2 - buf);
+        }
+        default:
+            return -1;
+    }
+}
+
+// 解析一个回复（数组的元素放在c->elems中），返回消耗的字节数，不完整返回0，格式错误返回-1
+static long mkc_parse(mkc_t *c, const char *buf, size_t len, mkc_reply_t *r) {
+    if (buf[0] != '*') return mkc_parse_simple(buf, len, r);
+
+    const char *nl = memchr(buf, '\n', len);
+    if (nl == NULL) return 0;
+    int64_t n = 0;
+    if (nl[-1] != '\r' || mkc_parse_int(buf + 1, (size_t)(nl - 1 - buf - 1), &n) != 0 || n < -1) return -1;
+    memset(r, 0, sizeof(*r));
+    if (n == -1) {
+        r->type = MKC_REPLY_NIL;
+        return (long)(nl + 1 - buf);
+    }
+    if ((size_t)n > c->elems_cap) {
+        mkc_reply_t *grown = realloc(c->elems, (size_t)n * sizeof(mkc_reply_t));
+        if (grown == NULL) return -1;
+        c->elems = grown;
+        c->elems_cap = (size_t)n;
+    }
+    size_t pos = (size_t)(nl + 1 - buf);
+    for (int64_t i = 0; i < n; i++) {
+        if (pos == len) return 0;
+        long used = mkc_parse_simple(buf + pos, len - pos, &c->elems[i]);
+        if (used <= 0) return used;
+        pos += (size_t)used;
+    }
+    r->type = MKC_REPLY_ARRAY;
+    r->element = c->elems;
+    r->elements = (size_t)n;
+    return (long)pos;
+}
+
+// 回复完整后，把字符串末尾的'\r'改成'\0'（不完整时缓冲区保持原样，之后可以重新解析）
+static void mkc_terminate(mkc_reply_t *r) {
+    if (r->str != NULL) ((char *)r->str)[r->len] = '\0';
+    for (size_t i = 0; i < r->elements; i++) mkc_terminate((mkc_reply_t *)&r->element[i]);
+}
+
+// 解析所有完整的回复并执行回调
+static void mkc_dispatch(mkc_t *c) {
+    size_t pos = 0;
+    while (pos < c->in_len && c->state != MKC_CLOSED) {
+        if (c->count == 0) {
+            mkc_fail(c, "ERR unexpected reply");
+            return;
+        }
+        mkc_reply_t r;
+        long used = mkc_parse(c, c->in + pos, c->in_len - pos, &r);
+        if (used == 0) break;
+        if (used < 0) {
+            mkc_fail(c, "ERR protocol error");
+            return;
+        }
+        pos += (size_t)used;
+        mkc_terminate(&r);
+
+        mkc_pending_t p = c->pending[c->head];
+        c->head = (c->head + 1) % c->cap;
+        c->count--;
+        if (p.cb != NULL) p.cb(c, &r, p.ctx);
+    }
+    memmove(c->in, c->in + pos, c->in_len - pos);
+    c->in_len -= pos;
+}
+
+// 读取所有可读的回复
+static void mkc_read(mkc_t *c) {
+    while (c->state == MKC_CONNECTED) {
+        if (c->in_cap - c->in_len < MKC_READ_CHUNK) {
+            char *grown = realloc(c->in, c->in_cap + MKC_READ_CHUNK);
+            if (grown == NULL) {
+                mkc_fail(c, "ERR out of memory");
+                return;
+            }
+            c->in = grown;
+            c->in_cap += MKC_READ_CHUNK;
+        }
+        ssize_t n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+            mkc_dispatch(c);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        mkc_fail(c, "ERR connection lost");
+    }
+}
+
+// 处理poll返回的事件
+int mkc_process(mkc_t *c, short revents) {
+    if (c->state == MKC_CONNECTING && (revents & (POLLOUT | POLLERR | POLLHUP))) {
+        int err = 0;
+        socklen_t elen = sizeof(err);
+        if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &elen) != 0 || err != 0) {
+            mkc_fail(c, "ERR connection refused");
+            return -1;
+        }
+        c->state = MKC_CONNECTED;
+    }
+    if (c->state == MKC_CONNECTED && (revents & POLLOUT)) mkc_flush(c);
+    if (c->state == MKC_CONNECTED && (revents & (POLLIN | POLLHUP | POLLERR))) mkc_read(c);
+    return c->state == MKC_CLOSED ? -1 : 0;
+}
+
+// 当前时间（毫秒）
+static int64_t mkc_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 阻塞直到所有请求完成
+int mkc_wait(mkc_t *c, int timeout_ms) {
+    int64_t deadline = mkc_now_ms() + timeout_ms;
+    // 发送失败时未完成的请求已经以错误回复结束
+    if (mkc_flush(c) != 0) return -1;
+    while (c->count > 0) {
+        if (c->state == MKC_CLOSED) return -1;
+        int wait = -1;
+        if (timeout_ms >= 0) {
+            int64_t left = deadline - mkc_now_ms();
+            if (left <= 0) return -1;
+            wait = (int)left;
+        }
+        struct pollfd pfd = {c->fd, mkc_events(c), 0};
+        int n = poll(&pfd, 1, wait);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n > 0 && mkc_process(c, pfd.revents) != 0) return -1;
+    }
+    return 0;
+}
+
+// 追加n字节到发送缓冲区
+static int mkc_append(mkc_t *c, const void *data, size_t n) {
+    if (c->out_len + n > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap : 4096;
+        while (cap < c->out_len + n) cap *= 2;
+        char *grown = realloc(c->out, cap);
+        if (grown == NULL) return -1;
+        c->out = grown;
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, data, n);
+    c->out_len += n;
+    return 0;
+}
+
+// 追加请求头：参数个数
+static int mkc_begin(mkc_t *c, size_t argc) {
+    char hdr[32];
+    int n = snprintf(hdr, sizeof(hdr), "*%zu\r\n", argc);
+    return mkc_append(c, hdr, (size_t)n);
+}
+
+// 追加一个参数
+static int mkc_arg(mkc_t *c, const void *data, size_t len) {
+    char hdr[32];
+    int n = snprintf(hdr, sizeof(hdr), "$%zu\r\n", len);
+    if (mkc_append(c, hdr, (size_t)n) != 0 || mkc_append(c, data, len) != 0) return -1;
+    return mkc_append(c, "\r\n", 2);
+}
+
+// 请求编码完成：登记回调，失败时撤销从mark开始写入的部分；待发送的数据较多时顺便发送
+static int mkc_end(mkc_t *c, size_t mark, int ret, mkc_callback_t cb, void *ctx) {
+    if (ret == 0 && c->count == c->cap) {
+        size_t cap = c->cap ? c->cap * 2 : 64;
+        mkc_pending_t *grown = malloc(cap * sizeof(mkc_pending_t));
+        if (grown == NULL) {
+            ret = -1;
+        } else {
+            for (size_t i = 0; i < c->count; i++) grown[i] = c->pending[(c->head + i) % c->cap];
+            free(c->pending);
+            c->pending = grown;
+            c->head = 0;
+            c->cap = cap;
+        }
+    }
+    if (ret != 0) {
+        c->out_len = mark;
+        fprintf(stderr, "mkc 内存分配失败 ❌\n");
+        return -1;
+    }
+    c->pending[(c->head + c->count) % c->cap] = (mkc_pending_t){cb, ctx};
+    c->count++;
+    if (c->out_len - c->out_pos >= MKC_FLUSH_HIGH) mkc_flush(c);
+    return 0;
+}
+
+// 发送请求前检查连接
+static int mkc_check(const mkc_t *c) {
+    if (c == NULL || c->state == MKC_CLOSED) {
+        fprintf(stderr, "mkc 连接已关闭 ❌\n");
+        return -1;
+    }
+    return 0;
+}
+
+// 发送任意命令
+int mkc_command(mkc_t *c, size_t argc, const char *const *argv, const size_t *lens, mkc_callback_t cb, void *ctx) {
+    if (mkc_check(c) != 0 || argc == 0 || argv == NULL) return -1;
+    size_t mark = c->out_len;
+    int ret = mkc_begin(c, argc);
+    for (size_t i = 0; i < argc && ret == 0; i++) {
+        ret = mkc_arg(c, argv[i], lens ? lens[i] : strlen(argv[i]));
+    }
+    return mkc_end(c, mark, ret, cb, ctx);
+}
+
+int mkc_get(mkc_t *c, const char *key, mkc_callback_t cb, void *ctx) {
+    if (mkc_check(c) != 0 || key == NULL) return -1;
+    size_t mark = c->out_len;
+    int ret = mkc_begin(c, 2) | mkc_arg(c, "GET", 3) | mkc_arg(c, key, strlen(key));
+    return mkc_end(c, mark, ret, cb, ctx);
+}
+
+int mkc_put(mkc_t *c, const char *key, const void *value, size_t len, mkc_callback_t cb, void *ctx) {
+    if (mkc_check(c) != 0 || key == NULL || (value == NULL && len > 0)) return -1;
+    size_t mark = c->out_len;
+    int ret = mkc_begin(c, 3) | mkc_arg(c, "PUT", 3) | mkc_arg(c, key, strlen(key)) | mkc_arg(c, value, len);
+    return mkc_end(c, mark, ret, cb, ctx);
+}
+
+int mkc_del(mkc_t *c, const char *key, mkc_callback_t cb, void *ctx) {
+    if (mkc_check(c) != 0 || key == NULL) return -1;
+    size_t mark = c->out_len;
+    int ret = mkc_begin(c, 2) | mkc_arg(c, "DEL", 3) | mkc_arg(c, key, strlen(key));
+    return mkc_end(c, mark, ret, cb, ctx);
+}
+
+int mkc_incrby(mkc_t *c, const char *key, int64_t delta, mkc_callback_t cb, void *ctx) {
+    if (mkc_check(c) != 0 || key == NULL) return -1;
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%lld", (long long)delta);
+    size_t mark = c->out_len;
+    int ret = mkc_begin(c, 3) | mkc_arg(c, "INCRBY", 6) | mkc_arg(c, key, strlen(key)) | mkc_arg(c, num, (size_t)n);
+    return mkc_end(c, mark, ret, cb, ctx);
+}
+
+int mkc_mget(mkc_t *c, size_t n, const char *const *keys, mkc_callback_t cb, void *ctx) {
+    if (mkc_check(c) != 0 || n == 0 || keys == NULL) return -1;
+    size_t mark = c->out_len;
+    int ret = mkc_begin(c, n + 1) | mkc_arg(c, "MGET", 4);
+    for (size_t i = 0; i < n && ret == 0; i++) ret = mkc_arg(c, keys[i], strlen(keys[i]));
+    return mkc_end(c, mark, ret, cb, ctx);
+}
+
+int mkc_mset(mkc_t *c, size_t n, const char *const *keys, const void *const *values, const size_t *lens, mkc_callback_t cb, void *ctx) {
+    if (mkc_check(c) != 0 || n == 0 || keys == NULL || values == NULL || lens == NULL) return -1;
+    size_t mark = c->out_len;
+    int ret = mkc_begin(c, 2 * n + 1) | mkc_arg(c, "MSET", 4);
+    for (size_t i = 0; i < n && ret == 0; i++) {
+        ret = mkc_arg(c, keys[i], strlen(keys[i])) | mkc_arg(c, values[i], lens[i]);
+    }
+    return mkc_end(c, mark, ret, cb, ctx);
+}
+
+// 深拷贝回复，内存不足时变为没有信息的错误回复
+static void mkc_reply_copy(mkc_reply_t *dst, const mkc_reply_t *src) {
+    *dst = *src;
+    dst->str = NULL;
+    dst->element = NULL;
+    dst->elements = 0;
+    if (src->str != NULL) {
+        char *s = malloc(src->len + 1);
+        if (s == NULL) {
+            dst->type = MKC_REPLY_ERROR;
+            dst->len = 0;
+            return;
+        }
+        memcpy(s, src->str, src->len);
+        s[src->len] = '\0';
+        dst->str = s;
+    }
+    if (src->elements > 0) {
+        mkc_reply_t *elems = calloc(src->elements, sizeof(mkc_reply_t));
+        if (elems == NULL) {
+            dst->type = MKC_REPLY_ERROR;
+            return;
+        }
+        for (size_t i = 0; i < src->elements; i++) mkc_reply_copy(&elems[i], &src->element[i]);
+        dst->element = elems;
+        dst->elements = src->elements;
+    }
+}
+
+// 释放拷贝出来的回复
+static void mkc_reply_release(mkc_reply_t *r) {
+    for (size_t i = 0; i < r->elements; i++) mkc_reply_release((mkc_reply_t *)&r->element[i]);
+    free((void *)r->element);
+    free((void *)r->str);
+    memset(r, 0, sizeof(*r));
+}
+
+void mkc_future_cb(mkc_t *c, const mkc_reply_t *reply, void *future) {
+    (void)c;
+    mkc_future_t *f = future;
+    mkc_reply_copy(&f->reply, reply);
+    f->done = 1;
+}
+
+void mkc_future_free(mkc_future_t *f) {
+    if (f == NULL) return;
+    mkc_reply_release(&f->reply);
+    f->done = 0;
+}
@@ -0,0 +1,137 @@
+#include "../include/minikv.h"
+#include <stdint.h>
+#include <string.h>
+
+// 内置的LZ77族压缩算法（格式与LZF相同）
+// 控制字节 < 32：后面跟着 ctrl+1 个字面字节
+// 控制字节 >= 32：回引用，高3位为长度-2（等于7时再读一个字节累加），
+//                 低5位与下一字节组成 偏移-1（最大8191）
+
+#define MK_LZ_HLOG 13                          // 哈希表大小为 2^13
+#define MK_LZ_MAX_LIT (1 << 5)                 // 一段字面量的最大长度
+#define MK_LZ_MAX_OFF (1 << 13)                // 回引用的最大偏移
+#define MK_LZ_MAX_REF ((1 << 8) + (1 << 3))    // 回引用的最大长度
+
+// 取3个字节计算哈希槽位
+static inline uint32_t mk_lz_hash(const uint8_t *p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - MK_LZ_HLOG);
+}
+
+// 压缩in中的in_len个字节到out，返回压缩后的长度
+// 输出超过out_cap（即数据不可压缩）时返回0
+size_t mk_lz_compress(const void *in, size_t in_len, void *out, size_t out_cap) {
+    const uint8_t *ip = (const uint8_t *)in;
+    const uint8_t *in_end = ip + in_len;
+    uint8_t *op = (uint8_t *)out;
+    uint8_t *out_end = op + out_cap;
+    uint32_t htab[1 << MK_LZ_HLOG];// 记录每个哈希槽最近一次出现的位置
+    int lit = 0;
+
+    if (in_len == 0 || out_cap < 2) return 0;
+    memset(htab, 0, sizeof(htab));
+
+    op++;// 预留第一段字面量的控制字节
+    while (in_len > 2 && ip < in_end - 2) {
+        uint32_t slot = mk_lz_hash(ip);
+        const uint8_t *ref = (const uint8_t *)in + htab[slot];
+        htab[slot] = (uint32_t)(ip - (const uint8_t *)in);
+        size_t off = (size_t)(ip - ref) - 1;
+
+        if (ref < ip && off < MK_LZ_MAX_OFF &&
+            ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2]) {
+            // 找到匹配，计算匹配长度
+            size_t len = 2;
+            size_t maxlen = (size_t)(in_end - ip) - len;
+            if (maxlen > MK_LZ_MAX_REF) maxlen = MK_LZ_MAX_REF;
+
+            if (op - !lit + 3 + 1 >= out_end) return 0;
+
+            op[-lit - 1] = (uint8_t)(lit - 1);// 结束当前字面量段
+            op -= !lit;// 字面量段为空时撤销预留的控制字节
+
+            do {
+                len++;
+            } while (len < maxlen && ref[len] == ip[len]);
+
+            len -= 2;// 写入的长度字段为 匹配字节数-2
+            ip++;
+
+            if (len < 7) {
+                *op++ = (uint8_t)((off >> 8) + (len << 5));
+            } else {
+                *op++ = (uint8_t)((off >> 8) + (7 << 5));
+                *op++ = (uint8_t)(len - 7);
+            }
+            *op++ = (uint8_t)off;
+
+            lit = 0;
+            op++;// 预留下一段字面量的控制字节
+            ip += len + 1;
+        } else {
+            // 没有匹配，输出一个字面字节
+            if (op >= out_end) return 0;
+            lit++;
+            *op++ = *ip++;
+            if (lit == MK_LZ_MAX_LIT) {
+                op[-lit - 1] = (uint8_t)(lit - 1);
+                lit = 0;
+                op++;
+            }
+        }
+    }
+
+    // 末尾不足3字节的部分按字面量输出
+    while (ip < in_end) {
+        if (op >= out_end) return 0;
+        lit++;
+        *op++ = *ip++;
+        if (lit == MK_LZ_MAX_LIT) {
+            op[-lit - 1] = (uint8_t)(lit - 1);
+            lit = 0;
+            op++;
+        }
+    }
+
+    op[-lit - 1] = (uint8_t)(lit - 1);
+    op -= !lit;
+    if (op > out_end) return 0;
+    return (size_t)(op - (uint8_t *)out);
+}
+
+// 解压in中的in_len个字节到out，返回解压后的长度，数据损坏或out_cap不足时返回0
+size_t mk_lz_decompress(const void *in, size_t in_len, void *out, size_t out_cap) {
+    const uint8_t *ip = (const uint8_t *)in;
+    const uint8_t *in_end = ip + in_len;
+    uint8_t *op = (uint8_t *)out;
+    uint8_t *out_end = op + out_cap;
+
+    while (ip < in_end) {
+        size_t ctrl = *ip++;
+
+        if (ctrl < MK_LZ_MAX_LIT) {
+            // 字面量段
+            ctrl++;
+            if (op + ctrl > out_end || ip + ctrl > in_end) return 0;
+            memcpy(op, ip, ctrl);
+            op += ctrl;
+            ip += ctrl;
+        } else {
+            // 回引用
+            size_t len = ctrl >> 5;
+            if (ip >= in_end) return 0;
+            if (len == 7) {
+                len += *ip++;
+                if (ip >= in_end) return 0;
+            }
+            size_t off = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+            len += 2;
+            if (op + len > out_end || off > (size_t)(op - (uint8_t *)out)) return 0;
+
+            // 源和目标可能重叠，逐字节复制
+            const uint8_t *ref = op - off;
+            while (len--) *op++ = *ref++;
+        }
+    }
+    return (size_t)(op - (uint8_t *)out);
+}
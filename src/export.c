@@ -0,0 +1,242 @@
+#include "../include/minikv.h"
+#include <ctype.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+// 遍历与导出
+// mk_foreach把键值对交给调用方的回调，不经过stdio；mk_export/mk_export_sorted把键值对
+// 以mk_save的格式写入缓冲输出（文件描述符或内存），记录直接复制进缓冲区，攒满一块才写出一次。
+
+#define MK_SINK_BUF_SIZE (64 * 1024)// 输出到fd时的缓冲区大小
+
+// 初始化输出到fd的缓冲输出
+int mk_sink_fd(mk_sink_t *sink, int fd) {
+    if (sink == NULL || fd < 0) {
+        fprintf(stderr, "mk_sink_fd 无效的参数 ❌\n");
+        return -1;
+    }
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = fd;
+    sink->buf = malloc(MK_SINK_BUF_SIZE);
+    if (sink->buf == NULL) {
+        perror("mk_sink_fd 内存分配失败");
+        return -1;
+    }
+    sink->cap = MK_SINK_BUF_SIZE;
+    return 0;
+}
+
+// 初始化输出到内存的缓冲输出：导出的内容在sink->buf中，长度为sink->len，由mk_sink_free释放
+int mk_sink_mem(mk_sink_t *sink) {
+    if (sink == NULL) {
+        fprintf(stderr, "mk_sink_mem 无效的参数 ❌\n");
+        return -1;
+    }
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = -1;
+    return 0;
+}
+
+// 把数据全部写到fd（处理被信号打断和部分写入）
+static int mk_sink_write_fd(mk_sink_t *sink, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(sink->fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            perror("mk_sink 写入失败");
+            sink->error = 1;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// 把缓冲的数据写出到fd（输出到内存时无操作）
+int mk_sink_flush(mk_sink_t *sink) {
+    if (sink->error) return -1;
+    if (sink->fd < 0 || sink->len == 0) return 0;
+    int ret = mk_sink_write_fd(sink, sink->buf, sink->len);
+    sink->len = 0;
+    return ret;
+}
+
+// 写入数据；出错后sink->error置1，之后的写入直接返回-1
+int mk_sink_write(mk_sink_t *sink, const void *data, size_t len) {
+    if (sink->error) return -1;
+    if (sink->len + len > sink->cap) {
+        if (sink->fd >= 0) {
+            if (mk_sink_flush(sink) != 0) return -1;
+            // 比缓冲区还大的数据直接写出，不再复制
+            if (len >= sink->cap) return mk_sink_write_fd(sink, data, len);
+        } else {
+            size_t ncap = sink->cap ? sink->cap * 2 : MK_SINK_BUF_SIZE;
+            while (ncap < sink->len + len) ncap *= 2;
+            char *grown = realloc(sink->buf, ncap);
+            if (grown == NULL) {
+                perror("mk_sink 内存分配失败");
+                sink->error = 1;
+                return -1;
+            }
+            sink->buf = grown;
+            sink->cap = ncap;
+        }
+    }
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    return 0;
+}
+
+// 释放缓冲区（不写出剩余数据，也不关闭fd）
+void mk_sink_free(mk_sink_t *sink) {
+    if (sink == NULL) return;
+    free(sink->buf);
+    sink->buf = NULL;
+    sink->len = 0;
+    sink->cap = 0;
+}
+
+// 按哈希桶顺序（开启磁盘层时按key升序）遍历所有键值对，cb返回非0时提前结束并返回该值
+// 未开启磁盘层时在快照上遍历，期间写操作不受影响；开启磁盘层时持有全部读锁
+// cb执行期间持有分段读锁，不能在cb中修改同一张表
+int mk_foreach(const mk_t *mk, int (*cb)(const char *key, size_t klen, const char *value, size_t vlen, void *ctx), void *ctx) {
+    if (mk == NULL || cb == NULL) {
+        fprintf(stderr, "mk_foreach 无效的参数 ❌\n");
+        return -1;
+    }
+    if (mk->lsm != NULL) {
+        mk_lock_all(mk, 0);
+        int ret = mk_lsm_scan(mk, cb, ctx);
+        mk_unlock_all(mk);
+        return ret;
+    }
+    mk_snapshot_t *snap = mk_snapshot_begin(mk);
+    if (snap == NULL) return -1;
+    int ret = mk_snapshot_foreach(snap, cb, ctx);
+    mk_snapshot_end(snap);
+    return ret;
+}
+
+// 判断value能否按 key=value 文本格式保存（不含换行/'\0'，且首尾没有会被trim掉的空白）
+static int mk_value_is_text(const char *value, size_t len) {
+    if (len == 0) return 1;
+    if (isspace((unsigned char)value[0]) || isspace((unsigned char)value[len - 1])) return 0;
+    return memchr(value, '\n', len) == NULL && memchr(value, '\r', len) == NULL && memchr(value, '\0', len) == NULL;
+}
+
+// 按mk_save的格式写出一条键值对
+static int mk_export_record(const char *key, size_t klen, const char *value, size_t vlen, void *ctx) {
+    mk_sink_t *sink = ctx;
+    if (mk_value_is_text(value, vlen)) {
+        mk_sink_write(sink, key, klen);
+        mk_sink_write(sink, "=", 1);
+        mk_sink_write(sink, value, vlen);
+        return mk_sink_write(sink, "\n", 1);
+    }
+    // 含换行、'\0'或首尾空白的value按长度写出原始字节
+    char head[24];
+    head[0] = ':';
+    head[1] = '=';
+    size_t n = 2 + mk_ll2str(head + 2, (int64_t)vlen);
+    head[n++] = '\n';
+    mk_sink_write(sink, key, klen);
+    mk_sink_write(sink, head, n);
+    mk_sink_write(sink, value, vlen);
+    return mk_sink_write(sink, "\n", 1);
+}
+
+// 按mk_foreach的顺序导出所有键值对（mk_load可以读取的格式），结束时写出缓冲的数据
+int mk_export(const mk_t *mk, mk_sink_t *sink) {
+    if (mk == NULL || sink == NULL) {
+        fprintf(stderr, "mk_export 无效的参数 ❌\n");
+        return -1;
+    }
+    if (mk_foreach(mk, mk_export_record, sink) != 0) return -1;
+    return mk_sink_flush(sink);
+}
+
+// 排序导出时收集的键值对：所有记录连续存放在一块内存中（key '\0' vlen value），只对位置排序
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    size_t *offs;                      // 每条记录的起始位置
+    size_t count;
+    size_t offs_cap;
+} mk_export_arena_t;
+
+// mk_foreach回调：把一条键值对追加到收集区
+static int mk_export_collect(const char *key, size_t klen, const char *value, size_t vlen, void *ctx) {
+    mk_export_arena_t *a = ctx;
+    size_t need = klen + 1 + sizeof(uint64_t) + vlen;
+    if (a->len + need > a->cap) {
+        size_t ncap = a->cap ? a->cap * 2 : MK_SINK_BUF_SIZE;
+        while (ncap < a->len + need) ncap *= 2;
+        char *grown = realloc(a->data, ncap);
+        if (grown == NULL) return -1;
+        a->data = grown;
+        a->cap = ncap;
+    }
+    if (a->count == a->offs_cap) {
+        size_t ncap = a->offs_cap ? a->offs_cap * 2 : 1024;
+        size_t *grown = realloc(a->offs, ncap * sizeof(size_t));
+        if (grown == NULL) return -1;
+        a->offs = grown;
+        a->offs_cap = ncap;
+    }
+    a->offs[a->count++] = a->len;
+    char *p = a->data + a->len;
+    uint64_t len64 = vlen;
+    memcpy(p, key, klen + 1);
+    memcpy(p + klen + 1, &len64, sizeof(len64));
+    memcpy(p + klen + 1 + sizeof(len64), value, vlen);
+    a->len += need;
+    return 0;
+}
+
+// 比较函数，用于qsort按key升序/降序排序（元素为指向记录开头的指针）
+static int mk_export_cmp_asc(const void *a, const void *b) {
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static int mk_export_cmp_desc(const void *a, const void *b) {
+    return strcmp(*(const char * const *)b, *(const char * const *)a);
+}
+
+// 按key排序导出所有键值对，desc为1时降序，结束时写出缓冲的数据
+// 开启磁盘层时升序导出直接流式写出；其余情况先在快照上收集到一块连续内存，排序后写出
+int mk_export_sorted(const mk_t *mk, mk_sink_t *sink, int desc) {
+    if (mk == NULL || sink == NULL) {
+        fprintf(stderr, "mk_export_sorted 无效的参数 ❌\n");
+        return -1;
+    }
+    if (mk->lsm != NULL && !desc) return mk_export(mk, sink);
+
+    mk_export_arena_t a = {0};
+    int ret = mk_foreach(mk, mk_export_collect, &a);
+    // 收集完成后缓冲区不再移动，位置换成指针再排序
+    const char **keys = (ret == 0 && a.count > 0) ? malloc(a.count * sizeof(char *)) : NULL;
+    if (ret != 0 || (a.count > 0 && keys == NULL)) {
+        perror("mk_export_sorted 内存分配失败");
+        free(a.data);
+        free(a.offs);
+        return -1;
+    }
+    for (size_t i = 0; i < a.count; i++) keys[i] = a.data + a.offs[i];
+    free(a.offs);
+    if (a.count > 0) qsort(keys, a.count, sizeof(char *), desc ? mk_export_cmp_desc : mk_export_cmp_asc);
+
+    for (size_t i = 0; i < a.count && ret == 0; i++) {
+        size_t klen = strlen(keys[i]);
+        uint64_t vlen = 0;
+        memcpy(&vlen, keys[i] + klen + 1, sizeof(vlen));
+        const char *value = keys[i] + klen + 1 + sizeof(vlen);
+        ret = mk_export_record(keys[i], klen, value, (size_t)vlen, sink);
+    }
+    free(keys);
+    free(a.data);
+    if (ret != 0) return -1;
+    return mk_sink_flush(sink);
+}
@@ -0,0 +1,197 @@
+#include "../include/minikv.h"
+#include <string.h>
+
+// 热点key统计
+// 读写操作按采样间隔抽样，抽中的key在count-min sketch中计数（估计值只会偏大），
+// 再用一个按计数排列的小顶堆保留估计次数最多的k个key。sketch和堆的大小固定，
+// 内存占用与key的数量无关；没有抽中的操作只多一次线程局部计数。
+
+typedef struct {
+    uint64_t h;                        // key的64位哈希（识别同一个key）
+    uint64_t count;                    // sketch估计的采样次数
+    char key[128];                     // key（过长时截断）
+} mk_hot_entry_t;
+
+struct mk_hot {
+    uint32_t rate;                     // 采样间隔：每rate次操作采样一次
+    size_t k;                          // 跟踪的热点key个数
+    uint64_t samples;                  // 累计采样次数（原子操作）
+    uint32_t sketch[MK_HOT_DEPTH][MK_HOT_WIDTH];// 计数器（原子操作）
+    pthread_mutex_t mu;                // 保护小顶堆
+    uint64_t heap_min;                 // 堆满时堆顶的计数，未满时为0（锁外原子读取，用于快速过滤）
+    size_t size;                       // 堆中的key个数
+    mk_hot_entry_t heap[MK_HOT_TOPK_MAX];// 按count排列的小顶堆
+};
+
+static __thread uint32_t mk_hot_tick;// 当前线程距上次采样的操作数
+
+// 交换堆中的两个元素
+static void mk_hot_swap(mk_hot_entry_t *a, mk_hot_entry_t *b) {
+    mk_hot_entry_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+// 计数变大的元素向下调整
+static void mk_hot_sift_down(mk_hot_t *hot, size_t i) {
+    while (1) {
+        size_t l = 2 * i + 1, r = l + 1, min = i;
+        if (l < hot->size && hot->heap[l].count < hot->heap[min].count) min = l;
+        if (r < hot->size && hot->heap[r].count < hot->heap[min].count) min = r;
+        if (min == i) return;
+        mk_hot_swap(&hot->heap[i], &hot->heap[min]);
+        i = min;
+    }
+}
+
+// 新加入的元素向上调整
+static void mk_hot_sift_up(mk_hot_t *hot, size_t i) {
+    while (i > 0 && hot->heap[(i - 1) / 2].count > hot->heap[i].count) {
+        mk_hot_swap(&hot->heap[i], &hot->heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+}
+
+// 堆满时记下堆顶计数，供锁外过滤（调用方持有hot->mu）
+static void mk_hot_update_min(mk_hot_t *hot) {
+    MK_ATOMIC_STORE(hot->heap_min, hot->size == hot->k ? hot->heap[0].count : 0);
+}
+
+// 所有计数减半，让统计只反映近期的访问（减半不改变堆中元素的相对顺序）
+static void mk_hot_decay(mk_hot_t *hot) {
+    pthread_mutex_lock(&hot->mu);
+    for (int i = 0; i < MK_HOT_DEPTH; i++) {
+        for (int j = 0; j < MK_HOT_WIDTH; j++) {
+            // 与并发的计数相比只是少算几次，估计值本身就是近似的
+            MK_ATOMIC_STORE(hot->sketch[i][j], MK_ATOMIC_LOAD(hot->sketch[i][j]) >> 1);
+        }
+    }
+    for (size_t i = 0; i < hot->size; i++) hot->heap[i].count >>= 1;
+    mk_hot_update_min(hot);
+    pthread_mutex_unlock(&hot->mu);
+}
+
+// 开启（sample_rate > 0）或关闭（sample_rate == 0）热点key统计，重新开启时清空之前的统计
+int mk_hotkeys_enable(mk_t *mk, uint32_t sample_rate, size_t k) {
+    if (mk == NULL || (sample_rate > 0 && (k == 0 || k > MK_HOT_TOPK_MAX))) {
+        fprintf(stderr, "mk_hotkeys_enable 无效的参数 ❌\n");
+        return -1;
+    }
+    mk_hot_t *hot = NULL;
+    if (sample_rate > 0) {
+        hot = calloc(1, sizeof(mk_hot_t));
+        if (hot == NULL) {
+            perror("mk_hotkeys_enable 内存分配失败");
+            return -1;
+        }
+        hot->rate = sample_rate;
+        hot->k = k;
+        pthread_mutex_init(&hot->mu, NULL);
+    }
+
+    // 读写操作都在分段锁内使用统计，持有全部写锁时替换不会与它们冲突
+    mk_lock_all(mk, 1);
+    mk_hot_t *old = mk->hot;
+    mk->hot = hot;
+    mk_unlock_all(mk);
+
+    if (old != NULL) {
+        pthread_mutex_destroy(&old->mu);
+        free(old);
+    }
+    return 0;
+}
+
+// 记录一次对validKey的访问（调用方持有key所在分段的锁）
+void mk_hotkeys_touch(const mk_t *mk, const char *validKey) {
+    mk_hot_t *hot = mk->hot;
+    if (hot == NULL) return;
+    if (++mk_hot_tick < hot->rate) return;
+    mk_hot_tick = 0;
+
+    // 在每行中计数，估计值取各行的最小值
+    size_t klen = strlen(validKey);
+    uint64_t h = mk_hash64(validKey, klen);
+    uint64_t h2 = (h >> 32) | 1;
+    uint64_t est = UINT32_MAX;
+    for (int i = 0; i < MK_HOT_DEPTH; i++) {
+        uint32_t c = MK_ATOMIC_ADD(hot->sketch[i][(h + (uint64_t)i * h2) % MK_HOT_WIDTH], 1);
+        if (c < est) est = c;
+    }
+    if (MK_ATOMIC_ADD(hot->samples, 1) % MK_HOT_DECAY == 0) mk_hot_decay(hot);
+
+    // 堆已满且估计值进不了前k名时不加锁
+    if (est <= MK_ATOMIC_LOAD(hot->heap_min)) return;
+
+    pthread_mutex_lock(&hot->mu);
+    size_t i = 0;
+    while (i < hot->size && hot->heap[i].h != h) i++;
+    if (i < hot->size) {
+        // 已在堆中，更新计数
+        if (est > hot->heap[i].count) {
+            hot->heap[i].count = est;
+            mk_hot_sift_down(hot, i);
+        }
+    } else if (hot->size < hot->k || est > hot->heap[0].count) {
+        // 堆未满时加入，否则替换堆顶计数最小的key
+        if (hot->size < hot->k) {
+            i = hot->size++;
+        } else {
+            i = 0;
+        }
+        mk_hot_entry_t *e = &hot->heap[i];
+        e->h = h;
+        e->count = est;
+        if (klen >= sizeof(e->key)) klen = sizeof(e->key) - 1;
+        memcpy(e->key, validKey, klen);
+        e->key[klen] = '\0';
+        if (i == 0 && hot->size == hot->k) mk_hot_sift_down(hot, 0);
+        else mk_hot_sift_up(hot, i);
+    }
+    mk_hot_update_min(hot);
+    pthread_mutex_unlock(&hot->mu);
+}
+
+// 按计数降序排序
+static int mk_hot_cmp_desc(const void *a, const void *b) {
+    uint64_t ca = ((const mk_hot_entry_t *)a)->count;
+    uint64_t cb = ((const mk_hot_entry_t *)b)->count;
+    return (ca < cb) - (ca > cb);
+}
+
+// 获取近期访问最多的n个key，按估计次数降序写入out，返回个数（未开启时返回0）
+size_t mk_hotkeys(const mk_t *mk, mk_hotkey_t *out, size_t n) {
+    if (mk == NULL || (out == NULL && n > 0)) {
+        fprintf(stderr, "mk_hotkeys 无效的参数 ❌\n");
+        return 0;
+    }
+    size_t found = 0;
+    mk_hot_entry_t copy[MK_HOT_TOPK_MAX];
+    // 开关统计需要全部写锁，持有任意一个分段的读锁即可保证统计不会被释放
+    pthread_rwlock_rdlock(mk_stripe(mk, 0));
+    mk_hot_t *hot = mk->hot;
+    if (hot != NULL) {
+        pthread_mutex_lock(&hot->mu);
+        size_t size = hot->size;
+        memcpy(copy, hot->heap, size * sizeof(mk_hot_entry_t));
+        pthread_mutex_unlock(&hot->mu);
+
+        qsort(copy, size, sizeof(mk_hot_entry_t), mk_hot_cmp_desc);
+        for (size_t i = 0; i < size && found < n; i++) {
+            if (copy[i].count == 0) break;
+            memcpy(out[found].key, copy[i].key, sizeof(out[found].key));
+            out[found].count = copy[i].count * hot->rate;
+            found++;
+        }
+    }
+    pthread_rwlock_unlock(mk_stripe(mk, 0));
+    return found;
+}
+
+// 释放热点key统计（销毁Hash表时调用）
+void mk_hotkeys_free(mk_t *mk) {
+    if (mk->hot == NULL) return;
+    pthread_mutex_destroy(&mk->hot->mu);
+    free(mk->hot);
+    mk->hot = NULL;
+}
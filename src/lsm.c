@@ -0,0 +1,1124 @@
+#include "../include/minikv.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// 磁盘层（LSM）：Hash表作为内存表，写满后按key排序刷成不可变的磁盘表（SSTable）
+// 磁盘表分两层：L0 为每次刷盘生成的表（key范围互相重叠，新表优先）；
+// L1 为后台合并生成的一张有序表。查找顺序：内存表 -> 正在刷盘的内存表 -> L0(新到旧) -> L1
+//
+// 磁盘表文件格式（整数均为本机字节序）：
+//   数据块：若干条记录 [u32 klen][u32 vlen][u64 version][key][value]，vlen为MK_SST_TOMBSTONE表示删除标记，
+//           version为写入时的版本号，刷盘和合并都原样保留
+//   块索引：[u32 块数] 每块 [u64 偏移][u32 长度][u32 首key长度][首key]
+//   布隆过滤器：bloom_bits 位
+//   文件尾：mk_sst_footer_t
+
+#define MK_SST_MAGIC 0x3230305453534b4dull   // "MKSST002"
+#define MK_SST_REC_HDR 16                     // 记录头：klen、vlen和version
+#define MK_SST_BLOCK_SIZE 4096                // 数据块的目标大小
+#define MK_SST_TOMBSTONE 0xffffffffu          // 删除标记
+#define MK_BLOOM_BITS_PER_KEY 10              // 布隆过滤器每个key占用的位数
+#define MK_BLOOM_K 7                          // 布隆过滤器哈希函数个数
+
+// 文件尾
+typedef struct {
+    uint64_t index_off;                // 块索引偏移
+    uint64_t index_len;                // 块索引长度
+    uint64_t bloom_off;                // 布隆过滤器偏移
+    uint64_t bloom_bits;               // 布隆过滤器位数
+    uint64_t entries;                  // 记录条数
+    uint64_t max_version;              // 记录中最大的版本号
+    uint64_t magic;                    // 魔数
+} mk_sst_footer_t;
+
+// 块索引项
+typedef struct {
+    char *first_key;                   // 块内第一个key
+    uint64_t off;                      // 块在文件中的偏移
+    uint32_t len;                      // 块长度
+} mk_sst_block_t;
+
+// 一张已打开的磁盘表
+typedef struct {
+    uint64_t id;                       // 文件编号（越大越新）
+    int level;                         // 所在层（0或1）
+    int fd;                            // 文件描述符（用pread读取，可多线程共享）
+    char *path;                        // 文件路径
+    mk_sst_block_t *blocks;            // 块索引
+    size_t nblocks;                    // 块数
+    uint8_t *bloom;                    // 布隆过滤器
+    uint64_t bloom_bits;               // 布隆过滤器位数
+    uint64_t entries;                  // 记录条数
+    uint64_t max_version;              // 记录中最大的版本号
+    uint64_t file_size;                // 文件大小
+} mk_sst_t;
+
+// 磁盘层
+struct mk_lsm {
+    char *dir;                         // 磁盘表所在目录
+    size_t memtable_limit;             // 内存表占用超过该字节数时刷盘
+    pthread_rwlock_t lock;             // 保护下面的表列表和imm（查找持读锁，替换持写锁）
+    mk_node_t **imm;                   // 正在刷盘的内存表（从哈希桶整体摘下，不再修改），没有时为NULL
+    mk_sst_t **l0;                     // L0表，新表在前
+    size_t l0_count;
+    size_t l0_cap;
+    mk_sst_t *l1;                      // L1表，可能为NULL
+    uint64_t next_id;                  // 下一个文件编号
+    pthread_mutex_t flush_mutex;       // 保证同一时间只有一个刷盘在进行
+    pthread_mutex_t compact_mutex;     // 保证同一时间只有一个合并在进行
+    pthread_mutex_t bg_mutex;          // 后台合并线程的等待锁
+    pthread_cond_t bg_cond;
+    pthread_t bg_thread;
+    int bg_stop;                       // 通知后台线程退出
+    mk_lsm_stats_t stats;              // 统计（计数器用原子操作更新）
+};
+
+// 统计计数加一（查找可能发生在多个线程）
+#define MK_LSM_STAT_INC(lsm, field) MK_ATOMIC_ADD((lsm)->stats.field, 1)
+
+// 布隆过滤器：双重哈希计算第i个位
+static inline uint64_t mk_bloom_bit(uint64_t h, int i, uint64_t nbits) {
+    uint64_t h2 = (h >> 33) | 1;
+    return (h + (uint64_t)i * h2) % nbits;
+}
+
+// 布隆过滤器判断key可能存在返回1，一定不存在返回0
+static int mk_bloom_may_contain(const mk_sst_t *t, uint64_t h) {
+    if (t->bloom_bits == 0) return 1;
+    for (int i = 0; i < MK_BLOOM_K; i++) {
+        uint64_t bit = mk_bloom_bit(h, i, t->bloom_bits);
+        if ((t->bloom[bit >> 3] & (1u << (bit & 7))) == 0) return 0;
+    }
+    return 1;
+}
+
+// 比较两个带长度的key
+static int mk_key_cmp(const char *a, size_t alen, const char *b, size_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c != 0) return c;
+    return (alen < blen) ? -1 : (alen > blen);
+}
+
+// 读满len个字节
+static int mk_pread_full(int fd, void *buf, size_t len, uint64_t off) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, (char *)buf + done, len - done, (off_t)(off + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+// 拼出磁盘表文件路径
+static char *mk_sst_path(const char *dir, int level, uint64_t id, const char *suffix) {
+    size_t len = strlen(dir) + 64;
+    char *path = malloc(len);
+    if (path == NULL) return NULL;
+    snprintf(path, len, "%s/L%d-%06llu.sst%s", dir, level, (unsigned long long)id, suffix);
+    return path;
+}
+
+// 关闭磁盘表，unlink非0时同时删除文件
+static void mk_sst_close(mk_sst_t *t, int unlink_file) {
+    if (t == NULL) return;
+    if (t->fd >= 0) close(t->fd);
+    if (unlink_file) unlink(t->path);
+    for (size_t i = 0; i < t->nblocks; i++) free(t->blocks[i].first_key);
+    free(t->blocks);
+    free(t->bloom);
+    free(t->path);
+    free(t);
+}
+
+// 打开磁盘表，把块索引和布隆过滤器读进内存
+static mk_sst_t *mk_sst_open(const char *path, int level, uint64_t id) {
+    mk_sst_t *t = calloc(1, sizeof(mk_sst_t));
+    if (t == NULL) return NULL;
+    t->fd = open(path, O_RDONLY);
+    t->path = strdup(path);
+    t->level = level;
+    t->id = id;
+    if (t->fd < 0 || t->path == NULL) goto fail;
+
+    struct stat st;
+    if (fstat(t->fd, &st) != 0 || (uint64_t)st.st_size < sizeof(mk_sst_footer_t)) goto fail;
+    t->file_size = (uint64_t)st.st_size;
+
+    mk_sst_footer_t footer;
+    if (mk_pread_full(t->fd, &footer, sizeof(footer), t->file_size - sizeof(footer)) != 0) goto fail;
+    if (footer.magic != MK_SST_MAGIC || footer.index_off + footer.index_len > t->file_size ||
+        footer.bloom_off + (footer.bloom_bits + 7) / 8 > t->file_size) goto fail;
+    t->entries = footer.entries;
+    t->max_version = footer.max_version;
+
+    // 读块索引
+    char *index = malloc(footer.index_len);
+    if (index == NULL) goto fail;
+    if (mk_pread_full(t->fd, index, footer.index_len, footer.index_off) != 0) {
+        free(index);
+        goto fail;
+    }
+    const char *p = index, *end = index + footer.index_len;
+    uint32_t nblocks = 0;
+    if (end - p >= 4) {
+        memcpy(&nblocks, p, 4);
+        p += 4;
+    }
+    t->blocks = calloc(nblocks ? nblocks : 1, sizeof(mk_sst_block_t));
+    if (t->blocks == NULL) {
+        free(index);
+        goto fail;
+    }
+    for (uint32_t i = 0; i < nblocks; i++) {
+        uint32_t klen;
+        if (end - p < 16) break;
+        memcpy(&t->blocks[i].off, p, 8);
+        memcpy(&t->blocks[i].len, p + 8, 4);
+        memcpy(&klen, p + 12, 4);
+        p += 16;
+        if ((size_t)(end - p) < klen) break;
+        t->blocks[i].first_key = malloc(klen + 1);
+        if (t->blocks[i].first_key == NULL) break;
+        memcpy(t->blocks[i].first_key, p, klen);
+        t->blocks[i].first_key[klen] = '\0';
+        p += klen;
+        t->nblocks++;
+    }
+    free(index);
+    if (t->nblocks != nblocks) goto fail;
+
+    // 读布隆过滤器
+    t->bloom_bits = footer.bloom_bits;
+    if (t->bloom_bits > 0) {
+        t->bloom = malloc((t->bloom_bits + 7) / 8);
+        if (t->bloom == NULL ||
+            mk_pread_full(t->fd, t->bloom, (t->bloom_bits + 7) / 8, footer.bloom_off) != 0) goto fail;
+    }
+    return t;
+
+fail:
+    fprintf(stderr, "mk_lsm 磁盘表 %s 打开失败 ❌\n", path);
+    mk_sst_close(t, 0);
+    return NULL;
+}
+
+// 在一张磁盘表中查找key
+// 找到value返回0（value为新分配的内存，version为写入时的版本号），遇到删除标记返回1，不存在返回2，出错返回-1
+static int mk_sst_get(mk_lsm_t *lsm, mk_sst_t *t, const char *key, size_t klen, uint64_t h,
+                      char **value, size_t *vlen, uint64_t *version) {
+    if (!mk_bloom_may_contain(t, h)) {
+        MK_LSM_STAT_INC(lsm, bloom_negatives);
+        return 2;
+    }
+
+    // 二分查找首key不大于key的最后一个块
+    size_t lo = 0, hi = t->nblocks;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (strcmp(t->blocks[mid].first_key, key) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return 2;
+    const mk_sst_block_t *blk = &t->blocks[lo - 1];
+
+    char *buf = malloc(blk->len);
+    if (buf == NULL) return -1;
+    if (mk_pread_full(t->fd, buf, blk->len, blk->off) != 0) {
+        free(buf);
+        return -1;
+    }
+    MK_LSM_STAT_INC(lsm, block_reads);
+
+    // 块内记录有序，顺序扫描
+    int ret = 2;
+    const char *p = buf, *end = buf + blk->len;
+    while (end - p >= MK_SST_REC_HDR) {
+        uint32_t rk, rv;
+        memcpy(&rk, p, 4);
+        memcpy(&rv, p + 4, 4);
+        const char *rkey = p + MK_SST_REC_HDR;
+        size_t rvlen = (rv == MK_SST_TOMBSTONE) ? 0 : rv;
+        if ((size_t)(end - rkey) < rk + rvlen) {
+            ret = -1;
+            break;
+        }
+        int c = mk_key_cmp(rkey, rk, key, klen);
+        if (c == 0) {
+            if (rv == MK_SST_TOMBSTONE) {
+                ret = 1;
+            } else {
+                *value = malloc(rvlen + 1);
+                if (*value == NULL) {
+                    ret = -1;
+                    break;
+                }
+                memcpy(*value, rkey + rk, rvlen);
+                (*value)[rvlen] = '\0';
+                *vlen = rvlen;
+                memcpy(version, p + 8, 8);
+                ret = 0;
+            }
+            break;
+        }
+        if (c > 0) break;
+        p = rkey + rk + rvlen;
+    }
+    free(buf);
+    return ret;
+}
+
+// ---------------- 磁盘表写入 ----------------
+
+typedef struct {
+    FILE *fp;
+    char *tmp_path;                    // 写入中的临时文件
+    char *path;                        // 完成后重命名成的文件
+    uint64_t off;                      // 已写入的字节数
+    char *block;                       // 当前数据块
+    size_t block_len;
+    size_t block_cap;
+    char *first_key;                   // 当前数据块的首key
+    char *index;                       // 块索引
+    size_t index_len;
+    size_t index_cap;
+    uint32_t nblocks;
+    uint64_t *hashes;                  // 所有key的哈希，最后生成布隆过滤器
+    size_t entries;
+    size_t hashes_cap;
+    uint64_t max_version;              // 已追加记录中最大的版本号
+    int error;
+} mk_sst_builder_t;
+
+// 向可增长缓冲区追加数据
+static int mk_buf_append(char **buf, size_t *len, size_t *cap, const void *data, size_t n) {
+    if (*len + n > *cap) {
+        size_t ncap = (*cap == 0) ? 256 : *cap;
+        while (ncap < *len + n) ncap *= 2;
+        char *grown = realloc(*buf, ncap);
+        if (grown == NULL) return -1;
+        *buf = grown;
+        *cap = ncap;
+    }
+    memcpy(*buf + *len, data, n);
+    *len += n;
+    return 0;
+}
+
+static int mk_sst_builder_init(mk_sst_builder_t *b, const char *dir, int level, uint64_t id) {
+    memset(b, 0, sizeof(*b));
+    b->path = mk_sst_path(dir, level, id, "");
+    b->tmp_path = mk_sst_path(dir, level, id, ".tmp");
+    if (b->path == NULL || b->tmp_path == NULL) return -1;
+    b->fp = fopen(b->tmp_path, "wb");
+    return (b->fp == NULL) ? -1 : 0;
+}
+
+// 把当前数据块写入文件并记录索引项
+static void mk_sst_builder_flush_block(mk_sst_builder_t *b) {
+    if (b->block_len == 0 || b->error) return;
+    if (fwrite(b->block, 1, b->block_len, b->fp) != b->block_len) {
+        b->error = 1;
+        return;
+    }
+    uint32_t len = (uint32_t)b->block_len;
+    uint32_t klen = (uint32_t)strlen(b->first_key);
+    if (mk_buf_append(&b->index, &b->index_len, &b->index_cap, &b->off, 8) != 0 ||
+        mk_buf_append(&b->index, &b->index_len, &b->index_cap, &len, 4) != 0 ||
+        mk_buf_append(&b->index, &b->index_len, &b->index_cap, &klen, 4) != 0 ||
+        mk_buf_append(&b->index, &b->index_len, &b->index_cap, b->first_key, klen) != 0) {
+        b->error = 1;
+    }
+    b->off += b->block_len;
+    b->nblocks++;
+    b->block_len = 0;
+    free(b->first_key);
+    b->first_key = NULL;
+}
+
+// 追加一条记录（key必须按升序追加），value为NULL表示删除标记
+static void mk_sst_builder_add(mk_sst_builder_t *b, const char *key, const char *value, size_t vlen, uint64_t version) {
+    if (b->error) return;
+    uint32_t rk = (uint32_t)strlen(key);
+    uint32_t rv = (value == NULL) ? MK_SST_TOMBSTONE : (uint32_t)vlen;
+
+    if (b->block_len == 0) {
+        b->first_key = strdup(key);
+        if (b->first_key == NULL) {
+            b->error = 1;
+            return;
+        }
+    }
+    if (mk_buf_append(&b->block, &b->block_len, &b->block_cap, &rk, 4) != 0 ||
+        mk_buf_append(&b->block, &b->block_len, &b->block_cap, &rv, 4) != 0 ||
+        mk_buf_append(&b->block, &b->block_len, &b->block_cap, &version, 8) != 0 ||
+        mk_buf_append(&b->block, &b->block_len, &b->block_cap, key, rk) != 0 ||
+        (value != NULL && mk_buf_append(&b->block, &b->block_len, &b->block_cap, value, vlen) != 0)) {
+        b->error = 1;
+        return;
+    }
+
+    if (b->entries == b->hashes_cap) {
+        size_t ncap = b->hashes_cap ? b->hashes_cap * 2 : 1024;
+        uint64_t *grown = realloc(b->hashes, ncap * sizeof(uint64_t));
+        if (grown == NULL) {
+            b->error = 1;
+            return;
+        }
+        b->hashes = grown;
+        b->hashes_cap = ncap;
+    }
+    b->hashes[b->entries++] = mk_hash64(key, rk);
+    if (version > b->max_version) b->max_version = version;
+
+    if (b->block_len >= MK_SST_BLOCK_SIZE) mk_sst_builder_flush_block(b);
+}
+
+// 写完索引、布隆过滤器和文件尾，落盘后重命名为正式文件
+// 成功返回0；没有任何记录时不生成文件并返回1
+static int mk_sst_builder_finish(mk_sst_builder_t *b) {
+    int ret = -1;
+    mk_sst_builder_flush_block(b);
+
+    if (!b->error && b->entries == 0) {
+        ret = 1;
+    } else if (!b->error) {
+        mk_sst_footer_t footer;
+        memset(&footer, 0, sizeof(footer));
+
+        // 块索引
+        footer.index_off = b->off;
+        footer.index_len = 4 + b->index_len;
+        fwrite(&b->nblocks, 4, 1, b->fp);
+        if (b->index_len > 0) fwrite(b->index, 1, b->index_len, b->fp);
+
+        // 布隆过滤器
+        footer.bloom_off = footer.index_off + footer.index_len;
+        footer.bloom_bits = (uint64_t)b->entries * MK_BLOOM_BITS_PER_KEY;
+        if (footer.bloom_bits < 64) footer.bloom_bits = 64;
+        size_t bloom_bytes = (footer.bloom_bits + 7) / 8;
+        uint8_t *bloom = calloc(bloom_bytes, 1);
+        if (bloom != NULL) {
+            for (size_t i = 0; i < b->entries; i++) {
+                for (int k = 0; k < MK_BLOOM_K; k++) {
+                    uint64_t bit = mk_bloom_bit(b->hashes[i], k, footer.bloom_bits);
+                    bloom[bit >> 3] |= (uint8_t)(1u << (bit & 7));
+                }
+            }
+            fwrite(bloom, 1, bloom_bytes, b->fp);
+            free(bloom);
+
+            footer.entries = b->entries;
+            footer.max_version = b->max_version;
+            footer.magic = MK_SST_MAGIC;
+            fwrite(&footer, sizeof(footer), 1, b->fp);
+            if (fflush(b->fp) == 0 && !ferror(b->fp) && fsync(fileno(b->fp)) == 0) ret = 0;
+        }
+    }
+
+    if (b->fp != NULL) fclose(b->fp);
+    if (ret == 0 && rename(b->tmp_path, b->path) != 0) ret = -1;
+    if (ret != 0 && b->tmp_path != NULL) unlink(b->tmp_path);
+    free(b->block);
+    free(b->first_key);
+    free(b->index);
+    free(b->hashes);
+    free(b->tmp_path);
+    free(b->path);
+    b->tmp_path = NULL;
+    b->path = NULL;
+    return ret;
+}
+
+// ---------------- 多路归并 ----------------
+
+// 归并的一路输入：内存表的有序节点数组，或一张磁盘表
+typedef struct {
+    mk_node_t **nodes;                 // 内存表节点（已按key排序）
+    size_t nnodes;
+    size_t node_idx;
+    const mk_t *mk;
+    mk_sst_t *t;                       // 磁盘表
+    size_t block_idx;
+    char *buf;                         // 当前数据块
+    size_t buf_len;
+    size_t pos;
+    int valid;                         // 是否还有当前记录
+    int error;                         // 读取失败（内存不足、读盘出错或解压失败），之后不再有记录
+    const char *key;                   // 当前记录
+    size_t klen;
+    const char *value;                 // NULL表示删除标记
+    size_t vlen;
+    uint64_t version;
+} mk_merge_src_t;
+
+// 前进到下一条记录
+static void mk_merge_next(mk_merge_src_t *s) {
+    s->valid = 0;
+    if (s->nodes != NULL) {
+        while (s->node_idx < s->nnodes) {
+            mk_node_t *node = s->nodes[s->node_idx++];
+            s->key = node->key;
+            s->klen = strlen(node->key);
+            s->version = node->version;
+            if (node->flags & MK_NODE_TOMBSTONE) {
+                s->value = NULL;
+                s->vlen = 0;
+            } else {
+                s->value = mk_node_value(s->mk, node, &s->vlen);
+                if (s->value == NULL) {
+                    s->error = 1;
+                    return;
+                }
+            }
+            s->valid = 1;
+            return;
+        }
+        return;
+    }
+
+    while (1) {
+        if (s->pos + MK_SST_REC_HDR <= s->buf_len) {
+            uint32_t rk, rv;
+            memcpy(&rk, s->buf + s->pos, 4);
+            memcpy(&rv, s->buf + s->pos + 4, 4);
+            size_t vlen = (rv == MK_SST_TOMBSTONE) ? 0 : rv;
+            if (s->pos + MK_SST_REC_HDR + rk + vlen <= s->buf_len) {
+                memcpy(&s->version, s->buf + s->pos + 8, 8);
+                s->key = s->buf + s->pos + MK_SST_REC_HDR;
+                s->klen = rk;
+                s->value = (rv == MK_SST_TOMBSTONE) ? NULL : s->key + rk;
+                s->vlen = vlen;
+                s->pos += MK_SST_REC_HDR + rk + vlen;
+                s->valid = 1;
+                return;
+            }
+        }
+        // 读下一个数据块
+        if (s->block_idx >= s->t->nblocks) return;
+        const mk_sst_block_t *blk = &s->t->blocks[s->block_idx++];
+        char *buf = realloc(s->buf, blk->len);
+        if (buf == NULL) {
+            s->error = 1;
+            return;
+        }
+        s->buf = buf;
+        if (mk_pread_full(s->t->fd, s->buf, blk->len, blk->off) != 0) {
+            s->error = 1;
+            return;
+        }
+        s->buf_len = blk->len;
+        s->pos = 0;
+    }
+}
+
+// 比较函数：节点按key升序
+static int mk_node_cmp(const void *a, const void *b) {
+    const mk_node_t *n1 = *(mk_node_t * const *)a;
+    const mk_node_t *n2 = *(mk_node_t * const *)b;
+    return strcmp(n1->key, n2->key);
+}
+
+// 收集哈希桶中的所有节点（包括删除标记）并按key排序，没有节点时返回空数组（调用方持有保护这些桶的锁）
+static mk_node_t **mk_sorted_nodes(mk_node_t *const *buckets, size_t hint, size_t *count) {
+    size_t n = 0, cap = hint + 64;
+    mk_node_t **nodes = malloc(cap * sizeof(mk_node_t *));
+    if (nodes == NULL) return NULL;
+    for (int i = 0; i < MK_HASH_SIZE; i++) {
+        for (mk_node_t *node = buckets[i]; node != NULL; node = node->next) {
+            if (n == cap) {
+                mk_node_t **grown = realloc(nodes, cap * 2 * sizeof(mk_node_t *));
+                if (grown == NULL) {
+                    free(nodes);
+                    return NULL;
+                }
+                nodes = grown;
+                cap *= 2;
+            }
+            nodes[n++] = node;
+        }
+    }
+    qsort(nodes, n, sizeof(mk_node_t *), mk_node_cmp);
+    *count = n;
+    return nodes;
+}
+
+// 多路归并：srcs按新旧顺序排列（新的在前），同一个key只取最新的一条（连同版本号）交给emit
+// drop_tombstones非0时丢弃删除标记；emit返回非0时提前结束
+// 任何一路读取失败时立即返回-1，已交给emit的结果不完整
+static int mk_merge(mk_merge_src_t *srcs, size_t nsrc, int drop_tombstones,
+                    int (*emit)(const char *key, size_t klen, const char *value, size_t vlen, uint64_t version, void *ctx),
+                    void *ctx) {
+    for (size_t i = 0; i < nsrc; i++) mk_merge_next(&srcs[i]);
+
+    char *key = NULL;
+    size_t key_cap = 0;
+    char *value = NULL;
+    size_t value_cap = 0;
+    int ret = 0;
+    while (1) {
+        // 找出最小的key，相同key时取最新的一路
+        mk_merge_src_t *min = NULL;
+        for (size_t i = 0; i < nsrc && ret == 0; i++) {
+            if (srcs[i].error) ret = -1;
+            if (!srcs[i].valid) continue;
+            if (min == NULL || mk_key_cmp(srcs[i].key, srcs[i].klen, min->key, min->klen) < 0) min = &srcs[i];
+        }
+        if (ret != 0 || min == NULL) break;
+
+        // 先复制key，因为推进输入后原缓冲区可能被覆盖
+        if (key_cap < min->klen + 1) {
+            char *grown = realloc(key, min->klen + 1);
+            if (grown == NULL) {
+                ret = -1;
+                break;
+            }
+            key = grown;
+            key_cap = min->klen + 1;
+        }
+        memcpy(key, min->key, min->klen);
+        key[min->klen] = '\0';
+        size_t klen = min->klen;
+
+        if (min->value != NULL) {
+            // 磁盘块中的value没有'\0'结尾，复制一份补上
+            if (value_cap < min->vlen + 1) {
+                char *grown = realloc(value, min->vlen + 1);
+                if (grown == NULL) {
+                    ret = -1;
+                    break;
+                }
+                value = grown;
+                value_cap = min->vlen + 1;
+            }
+            memcpy(value, min->value, min->vlen);
+            value[min->vlen] = '\0';
+            ret = emit(key, klen, value, min->vlen, min->version, ctx);
+            if (ret != 0) break;
+        } else if (!drop_tombstones) {
+            ret = emit(key, klen, NULL, 0, min->version, ctx);
+            if (ret != 0) break;
+        }
+
+        // 所有指向这个key的输入都前进一条（旧版本被覆盖）
+        for (size_t i = 0; i < nsrc; i++) {
+            if (srcs[i].valid && mk_key_cmp(srcs[i].key, srcs[i].klen, key, klen) == 0) mk_merge_next(&srcs[i]);
+        }
+    }
+    free(key);
+    free(value);
+    for (size_t i = 0; i < nsrc; i++) free(srcs[i].buf);
+    return ret;
+}
+
+// ---------------- 合并（compaction） ----------------
+
+static int mk_compact_emit(const char *key, size_t klen, const char *value, size_t vlen, uint64_t version, void *ctx) {
+    (void)klen;
+    mk_sst_builder_t *b = ctx;
+    mk_sst_builder_add(b, key, value, vlen, version);
+    return b->error ? -1 : 0;
+}
+
+// 把当前所有L0表和L1表合并成一张新的L1表
+static int mk_lsm_compact_tables(mk_lsm_t *lsm) {
+    pthread_mutex_lock(&lsm->compact_mutex);
+
+    // 记下参与合并的表；合并期间新刷出的L0表不参与
+    pthread_rwlock_rdlock(&lsm->lock);
+    size_t n0 = lsm->l0_count;
+    mk_sst_t *old_l1 = lsm->l1;
+    mk_sst_t **inputs = malloc((n0 + 1) * sizeof(mk_sst_t *));
+    if (inputs != NULL) memcpy(inputs, lsm->l0, n0 * sizeof(mk_sst_t *));
+    // 新L1的编号在合并开始时分配，使所有编号更小的L0都已包含在其中
+    uint64_t id = __atomic_fetch_add(&lsm->next_id, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&lsm->lock);
+
+    if (inputs == NULL || n0 == 0) {
+        free(inputs);
+        pthread_mutex_unlock(&lsm->compact_mutex);
+        return (inputs == NULL) ? -1 : 0;
+    }
+
+    size_t nsrc = n0 + (old_l1 != NULL);
+    mk_merge_src_t *srcs = calloc(nsrc, sizeof(mk_merge_src_t));
+    if (old_l1 != NULL) inputs[n0] = old_l1;
+    int ret = -1;
+    mk_sst_builder_t b;
+    if (srcs != NULL && mk_sst_builder_init(&b, lsm->dir, 1, id) == 0) {
+        for (size_t i = 0; i < nsrc; i++) srcs[i].t = inputs[i];
+        // L1是最底层，删除标记不用再保留；归并失败时丢弃新表，保留参与合并的表
+        if (mk_merge(srcs, nsrc, 1, mk_compact_emit, &b) != 0) b.error = 1;
+        ret = mk_sst_builder_finish(&b);
+    } else if (srcs != NULL) {
+        mk_sst_builder_finish(&b);
+    }
+    free(srcs);
+
+    mk_sst_t *new_l1 = NULL;
+    if (ret == 0) {
+        char *path = mk_sst_path(lsm->dir, 1, id, "");
+        if (path != NULL) new_l1 = mk_sst_open(path, 1, id);
+        free(path);
+        if (new_l1 == NULL) ret = -1;
+    }
+
+    if (ret >= 0) {
+        // 替换表列表：去掉参与合并的L0（它们是列表中最旧的n0张）
+        pthread_rwlock_wrlock(&lsm->lock);
+        lsm->l0_count -= n0;
+        lsm->l1 = new_l1;
+        pthread_rwlock_unlock(&lsm->lock);
+
+        // 写锁已保证没有查找还在使用旧表
+        for (size_t i = 0; i < nsrc; i++) mk_sst_close(inputs[i], 1);
+        MK_LSM_STAT_INC(lsm, compactions);
+        ret = 0;
+    } else {
+        fprintf(stderr, "mk_lsm 合并磁盘表失败 ❌\n");
+    }
+    free(inputs);
+    pthread_mutex_unlock(&lsm->compact_mutex);
+    return ret;
+}
+
+// 后台合并线程：L0表数达到阈值时合并
+static void *mk_lsm_bg_main(void *arg) {
+    mk_lsm_t *lsm = arg;
+    pthread_mutex_lock(&lsm->bg_mutex);
+    while (!lsm->bg_stop) {
+        pthread_rwlock_rdlock(&lsm->lock);
+        size_t n0 = lsm->l0_count;
+        pthread_rwlock_unlock(&lsm->lock);
+
+        if (n0 >= MK_LSM_L0_TRIGGER) {
+            pthread_mutex_unlock(&lsm->bg_mutex);
+            int ret = mk_lsm_compact_tables(lsm);
+            pthread_mutex_lock(&lsm->bg_mutex);
+            if (ret == 0) continue;
+        }
+        pthread_cond_wait(&lsm->bg_cond, &lsm->bg_mutex);
+    }
+    pthread_mutex_unlock(&lsm->bg_mutex);
+    return NULL;
+}
+
+// ---------------- 对外接口 ----------------
+
+// 把一张表加入L0列表头部（最新）
+static int mk_lsm_add_l0(mk_lsm_t *lsm, mk_sst_t *t) {
+    if (lsm->l0_count == lsm->l0_cap) {
+        size_t ncap = lsm->l0_cap ? lsm->l0_cap * 2 : 8;
+        mk_sst_t **grown = realloc(lsm->l0, ncap * sizeof(mk_sst_t *));
+        if (grown == NULL) return -1;
+        lsm->l0 = grown;
+        lsm->l0_cap = ncap;
+    }
+    memmove(lsm->l0 + 1, lsm->l0, lsm->l0_count * sizeof(mk_sst_t *));
+    lsm->l0[0] = t;
+    lsm->l0_count++;
+    return 0;
+}
+
+// 比较函数：L0表按编号降序（新表在前）
+static int mk_sst_cmp_desc(const void *a, const void *b) {
+    const mk_sst_t *t1 = *(mk_sst_t * const *)a;
+    const mk_sst_t *t2 = *(mk_sst_t * const *)b;
+    return (t1->id < t2->id) ? 1 : (t1->id > t2->id) ? -1 : 0;
+}
+
+// 释放磁盘层（不刷盘）
+static void mk_lsm_free(mk_lsm_t *lsm) {
+    for (size_t i = 0; i < lsm->l0_count; i++) mk_sst_close(lsm->l0[i], 0);
+    mk_sst_close(lsm->l1, 0);
+    free(lsm->l0);
+    free(lsm->dir);
+    pthread_rwlock_destroy(&lsm->lock);
+    pthread_mutex_destroy(&lsm->flush_mutex);
+    pthread_mutex_destroy(&lsm->compact_mutex);
+    pthread_mutex_destroy(&lsm->bg_mutex);
+    pthread_cond_destroy(&lsm->bg_cond);
+    free(lsm);
+}
+
+// 为Hash表开启磁盘层：dir为磁盘表目录（不存在则创建），内存表占用超过memtable_limit字节时刷盘
+int mk_lsm_open(mk_t *mk, const char *dir, size_t memtable_limit) {
+    if (mk == NULL || dir == NULL || mk->lsm != NULL) {
+        fprintf(stderr, "mk_lsm_open 无效的参数 ❌\n");
+        return -1;
+    }
+    if (MK_ATOMIC_LOAD(mk->snap_count) > 0) {
+        // 刷盘会整体清空内存表，快照需要的旧版本会丢失
+        fprintf(stderr, "mk_lsm_open 有活动快照时不能开启磁盘层 ❌\n");
+        return -1;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "mk_lsm_open 无法创建目录 %s ❌\n", dir);
+        return -1;
+    }
+    DIR *dp = opendir(dir);
+    if (dp == NULL) {
+        fprintf(stderr, "mk_lsm_open 无法打开目录 %s ❌\n", dir);
+        return -1;
+    }
+
+    mk_lsm_t *lsm = calloc(1, sizeof(mk_lsm_t));
+    if (lsm == NULL || (lsm->dir = strdup(dir)) == NULL) {
+        free(lsm);
+        closedir(dp);
+        return -1;
+    }
+    lsm->memtable_limit = memtable_limit;
+    lsm->next_id = 1;
+    pthread_rwlock_init(&lsm->lock, NULL);
+    pthread_mutex_init(&lsm->flush_mutex, NULL);
+    pthread_mutex_init(&lsm->compact_mutex, NULL);
+    pthread_mutex_init(&lsm->bg_mutex, NULL);
+    pthread_cond_init(&lsm->bg_cond, NULL);
+
+    // 扫描目录中已有的磁盘表
+    struct dirent *de;
+    int ret = 0;
+    while ((de = readdir(dp)) != NULL) {
+        int level = -1;
+        unsigned long long id = 0;
+        char tail[8] = "";
+        if (sscanf(de->d_name, "L%d-%llu.sst%7s", &level, &id, tail) < 2 || (level != 0 && level != 1)) continue;
+
+        char *path = mk_sst_path(dir, level, id, tail);
+        if (path == NULL) {
+            ret = -1;
+            break;
+        }
+        if (tail[0] != '\0') {
+            unlink(path);// 上次没写完的临时文件
+            free(path);
+            continue;
+        }
+        mk_sst_t *t = mk_sst_open(path, level, id);
+        free(path);
+        if (t == NULL) {
+            ret = -1;
+            break;
+        }
+        if (id >= lsm->next_id) lsm->next_id = id + 1;
+        if (level == 1) {
+            // 合并中途退出可能留下多张L1，只保留最新的一张
+            if (lsm->l1 == NULL || lsm->l1->id < t->id) {
+                mk_sst_close(lsm->l1, 1);
+                lsm->l1 = t;
+            } else {
+                mk_sst_close(t, 1);
+            }
+        } else if (mk_lsm_add_l0(lsm, t) != 0) {
+            mk_sst_close(t, 0);
+            ret = -1;
+            break;
+        }
+    }
+    closedir(dp);
+
+    if (ret == 0) {
+        // 编号小于L1的L0表已经合并进了L1
+        size_t kept = 0;
+        for (size_t i = 0; i < lsm->l0_count; i++) {
+            if (lsm->l1 != NULL && lsm->l0[i]->id < lsm->l1->id) mk_sst_close(lsm->l0[i], 1);
+            else lsm->l0[kept++] = lsm->l0[i];
+        }
+        lsm->l0_count = kept;
+        if (lsm->l0_count > 1) qsort(lsm->l0, lsm->l0_count, sizeof(mk_sst_t *), mk_sst_cmp_desc);
+
+        if (pthread_create(&lsm->bg_thread, NULL, mk_lsm_bg_main, lsm) != 0) ret = -1;
+    }
+    if (ret != 0) {
+        fprintf(stderr, "mk_lsm_open 加载磁盘表失败 ❌\n");
+        mk_lsm_free(lsm);
+        return -1;
+    }
+    // 磁盘表中的key保留着写入时的版本号，之后的写序号必须比它们都大，否则条件写入可能误判
+    uint64_t top = (lsm->l1 != NULL) ? lsm->l1->max_version : 0;
+    for (size_t i = 0; i < lsm->l0_count; i++) {
+        if (lsm->l0[i]->max_version > top) top = lsm->l0[i]->max_version;
+    }
+    uint64_t seq = MK_ATOMIC_LOAD(mk->seq);
+    while (seq < top && !__atomic_compare_exchange_n(&mk->seq, &seq, top, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    mk->lsm = lsm;
+    return 0;
+}
+
+// 刷盘：在全部写锁下把内存表整体摘下作为imm（查找和遍历仍能看到），换上空的内存表后立即释放锁，
+// 排序、写文件和fsync都在锁外进行；写成后在lock下换成L0表。force为0时内存表已低于上限则不刷
+static int mk_lsm_flush_impl(mk_t *mk, int force) {
+    mk_lsm_t *lsm = mk->lsm;
+    mk_node_t **frozen = malloc(MK_HASH_SIZE * sizeof(mk_node_t *));
+    if (frozen == NULL) {
+        perror("mk_lsm_flush 内存分配失败");
+        return -1;
+    }
+
+    pthread_mutex_lock(&lsm->flush_mutex);
+    int gc_paused = mk_vlog_pause_gc(mk);
+    mk_lock_all(mk, 1);
+    int empty = !force && MK_ATOMIC_LOAD(mk->mem_used) <= lsm->memtable_limit;
+    if (!empty) {
+        mk_detach_memtable(mk, frozen);
+        pthread_rwlock_wrlock(&lsm->lock);
+        lsm->imm = frozen;
+        pthread_rwlock_unlock(&lsm->lock);
+    }
+    mk_unlock_all(mk);
+    if (empty) {
+        if (gc_paused) mk_vlog_resume_gc(mk);
+        pthread_mutex_unlock(&lsm->flush_mutex);
+        free(frozen);
+        return 0;
+    }
+
+    // imm不再修改，锁外读取它的节点
+    size_t n = 0;
+    mk_node_t **nodes = mk_sorted_nodes(frozen, 1024, &n);
+    mk_sst_t *t = NULL;
+    int ret = (nodes != NULL && n == 0) ? 0 : -1;
+    if (nodes != NULL && n > 0) {
+        uint64_t id = __atomic_fetch_add(&lsm->next_id, 1, __ATOMIC_RELAXED);
+        mk_sst_builder_t b;
+        if (mk_sst_builder_init(&b, lsm->dir, 0, id) == 0) {
+            for (size_t i = 0; i < n; i++) {
+                mk_node_t *node = nodes[i];
+                if (node->flags & MK_NODE_TOMBSTONE) {
+                    mk_sst_builder_add(&b, node->key, NULL, 0, node->version);
+                } else {
+                    size_t vlen = 0;
+                    const char *value = mk_node_value(mk, node, &vlen);
+                    // 长度等于删除标记或超出u32的value无法写入（写入路径已拒绝）
+                    if (value == NULL || vlen >= MK_SST_TOMBSTONE) b.error = 1;
+                    else mk_sst_builder_add(&b, node->key, value, vlen, node->version);
+                }
+            }
+        }
+        if (mk_sst_builder_finish(&b) == 0) {
+            char *path = mk_sst_path(lsm->dir, 0, id, "");
+            if (path != NULL) t = mk_sst_open(path, 0, id);
+            free(path);
+        }
+        if (t != NULL) ret = 0;
+    }
+    free(nodes);
+
+    pthread_rwlock_wrlock(&lsm->lock);
+    if (t != NULL && mk_lsm_add_l0(lsm, t) != 0) {
+        mk_sst_close(t, 1);
+        t = NULL;
+        ret = -1;
+    }
+    if (ret == 0) lsm->imm = NULL;
+    size_t n0 = lsm->l0_count;
+    pthread_rwlock_unlock(&lsm->lock);
+
+    if (ret == 0) {
+        mk_free_detached(mk, frozen);
+        if (t != NULL) MK_LSM_STAT_INC(lsm, flushes);
+    } else {
+        // 写盘失败：把节点放回内存表，imm在放回的同一临界区内撤下，查找不会漏掉它们
+        fprintf(stderr, "mk_lsm_flush 写入磁盘表失败 ❌\n");
+        mk_lock_all(mk, 1);
+        mk_attach_memtable(mk, frozen);
+        pthread_rwlock_wrlock(&lsm->lock);
+        lsm->imm = NULL;
+        pthread_rwlock_unlock(&lsm->lock);
+        mk_unlock_all(mk);
+    }
+    if (gc_paused) mk_vlog_resume_gc(mk);
+    pthread_mutex_unlock(&lsm->flush_mutex);
+    free(frozen);
+
+    // 唤醒后台线程合并
+    if (n0 >= MK_LSM_L0_TRIGGER) {
+        pthread_mutex_lock(&lsm->bg_mutex);
+        pthread_cond_signal(&lsm->bg_cond);
+        pthread_mutex_unlock(&lsm->bg_mutex);
+    }
+    return ret;
+}
+
+// 把内存表按key排序刷成一张新的L0磁盘表，然后清空内存表
+int mk_lsm_flush(mk_t *mk) {
+    if (mk == NULL || mk->lsm == NULL) {
+        fprintf(stderr, "mk_lsm_flush 未开启磁盘层 ❌\n");
+        return -1;
+    }
+    return mk_lsm_flush_impl(mk, 1);
+}
+
+// 写入后检查内存表是否超过上限，超过则刷盘
+int mk_lsm_maybe_flush(mk_t *mk) {
+    if (mk->lsm == NULL || MK_ATOMIC_LOAD(mk->mem_used) <= mk->lsm->memtable_limit) return 0;
+    return mk_lsm_flush_impl(mk, 0);
+}
+
+// 立即把所有L0表合并进L1（同步执行）
+int mk_lsm_compact(mk_t *mk) {
+    if (mk == NULL || mk->lsm == NULL) {
+        fprintf(stderr, "mk_lsm_compact 未开启磁盘层 ❌\n");
+        return -1;
+    }
+    return mk_lsm_compact_tables(mk->lsm);
+}
+
+// 关闭磁盘层：刷出内存表，停止后台线程，释放所有磁盘表
+int mk_lsm_close(mk_t *mk) {
+    if (mk == NULL || mk->lsm == NULL) {
+        fprintf(stderr, "mk_lsm_close 未开启磁盘层 ❌\n");
+        return -1;
+    }
+    mk_lsm_t *lsm = mk->lsm;
+    int ret = mk_lsm_flush(mk);
+
+    pthread_mutex_lock(&lsm->bg_mutex);
+    lsm->bg_stop = 1;
+    pthread_cond_signal(&lsm->bg_cond);
+    pthread_mutex_unlock(&lsm->bg_mutex);
+    pthread_join(lsm->bg_thread, NULL);
+
+    mk_lsm_free(lsm);
+    mk->lsm = NULL;
+    return ret;
+}
+
+// 在磁盘层中查找key（key需已去除首尾空白，调用方持有该key所在分段的锁）
+// 找到返回0并把value放进线程局部缓冲区、version（可为NULL）返回写入时的版本号，不存在或已删除返回1，出错返回-1
+int mk_lsm_get(const mk_t *mk, const char *key, const char **value, size_t *len, uint64_t *version) {
+    mk_lsm_t *lsm = mk->lsm;
+    size_t klen = strlen(key);
+    uint64_t h = mk_hash64(key, klen);
+    char *found = NULL;
+    size_t vlen = 0;
+    uint64_t ver = 0;
+    int ret = 2;
+
+    MK_LSM_STAT_INC(lsm, lookups);
+    pthread_rwlock_rdlock(&lsm->lock);
+    if (lsm->imm != NULL) {
+        // 正在刷盘的内存表比所有磁盘表都新
+        for (mk_node_t *node = lsm->imm[mk_hash(key)]; node != NULL && ret == 2; node = node->next) {
+            if (strcmp(node->key, key) != 0) continue;
+            if (node->flags & MK_NODE_TOMBSTONE) {
+                ret = 1;
+            } else if ((found = malloc(node->raw_len + 1)) == NULL || mk_node_decode(mk, node, found, node->raw_len + 1) != 0) {
+                ret = -1;
+            } else {
+                vlen = node->raw_len;
+                ver = node->version;
+                ret = 0;
+            }
+        }
+    }
+    for (size_t i = 0; i < lsm->l0_count && ret == 2; i++) {
+        ret = mk_sst_get(lsm, lsm->l0[i], key, klen, h, &found, &vlen, &ver);
+    }
+    if (ret == 2 && lsm->l1 != NULL) {
+        ret = mk_sst_get(lsm, lsm->l1, key, klen, h, &found, &vlen, &ver);
+    }
+    pthread_rwlock_unlock(&lsm->lock);
+
+    if (ret != 0) return (ret < 0) ? -1 : 1;
+
+    char *buf = mk_tls_buffer(vlen + 1);
+    if (buf == NULL) {
+        free(found);
+        return -1;
+    }
+    memcpy(buf, found, vlen + 1);
+    free(found);
+    *value = buf;
+    if (len != NULL) *len = vlen;
+    if (version != NULL) *version = ver;
+    return 0;
+}
+
+// mk_lsm_scan的回调不需要版本号
+typedef struct {
+    int (*cb)(const char *key, size_t klen, const char *value, size_t vlen, void *ctx);
+    void *ctx;
+} mk_scan_ctx_t;
+
+static int mk_scan_emit(const char *key, size_t klen, const char *value, size_t vlen, uint64_t version, void *ctx) {
+    (void)version;
+    mk_scan_ctx_t *sc = ctx;
+    return sc->cb(key, klen, value, vlen, sc->ctx);
+}
+
+// 按key升序遍历内存表和磁盘层中的所有有效键值对，cb返回非0时提前结束（调用方持有全部读锁）
+int mk_lsm_scan(const mk_t *mk, int (*cb)(const char *key, size_t klen, const char *value, size_t vlen, void *ctx),
+                void *ctx) {
+    mk_lsm_t *lsm = mk->lsm;
+
+    // 内存表按key排序后作为最新的一路，正在刷盘的内存表作为次新的一路（删除标记不计入count，不够时再扩容）
+    size_t n = 0, nimm = 0;
+    mk_node_t **nodes = mk_sorted_nodes(mk->buckets, mk->count, &n);
+    if (nodes == NULL) return -1;
+
+    pthread_rwlock_rdlock(&lsm->lock);
+    mk_node_t **imm = (lsm->imm != NULL) ? mk_sorted_nodes(lsm->imm, 1024, &nimm) : NULL;
+    size_t first = (lsm->imm != NULL) ? 2 : 1;
+    size_t nsrc = first + lsm->l0_count + (lsm->l1 != NULL);
+    mk_merge_src_t *srcs = calloc(nsrc, sizeof(mk_merge_src_t));
+    int ret = -1;
+    if (srcs != NULL && (lsm->imm == NULL || imm != NULL)) {
+        srcs[0].nodes = nodes;
+        srcs[0].nnodes = n;
+        srcs[0].mk = mk;
+        if (imm != NULL) {
+            srcs[1].nodes = imm;
+            srcs[1].nnodes = nimm;
+            srcs[1].mk = mk;
+        }
+        for (size_t i = 0; i < lsm->l0_count; i++) srcs[first + i].t = lsm->l0[i];
+        if (lsm->l1 != NULL) srcs[nsrc - 1].t = lsm->l1;
+        mk_scan_ctx_t sc = {cb, ctx};
+        ret = mk_merge(srcs, nsrc, 1, mk_scan_emit, &sc);
+    }
+    free(srcs);
+    pthread_rwlock_unlock(&lsm->lock);
+    free(imm);
+    free(nodes);
+    return (ret < 0) ? -1 : 0;
+}
+
+// 获取磁盘层统计
+int mk_lsm_stats(const mk_t *mk, mk_lsm_stats_t *stats) {
+    if (mk == NULL || mk->lsm == NULL || stats == NULL) {
+        fprintf(stderr, "mk_lsm_stats 未开启磁盘层 ❌\n");
+        return -1;
+    }
+    mk_lsm_t *lsm = mk->lsm;
+    pthread_rwlock_rdlock(&lsm->lock);
+    // 计数器由后台线程和查询线程原子更新，逐个原子读取
+    memset(stats, 0, sizeof(*stats));
+    stats->lookups = MK_ATOMIC_LOAD(lsm->stats.lookups);
+    stats->bloom_negatives = MK_ATOMIC_LOAD(lsm->stats.bloom_negatives);
+    stats->block_reads = MK_ATOMIC_LOAD(lsm->stats.block_reads);
+    stats->flushes = MK_ATOMIC_LOAD(lsm->stats.flushes);
+    stats->compactions = MK_ATOMIC_LOAD(lsm->stats.compactions);
+    stats->l0_tables = lsm->l0_count;
+    stats->l1_tables = (lsm->l1 != NULL);
+    for (size_t i = 0; i < lsm->l0_count; i++) {
+        stats->disk_entries += lsm->l0[i]->entries;
+        stats->disk_bytes += lsm->l0[i]->file_size;
+    }
+    if (lsm->l1 != NULL) {
+        stats->disk_entries += lsm->l1->entries;
+        stats->disk_bytes += lsm->l1->file_size;
+    }
+    pthread_rwlock_unlock(&lsm->lock);
+    return 0;
+}
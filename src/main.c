@@ -4,7 +4,11 @@
 #include <string.h>
 
 
-int main() {
+int main(int argc, char *argv[]) {
+    // --batch：批量（管道）模式，如 ./minikv --batch < cmds.txt
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        return start_minikv_batch();
+    }
     start_minikv();// 启动MiniKV
     return 0;
 }
@@ -2,9 +2,27 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <malloc.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 void mk_destroy_chain(mk_node_t *node);//递归销毁一条Hash链
 
+// 一块堆内存实际占用的字节数（可用大小 + 分配器块头开销）
+size_t mk_alloc_size(const void *ptr) {
+    if (ptr == NULL) return 0;
+    return malloc_usable_size((void *)ptr) + MK_MALLOC_OVERHEAD;
+}
+
+// 一个节点占用的全部内存：节点本身 + key缓冲区 + value缓冲区
+size_t mk_node_mem(const mk_node_t *node) {
+    return mk_alloc_size(node) + mk_alloc_size(node->key) + mk_alloc_size(node->value);
+}
+
 // 简易哈希函数（DJB2）
 size_t mk_hash(const char *key) {
     size_t hash = 5381;// 初始化哈希值
@@ -18,23 +36,70 @@ size_t mk_hash(const char *key) {
     return hash % MK_HASH_SIZE;
 }
 
+// key的64位哈希（FNV-1a），用于布隆过滤器和热点key统计
+uint64_t mk_hash64(const char *key, size_t len) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
 // 创建Hash表
 mk_t* mk_create(void) {
     mk_t *mk = calloc(1, sizeof(mk_t)); // 自动初始化为0
     if (mk == NULL) return NULL;
+    mk->mem_used = mk_alloc_size(mk);// 哈希桶数组内嵌在mk_t中，一并计入
+    for (int i = 0; i < MK_LOCK_STRIPES; i++) {
+        pthread_rwlock_init(&mk->locks[i], NULL);
+    }
+    pthread_mutex_init(&mk->snap_mu, NULL);
     return mk;
 }
 
-// 销毁Hash表
+// 获取全部分段锁（按顺序加锁，避免死锁），用于遍历或清空整张表
+void mk_lock_all(const mk_t *mk, int write) {
+    for (int i = 0; i < MK_LOCK_STRIPES; i++) {
+        if (write) pthread_rwlock_wrlock(mk_stripe(mk, (size_t)i));
+        else pthread_rwlock_rdlock(mk_stripe(mk, (size_t)i));
+    }
+}
+
+// 释放全部分段锁
+void mk_unlock_all(const mk_t *mk) {
+    for (int i = MK_LOCK_STRIPES - 1; i >= 0; i--) {
+        pthread_rwlock_unlock(mk_stripe(mk, (size_t)i));
+    }
+}
+
+// 销毁Hash表（调用前需结束全部快照）
 int mk_destroy(mk_t *mk) {
     if (mk == NULL) {
         fprintf(stderr,"mk_destroy 无效的参数\n");
         return -1;
     }
+    // 先停止网络服务和复制，再把内存表刷盘
+    mk_server_stop(mk);
+    mk_shm_stop(mk);
+    if (mk->repl != NULL) {
+        mk_repl_free(mk);
+    }
+    mk_wal_free(mk);
+    if (mk->lsm != NULL) {
+        mk_lsm_close(mk);
+    }
+    mk_vlog_free(mk);
+    mk_hotkeys_free(mk);
+    mk_slowlog_free(mk);
     // 遍历哈希桶，释放链表
     for (int i = 0; i < MK_HASH_SIZE; i++) {
         mk_destroy_chain(mk->buckets[i]);//逐个销毁Hash桶的链
     }
+    for (int i = 0; i < MK_LOCK_STRIPES; i++) {
+        pthread_rwlock_destroy(&mk->locks[i]);
+    }
+    pthread_mutex_destroy(&mk->snap_mu);
     free(mk);
     return 0;
 
@@ -44,14 +109,158 @@ int mk_destroy(mk_t *mk) {
 void mk_destroy_chain(mk_node_t *node) {
     if (node == NULL) return;
     mk_destroy_chain(node->next);
+    // 释放为快照保留的旧版本
+    mk_node_t *old = node->older;
+    while (old != NULL) {
+        mk_node_t *older = old->older;
+        free(old->value);
+        free(old);
+        old = older;
+    }
     free(node->key);
     free(node->value);
     free(node);
 }
 
+// 批量写在加锁前为每个操作预先分配的内存，应用时从这里取用，不会因内存不足只应用一部分
+// 其余写操作传NULL，需要时直接分配
+typedef struct {
+    mk_node_t *node;                   // 新建节点（key已复制）
+    mk_node_t *old;                    // 为快照保留旧版本用的节点
+    char *empty;                       // 删除标记的空value
+} mk_spare_t;
+
+static int mk_del_to_tombstone(mk_t *mk, mk_node_t *node, uint64_t version, mk_spare_t *sp);
+static int mk_mvcc_needed(const mk_t *mk, const mk_node_t *node);
+static void mk_cstats_track(mk_t *mk, const mk_node_t *node, int sign);
+
+// 释放节点的value：存放在值日志中时把记录标记为失效，否则释放value缓冲区（调用方持有分段写锁）
+static void mk_value_free(mk_t *mk, mk_node_t *node) {
+    if (node->enc == MK_ENC_VLOG) mk_vlog_release(mk, node->vlog_off);
+    free(node->value);
+}
+
+// 清空内存表中的所有节点（包括删除标记），统计随之归零（调用方需持有全部写锁）
+void mk_clear_memtable(mk_t *mk) {
+    if (MK_ATOMIC_LOAD(mk->snap_count) > 0) {
+        // 有活动快照时逐个删除，快照还需要的节点改为删除标记，快照仍能看到清空前的数据
+        uint64_t version = MK_ATOMIC_ADD(mk->seq, 1);
+        for (int i = 0; i < MK_HASH_SIZE; i++) {
+            mk_node_t *prev = NULL;
+            mk_node_t *curr = mk->buckets[i];
+            while (curr != NULL) {
+                mk_node_t *next = curr->next;
+                if (curr->flags & MK_NODE_TOMBSTONE) {
+                    prev = curr;
+                } else if (curr->older != NULL || mk_mvcc_needed(mk, curr)) {
+                    if (mk_del_to_tombstone(mk, curr, version, NULL) == 0) MK_ATOMIC_SUB(mk->count, 1);
+                    prev = curr;
+                } else {
+                    if (prev == NULL) mk->buckets[i] = next;
+                    else prev->next = next;
+                    MK_ATOMIC_SUB(mk->mem_used, mk_node_mem(curr));
+                    mk_cstats_track(mk, curr, -1);
+                    free(curr->key);
+                    mk_value_free(mk, curr);
+                    free(curr);
+                    MK_ATOMIC_SUB(mk->count, 1);
+                }
+                curr = next;
+            }
+        }
+        return;
+    }
+    mk_node_t *detached[MK_HASH_SIZE];
+    mk_detach_memtable(mk, detached);
+    mk_free_detached(mk, detached);
+}
+
+// 把内存表的全部哈希桶摘到buckets中，内存表变为空，统计随之归零（调用方需持有全部写锁）
+void mk_detach_memtable(mk_t *mk, mk_node_t **buckets) {
+    memcpy(buckets, mk->buckets, sizeof(mk->buckets));
+    memset(mk->buckets, 0, sizeof(mk->buckets));
+    mk->count=0;
+    mk->mem_used=mk_alloc_size(mk);
+    mk->cstats.compressed_values = 0;
+    mk->cstats.raw_bytes = 0;
+    mk->cstats.stored_bytes = 0;
+    mk->old_versions = 0;
+}
+
+// 释放mk_detach_memtable摘下的节点（已不在内存表中，不需要持锁）
+void mk_free_detached(mk_t *mk, mk_node_t **buckets) {
+    for(int i=0;i<MK_HASH_SIZE;i++){
+        // 值日志中的记录随节点一起失效
+        for (mk_node_t *node = buckets[i]; node != NULL && mk->vlog != NULL; node = node->next) {
+            for (mk_node_t *v = node; v != NULL; v = v->older) {
+                if (v->enc == MK_ENC_VLOG) mk_vlog_release(mk, v->vlog_off);
+            }
+        }
+        mk_destroy_chain(buckets[i]);
+        buckets[i]=NULL;
+    }
+}
+
+// 把mk_detach_memtable摘下的节点放回内存表，摘下后又被写入或删除的key保留内存表中较新的节点（调用方需持有全部写锁）
+void mk_attach_memtable(mk_t *mk, mk_node_t **buckets) {
+    for (int i = 0; i < MK_HASH_SIZE; i++) {
+        mk_node_t *node = buckets[i];
+        while (node != NULL) {
+            mk_node_t *next = node->next;
+            node->next = NULL;
+            if (mk_bucket_find(mk, (size_t)i, node->key) != NULL) {
+                if (mk->vlog != NULL && node->enc == MK_ENC_VLOG) mk_vlog_release(mk, node->vlog_off);
+                mk_destroy_chain(node);
+            } else {
+                node->next = mk->buckets[i];
+                mk->buckets[i] = node;
+                MK_ATOMIC_ADD(mk->mem_used, mk_node_mem(node));
+                mk_cstats_track(mk, node, 1);
+                if (!(node->flags & MK_NODE_TOMBSTONE)) MK_ATOMIC_ADD(mk->count, 1);
+            }
+            node = next;
+        }
+        buckets[i] = NULL;
+    }
+}
+
+// 线程退出时释放该线程的临时缓冲区
+static pthread_key_t mk_tls_key;
+static pthread_once_t mk_tls_once = PTHREAD_ONCE_INIT;
+static void mk_tls_key_init(void) {
+    pthread_key_create(&mk_tls_key, free);
+}
+
+// 当前线程的临时缓冲区，至少need字节；在同一线程下次调用前有效
+char *mk_tls_buffer(size_t need) {
+    static __thread char *tls_buf = NULL;
+    static __thread size_t tls_cap = 0;
+    if (tls_cap < need) {
+        char *grown = realloc(tls_buf, need);
+        if (grown == NULL) return NULL;
+        tls_buf = grown;
+        tls_cap = need;
+        pthread_once(&mk_tls_once, mk_tls_key_init);
+        pthread_setspecific(mk_tls_key, tls_buf);
+    }
+    return tls_buf;
+}
+
 
 
-// 查找key对应的节点（内部函数）
+// 在第idx个哈希桶中查找已去除空白的key（内部函数，调用方需持有该桶所在分段的锁）
+mk_node_t *mk_bucket_find(const mk_t *mk, size_t idx, const char *validKey) {
+    mk_node_t *node = mk->buckets[idx];
+    while (node != NULL) {
+        if (strcmp(node->key, validKey) == 0) {
+            return node;//找到节点，返回节点指针
+        }
+        node = node->next;
+    }
+    return NULL;//未找到节点
+}
+
+// 查找key对应的节点（内部函数，调用方需持有该key所在分段的锁）
 mk_node_t* mk_find_node(const mk_t *mk, const char *key) {
     if (mk == NULL || key == NULL) return NULL;
     //去除key两边的空格
@@ -60,27 +269,371 @@ mk_node_t* mk_find_node(const mk_t *mk, const char *key) {
         perror("mk_find_node 内存分配失败");
         return NULL;//内存分配失败
     }
-    // 校验key合法性
-    size_t idx = mk_hash(validKey);
-    mk_node_t *node = mk->buckets[idx];
-    while (node != NULL) {
-        if (strcmp(node->key, validKey) == 0) {
-            free(validKey);
-            return node;//找到节点，返回节点指针
+    mk_node_t *node = mk_bucket_find(mk, mk_hash(validKey), validKey);
+    free(validKey);
+    return node;
+}
+
+// 复制一段任意字节，末尾额外补一个'\0'，方便按C字符串读取
+static char *mk_dup_bytes(const void *data, size_t len) {
+    char *buf = malloc(len + 1);
+    if (buf == NULL) return NULL;
+    if (len > 0) memcpy(buf, data, len);
+    buf[len] = '\0';
+    return buf;
+}
+
+// 为一个批量写操作预先分配全部可能用到的内存，失败返回-1
+static int mk_spare_alloc(mk_spare_t *sp, const char *validKey) {
+    sp->node = calloc(1, sizeof(mk_node_t));
+    sp->old = malloc(sizeof(mk_node_t));
+    sp->empty = mk_dup_bytes("", 0);
+    if (sp->node != NULL) sp->node->key = strdup(validKey);
+    if (sp->node == NULL || sp->node->key == NULL || sp->old == NULL || sp->empty == NULL) return -1;
+    return 0;
+}
+
+// 释放没有用到的预分配内存
+static void mk_spare_free(mk_spare_t *sp) {
+    if (sp->node != NULL) free(sp->node->key);
+    free(sp->node);
+    free(sp->old);
+    free(sp->empty);
+    memset(sp, 0, sizeof(*sp));
+}
+
+// 取一个新节点（key已复制）：有预分配时直接取用，否则分配；内存不足返回NULL
+static mk_node_t *mk_spare_node(mk_spare_t *sp, const char *validKey) {
+    if (sp != NULL) {
+        mk_node_t *node = sp->node;
+        sp->node = NULL;
+        return node;
+    }
+    mk_node_t *node = calloc(1, sizeof(mk_node_t));
+    if (node != NULL) node->key = strdup(validKey);
+    if (node != NULL && node->key == NULL) {
+        free(node);
+        node = NULL;
+    }
+    return node;
+}
+
+// 取一个保留旧版本用的节点
+static mk_node_t *mk_spare_old(mk_spare_t *sp) {
+    if (sp == NULL) return malloc(sizeof(mk_node_t));
+    mk_node_t *old = sp->old;
+    sp->old = NULL;
+    return old;
+}
+
+// 取一个删除标记的空value
+static char *mk_spare_empty(mk_spare_t *sp) {
+    if (sp == NULL) return mk_dup_bytes("", 0);
+    char *empty = sp->empty;
+    sp->empty = NULL;
+    return empty;
+}
+
+// 当前单调时钟，单位纳秒
+uint64_t mk_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 按表的压缩阈值编码value，返回新分配的存储缓冲区
+// 达到阈值且压缩后确实变小时存为MK_ENC_LZ，否则原样存为MK_ENC_RAW
+static char *mk_encode_value(mk_t *mk, const void *data, size_t len, size_t *stored_len, unsigned char *enc) {
+    if (mk->compress_threshold > 0 && len >= mk->compress_threshold) {
+        char *buf = malloc(len + 1);
+        if (buf == NULL) return NULL;
+
+        uint64_t start = mk_now_ns();
+        size_t clen = mk_lz_compress(data, len, buf, len - 1);// 至少要省下一个字节
+        MK_ATOMIC_ADD(mk->cstats.compress_ns, mk_now_ns() - start);
+        MK_ATOMIC_ADD(mk->cstats.compress_calls, 1);
+
+        if (clen > 0) {
+            char *shrunk = realloc(buf, clen + 1);// 按压缩后的大小收缩
+            if (shrunk != NULL) buf = shrunk;
+            buf[clen] = '\0';
+            *stored_len = clen;
+            *enc = MK_ENC_LZ;
+            return buf;
         }
-        node = node->next;
+        MK_ATOMIC_ADD(mk->cstats.incompressible, 1);
+        free(buf);
     }
-    free(validKey);
-    return NULL;//未找到节点
+
+    *stored_len = len;
+    *enc = MK_ENC_RAW;
+    return mk_dup_bytes(data, len);
+}
+
+// 把节点的压缩value计入/移出压缩统计（sign为1或-1）
+static void mk_cstats_track(mk_t *mk, const mk_node_t *node, int sign) {
+    if (node->enc != MK_ENC_LZ) return;
+    if (sign > 0) {
+        MK_ATOMIC_ADD(mk->cstats.compressed_values, 1);
+        MK_ATOMIC_ADD(mk->cstats.raw_bytes, node->raw_len);
+        MK_ATOMIC_ADD(mk->cstats.stored_bytes, node->value_len);
+    } else {
+        MK_ATOMIC_SUB(mk->cstats.compressed_values, 1);
+        MK_ATOMIC_SUB(mk->cstats.raw_bytes, node->raw_len);
+        MK_ATOMIC_SUB(mk->cstats.stored_bytes, node->value_len);
+    }
+}
+
+// 节点的当前版本是否可能被某个活动快照看到（存在序号不小于该版本的快照）
+// 与mk_snapshot_end的release配对：看到快照已结束时，快照线程之前对value的读取都已完成
+static int mk_mvcc_needed(const mk_t *mk, const mk_node_t *node) {
+    return __atomic_load_n(&mk->snap_count, __ATOMIC_ACQUIRE) > 0 &&
+           __atomic_load_n(&mk->snap_newest, __ATOMIC_ACQUIRE) >= node->version;
+}
+
+// 修改节点前调用：当前版本仍可能被快照看到时，把它挂到旧版本链上保留（调用方持有分段写锁）
+// 返回1表示已保留（value缓冲区转交给旧版本，不能释放），0表示不需要保留，-1表示内存不足
+static int mk_mvcc_retire(mk_t *mk, mk_node_t *node, mk_spare_t *sp) {
+    if (!mk_mvcc_needed(mk, node)) return 0;
+    mk_node_t *old = mk_spare_old(sp);
+    if (old == NULL) return -1;
+    *old = *node;
+    old->key = NULL;
+    old->next = NULL;
+    node->older = old;
+    MK_ATOMIC_ADD(mk->mem_used, mk_alloc_size(old));
+    MK_ATOMIC_ADD(mk->old_versions, 1);
+    return 1;
+}
+
+// 释放节点上不再被任何快照需要的旧版本（调用方持有分段写锁）
+// 保留版本号大于最老快照的旧版本，以及最老快照能看到的那一个
+static void mk_mvcc_prune(mk_t *mk, mk_node_t *node) {
+    mk_node_t **pp = &node->older;
+    if (*pp == NULL) return;
+    if (__atomic_load_n(&mk->snap_count, __ATOMIC_ACQUIRE) > 0) {
+        uint64_t oldest = __atomic_load_n(&mk->snap_oldest, __ATOMIC_ACQUIRE);
+        if (node->version > oldest) {
+            while (*pp != NULL && (*pp)->version > oldest) pp = &(*pp)->older;
+            if (*pp != NULL) pp = &(*pp)->older;
+        }
+    }
+
+    mk_node_t *old = *pp;
+    *pp = NULL;
+    while (old != NULL) {
+        mk_node_t *older = old->older;
+        MK_ATOMIC_SUB(mk->mem_used, mk_alloc_size(old) + mk_alloc_size(old->value));
+        MK_ATOMIC_SUB(mk->old_versions, 1);
+        mk_value_free(mk, old);
+        free(old);
+        old = older;
+    }
+}
+
+// 回收不再被任何快照需要的旧版本，旧版本都回收后的删除标记一并移除（逐个分段加写锁）
+void mk_mvcc_gc(mk_t *mk) {
+    for (size_t i = 0; i < MK_HASH_SIZE; i++) {
+        pthread_rwlock_wrlock(mk_stripe(mk, i));
+        mk_node_t *prev = NULL;
+        mk_node_t *curr = mk->buckets[i];
+        while (curr != NULL) {
+            mk_node_t *next = curr->next;
+            mk_mvcc_prune(mk, curr);
+            if (mk->lsm == NULL && (curr->flags & MK_NODE_TOMBSTONE) && curr->older == NULL) {
+                if (prev == NULL) mk->buckets[i] = next;
+                else prev->next = next;
+                MK_ATOMIC_SUB(mk->mem_used, mk_node_mem(curr));
+                free(curr->key);
+                free(curr->value);
+                free(curr);
+            } else {
+                prev = curr;
+            }
+            curr = next;
+        }
+        pthread_rwlock_unlock(mk_stripe(mk, i));
+    }
+}
+
+// 取出节点value的原始字节：未压缩时直接返回表内指针，整数编码、压缩或存放在值日志中时还原到线程局部缓冲区
+// 线程局部缓冲区在同一线程下次取值前有效；解压失败返回NULL
+const char *mk_node_value(const mk_t *mk, const mk_node_t *node, size_t *len) {
+    if (node->enc == MK_ENC_RAW) {
+        if (len != NULL) *len = node->value_len;
+        return node->value;
+    }
+
+    char *tls_buf = mk_tls_buffer(node->raw_len + 1);
+    if (tls_buf == NULL) return NULL;
+    if (mk_node_decode(mk, node, tls_buf, node->raw_len + 1) != 0) return NULL;
+    if (len != NULL) *len = node->raw_len;
+    return tls_buf;
+}
+
+// 把节点value的原始字节写入buf（cap至少为原始长度+1），末尾补'\0'
+int mk_node_decode(const mk_t *mk, const mk_node_t *node, char *buf, size_t cap) {
+    if (cap < node->raw_len + 1) return -1;
+    if (node->enc == MK_ENC_RAW) {
+        memcpy(buf, node->value, node->value_len);
+        buf[node->value_len] = '\0';
+        return 0;
+    }
+    if (node->enc == MK_ENC_INT) {
+        // 整数编码只保存int64，取值时再格式化为十进制字符串（长度为raw_len）
+        mk_ll2str(buf, node->ival);
+        return 0;
+    }
+    if (node->enc == MK_ENC_VLOG) {
+        // 复制出来再使用：回收可能在释放分段锁后搬走记录
+        memcpy(buf, mk_vlog_value(mk, node->vlog_off), node->raw_len + 1);
+        return 0;
+    }
+
+    // 统计写入const表：表对象本身总是由mk_create在堆上创建的
+    mk_compress_stats_t *cstats = (mk_compress_stats_t *)&mk->cstats;
+    uint64_t start = mk_now_ns();
+    size_t n = mk_lz_decompress(node->value, node->value_len, buf, cap);
+    MK_ATOMIC_ADD(cstats->decompress_ns, mk_now_ns() - start);
+    MK_ATOMIC_ADD(cstats->decompress_calls, 1);
+    if (n != node->raw_len) {
+        fprintf(stderr, "mk_node_decode 压缩数据损坏 ❌\n");
+        return -1;
+    }
+    buf[n] = '\0';
+    return 0;
+}
+
+// 设置/覆盖key的value（C字符串）
+int mk_put(mk_t *mk, const char *key, const char *value) {
+    // 处理value（允许空字符串）
+    const char *val = (value == NULL) ? "" : value;
+    return mk_put_bin(mk, key, val, strlen(val));
+}
+
+// 写入的条件（内部使用）
+#define MK_PUT_ALWAYS 0// 无条件写入
+#define MK_PUT_IF_VERSION 1// 版本号等于expected时写入
+#define MK_PUT_IF_ABSENT 2// key不存在时写入
+#define MK_PUT_IF_PRESENT 3// key存在时写入
+
+// key当前的版本号（调用方持有所在分段的锁）：不存在或已删除为0，只在磁盘层中时为磁盘表记录的写入时的版本号
+static uint64_t mk_key_version(const mk_t *mk, const char *validKey, const mk_node_t *node) {
+    if (node != NULL) return (node->flags & MK_NODE_TOMBSTONE) ? 0 : node->version;
+    uint64_t version = 0;
+    if (mk->lsm != NULL && mk_lsm_get(mk, validKey, &(const char *){NULL}, NULL, &version) == 0) return version;
+    return 0;
+}
+
+// 在锁外编码好的新value
+typedef struct {
+    char *value;                       // 编码后的value，整数编码和值日志编码时为NULL
+    size_t stored_len;
+    int64_t ival;                      // 整数值，或值日志中的记录位置
+    unsigned char enc;
+} mk_newval_t;
+
+// 在锁外编码新值（压缩可能比较耗时）；规范形式的整数只存为int64，不分配value缓冲区
+// 大value开启值日志时追加到值日志，节点只保存记录位置（不再压缩）
+static int mk_newval_prepare(mk_t *mk, const char *validKey, const void *data, size_t len, mk_newval_t *v) {
+    memset(v, 0, sizeof(*v));
+    if (mk_vlog_wants(mk, len)) {
+        uint64_t off = 0;
+        if (mk_vlog_append(mk, validKey, data, len, &off) != 0) return -1;
+        v->enc = MK_ENC_VLOG;
+        v->ival = (int64_t)off;
+    } else if (mk_str2ll(data, len, &v->ival)) {
+        v->enc = MK_ENC_INT;
+    } else {
+        v->value = mk_encode_value(mk, data, len, &v->stored_len, &v->enc);
+        if (v->value == NULL) {
+            perror("mk_put 内存分配失败");
+            return -1;
+        }
+    }
+    return 0;
 }
 
-// 设置/覆盖key的value
-int mk_put(mk_t *mk, const char *key, const char *value) {//todo
+// 放弃没有写入的新值
+static void mk_newval_discard(mk_t *mk, mk_newval_t *v) {
+    if (v->enc == MK_ENC_VLOG) {
+        mk_vlog_release(mk, (uint64_t)v->ival);
+        mk_vlog_unpin(mk, (uint64_t)v->ival);
+    }
+    free(v->value);
+    v->value = NULL;
+}
+
+// 把新值写入key（调用方持有所在分段的写锁，node为桶中查到的节点）
+// 成功时新值归节点所有；失败返回-1，新值仍由调用方放弃
+static int mk_put_locked(mk_t *mk, size_t idx, const char *validKey, mk_node_t *node, mk_newval_t *v, size_t len,
+                         mk_spare_t *sp) {
+    uint64_t version = MK_ATOMIC_ADD(mk->seq, 1);
+    if (node != NULL) {
+        // 覆盖value：旧值仍可能被快照看到时保留为旧版本，否则释放
+        mk_mvcc_prune(mk, node);
+        int kept = mk_mvcc_retire(mk, node, sp);
+        if (kept < 0) {
+            perror("mk_put 内存分配失败");
+            return -1;
+        }
+        mk_cstats_track(mk, node, -1);
+        if (!kept) {
+            MK_ATOMIC_SUB(mk->mem_used, mk_alloc_size(node->value));
+            mk_value_free(mk, node);
+        }
+        MK_ATOMIC_ADD(mk->mem_used, mk_alloc_size(v->value));
+        node->value = v->value;
+        node->value_len = v->stored_len;
+        node->raw_len = len;
+        node->ival = v->ival;
+        node->enc = v->enc;
+        node->version = version;
+        mk_cstats_track(mk, node, 1);
+        if (node->flags & MK_NODE_TOMBSTONE) {
+            // 覆盖删除标记，key重新生效
+            node->flags &= ~MK_NODE_TOMBSTONE;
+            MK_ATOMIC_ADD(mk->count, 1);
+        }
+        if (v->enc == MK_ENC_VLOG) mk_vlog_unpin(mk, (uint64_t)v->ival);// 记录已有节点引用
+        return 0;
+    }
+
+    // 不存在则新建节点
+    node = mk_spare_node(sp, validKey);
+    if (node == NULL) {
+        perror("mk_put 内存分配失败");
+        return -1;
+    }
+    node->value = v->value;
+    node->value_len = v->stored_len;
+    node->raw_len = len;
+    node->ival = v->ival;
+    node->enc = v->enc;
+    node->version = version;
+
+    // 插入哈希桶（头插法）
+    node->next = mk->buckets[idx];
+    mk->buckets[idx] = node;
+    MK_ATOMIC_ADD(mk->count, 1);
+    MK_ATOMIC_ADD(mk->mem_used, mk_node_mem(node));
+    mk_cstats_track(mk, node, 1);
+    if (v->enc == MK_ENC_VLOG) mk_vlog_unpin(mk, (uint64_t)v->ival);
+    return 0;
+}
+
+// 写入的实现（内部函数）：cond不满足时不写入并返回1
+static int mk_put_bin_impl(mk_t *mk, const char *key, const void *data, size_t len, int cond, uint64_t expected) {
     // 参数校验
-    if (mk == NULL || key == NULL || *key == '\0') {
+    if (mk == NULL || key == NULL || *key == '\0' || (data == NULL && len > 0)) {
         fprintf(stderr, "mk_put 函数参数错误 ❌\n");
         return -1;
     }
+    if (len >= UINT32_MAX) {
+        // 磁盘表和写日志用u32记录value长度，0xffffffff表示删除标记
+        fprintf(stderr, "mk_put value过长 ❌\n");
+        return -1;
+    }
 
   //去除key两边的空格
    char * validKey=mk_trim(key);//如果key两边有空格也判定为合法
@@ -89,131 +642,822 @@ int mk_put(mk_t *mk, const char *key, const char *value) {//todo
         return -1;
    }
 
-    // 校验key合法性
-   int check =mk_is_valid_key(validKey);//判断key的合法性
-   if(check!=0){//key不合法
-        fprintf(stderr, "mk_put 非法的key! ❌\n");
-        free(validKey);
-        return check;
-   }
+    // 校验key合法性
+   int check =mk_is_valid_key(validKey);//判断key的合法性
+   if(check!=0){//key不合法
+        fprintf(stderr, "mk_put 非法的key! ❌\n");
+        free(validKey);
+        return check;
+   }
+
+    if (mk->wal != NULL && mk_wal_reserve(mk, strlen(validKey), len) != 0) {
+        free(validKey);
+        return -1;
+    }
+    mk_newval_t v;
+    if (mk_newval_prepare(mk, validKey, data, len, &v) != 0) {
+        free(validKey);
+        return -1;
+    }
+
+    size_t idx = mk_hash(validKey);
+    pthread_rwlock_wrlock(mk_stripe(mk, idx));
+    if (mk->hot != NULL) mk_hotkeys_touch(mk, validKey);
+
+    // 查找是否已存在该key
+    mk_node_t *node = mk_bucket_find(mk, idx, validKey);
+    int ret = 0;
+    if (cond != MK_PUT_ALWAYS) {
+        // 条件判断和写入在同一把写锁下完成
+        uint64_t cur = mk_key_version(mk, validKey, node);
+        int ok = (cond == MK_PUT_IF_VERSION) ? (cur == expected) : ((cond == MK_PUT_IF_PRESENT) == (cur != 0));
+        if (!ok) ret = 1;
+    }
+    if (ret == 0) ret = mk_put_locked(mk, idx, validKey, node, &v, len, NULL);
+    if (ret != 0) {
+        mk_newval_discard(mk, &v);
+        pthread_rwlock_unlock(mk_stripe(mk, idx));
+        free(validKey);
+        return ret;
+    }
+
+    // 持锁写入复制日志和写日志，保证同一个key的操作顺序与生效顺序一致
+    if (mk->repl != NULL) mk_repl_feed(mk, MK_OP_PUT, validKey, data, len);
+    if (mk->wal != NULL) mk_wal_feed(mk, MK_OP_PUT, validKey, data, len);
+    pthread_rwlock_unlock(mk_stripe(mk, idx));
+    free(validKey);
+    return mk_lsm_maybe_flush(mk);
+}
+
+// 设置/覆盖key的value（任意字节，可包含'\0'）
+int mk_put_bin(mk_t *mk, const char *key, const void *data, size_t len) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_put_bin_impl(mk, key, data, len, MK_PUT_ALWAYS, 0);
+    mk_slowlog_end(mk, "put", key, start);
+    return ret;
+}
+
+// key的版本号等于expected_version时写入（乐观并发控制，配合mk_get_versioned使用）
+// expected_version为0表示要求key不存在；成功返回0，版本不符返回1，出错返回-1
+int mk_cas(mk_t *mk, const char *key, uint64_t expected_version, const void *data, size_t len) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_put_bin_impl(mk, key, data, len, MK_PUT_IF_VERSION, expected_version);
+    mk_slowlog_end(mk, "cas", key, start);
+    return ret;
+}
+
+// key不存在时写入；成功返回0，已存在返回1，出错返回-1
+int mk_put_if_absent(mk_t *mk, const char *key, const void *data, size_t len) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_put_bin_impl(mk, key, data, len, MK_PUT_IF_ABSENT, 0);
+    mk_slowlog_end(mk, "putnx", key, start);
+    return ret;
+}
+
+// key存在时写入；成功返回0，不存在返回1，出错返回-1
+int mk_put_if_present(mk_t *mk, const char *key, const void *data, size_t len) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_put_bin_impl(mk, key, data, len, MK_PUT_IF_PRESENT, 0);
+    mk_slowlog_end(mk, "putxx", key, start);
+    return ret;
+}
+
+// 读出key当前的整数值（调用方持有所在分段的写锁），不存在视为0
+// value不是规范形式的整数时返回-1
+static int mk_int_current(const mk_t *mk, const char *validKey, const mk_node_t *node, int64_t *cur) {
+    const char *value = NULL;
+    size_t len = 0;
+    *cur = 0;
+    if (node != NULL) {
+        if (node->flags & MK_NODE_TOMBSTONE) return 0;
+        if (node->enc == MK_ENC_INT) {
+            *cur = node->ival;
+            return 0;
+        }
+        value = mk_node_value(mk, node, &len);
+    } else if (mk->lsm == NULL || mk_lsm_get(mk, validKey, &value, &len, NULL) != 0) {
+        return 0;
+    }
+    return (value != NULL && mk_str2ll(value, len, cur)) ? 0 : -1;
+}
+
+// mk_incrby的实现（内部函数）
+static int mk_incrby_impl(mk_t *mk, const char *key, int64_t delta, int64_t *result) {
+    if (mk == NULL || key == NULL || *key == '\0') {
+        fprintf(stderr, "mk_incrby 无效的参数 ❌\n");
+        return -1;
+    }
+
+    // key首尾没有空白时直接使用，避免每次分配
+    char *trimmed = NULL;
+    const char *validKey = key;
+    if (isspace((unsigned char)key[0]) || isspace((unsigned char)key[strlen(key) - 1])) {
+        trimmed = mk_trim(key);
+        if (trimmed == NULL) {
+            perror("mk_incrby 内存分配失败");
+            return -1;
+        }
+        validKey = trimmed;
+    }
+    if (mk_is_valid_key(validKey) != 0) {
+        fprintf(stderr, "mk_incrby 非法的key! ❌\n");
+        free(trimmed);
+        return -1;
+    }
+
+    size_t idx = mk_hash(validKey);
+    pthread_rwlock_wrlock(mk_stripe(mk, idx));
+    if (mk->hot != NULL) mk_hotkeys_touch(mk, validKey);
+    mk_node_t *node = mk_bucket_find(mk, idx, validKey);
+    int64_t cur = 0, next = 0;
+    int ret = 0;
+    if (mk_int_current(mk, validKey, node, &cur) != 0) {
+        fprintf(stderr, "键 %s 的值不是整数 ❌\n", validKey);
+        ret = -1;
+    } else if (__builtin_add_overflow(cur, delta, &next)) {
+        fprintf(stderr, "键 %s 的整数值溢出 ❌\n", validKey);
+        ret = -1;
+    }
+
+    // 已是整数编码且旧值不再被快照需要时直接改写int64，否则释放（或为快照保留）旧value后改为整数编码
+    if (ret == 0 && node != NULL) mk_mvcc_prune(mk, node);
+    int inplace = ret == 0 && node != NULL && node->enc == MK_ENC_INT &&
+                  !(node->flags & MK_NODE_TOMBSTONE) && !mk_mvcc_needed(mk, node);
+    if (ret == 0 && !inplace && node != NULL) {
+        int kept = mk_mvcc_retire(mk, node, NULL);
+        if (kept < 0) {
+            perror("mk_incrby 内存分配失败");
+            ret = -1;
+        } else {
+            mk_cstats_track(mk, node, -1);
+            if (!kept) {
+                MK_ATOMIC_SUB(mk->mem_used, mk_alloc_size(node->value));
+                mk_value_free(mk, node);
+            }
+            node->value = NULL;
+            if (node->flags & MK_NODE_TOMBSTONE) {
+                node->flags &= ~MK_NODE_TOMBSTONE;
+                MK_ATOMIC_ADD(mk->count, 1);
+            }
+        }
+    } else if (ret == 0 && node == NULL) {
+        node = calloc(1, sizeof(mk_node_t));
+        if (node != NULL) node->key = strdup(validKey);
+        if (node == NULL || node->key == NULL) {
+            free(node);
+            perror("mk_incrby 内存分配失败");
+            ret = -1;
+        } else {
+            node->next = mk->buckets[idx];
+            mk->buckets[idx] = node;
+            MK_ATOMIC_ADD(mk->count, 1);
+            MK_ATOMIC_ADD(mk->mem_used, mk_node_mem(node));
+        }
+    }
+    if (ret == 0) {
+        char digits[MK_INT_BUF];
+        size_t ndigits = mk_ll2str(digits, next);
+        node->enc = MK_ENC_INT;
+        node->ival = next;
+        node->value_len = 0;
+        node->raw_len = ndigits;
+        node->version = MK_ATOMIC_ADD(mk->seq, 1);
+        if (mk->repl != NULL) mk_repl_feed(mk, MK_OP_PUT, validKey, digits, ndigits);
+        if (mk->wal != NULL) mk_wal_feed(mk, MK_OP_PUT, validKey, digits, ndigits);
+        if (result != NULL) *result = next;
+    }
+    pthread_rwlock_unlock(mk_stripe(mk, idx));
+    free(trimmed);
+    return (ret == 0) ? mk_lsm_maybe_flush(mk) : -1;
+}
+
+// 把key的整数值原子地加上delta，结果写入result（可为NULL）；key不存在时从0开始
+// 整数编码只保存int64，已是整数编码的key原地更新，不分配内存；value不是整数或结果溢出时返回-1且不做修改
+int mk_incrby(mk_t *mk, const char *key, int64_t delta, int64_t *result) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_incrby_impl(mk, key, delta, result);
+    mk_slowlog_end(mk, "incrby", key, start);
+    return ret;
+}
+
+// 把key的整数值原子地减去delta
+int mk_decrby(mk_t *mk, const char *key, int64_t delta, int64_t *result) {
+    if (delta == INT64_MIN) {
+        fprintf(stderr, "mk_decrby 整数值溢出 ❌\n");
+        return -1;
+    }
+    return mk_incrby(mk, key, -delta, result);
+}
+
+// mk_lookup的实现（内部函数）
+static const char *mk_lookup_impl(const mk_t *mk, const char *key, size_t *len) {
+    if (mk == NULL || key == NULL) return NULL;
+    char *validKey = mk_trim(key);
+    if (validKey == NULL) return NULL;
+
+    size_t idx = mk_hash(validKey);
+    const char *value = NULL;
+    pthread_rwlock_rdlock(mk_stripe(mk, idx));
+    if (mk->hot != NULL) mk_hotkeys_touch(mk, validKey);
+    mk_node_t *node = mk_bucket_find(mk, idx, validKey);
+    if (node != NULL) {
+        if (!(node->flags & MK_NODE_TOMBSTONE)) value = mk_node_value(mk, node, len);
+    } else if (mk->lsm != NULL) {
+        mk_lsm_get(mk, validKey, &value, len, NULL);
+    }
+    pthread_rwlock_unlock(mk_stripe(mk, idx));
+    free(validKey);
+    return value;
+}
+
+// 查找key对应的value（内部函数）：先查内存表，未命中且开启了磁盘层时再查磁盘
+// 返回value指针（表内存储或线程局部缓冲区），不存在返回NULL
+static const char *mk_lookup(const mk_t *mk, const char *key, size_t *len) {
+    uint64_t start = mk_slowlog_start(mk);
+    const char *value = mk_lookup_impl(mk, key, len);
+    mk_slowlog_end(mk, "get", key, start);
+    return value;
+}
+
+// 查询key对应的value
+// 原样存储的value返回表内指针，在该key下次被修改或删除前有效，可以同时持有多个
+// 整数编码、压缩存储、存放在值日志中或从磁盘读出的value放在线程局部缓冲区，在同一线程下次查询前有效
+// 多线程同时读写同一个key时请使用mk_get_buf
+const char* mk_get(const mk_t *mk, const char *key) {
+    return mk_lookup(mk, key, NULL);
+}
+
+// 查询key对应的value（零拷贝），data指向表内存储的字节，len为其长度
+// 指针在该key下次被修改或删除前有效；整数编码、压缩存储、存放在值日志中或从磁盘读出的value放在线程局部缓冲区
+// key不存在返回-1
+int mk_get_bin(const mk_t *mk, const char *key, const void **data, size_t *len) {
+    if (data == NULL || len == NULL) {
+        fprintf(stderr, "mk_get_bin 无效的参数 ❌\n");
+        return -1;
+    }
+    const char *value = mk_lookup(mk, key, len);
+    if (value == NULL) return -1;
+    *data = value;
+    return 0;
+}
+
+// mk_get_buf的实现（内部函数），version不为NULL时返回key的版本号（不存在为0）
+static int mk_get_buf_impl(const mk_t *mk, const char *key, void *buf, size_t cap, size_t *len, uint64_t *version) {
+    if (mk == NULL || key == NULL || buf == NULL || len == NULL) {
+        fprintf(stderr, "mk_get_buf 无效的参数 ❌\n");
+        return -1;
+    }
+    char *validKey = mk_trim(key);
+    if (validKey == NULL) return -1;
+
+    size_t idx = mk_hash(validKey);
+    int ret = -1;
+    pthread_rwlock_rdlock(mk_stripe(mk, idx));
+    if (mk->hot != NULL) mk_hotkeys_touch(mk, validKey);
+    mk_node_t *node = mk_bucket_find(mk, idx, validKey);
+    if (version != NULL) *version = 0;
+    if (node != NULL) {
+        if (!(node->flags & MK_NODE_TOMBSTONE)) {
+            *len = node->raw_len;
+            if (version != NULL) *version = node->version;
+            ret = mk_node_decode(mk, node, buf, cap);
+        }
+    } else if (mk->lsm != NULL) {
+        // 内存表未命中，查磁盘层
+        const char *value = NULL;
+        if (mk_lsm_get(mk, validKey, &value, len, version) == 0) {
+            if (cap >= *len + 1) {
+                memcpy(buf, value, *len + 1);
+                ret = 0;
+            }
+        }
+    }
+    pthread_rwlock_unlock(mk_stripe(mk, idx));
+    free(validKey);
+    return ret;
+}
+
+// 查询key对应的value并复制（必要时解压）到调用方提供的buf中，末尾补'\0'
+// 复制在锁内完成，可以与其他线程的写操作并发；len返回value长度
+// key不存在返回-1，cap不足（需不小于长度+1）时返回-1且len为所需长度
+int mk_get_buf(const mk_t *mk, const char *key, void *buf, size_t cap, size_t *len) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_get_buf_impl(mk, key, buf, cap, len, NULL);
+    mk_slowlog_end(mk, "get", key, start);
+    return ret;
+}
+
+// 与mk_get_buf相同，并在同一把锁下取出key的版本号（value与版本号一致）
+// key不存在返回-1且version为0；cap不足时返回-1，len和version照常返回
+int mk_get_versioned(const mk_t *mk, const char *key, void *buf, size_t cap, size_t *len, uint64_t *version) {
+    if (version == NULL) {
+        fprintf(stderr, "mk_get_versioned 无效的参数 ❌\n");
+        return -1;
+    }
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_get_buf_impl(mk, key, buf, cap, len, version);
+    mk_slowlog_end(mk, "get", key, start);
+    return ret;
+}
+
+// 把节点的value换成删除标记，旧值仍可能被快照看到时保留为旧版本
+static int mk_del_to_tombstone(mk_t *mk, mk_node_t *node, uint64_t version, mk_spare_t *sp) {
+    char *empty = mk_spare_empty(sp);
+    int kept = (empty == NULL) ? -1 : mk_mvcc_retire(mk, node, sp);
+    if (kept < 0) {
+        free(empty);
+        perror("mk_del 内存分配失败");
+        return -1;
+    }
+    mk_cstats_track(mk, node, -1);
+    if (!kept) {
+        MK_ATOMIC_SUB(mk->mem_used, mk_alloc_size(node->value));
+        mk_value_free(mk, node);
+    }
+    MK_ATOMIC_ADD(mk->mem_used, mk_alloc_size(empty));
+    node->value = empty;
+    node->value_len = 0;
+    node->raw_len = 0;
+    node->enc = MK_ENC_RAW;
+    node->flags |= MK_NODE_TOMBSTONE;
+    node->version = version;
+    return 0;
+}
+
+// 删除指定key（调用方持有所在分段的写锁），成功返回0，key不存在返回1，出错返回-1
+static int mk_del_locked(mk_t *mk, size_t idx, const char *validKey, mk_spare_t *sp) {
+    uint64_t version = MK_ATOMIC_ADD(mk->seq, 1);
+    mk_node_t *prev = NULL;
+    mk_node_t *curr = mk->buckets[idx];
+
+    // 遍历链表找key
+    while (curr != NULL) {
+        if (strcmp(curr->key, validKey) == 0) {
+            if (curr->flags & MK_NODE_TOMBSTONE) return 1;// 已经删除过
+
+            mk_mvcc_prune(mk, curr);
+            if (mk->lsm != NULL || curr->older != NULL || mk_mvcc_needed(mk, curr)) {
+                // 开启磁盘层时留下删除标记遮住磁盘上的旧值；快照还需要旧版本时由删除标记保存版本链
+                if (mk_del_to_tombstone(mk, curr, version, sp) != 0) return -1;
+                MK_ATOMIC_SUB(mk->count, 1);
+                return 0;
+            }
+
+            // 从链表中移除节点
+            if (prev == NULL) {
+                mk->buckets[idx] = curr->next;
+            } else {
+                prev->next = curr->next;
+            }
+            // 释放节点内存
+            MK_ATOMIC_SUB(mk->mem_used, mk_node_mem(curr));
+            mk_cstats_track(mk, curr, -1);
+            free(curr->key);
+            mk_value_free(mk, curr);
+            free(curr);
+            MK_ATOMIC_SUB(mk->count, 1);
+            return 0;
+        }
+        prev = curr;
+        curr = curr->next;
+    }
+
+    // 内存表中没有，但磁盘层中存在：插入一个删除标记
+    int found = (mk->lsm == NULL) ? 1 : mk_lsm_get(mk, validKey, &(const char *){NULL}, NULL, NULL);
+    if (found != 0) return found;
+    mk_node_t *node = mk_spare_node(sp, validKey);
+    if (node == NULL || (node->value = mk_spare_empty(sp)) == NULL) {
+        if (node != NULL) free(node->key);
+        free(node);
+        perror("mk_del 内存分配失败");
+        return -1;
+    }
+    node->flags = MK_NODE_TOMBSTONE;
+    node->version = version;
+    node->next = mk->buckets[idx];
+    mk->buckets[idx] = node;
+    MK_ATOMIC_ADD(mk->mem_used, mk_node_mem(node));
+    return 0;
+}
+
+// 加锁删除已去除空白的key，并写入复制日志和写日志；返回值同mk_del_locked
+static int mk_del_key(mk_t *mk, const char *validKey) {
+    size_t idx = mk_hash(validKey);
+    pthread_rwlock_wrlock(mk_stripe(mk, idx));
+    int ret = mk_del_locked(mk, idx, validKey, NULL);
+    if (ret == 0 && mk->repl != NULL) mk_repl_feed(mk, MK_OP_DEL, validKey, NULL, 0);
+    if (ret == 0 && mk->wal != NULL) mk_wal_feed(mk, MK_OP_DEL, validKey, NULL, 0);
+    pthread_rwlock_unlock(mk_stripe(mk, idx));
+    return ret;
+}
+
+// mk_del的实现（内部函数）
+static int mk_del_impl(mk_t *mk, const char *key) {
+    if (mk == NULL || key == NULL || *key == '\0') {
+
+
+        fprintf(stderr,"mk_del 无效的参数\n");
+        return -1;
+    }
+
+    // 去除key两边的空格
+    char * validKey=mk_trim(key);
+    if (validKey == NULL) {
+        perror("mk_del 内存分配失败");
+        return -1;
+    }
+    int ret = mk_del_key(mk, validKey);
+    if (ret != 0) {
+        // key不存在
+        if (ret > 0) fprintf(stderr, "键 %s 不存在 ❌\n",validKey);
+        free(validKey);
+        return -1;
+    }
+    free(validKey);
+    return mk_lsm_maybe_flush(mk);
+}
+
+// 删除指定key
+int mk_del(mk_t *mk, const char *key) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_del_impl(mk, key);
+    mk_slowlog_end(mk, "del", key, start);
+    return ret;
+}
+
+// 应用一条复制日志中的写操作（不输出提示信息），删除不存在的key视为成功
+int mk_apply(mk_t *mk, int op, const char *key, const void *data, size_t len) {
+    if (mk == NULL || key == NULL) return -1;
+    if (op == MK_OP_PUT) return mk_put_bin(mk, key, data, len);
+    if (op == MK_OP_BATCH) return mk_batch_apply(mk, data, len);
+    if (op != MK_OP_DEL) return -1;
+    if (mk_del_key(mk, key) < 0) return -1;
+    return mk_lsm_maybe_flush(mk);
+}
+
+// 网络服务和共享内存服务的删除：key先去除空白并校验，不输出提示信息
+// 删除了返回1，key不存在返回0，key不合法或出错返回-1
+int mk_del_checked(mk_t *mk, const char *key) {
+    if (mk == NULL || key == NULL) return -1;
+    char *validKey = mk_trim(key);
+    if (validKey == NULL) return -1;
+    int ret = (mk_is_valid_key(validKey) == 0) ? mk_del_key(mk, validKey) : -1;
+    free(validKey);
+    if (ret < 0) return -1;
+    if (ret > 0) return 0;
+    return (mk_lsm_maybe_flush(mk) == 0) ? 1 : -1;
+}
+
+// 批量写：操作依次排列在一块内存中，格式与写日志记录相同（见MK_BATCH_OP_HDR），
+// 提交时作为一条记录写入复制日志和写日志
+struct mk_batch {
+    char *buf;
+    size_t len;
+    size_t cap;
+    size_t count;                      // 操作数
+};
+
+// 批量写中的一个操作（提交时使用）
+typedef struct {
+    int op;
+    const char *key;
+    const char *data;
+    size_t len;
+    size_t idx;                        // key所在的哈希桶
+    mk_newval_t v;                     // 写入的新值（在锁外编码）
+    mk_spare_t sp;                     // 应用时需要的节点等内存（在锁外分配）
+} mk_batch_op_t;
+
+// 创建空的批量写
+mk_batch_t *mk_batch_create(void) {
+    mk_batch_t *b = calloc(1, sizeof(mk_batch_t));
+    if (b == NULL) perror("mk_batch_create 内存分配失败");
+    return b;
+}
+
+// 追加一个操作：key在这里去除空白并校验，不合法时不加入
+static int mk_batch_add(mk_batch_t *b, int op, const char *key, const void *data, size_t len) {
+    if (b == NULL || key == NULL || *key == '\0' || (data == NULL && len > 0) || len >= UINT32_MAX) {
+        fprintf(stderr, "mk_batch 无效的参数 ❌\n");
+        return -1;
+    }
+    char *validKey = mk_trim(key);
+    if (validKey == NULL) {
+        perror("mk_batch 内存分配失败");
+        return -1;
+    }
+    if (mk_is_valid_key(validKey) != 0) {
+        fprintf(stderr, "mk_batch 非法的key! ❌\n");
+        free(validKey);
+        return -1;
+    }
+    size_t klen = strlen(validKey);
+    size_t need = MK_BATCH_OP_HDR + klen + 1 + len;
+    if (b->len + need > b->cap) {
+        size_t ncap = b->cap ? b->cap * 2 : 4096;
+        while (ncap < b->len + need) ncap *= 2;
+        char *grown = realloc(b->buf, ncap);
+        if (grown == NULL) {
+            perror("mk_batch 内存分配失败");
+            free(validKey);
+            return -1;
+        }
+        b->buf = grown;
+        b->cap = ncap;
+    }
+    char *p = b->buf + b->len;
+    uint32_t zero = 0, k32 = (uint32_t)klen, v32 = (uint32_t)len;
+    uint8_t op8 = (uint8_t)op;
+    memcpy(p, &zero, 4);
+    memcpy(p + 4, &op8, 1);
+    memcpy(p + 5, &k32, 4);
+    memcpy(p + 9, &v32, 4);
+    memcpy(p + MK_BATCH_OP_HDR, validKey, klen + 1);
+    if (len > 0) memcpy(p + MK_BATCH_OP_HDR + klen + 1, data, len);
+    b->len += need;
+    b->count++;
+    free(validKey);
+    return 0;
+}
+
+// 向批量写追加一次写入
+int mk_batch_put(mk_batch_t *b, const char *key, const void *data, size_t len) {
+    return mk_batch_add(b, MK_OP_PUT, key, data, len);
+}
+
+// 向批量写追加一次删除（提交时key不存在视为成功）
+int mk_batch_del(mk_batch_t *b, const char *key) {
+    return mk_batch_add(b, MK_OP_DEL, key, NULL, 0);
+}
 
+// 批量写中的操作数
+size_t mk_batch_count(const mk_batch_t *b) {
+    return (b == NULL) ? 0 : b->count;
+}
 
- 
+// 清空批量写，保留缓冲区以便复用
+void mk_batch_clear(mk_batch_t *b) {
+    if (b == NULL) return;
+    b->len = 0;
+    b->count = 0;
+}
 
-    // 处理value（允许空字符串）
-    const char *val = (value == NULL) ? "" : value;
+// 释放批量写
+void mk_batch_free(mk_batch_t *b) {
+    if (b == NULL) return;
+    free(b->buf);
+    free(b);
+}
 
-    // 查找是否已存在该key
-    mk_node_t *node = mk_find_node(mk, validKey);
-    if (node != NULL) {
-        // 覆盖value：先释放旧值，再分配新值
-        char *new_val = strdup(val);
-        if (new_val == NULL) {
-            perror("mk_put 内存分配失败");
-            free(validKey);
-            return -1;
+// 解析批量写的操作序列，格式或key不合法返回-1
+static int mk_batch_parse(const char *buf, size_t len, mk_batch_op_t **out, size_t *count) {
+    size_t n = 0, cap = 0, off = 0;
+    mk_batch_op_t *ops = NULL;
+    while (off < len) {
+        uint32_t klen, vlen;
+        if (len - off < MK_BATCH_OP_HDR) break;
+        memcpy(&klen, buf + off + 5, 4);
+        memcpy(&vlen, buf + off + 9, 4);
+        const char *key = buf + off + MK_BATCH_OP_HDR;
+        size_t rec = MK_BATCH_OP_HDR + (size_t)klen + 1 + vlen;
+        int op = (unsigned char)buf[off + 4];
+        if (rec > len - off || vlen == UINT32_MAX || key[klen] != '\0' || strlen(key) != klen || mk_is_valid_key(key) != 0 ||
+            (op != MK_OP_PUT && op != MK_OP_DEL)) {
+            break;
         }
-        free(node->value);
-        node->value = new_val;
-        free(validKey);
-        return 0;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 16;
+            mk_batch_op_t *grown = realloc(ops, cap * sizeof(mk_batch_op_t));
+            if (grown == NULL) break;
+            ops = grown;
+        }
+        ops[n++] = (mk_batch_op_t){op, key, key + klen + 1, vlen, mk_hash(key), {NULL, 0, 0, 0}, {NULL, NULL, NULL}};
+        off += rec;
+    }
+    if (off < len) {
+        fprintf(stderr, "mk_batch 操作格式错误 ❌\n");
+        free(ops);
+        return -1;
     }
+    *out = ops;
+    *count = n;
+    return 0;
+}
 
-    // 不存在则新建节点
-    node = malloc(sizeof(mk_node_t));
-    if (node == NULL) {
-        perror("mk_put 内存分配失败");
-        free(validKey);
+// 原子地应用一组操作（mk_batch_t的缓冲区格式）：先校验全部操作，在锁外编码新值并分配应用时需要的全部内存，
+// 再按顺序获取涉及到的分段写锁，在同一个临界区内应用全部操作，并作为一条记录写入复制日志和写日志
+// 应用阶段不再分配内存，要么全部应用，要么（加锁前失败时）一个都不应用
+int mk_batch_apply(mk_t *mk, const char *buf, size_t len) {
+    mk_batch_op_t *ops = NULL;
+    size_t n = 0;
+    if (mk == NULL || (buf == NULL && len > 0) || mk_batch_parse(buf, len, &ops, &n) != 0) return -1;
+    if (n == 0) return 0;
+
+    int touched[MK_LOCK_STRIPES] = {0};
+    int ret = (mk->wal != NULL) ? mk_wal_reserve(mk, 0, len) : 0;
+    for (size_t i = 0; i < n && ret == 0; i++) {
+        mk_batch_op_t *o = &ops[i];
+        touched[o->idx % MK_LOCK_STRIPES] = 1;
+        if (mk_spare_alloc(&o->sp, o->key) != 0) {
+            perror("mk_batch 内存分配失败");
+            ret = -1;
+        } else if (o->op == MK_OP_PUT && mk_newval_prepare(mk, o->key, o->data, o->len, &o->v) != 0) {
+            ret = -1;
+        }
+    }
+    if (ret != 0) {
+        for (size_t i = 0; i < n; i++) {
+            mk_newval_discard(mk, &ops[i].v);
+            mk_spare_free(&ops[i].sp);
+        }
+        free(ops);
         return -1;
     }
-    node->next = NULL;
-    // 分配key和value内存
-    node->key = strdup(validKey);
-    node->value = strdup(val);
 
-    if (node->key == NULL || node->value == NULL) {
-        free(node->key);
-        free(node->value);
-        free(node);
-        free(validKey);
-        perror("mk_put 内存分配失败");
+    // 与mk_lock_all相同按编号顺序加锁，多个批量写之间不会死锁
+    for (int i = 0; i < MK_LOCK_STRIPES; i++) {
+        if (touched[i]) pthread_rwlock_wrlock(&mk->locks[i]);
+    }
+    for (size_t i = 0; i < n; i++) {
+        mk_batch_op_t *o = &ops[i];
+        if (mk->hot != NULL) mk_hotkeys_touch(mk, o->key);
+        if (o->op == MK_OP_DEL) {
+            mk_del_locked(mk, o->idx, o->key, &o->sp);// key不存在视为成功
+        } else {
+            mk_put_locked(mk, o->idx, o->key, mk_bucket_find(mk, o->idx, o->key), &o->v, o->len, &o->sp);
+        }
+    }
+    if (mk->repl != NULL) mk_repl_feed(mk, MK_OP_BATCH, "", buf, len);
+    if (mk->wal != NULL) mk_wal_feed(mk, MK_OP_BATCH, "", buf, len);
+    for (int i = MK_LOCK_STRIPES - 1; i >= 0; i--) {
+        if (touched[i]) pthread_rwlock_unlock(&mk->locks[i]);
+    }
+    for (size_t i = 0; i < n; i++) mk_spare_free(&ops[i].sp);
+    free(ops);
+    return mk_lsm_maybe_flush(mk);
+}
+
+// 原子地提交批量写：其他线程和快照要么看到全部操作，要么一个都看不到（批量写本身保持不变）
+int mk_batch_commit(mk_t *mk, const mk_batch_t *b) {
+    if (mk == NULL || b == NULL) {
+        fprintf(stderr, "mk_batch_commit 无效的参数 ❌\n");
         return -1;
     }
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_batch_apply(mk, b->buf, b->len);
+    mk_slowlog_end(mk, "batch", b->count > 0 ? b->buf + MK_BATCH_OP_HDR : NULL, start);
+    return ret;
+}
 
-    // 插入哈希桶（头插法）
+// 获取键值对数量
+size_t mk_count(const mk_t *mk) {
+    return (mk == NULL) ? 0 : MK_ATOMIC_LOAD(mk->count);
+}
+
+// 获取Hash表占用的全部内存字节数
+size_t mk_memory_usage(const mk_t *mk) {
+    return (mk == NULL) ? 0 : MK_ATOMIC_LOAD(mk->mem_used);
+}
+
+// 获取单个key占用的内存字节数，key不存在返回0
+size_t mk_key_memory_usage(const mk_t *mk, const char *key) {
+    if (mk == NULL || key == NULL) return 0;
+    char *validKey = mk_trim(key);
+    if (validKey == NULL) return 0;
     size_t idx = mk_hash(validKey);
-    node->next = mk->buckets[idx];
-    mk->buckets[idx] = node;
-    mk->count++;
+    pthread_rwlock_rdlock(mk_stripe(mk, idx));
+    mk_node_t *node = mk_bucket_find(mk, idx, validKey);
+    size_t bytes = (node != NULL && !(node->flags & MK_NODE_TOMBSTONE)) ? mk_node_mem(node) : 0;
+    pthread_rwlock_unlock(mk_stripe(mk, idx));
     free(validKey);
-    return 0;
+    return bytes;
 }
 
-// 查询key对应的value
-const char* mk_get(const mk_t *mk, const char *key) {
-    mk_node_t *node = mk_find_node(mk, key);
-    return (node != NULL) ? node->value : NULL;
+// 把一个节点放进按占用字节降序排列的top-n数组中（插入排序）
+static void mk_bigkeys_offer(mk_bigkey_t *out, size_t n, size_t *filled, const mk_node_t *node) {
+    if (node->flags & MK_NODE_TOMBSTONE) return;
+    size_t bytes = mk_node_mem(node);
+    if (*filled == n && out[n - 1].bytes >= bytes) return;//比当前最小的还小
+
+    size_t pos = (*filled < n) ? (*filled)++ : n - 1;
+    while (pos > 0 && out[pos - 1].bytes < bytes) {
+        out[pos] = out[pos - 1];
+        pos--;
+    }
+    snprintf(out[pos].key, sizeof(out[pos].key), "%s", node->key);
+    out[pos].bytes = bytes;
 }
 
-// 删除指定key
-int mk_del(mk_t *mk, const char *key) {
-    if (mk == NULL || key == NULL || *key == '\0') {
+// 抽样估计占用内存最大的n个key，samples为抽样的哈希桶数量（0或不小于桶数时全量扫描）
+// 返回实际写入out的个数
+size_t mk_memory_bigkeys(const mk_t *mk, size_t samples, mk_bigkey_t *out, size_t n) {
+    if (mk == NULL || out == NULL || n == 0) return 0;
+
+    size_t filled = 0;
+    if (samples == 0 || samples >= MK_HASH_SIZE) {
+        // 全量扫描
+        mk_lock_all(mk, 0);
+        for (int i = 0; i < MK_HASH_SIZE; i++) {
+            for (mk_node_t *node = mk->buckets[i]; node != NULL; node = node->next) {
+                mk_bigkeys_offer(out, n, &filled, node);
+            }
+        }
+        mk_unlock_all(mk);
+        return filled;
+    }
 
+    // 从随机位置开始连续抽取samples个桶（不会重复抽到同一个桶），扫描桶内整条链
+    // 种子按线程保存，多个线程同时抽样时不会竞争
+    static __thread unsigned int seed = 0;
+    if (seed == 0) seed = (unsigned int)mk_now_ns() | 1u;
+    size_t start = (size_t)rand_r(&seed) % MK_HASH_SIZE;
+    for (size_t s = 0; s < samples; s++) {
+        size_t idx = (start + s) % MK_HASH_SIZE;
+        pthread_rwlock_rdlock(mk_stripe(mk, idx));
+        for (mk_node_t *node = mk->buckets[idx]; node != NULL; node = node->next) {
+            mk_bigkeys_offer(out, n, &filled, node);
+        }
+        pthread_rwlock_unlock(mk_stripe(mk, idx));
+    }
+    return filled;
+}
 
-        fprintf(stderr,"mk_del 无效的参数\n");
+// 设置压缩阈值，value不小于threshold字节时压缩存储，0表示关闭压缩（已存储的value保持不变）
+int mk_set_compress_threshold(mk_t *mk, size_t threshold) {
+    if (mk == NULL) {
+        fprintf(stderr, "mk_set_compress_threshold 无效的参数 ❌\n");
         return -1;
     }
+    mk->compress_threshold = threshold;
+    return 0;
+}
 
-    // 去除key两边的空格
-    char * validKey=mk_trim(key);
-    if (validKey == NULL) {
-        perror("mk_del 内存分配失败");
+// 获取压缩统计
+int mk_compress_stats(const mk_t *mk, mk_compress_stats_t *stats) {
+    if (mk == NULL || stats == NULL) {
+        fprintf(stderr, "mk_compress_stats 无效的参数 ❌\n");
         return -1;
     }
-    size_t idx = mk_hash(validKey);
-    mk_node_t *prev = NULL;
-    mk_node_t *curr = mk->buckets[idx];
+    // 计数器可能正被其他线程原子更新，逐个原子读取
+    stats->compressed_values = MK_ATOMIC_LOAD(mk->cstats.compressed_values);
+    stats->raw_bytes = MK_ATOMIC_LOAD(mk->cstats.raw_bytes);
+    stats->stored_bytes = MK_ATOMIC_LOAD(mk->cstats.stored_bytes);
+    stats->compress_calls = MK_ATOMIC_LOAD(mk->cstats.compress_calls);
+    stats->incompressible = MK_ATOMIC_LOAD(mk->cstats.incompressible);
+    stats->compress_ns = MK_ATOMIC_LOAD(mk->cstats.compress_ns);
+    stats->decompress_calls = MK_ATOMIC_LOAD(mk->cstats.decompress_calls);
+    stats->decompress_ns = MK_ATOMIC_LOAD(mk->cstats.decompress_ns);
+    return 0;
+}
 
-    // 遍历链表找key
-    while (curr != NULL) {
-        if (strcmp(curr->key, validKey) == 0) {
-            // 从链表中移除节点
-            if (prev == NULL) {
-                mk->buckets[idx] = curr->next;
-            } else {
-                prev->next = curr->next;
-            }
-            // 释放节点内存
-            free(curr->key);
-            free(curr->value);
-            free(curr);
-            mk->count--;
-            printf("%s 删除成功 ✅\n",validKey);
-            free(validKey);
-            return 0;
-        }
-        prev = curr;
-        curr = curr->next;
+// 尝试按二进制记录解析一行：key:=<长度>\n<原始字节>\n
+// 不是二进制记录返回1，成功读入返回0，格式错误返回-1
+static int mk_load_bin_record(mk_t *mk, FILE *fp, const char *line) {
+    const char *eq_pos = strchr(line, '=');
+    if (eq_pos == NULL || eq_pos == line || eq_pos[-1] != ':') return 1;
+
+    // 长度必须是不溢出的十进制数（strtoull会接受负号和前导空白），且不超过文件剩余的字节数
+    if (!isdigit((unsigned char)eq_pos[1])) return -1;
+    char *end = NULL;
+    errno = 0;
+    unsigned long long len = strtoull(eq_pos + 1, &end, 10);
+    if (errno != 0 || (*end != '\n' && *end != '\0')) return -1;
+    struct stat st;
+    long pos = ftell(fp);
+    if (pos < 0 || fstat(fileno(fp), &st) != 0 || st.st_size < pos) return -1;
+    if (len >= (unsigned long long)(st.st_size - pos)) return -1;// 数据后面还有一个'\n'
+
+    // 取出key（去掉末尾的':'）
+    size_t key_len = (size_t)(eq_pos - line) - 1;
+    char *raw_key = mk_dup_bytes(line, key_len);
+    char *data = malloc(len + 1);
+    if (raw_key == NULL || data == NULL) {
+        free(raw_key);
+        free(data);
+        return -1;
     }
 
-    // key不存在
-    fprintf(stderr, "键 %s 不存在 ❌\n",validKey);
-    free(validKey);
-    return -1;
-}
-
-// 获取键值对数量
-size_t mk_count(const mk_t *mk) {
-    return (mk == NULL) ? 0 : mk->count;
+    int ret = -1;
+    if (fread(data, 1, len, fp) == len && fgetc(fp) == '\n') {
+        ret = mk_put_bin(mk, raw_key, data, len);
+    }
+    free(raw_key);
+    free(data);
+    return ret;
 }
 
-// 从文件读取数据
-int mk_load(mk_t *mk, const char *filepath) {
+// mk_load的实现（内部函数）
+static int mk_load_impl(mk_t *mk, const char *filepath) {
     if (mk == NULL || filepath == NULL) {
         fprintf(stderr, "mk_load 无效的参数 ❌\n");
         return -1;
     }
 
+    if (mk->lsm != NULL) {
+        fprintf(stderr, "mk_load 已开启磁盘层的表不能整体加载 ❌\n");
+        return -1;
+    }
+
     FILE *fp = fopen(filepath, "r");
     if (fp == NULL) {
         fprintf(stderr, "mk_load 文件打开失败 ❌\n");
@@ -221,19 +1465,29 @@ int mk_load(mk_t *mk, const char *filepath) {
     }
 
     //mk中所有数据清空
-    for(int i=0;i<MK_HASH_SIZE;i++){
-        mk_destroy_chain(mk->buckets[i]);
-        mk->buckets[i]=NULL;
-    }
-    mk->count=0;
+    mk_lock_all(mk, 1);
+    mk_clear_memtable(mk);
+    mk_unlock_all(mk);
 
-    char line[4096];
+    char *line = NULL;// 由getline按需分配，不限制行长
+    size_t line_cap = 0;
     int line_num = 0;
     int ret = 0;
 
     // 逐行解析
-    while (fgets(line, sizeof(line), fp) != NULL) {
+    while (getline(&line, &line_cap, fp) != -1) {
         line_num++;
+
+        // 二进制记录：key:=<长度>，下一行起为原始字节
+        int bin_ret = mk_load_bin_record(mk, fp, line);
+        if (bin_ret == 0) continue;
+        if (bin_ret < 0) {
+            fprintf(stderr, "mk_load 第%d行二进制记录读取失败 ❌\n", line_num);
+            free(line);
+            fclose(fp);
+            return -1;
+        }
+
         char *key = "";//key和value是传出参数
         char *value = "";
 
@@ -250,6 +1504,7 @@ int mk_load(mk_t *mk, const char *filepath) {
                     char tempMessage[256];
                     snprintf(tempMessage, sizeof(tempMessage), "mk_load 键值对存放失败");
                     fprintf(stderr, "%s ❌\n", tempMessage);
+                    free(line);
                     fclose(fp);
                     return ret;
                     
@@ -263,62 +1518,148 @@ int mk_load(mk_t *mk, const char *filepath) {
         }
     }
 
-
+    free(line);
     fclose(fp);
+    // 清空内存表不会记入写日志，加载后立即做检查点，重启时不会恢复出被清掉的key
+    if (ret == 0 && mk->wal != NULL) ret = mk_checkpoint(mk);
     return ret;
 }
 
-// 保存配置到文件
-int mk_save(mk_t *mk, const char *filepath) {
+// 从文件读取数据
+int mk_load(mk_t *mk, const char *filepath) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_load_impl(mk, filepath);
+    mk_slowlog_end(mk, "load", filepath, start);
+    return ret;
+}
+
+// mk_save的实现（内部函数）
+static int mk_save_impl(mk_t *mk, const char *filepath) {
     if (mk == NULL || filepath == NULL) {
         perror("mk_save 无效的参数");
         return -1;
     }
 
-    FILE *fp = fopen(filepath, "w");
-    if (fp == NULL) {
+    int fd = open(filepath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
         perror("mk_save 文件打开失败");
         return -1;
     }
-
-    // 遍历所有哈希桶，写入键值对
-    for (int i = 0; i < MK_HASH_SIZE; i++) {
-        mk_node_t *node = mk->buckets[i];
-        while (node != NULL) {
-            fprintf(fp, "%s=%s\n", node->key, node->value);
-            node = node->next;
-        }
+    mk_sink_t sink;
+    if (mk_sink_fd(&sink, fd) != 0) {
+        close(fd);
+        return -1;
     }
 
-    fclose(fp);
+    // 未开启磁盘层时在快照上导出（压缩的value以原文保存），保存的是同一时刻的数据，期间写操作不受影响；
+    // 开启磁盘层时按key顺序合并内存表和磁盘表写出，期间持有全部读锁
+    int ret = mk_export(mk, &sink);
+    mk_sink_free(&sink);
+    if (close(fd) != 0) ret = -1;
+    return ret;
+}
+
+// 保存配置到文件
+int mk_save(mk_t *mk, const char *filepath) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_save_impl(mk, filepath);
+    mk_slowlog_end(mk, "save", filepath, start);
+    return ret;
+}
+
+// 打印用的临时列表
+typedef struct {
+    kv_pair_t *pairs;
+    size_t count;
+    size_t cap;
+    int collect;                       // 0：边遍历边打印（升序）；1：先收集再倒序打印
+} mk_print_ctx_t;
+
+// mk_lsm_scan / mk_snapshot_foreach回调：打印或收集一条键值对
+static int mk_print_emit(const char *key, size_t klen, const char *value, size_t vlen, void *ctx) {
+    (void)klen;
+    (void)vlen;
+    mk_print_ctx_t *pc = ctx;
+    if (!pc->collect) {
+        printf("%s = %s ✅\n", key, value);
+        pc->count++;
+        return 0;
+    }
+    if (pc->count == pc->cap) {
+        size_t ncap = pc->cap ? pc->cap * 2 : 64;
+        kv_pair_t *grown = realloc(pc->pairs, ncap * sizeof(kv_pair_t));
+        if (grown == NULL) return -1;
+        pc->pairs = grown;
+        pc->cap = ncap;
+    }
+    kv_pair_t *pair = &pc->pairs[pc->count];
+    pair->key = strdup(key);
+    pair->value = strdup(value);
+    pair->node = NULL;
+    if (pair->key == NULL || pair->value == NULL) {
+        free(pair->key);
+        free(pair->value);
+        return -1;
+    }
+    pc->count++;
     return 0;
 }
 
+// 开启磁盘层时合并内存表和磁盘表，按key升序或降序打印
+static int mk_lsm_print(const mk_t *mk, int desc) {
+    mk_print_ctx_t pc = {NULL, 0, 0, desc};
+    printf("===== MiniKV Key-Value List (memtable: %zu) =====\n", mk_count(mk));
+    int ret = mk_lsm_scan(mk, mk_print_emit, &pc);
+    for (size_t i = pc.count; desc && i > 0; i--) {
+        printf("%s = %s ✅\n", pc.pairs[i - 1].key, pc.pairs[i - 1].value);
+    }
+    for (size_t i = 0; desc && i < pc.count; i++) {
+        free(pc.pairs[i].key);
+        free(pc.pairs[i].value);
+    }
+    free(pc.pairs);
+
+    if (pc.count == 0) {
+        printf("Hash表中无数据\n");
+    } else {
+        printf("一共输出了%zu个键值对\n", pc.count);
+        printf("输出成功✅\n");
+    }
+    printf("=============================================\n");
+    return ret;
+}
+
 
-int mk_print(const mk_t *mk){
+// mk_snapshot_foreach回调：按哈希桶顺序打印一条键值对
+static int mk_print_bucket_emit(const char *key, size_t klen, const char *value, size_t vlen, void *ctx) {
+    (void)klen;
+    (void)vlen;
+    printf("[%zu]%s = %s ✅\n", mk_hash(key), key, value);
+    (*(size_t *)ctx)++;
+    return 0;
+}
+
+// mk_print的实现（内部函数）
+static int mk_print_impl(const mk_t *mk){
     if (mk == NULL) {
         perror("无效的参数");
         return -1;
     }
+    if (mk->lsm != NULL) {
+        mk_lock_all(mk, 0);
+        int ret = mk_lsm_print(mk, 0);
+        mk_unlock_all(mk);
+        return ret;
+    }
 
-   
+    // 在快照上遍历所有哈希桶，打印期间写操作不受影响
+    mk_snapshot_t *snap = mk_snapshot_begin(mk);
+    if (snap == NULL) return -1;
     size_t printed_count = 0; // 统计输出的键值对数量
     printf("===== MiniKV Key-Value List (total: %zu) =====\n", mk_count(mk));
+    mk_snapshot_foreach(snap, mk_print_bucket_emit, &printed_count);
+    mk_snapshot_end(snap);
 
-    // 遍历所有哈希桶（0 ~ MK_HASH_SIZE-1）
-    for (int bucket_idx = 0; bucket_idx < MK_HASH_SIZE; bucket_idx++) {
-        mk_node_t *node = mk->buckets[bucket_idx];
-        
-        // 遍历当前桶的链表节点
-        while (node != NULL) {
-            // 输出格式：[桶索引] key = value
-            printf("[%d]%s = %s ✅\n", bucket_idx, node->key, node->value);
-            printed_count++;
-            node = node->next; // 移动到下一个节点
-        }
-    }
-
-    
     if (printed_count == 0) {
         printf("Hash表中无数据\n");
     }
@@ -333,6 +1674,14 @@ int mk_print(const mk_t *mk){
 
 }
 
+// 打印Hash表中的所有键值对
+int mk_print(const mk_t *mk) {
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_print_impl(mk);
+    mk_slowlog_end(mk, "list", NULL, start);
+    return ret;
+}
+
 
 
 // 比较函数，用于qsort升序排序
@@ -349,234 +1698,76 @@ int compare_kv_desc(const void *a, const void *b) {
     return strcmp(pair2->key, pair1->key);
 }
 
-// 按key升序打印Hash表中的所有键值对
-int mk_asc_print(const mk_t *mk) {
-    if (mk == NULL) {
-        perror("无效的参数");
-        return -1;
-    }
-
-    size_t count = mk_count(mk);
-    printf("===== MiniKV Key-Value List (total: %zu) =====\n", count);
-
-    if (count == 0) {
-        printf("Hash表中无数据\n");
-        printf("=============================================\n");
-        return 0;
+// 按key排序打印Hash表中的所有键值对，desc为1时降序
+static int mk_sorted_print(const mk_t *mk, int desc) {
+    if (mk->lsm != NULL) {
+        mk_lock_all(mk, 0);
+        int ret = mk_lsm_print(mk, desc);
+        mk_unlock_all(mk);
+        return ret;
     }
 
-    // 收集所有键值对
-    kv_pair_t *pairs = (kv_pair_t *)malloc(count * sizeof(kv_pair_t));
-    if (pairs == NULL) {
+    // 在快照上收集所有键值对，收集期间写操作不受影响
+    mk_snapshot_t *snap = mk_snapshot_begin(mk);
+    if (snap == NULL) return -1;
+    mk_print_ctx_t pc = {NULL, 0, 0, 1};
+    int ret = mk_snapshot_foreach(snap, mk_print_emit, &pc);
+    mk_snapshot_end(snap);
+    if (ret != 0) {
         perror("内存分配失败");
-        return -1;
-    }
-
-    size_t idx = 0;
-    // 遍历所有哈希桶，收集键值对
-    for (int bucket_idx = 0; bucket_idx < MK_HASH_SIZE; bucket_idx++) {
-        mk_node_t *node = mk->buckets[bucket_idx];
-        while (node != NULL) {
-            pairs[idx].key = node->key;
-            pairs[idx].value = node->value;
-            idx++;
-            node = node->next;
+        for (size_t i = 0; i < pc.count; i++) {
+            free(pc.pairs[i].key);
+            free(pc.pairs[i].value);
         }
-    }
-
-    // 按key升序排序
-    qsort(pairs, count, sizeof(kv_pair_t), compare_kv_asc);
-
-    // 打印排序后的键值对
-    for (size_t i = 0; i < count; i++) {
-        printf("%s = %s ✅\n", pairs[i].key, pairs[i].value);
-    }
-
-    // 释放临时数组
-    free(pairs);
-
-    printf("一共输出了%zu个键值对\n", count);
-    printf("输出成功✅\n");
-    printf("=============================================\n");
-
-    return 0;
-}
-
-// 按key降序打印Hash表中的所有键值对
-int mk_desc_print(const mk_t *mk) {
-    if (mk == NULL) {
-        perror("无效的参数");
+        free(pc.pairs);
         return -1;
     }
 
-    size_t count = mk_count(mk);
-    printf("===== MiniKV Key-Value List (total: %zu) =====\n", count);
-
-    if (count == 0) {
+    printf("===== MiniKV Key-Value List (total: %zu) =====\n", pc.count);
+    if (pc.count == 0) {
         printf("Hash表中无数据\n");
         printf("=============================================\n");
         return 0;
     }
 
-    // 收集所有键值对
-    kv_pair_t *pairs = (kv_pair_t *)malloc(count * sizeof(kv_pair_t));
-    if (pairs == NULL) {
-        perror("内存分配失败");
-        return -1;
-    }
-
-    size_t idx = 0;
-    // 遍历所有哈希桶，收集键值对
-    for (int bucket_idx = 0; bucket_idx < MK_HASH_SIZE; bucket_idx++) {
-        mk_node_t *node = mk->buckets[bucket_idx];
-        while (node != NULL) {
-            pairs[idx].key = node->key;
-            pairs[idx].value = node->value;
-            idx++;
-            node = node->next;
-        }
-    }
-
-    // 按key降序排序
-    qsort(pairs, count, sizeof(kv_pair_t), compare_kv_desc);
-
-    // 打印排序后的键值对
-    for (size_t i = 0; i < count; i++) {
-        printf("%s = %s ✅\n", pairs[i].key, pairs[i].value);
+    // 按key排序后打印
+    qsort(pc.pairs, pc.count, sizeof(kv_pair_t), desc ? compare_kv_desc : compare_kv_asc);
+    for (size_t i = 0; i < pc.count; i++) {
+        printf("%s = %s ✅\n", pc.pairs[i].key, pc.pairs[i].value);
+        free(pc.pairs[i].key);
+        free(pc.pairs[i].value);
     }
 
     // 释放临时数组
-    free(pairs);
+    free(pc.pairs);
 
-    printf("一共输出了%zu个键值对\n", count);
+    printf("一共输出了%zu个键值对\n", pc.count);
     printf("输出成功✅\n");
     printf("=============================================\n");
 
     return 0;
 }
 
-
-// 启动函数
-int start_minikv(void) {
-    mk_t *mk = mk_create();
+// 按key升序打印Hash表中的所有键值对
+int mk_asc_print(const mk_t *mk) {
     if (mk == NULL) {
-        fprintf(stderr, "Failed to initialize MiniKV\n");
-        return 1;
+        perror("无效的参数");
+        return -1;
     }
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_sorted_print(mk, 0);
+    mk_slowlog_end(mk, "list -asc", NULL, start);
+    return ret;
+}
 
-    printf("MiniKV Interactive Shell\n");
-    printf("Type 'help' for commands.\n");
-
-    char line[MAX_CMD_LEN];
-    while (1) {
-        printf("minikv> ");
-        //从标准输入中读取一行命令
-        if (fgets(line, sizeof(line), stdin) == NULL) {
-            break; // EOF
-        }
-
-        // 去除行尾换行符
-        line[strcspn(line, "\n")] = 0;
-
-        // 输入回车继续
-        if (strlen(line) == 0) continue;
-
-        //分割出要执行的命令
-        char *cmd = strtok(line, " ");
-
-        // 忽略空命令
-        if (cmd == NULL) continue;
-
-
-        //输入quit或exit退出工具
-        if (strcmp(cmd, "quit") == 0 || strcmp(cmd, "exit") == 0) {
-            break;
-        } else if (strcmp(cmd, "help") == 0) {//help指令 用于打印帮助信息
-            // 打印帮助信息
-            printf("Commands:\n");
-            printf("  get <key>          - Get value by key\n");
-            printf("  put <key> <value>  - Set key-value pair\n");
-            printf("  del <key>          - Delete key\n");
-            printf("  save <file>        - Save MiniKV data to file\n");
-            printf("  load <file>        - Load MiniKV data from file\n");
-            printf("  list [-asc|-desc]  - List all keys\n");
-            printf("  help               - Show this help\n");
-            printf("  quit / exit        - Exit program\n");
-        } else if (strcmp(cmd, "put") == 0) {//put指令 用于设置key和value
-            char *key = strtok(NULL, " ");
-            char *value = strtok(NULL, ""); // 分割出key和value
-            
-            if (key && value) {
-                 // 去除 value 前导空格
-                while(*value == ' ') value++;
-                
-                
-                if (mk_put(mk, key, value) == 0) {
-                    printf("OK\n");
-                }
-            } else {
-                printf("Usage: put <key> <value>\n");
-            }
-        } else if (strcmp(cmd, "get") == 0) {//get指令 用于获取指定key对应的value
-            char *key = strtok(NULL, " ");
-            if (key) {
-                const char *val = mk_get(mk, key);
-                if (val) {
-                    printf("%s\n", val);
-                } else {
-                    printf("\n");
-                }
-            } else {
-                printf("Usage: get <key>\n");
-            }
-        } else if (strcmp(cmd, "del") == 0) {//del指令 用于删除指定key
-            char *key = strtok(NULL, " ");
-            if (key) {
-                if (mk_del(mk, key) == 0) {
-                    //删除成功，mk_del内部会输出信息
-                }
-            } else {
-                printf("Usage: del <key>\n");
-            }
-        } else if (strcmp(cmd, "save") == 0) {//save指令 用于保存当前Hash表中数据到文件
-            char *file = strtok(NULL, " ");
-            if (file) {
-                if (mk_save(mk, file) == 0) {
-                    printf("成功将信息保存到%s中\n", file);
-                }
-            } else {
-                printf("Usage: save <file>\n");
-            }
-        } else if (strcmp(cmd, "load") == 0) {//load指令 用于从文件中加载数据到Hash表
-            char *file = strtok(NULL, " ");
-            if (file) {
-                if (mk_load(mk, file) == 0) {
-                    printf("已从%s中加载信息\n", file);
-                }
-            } else {
-                printf("Usage: load <file>\n");
-            }
-        } else if (strcmp(cmd, "list") == 0) {//list指令 用于打印Hash表中所有键值对
-            char *arg = strtok(NULL, " ");
-            if (arg == NULL) {
-                // 没有参数，使用默认打印
-                mk_print(mk);
-            } else if (strcmp(arg, "-asc") == 0) {
-                // 升序打印
-                mk_asc_print(mk);
-            } else if (strcmp(arg, "-desc") == 0) {
-                // 降序打印
-                mk_desc_print(mk);
-            } else {
-                printf("未知的list命令参数: %s\n", arg);
-                printf("Usage: list [-asc|-desc]\n");
-            }
-        } else {
-            printf("未知的命令: %s\n", cmd);
-        }
+// 按key降序打印Hash表中的所有键值对
+int mk_desc_print(const mk_t *mk) {
+    if (mk == NULL) {
+        perror("无效的参数");
+        return -1;
     }
-
-    mk_destroy(mk);
-    printf("Bye.\n");
-    return 0;
-}
\ No newline at end of file
+    uint64_t start = mk_slowlog_start(mk);
+    int ret = mk_sorted_print(mk, 1);
+    mk_slowlog_end(mk, "list -desc", NULL, start);
+    return ret;
+}
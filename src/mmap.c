@@ -0,0 +1,406 @@
+#define _GNU_SOURCE// F_OFD_SETLK
+#include "../include/minikv.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 基于内存映射文件的共享Hash表
+// 整个表（文件头、哈希桶、键值对和空闲链表）都放在一个映射文件里，表内只保存相对文件开头的偏移，
+// 因此文件可以被多个进程同时映射，进程重启后映射即可使用，不需要解析或复制数据。
+// 进程之间用放在文件头里的进程共享锁协调：哈希桶按分段读写锁保护，空间分配由一个互斥锁保护。
+// 持锁的进程崩溃时，同时打开该文件的其他进程可能被阻塞；所有进程都关闭后，第一个打开的进程会重置这些锁。
+// 文件大小在创建时确定，空间用完后写入失败。
+
+#define MK_MMAP_MAGIC "MKMMAP1"
+#define MK_MMAP_VERSION 1
+#define MK_MMAP_MIN_BLOCK 32// 最小分配块（字节），第k类块大小为 MK_MMAP_MIN_BLOCK << k
+#define MK_MMAP_CLASSES 48// 块大小类别数
+
+// 文件头（位于文件开头）
+typedef struct {
+    char magic[8];                     // MK_MMAP_MAGIC
+    uint32_t version;                  // 布局版本
+    uint32_t hdr_size;                 // sizeof(mk_mmap_hdr_t)，锁的大小不同的程序不能共用文件
+    uint64_t capacity;                 // 文件大小
+    uint64_t nbuckets;                 // 哈希桶数量（2的幂）
+    uint64_t buckets_off;              // 哈希桶数组的偏移
+    uint64_t brk;                      // 从未分配过的空间的起点（受alloc_mu保护）
+    uint64_t used;                     // 已分配的块的总字节数（受alloc_mu保护）
+    uint64_t count;                    // 键值对数量（原子操作）
+    uint64_t free_list[MK_MMAP_CLASSES];// 每类空闲块组成的链表，块的前8字节为下一块的偏移
+    pthread_mutex_t alloc_mu;          // 保护空间分配
+    pthread_rwlock_t locks[MK_LOCK_STRIPES];// 分段读写锁，第i个哈希桶由locks[i % MK_LOCK_STRIPES]保护
+} mk_mmap_hdr_t;
+
+// 键值对（位于分配的块中）
+typedef struct {
+    uint64_t next;                     // 冲突链中下一项的偏移，0表示结束
+    uint64_t hash;                     // key的64位哈希
+    uint64_t klen;                     // key长度
+    uint64_t vlen;                     // value长度
+    uint32_t cls;                      // 块大小类别
+    uint32_t reserved;
+    char data[];                       // key '\0' value '\0'
+} mk_mmap_entry_t;
+
+struct mk_mmap {
+    int fd;                            // 映射文件（持有文件上的OFD锁）
+    char *base;                        // 映射的起始地址
+    size_t size;                       // 映射的字节数
+    mk_mmap_hdr_t *hdr;                // 文件头
+    uint64_t *buckets;                 // 哈希桶数组（每项为冲突链第一项的偏移）
+};
+
+// 偏移对应的地址
+static inline void *mk_mmap_ptr(const mk_mmap_t *m, uint64_t off) {
+    return m->base + off;
+}
+
+// 哈希桶所在的锁
+static inline pthread_rwlock_t *mk_mmap_stripe(const mk_mmap_t *m, uint64_t idx) {
+    return &m->hdr->locks[idx % MK_LOCK_STRIPES];
+}
+
+// 初始化文件头中的进程共享锁
+static void mk_mmap_init_locks(mk_mmap_hdr_t *hdr) {
+    pthread_mutexattr_t ma;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&hdr->alloc_mu, &ma);
+    pthread_mutexattr_destroy(&ma);
+
+    pthread_rwlockattr_t ra;
+    pthread_rwlockattr_init(&ra);
+    pthread_rwlockattr_setpshared(&ra, PTHREAD_PROCESS_SHARED);
+    for (int i = 0; i < MK_LOCK_STRIPES; i++) pthread_rwlock_init(&hdr->locks[i], &ra);
+    pthread_rwlockattr_destroy(&ra);
+}
+
+// 在文件的第byte个字节上加OFD锁（type为F_RDLCK/F_WRLCK/F_UNLCK），wait为0时不等待
+static int mk_mmap_flock(int fd, short type, off_t byte, int wait) {
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = byte;
+    fl.l_len = 1;
+    while (fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl) != 0) {
+        if (errno != EINTR) return -1;
+    }
+    return 0;
+}
+
+// 在新文件中建立空表
+static void mk_mmap_format(mk_mmap_t *m) {
+    mk_mmap_hdr_t *hdr = m->hdr;
+    uint64_t hdr_end = (sizeof(mk_mmap_hdr_t) + 63) & ~(uint64_t)63;
+    // 平均每个键值对按256字节估计哈希桶数量
+    uint64_t nbuckets = 1024;
+    while (nbuckets * 2 <= m->size / 256) nbuckets *= 2;
+
+    memcpy(hdr->magic, MK_MMAP_MAGIC, sizeof(hdr->magic));
+    hdr->version = MK_MMAP_VERSION;
+    hdr->hdr_size = sizeof(mk_mmap_hdr_t);
+    hdr->capacity = m->size;
+    hdr->nbuckets = nbuckets;
+    hdr->buckets_off = hdr_end;
+    hdr->brk = hdr_end + nbuckets * sizeof(uint64_t);
+    mk_mmap_init_locks(hdr);
+}
+
+// 打开（不存在时创建）映射文件中的共享Hash表，capacity为新建文件的大小，打开已有文件时忽略
+mk_mmap_t *mk_mmap_open(const char *path, size_t capacity) {
+    if (path == NULL) {
+        fprintf(stderr, "mk_mmap_open 无效的参数 ❌\n");
+        return NULL;
+    }
+    mk_mmap_t *m = calloc(1, sizeof(mk_mmap_t));
+    if (m == NULL) {
+        perror("mk_mmap_open 内存分配失败");
+        return NULL;
+    }
+    m->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m->fd < 0) {
+        perror("mk_mmap_open 打开文件失败");
+        free(m);
+        return NULL;
+    }
+    // 第0字节的写锁让打开过程互斥；第1字节上的读锁表示有进程在使用，只有唯一的使用者能拿到写锁
+    if (mk_mmap_flock(m->fd, F_WRLCK, 0, 1) != 0) {
+        perror("mk_mmap_open 加锁失败");
+        goto fail;
+    }
+
+    struct stat st;
+    if (fstat(m->fd, &st) != 0) {
+        perror("mk_mmap_open 获取文件大小失败");
+        goto fail;
+    }
+    int created = (st.st_size == 0);
+    if (created) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        if (capacity < 1024 * 1024) capacity = 1024 * 1024;
+        capacity = (capacity + page - 1) / page * page;
+        if (ftruncate(m->fd, (off_t)capacity) != 0) {
+            perror("mk_mmap_open 设置文件大小失败");
+            goto fail;
+        }
+        m->size = capacity;
+    } else {
+        m->size = (size_t)st.st_size;
+    }
+    if (m->size < sizeof(mk_mmap_hdr_t)) {
+        fprintf(stderr, "mk_mmap_open %s 不是MiniKV映射文件 ❌\n", path);
+        goto fail;
+    }
+    m->base = mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, 0);
+    if (m->base == MAP_FAILED) {
+        m->base = NULL;
+        perror("mk_mmap_open 映射文件失败");
+        goto fail;
+    }
+    m->hdr = (mk_mmap_hdr_t *)m->base;
+
+    if (created) {
+        mk_mmap_format(m);
+    } else if (memcmp(m->hdr->magic, MK_MMAP_MAGIC, sizeof(m->hdr->magic)) != 0 ||
+               m->hdr->version != MK_MMAP_VERSION || m->hdr->hdr_size != sizeof(mk_mmap_hdr_t) ||
+               m->hdr->capacity != m->size) {
+        fprintf(stderr, "mk_mmap_open %s 不是MiniKV映射文件或版本不兼容 ❌\n", path);
+        goto fail;
+    }
+    m->buckets = mk_mmap_ptr(m, m->hdr->buckets_off);
+
+    if (mk_mmap_flock(m->fd, F_WRLCK, 1, 0) == 0) {
+        // 没有其他进程在使用：上次的使用者可能在持锁时崩溃，重置所有锁
+        if (!created) mk_mmap_init_locks(m->hdr);
+    } else if (errno != EAGAIN && errno != EACCES) {
+        perror("mk_mmap_open 加锁失败");
+        goto fail;
+    }
+    if (mk_mmap_flock(m->fd, F_RDLCK, 1, 1) != 0) {
+        perror("mk_mmap_open 加锁失败");
+        goto fail;
+    }
+    mk_mmap_flock(m->fd, F_UNLCK, 0, 0);
+    return m;
+
+fail:
+    if (m->base != NULL) munmap(m->base, m->size);
+    close(m->fd);
+    free(m);
+    return NULL;
+}
+
+// 关闭共享Hash表（数据保留在文件中，由操作系统写回磁盘）
+int mk_mmap_close(mk_mmap_t *m) {
+    if (m == NULL) {
+        fprintf(stderr, "mk_mmap_close 无效的参数 ❌\n");
+        return -1;
+    }
+    munmap(m->base, m->size);
+    close(m->fd);
+    free(m);
+    return 0;
+}
+
+// 把修改同步到磁盘
+int mk_mmap_sync(mk_mmap_t *m) {
+    if (m == NULL) {
+        fprintf(stderr, "mk_mmap_sync 无效的参数 ❌\n");
+        return -1;
+    }
+    if (msync(m->base, m->size, MS_SYNC) != 0) {
+        perror("mk_mmap_sync 同步失败");
+        return -1;
+    }
+    return 0;
+}
+
+// 分配至少need字节的块，返回偏移，空间不足返回0
+static uint64_t mk_mmap_alloc(mk_mmap_t *m, size_t need, uint32_t *cls) {
+    uint32_t k = 0;
+    while (k < MK_MMAP_CLASSES - 1 && ((uint64_t)MK_MMAP_MIN_BLOCK << k) < need) k++;
+    uint64_t size = (uint64_t)MK_MMAP_MIN_BLOCK << k;
+    if (size < need) return 0;
+
+    mk_mmap_hdr_t *hdr = m->hdr;
+    uint64_t off = 0;
+    pthread_mutex_lock(&hdr->alloc_mu);
+    if (hdr->free_list[k] != 0) {
+        off = hdr->free_list[k];
+        hdr->free_list[k] = *(uint64_t *)mk_mmap_ptr(m, off);
+    } else if (hdr->brk + size <= hdr->capacity) {
+        off = hdr->brk;
+        hdr->brk += size;
+    }
+    if (off != 0) hdr->used += size;
+    pthread_mutex_unlock(&hdr->alloc_mu);
+    *cls = k;
+    return off;
+}
+
+// 把块放回所属类别的空闲链表
+static void mk_mmap_free_block(mk_mmap_t *m, uint64_t off, uint32_t cls) {
+    mk_mmap_hdr_t *hdr = m->hdr;
+    pthread_mutex_lock(&hdr->alloc_mu);
+    *(uint64_t *)mk_mmap_ptr(m, off) = hdr->free_list[cls];
+    hdr->free_list[cls] = off;
+    hdr->used -= (uint64_t)MK_MMAP_MIN_BLOCK << cls;
+    pthread_mutex_unlock(&hdr->alloc_mu);
+}
+
+// 在冲突链中查找key，prev返回指向该项的偏移所在的位置（调用方持有分段锁）
+static mk_mmap_entry_t *mk_mmap_find(const mk_mmap_t *m, uint64_t idx, const char *key, size_t klen, uint64_t h, uint64_t **prev) {
+    uint64_t *link = &m->buckets[idx];
+    while (*link != 0) {
+        mk_mmap_entry_t *e = mk_mmap_ptr(m, *link);
+        if (e->hash == h && e->klen == klen && memcmp(e->data, key, klen) == 0) {
+            if (prev != NULL) *prev = link;
+            return e;
+        }
+        link = &e->next;
+    }
+    return NULL;
+}
+
+// 新增或覆盖一个键值对，value可以是任意字节
+int mk_mmap_put(mk_mmap_t *m, const char *key, const void *data, size_t len) {
+    if (m == NULL || key == NULL || (data == NULL && len > 0)) {
+        fprintf(stderr, "mk_mmap_put 无效的参数 ❌\n");
+        return -1;
+    }
+    char *validKey = mk_trim(key);
+    if (validKey == NULL) return -1;
+    if (mk_is_valid_key(validKey) != 0) {
+        fprintf(stderr, "mk_mmap_put 非法的key! ❌\n");
+        free(validKey);
+        return -1;
+    }
+    size_t klen = strlen(validKey);
+    uint64_t h = mk_hash64(validKey, klen);
+    uint64_t idx = h & (m->hdr->nbuckets - 1);
+    size_t need = sizeof(mk_mmap_entry_t) + klen + 1 + len + 1;
+    int ret = 0;
+
+    pthread_rwlock_wrlock(mk_mmap_stripe(m, idx));
+    uint64_t *link = NULL;
+    mk_mmap_entry_t *old = mk_mmap_find(m, idx, validKey, klen, h, &link);
+    if (old != NULL && ((uint64_t)MK_MMAP_MIN_BLOCK << old->cls) >= need) {
+        // 原来的块放得下，直接覆盖（读者都在分段锁外等待）
+        memcpy(old->data + klen + 1, data, len);
+        old->data[klen + 1 + len] = '\0';
+        old->vlen = len;
+    } else {
+        uint32_t cls = 0;
+        uint64_t off = mk_mmap_alloc(m, need, &cls);
+        if (off == 0) {
+            fprintf(stderr, "mk_mmap_put 映射文件空间不足 ❌\n");
+            ret = -1;
+        } else {
+            // 先写好新项再链入，进程在中途崩溃时表仍然完整（最多泄漏一个块）
+            mk_mmap_entry_t *e = mk_mmap_ptr(m, off);
+            e->hash = h;
+            e->klen = klen;
+            e->vlen = len;
+            e->cls = cls;
+            memcpy(e->data, validKey, klen + 1);
+            memcpy(e->data + klen + 1, data, len);
+            e->data[klen + 1 + len] = '\0';
+            if (old != NULL) {
+                e->next = old->next;
+                __atomic_store_n(link, off, __ATOMIC_RELEASE);
+                mk_mmap_free_block(m, (uint64_t)((char *)old - m->base), old->cls);
+            } else {
+                e->next = m->buckets[idx];
+                __atomic_store_n(&m->buckets[idx], off, __ATOMIC_RELEASE);
+                MK_ATOMIC_ADD(m->hdr->count, 1);
+            }
+        }
+    }
+    pthread_rwlock_unlock(mk_mmap_stripe(m, idx));
+    free(validKey);
+    return ret;
+}
+
+// 查询key对应的value并复制到buf中，末尾补'\0'；len返回value长度
+// key不存在返回-1，cap不足（需不小于长度+1）时返回-1且len为所需长度
+int mk_mmap_get(const mk_mmap_t *m, const char *key, void *buf, size_t cap, size_t *len) {
+    if (m == NULL || key == NULL || buf == NULL || len == NULL) {
+        fprintf(stderr, "mk_mmap_get 无效的参数 ❌\n");
+        return -1;
+    }
+    char *validKey = mk_trim(key);
+    if (validKey == NULL) return -1;
+    size_t klen = strlen(validKey);
+    uint64_t h = mk_hash64(validKey, klen);
+    uint64_t idx = h & (m->hdr->nbuckets - 1);
+    int ret = -1;
+
+    pthread_rwlock_rdlock(mk_mmap_stripe(m, idx));
+    mk_mmap_entry_t *e = mk_mmap_find(m, idx, validKey, klen, h, NULL);
+    if (e != NULL) {
+        *len = e->vlen;
+        if (cap >= e->vlen + 1) {
+            memcpy(buf, e->data + klen + 1, e->vlen + 1);
+            ret = 0;
+        }
+    }
+    pthread_rwlock_unlock(mk_mmap_stripe(m, idx));
+    free(validKey);
+    return ret;
+}
+
+// 删除key，成功返回0，key不存在返回-1
+int mk_mmap_del(mk_mmap_t *m, const char *key) {
+    if (m == NULL || key == NULL) {
+        fprintf(stderr, "mk_mmap_del 无效的参数 ❌\n");
+        return -1;
+    }
+    char *validKey = mk_trim(key);
+    if (validKey == NULL) return -1;
+    size_t klen = strlen(validKey);
+    uint64_t h = mk_hash64(validKey, klen);
+    uint64_t idx = h & (m->hdr->nbuckets - 1);
+    int ret = -1;
+
+    pthread_rwlock_wrlock(mk_mmap_stripe(m, idx));
+    uint64_t *link = NULL;
+    mk_mmap_entry_t *e = mk_mmap_find(m, idx, validKey, klen, h, &link);
+    if (e != NULL) {
+        uint64_t off = *link;
+        __atomic_store_n(link, e->next, __ATOMIC_RELEASE);
+        mk_mmap_free_block(m, off, e->cls);
+        MK_ATOMIC_SUB(m->hdr->count, 1);
+        ret = 0;
+    }
+    pthread_rwlock_unlock(mk_mmap_stripe(m, idx));
+    free(validKey);
+    return ret;
+}
+
+// 获取键值对数量
+size_t mk_mmap_count(const mk_mmap_t *m) {
+    if (m == NULL) return 0;
+    return (size_t)MK_ATOMIC_LOAD(m->hdr->count);
+}
+
+// 获取映射文件的空间统计
+int mk_mmap_stats(const mk_mmap_t *m, mk_mmap_stats_t *stats) {
+    if (m == NULL || stats == NULL) {
+        fprintf(stderr, "mk_mmap_stats 无效的参数 ❌\n");
+        return -1;
+    }
+    mk_mmap_hdr_t *hdr = m->hdr;
+    pthread_mutex_lock(&hdr->alloc_mu);
+    stats->capacity = hdr->capacity;
+    stats->used = hdr->used;
+    stats->free = hdr->capacity - hdr->brk;
+    pthread_mutex_unlock(&hdr->alloc_mu);
+    stats->count = MK_ATOMIC_LOAD(hdr->count);
+    stats->buckets = hdr->nbuckets;
+    return 0;
+}
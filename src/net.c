@@ -0,0 +1,74 @@
+#include "../include/minikv_net.h"
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// 网络地址：网络服务、共享内存服务、主从复制和客户端库使用同一种地址格式
+
+// 解析地址："unix:/path" 或包含'/'的路径为unix套接字，否则为 "host:port"
+// 成功返回地址族和填好的地址，失败返回-1
+int mk_net_parse_addr(const char *addr, struct sockaddr_storage *ss, socklen_t *sslen) {
+    const char *path = NULL;
+    if (strncmp(addr, "unix:", 5) == 0) path = addr + 5;
+    else if (strchr(addr, '/') != NULL) path = addr;
+
+    memset(ss, 0, sizeof(*ss));
+    if (path != NULL) {
+        struct sockaddr_un *sun = (struct sockaddr_un *)ss;
+        if (strlen(path) >= sizeof(sun->sun_path)) return -1;
+        sun->sun_family = AF_UNIX;
+        strcpy(sun->sun_path, path);
+        *sslen = sizeof(*sun);
+        return AF_UNIX;
+    }
+
+    const char *colon = strrchr(addr, ':');
+    if (colon == NULL) return -1;
+    char host[256];
+    size_t hlen = (size_t)(colon - addr);
+    if (hlen >= sizeof(host)) return -1;
+    memcpy(host, addr, hlen);
+    host[hlen] = '\0';
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(hlen ? host : "127.0.0.1", colon + 1, &hints, &res) != 0 || res == NULL) return -1;
+    memcpy(ss, res->ai_addr, res->ai_addrlen);
+    *sslen = res->ai_addrlen;
+    freeaddrinfo(res);
+    return AF_INET;
+}
+
+// 在addr上监听，返回监听套接字；unix_path（至少108字节）返回unix套接字的路径，TCP时为空串
+int mk_net_listen(const char *addr, char *unix_path) {
+    struct sockaddr_storage ss;
+    socklen_t sslen;
+    int family = mk_net_parse_addr(addr, &ss, &sslen);
+    if (family < 0) {
+        fprintf(stderr, "无效的地址 %s ❌\n", addr);
+        return -1;
+    }
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("mk_net_listen socket失败");
+        return -1;
+    }
+    unix_path[0] = '\0';
+    if (family == AF_UNIX) {
+        strcpy(unix_path, ((struct sockaddr_un *)&ss)->sun_path);
+        unlink(unix_path);
+    } else {
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    if (bind(fd, (struct sockaddr *)&ss, sslen) != 0 || listen(fd, 16) != 0) {
+        perror("mk_net_listen 监听失败");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
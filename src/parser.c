@@ -169,4 +169,47 @@ int mk_parse_line(const char *line, char **key, char **value) {
     *key = trimmed_key;
     *value = trimmed_value;
     return 0;
-}
\ No newline at end of file
+}
+// 判断len字节的s是否为规范形式的64位整数（可选负号，无前导0，不是"-0"），是则写入out并返回1
+// 只接受规范形式，保证整数编码存储后原样转回的字符串与写入时一致
+int mk_str2ll(const char *s, size_t len, int64_t *out) {
+    if (len == 0 || len > 20) return 0;
+    size_t i = 0;
+    int neg = (s[0] == '-');
+    if (neg) i++;
+    if (i == len) return 0;
+    if (s[i] == '0' && (len - i > 1 || neg)) return 0;// 前导0或"-0"
+
+    uint64_t v = 0;
+    for (; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9') return 0;
+        uint64_t d = (uint64_t)(s[i] - '0');
+        if (v > (UINT64_MAX - d) / 10) return 0;
+        v = v * 10 + d;
+    }
+    if (neg) {
+        if (v > (uint64_t)INT64_MAX + 1) return 0;
+        *out = (int64_t)(0 - v);
+    } else {
+        if (v > (uint64_t)INT64_MAX) return 0;
+        *out = (int64_t)v;
+    }
+    return 1;
+}
+
+// 把64位整数格式化为十进制字符串写入buf（至少21字节），返回长度
+size_t mk_ll2str(char *buf, int64_t v) {
+    char tmp[20];
+    size_t n = 0;
+    uint64_t u = (v < 0) ? 0 - (uint64_t)v : (uint64_t)v;
+    do {
+        tmp[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+
+    size_t len = 0;
+    if (v < 0) buf[len++] = '-';
+    while (n > 0) buf[len++] = tmp[--n];
+    buf[len] = '\0';
+    return len;
+}
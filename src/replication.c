@@ -0,0 +1,759 @@
+#include "../include/minikv.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// 主从复制
+// 主节点把每次写操作追加到复制日志，复制日志保存在一个环形积压缓冲区中，
+// 用从0开始递增的字节偏移定位。从节点连接后发送 "PSYNC <replid> <offset>\n"：
+//   - replid一致且offset仍在积压缓冲区内：回复 "+CONTINUE\n"，从offset开始续传
+//   - 否则：回复 "+FULLRESYNC <replid> <offset>\n$<len>\n" 和len字节的快照，再从offset开始续传
+// 快照和复制日志使用相同的记录格式：[u8 op][u32 klen][u32 vlen][key][value]
+// 批量写是一条op为MK_OP_BATCH、key为空的记录，从节点用mk_apply原子地应用其中的全部操作
+
+#define MK_REPL_BACKLOG_DEFAULT (1024 * 1024)// 默认积压缓冲区大小
+#define MK_REPL_BACKLOG_MIN (64 * 1024)      // 积压缓冲区的最小值，太小时一条记录就会挤掉整个缓冲区，从节点每次都要全量同步
+#define MK_REPL_HDR_LEN 9                    // 记录头长度
+#define MK_REPL_CHUNK 65536                  // 每次发送的最大字节数
+#define MK_REPL_RETRY_MAX_MS 2000            // 从节点重连的最大退避时间
+
+// 主节点上的一个从节点连接
+typedef struct mk_repl_peer {
+    int fd;
+    pthread_t tid;
+    int done;                          // 发送线程已经退出，等待回收
+    struct mk_repl_peer *next;
+} mk_repl_peer_t;
+
+struct mk_repl {
+    mk_t *mk;
+    pthread_mutex_t mu;                // 保护以下所有字段
+    pthread_cond_t cond;               // 复制日志有新数据 / 停止 / 从节点退出
+    int role;
+    int stopping;
+    char replid[41];
+    uint64_t offset;
+    uint64_t full_syncs;
+    uint64_t partial_syncs;
+
+    // 主节点
+    char *backlog;                     // 环形积压缓冲区，偏移o的字节位于backlog[o % backlog_size]
+    size_t backlog_size;
+    uint64_t backlog_start;            // 积压缓冲区中最早的有效偏移
+    int listen_fd;
+    char unix_path[108];               // 监听unix套接字时的路径，停止时删除
+    pthread_t accept_tid;
+    mk_repl_peer_t *peers;
+    size_t followers;
+
+    // 从节点
+    char *leader_addr;
+    pthread_t follow_tid;
+    int link_fd;
+    int link_up;
+};
+
+// 完整发送len字节
+static int mk_repl_send_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// 带缓冲的读取器，减少系统调用次数
+typedef struct {
+    int fd;
+    char buf[16384];
+    size_t pos, end;
+} mk_repl_reader_t;
+
+// 读取恰好len字节，连接断开返回-1
+static int mk_repl_read_exact(mk_repl_reader_t *r, void *dst, size_t len) {
+    char *out = dst;
+    while (len > 0) {
+        if (r->pos == r->end) {
+            ssize_t n = read(r->fd, r->buf, sizeof(r->buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return -1;
+            r->pos = 0;
+            r->end = (size_t)n;
+        }
+        size_t take = r->end - r->pos;
+        if (take > len) take = len;
+        memcpy(out, r->buf + r->pos, take);
+        r->pos += take;
+        out += take;
+        len -= take;
+    }
+    return 0;
+}
+
+// 读取一行（不含换行符），过长或连接断开返回-1
+static int mk_repl_read_line(mk_repl_reader_t *r, char *line, size_t cap) {
+    size_t n = 0;
+    while (n + 1 < cap) {
+        char c;
+        if (mk_repl_read_exact(r, &c, 1) != 0) return -1;
+        if (c == '\n') {
+            line[n] = '\0';
+            return 0;
+        }
+        line[n++] = c;
+    }
+    return -1;
+}
+
+// 编码记录头
+static void mk_repl_encode_hdr(char *hdr, int op, size_t klen, size_t vlen) {
+    uint32_t k = (uint32_t)klen, v = (uint32_t)vlen;
+    hdr[0] = (char)op;
+    memcpy(hdr + 1, &k, 4);
+    memcpy(hdr + 5, &v, 4);
+}
+
+// 生成40个十六进制字符的随机复制ID
+static void mk_repl_gen_id(char *id) {
+    unsigned char raw[20];
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0 || read(fd, raw, sizeof(raw)) != (ssize_t)sizeof(raw)) {
+        // 没有/dev/urandom时退化为时钟和进程号
+        uint64_t seed = mk_now_ns() ^ ((uint64_t)getpid() << 32);
+        for (size_t i = 0; i < sizeof(raw); i++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            raw[i] = (unsigned char)(seed >> 56);
+        }
+    }
+    if (fd >= 0) close(fd);
+    for (size_t i = 0; i < sizeof(raw); i++) sprintf(id + i * 2, "%02x", raw[i]);
+}
+
+// 取得复制状态，第一次使用时创建
+// 在持有全部写锁时设置mk->repl，写操作总是在分段锁内读取该指针
+static mk_repl_t *mk_repl_get(mk_t *mk) {
+    if (mk->repl != NULL) return mk->repl;
+    mk_repl_t *repl = calloc(1, sizeof(mk_repl_t));
+    if (repl == NULL) return NULL;
+    repl->mk = mk;
+    repl->listen_fd = -1;
+    repl->link_fd = -1;
+    pthread_mutex_init(&repl->mu, NULL);
+    pthread_cond_init(&repl->cond, NULL);
+    mk_lock_all(mk, 1);
+    mk->repl = repl;
+    mk_unlock_all(mk);
+    return repl;
+}
+
+// 扩大积压缓冲区，使其在保留现有数据的同时还能放下一条rec字节的记录（调用方持有repl->mu）
+// 否则这条记录会覆盖它自己的开头，并把backlog_start推过所有从节点，每个从节点都要重新全量同步
+// 分配失败时保持原样：记录照常写入，落后的从节点断开后全量同步
+static void mk_repl_grow_backlog(mk_repl_t *repl, size_t rec) {
+    size_t used = (size_t)(repl->offset - repl->backlog_start);
+    size_t size = repl->backlog_size;
+    while (size < used + rec) size *= 2;
+    char *grown = malloc(size);
+    if (grown == NULL) {
+        perror("mk_repl 积压缓冲区扩容失败");
+        return;
+    }
+    // 偏移o的字节从backlog[o % 旧大小]搬到grown[o % 新大小]
+    for (uint64_t o = repl->backlog_start; o < repl->offset;) {
+        size_t from = (size_t)(o % repl->backlog_size);
+        size_t to = (size_t)(o % size);
+        size_t n = (size_t)(repl->offset - o);
+        if (n > repl->backlog_size - from) n = repl->backlog_size - from;
+        if (n > size - to) n = size - to;
+        memcpy(grown + to, repl->backlog + from, n);
+        o += n;
+    }
+    free(repl->backlog);
+    repl->backlog = grown;
+    repl->backlog_size = size;
+}
+
+// 把一次写操作追加到复制日志（调用方持有key所在分段的写锁），只有主节点会记录
+void mk_repl_feed(mk_t *mk, int op, const char *key, const void *data, size_t len) {
+    mk_repl_t *repl = mk->repl;
+    pthread_mutex_lock(&repl->mu);
+    if (repl->role != MK_REPL_LEADER) {
+        pthread_mutex_unlock(&repl->mu);
+        return;
+    }
+
+    char hdr[MK_REPL_HDR_LEN];
+    size_t klen = strlen(key);
+    size_t rec = MK_REPL_HDR_LEN + klen + len;
+    if (rec > repl->backlog_size) mk_repl_grow_backlog(repl, rec);
+    mk_repl_encode_hdr(hdr, op, klen, len);
+    const char *parts[3] = {hdr, key, data};
+    size_t lens[3] = {MK_REPL_HDR_LEN, klen, len};
+
+    for (int i = 0; i < 3; i++) {
+        const char *p = parts[i];
+        size_t n = lens[i];
+        while (n > 0) {
+            size_t pos = (size_t)(repl->offset % repl->backlog_size);
+            size_t take = repl->backlog_size - pos;
+            if (take > n) take = n;
+            memcpy(repl->backlog + pos, p, take);
+            repl->offset += take;
+            p += take;
+            n -= take;
+        }
+    }
+    if (repl->offset - repl->backlog_start > repl->backlog_size) {
+        repl->backlog_start = repl->offset - repl->backlog_size;
+    }
+    pthread_cond_broadcast(&repl->cond);
+    pthread_mutex_unlock(&repl->mu);
+}
+
+// 快照缓冲区
+typedef struct {
+    char *buf;
+    size_t len, cap;
+} mk_repl_snap_t;
+
+// 向快照追加一条写入记录
+static int mk_repl_snap_add(const char *key, size_t klen, const char *value, size_t vlen, void *ctx) {
+    mk_repl_snap_t *snap = ctx;
+    size_t need = snap->len + MK_REPL_HDR_LEN + klen + vlen;
+    if (need > snap->cap) {
+        size_t cap = snap->cap ? snap->cap : 4096;
+        while (cap < need) cap *= 2;
+        char *grown = realloc(snap->buf, cap);
+        if (grown == NULL) return -1;
+        snap->buf = grown;
+        snap->cap = cap;
+    }
+    mk_repl_encode_hdr(snap->buf + snap->len, MK_OP_PUT, klen, vlen);
+    memcpy(snap->buf + snap->len + MK_REPL_HDR_LEN, key, klen);
+    memcpy(snap->buf + snap->len + MK_REPL_HDR_LEN + klen, value, vlen);
+    snap->len = need;
+    return 0;
+}
+
+// 生成全量快照，offset返回快照对应的复制日志偏移
+// 持有全部读锁期间没有写操作能写入复制日志，在这期间登记MVCC快照并读取offset，两者严格对应；
+// 序列化在释放全部读锁后按快照进行，不阻塞写操作。开启磁盘层时不支持快照，序列化期间持有全部读锁
+static int mk_repl_snapshot(mk_repl_t *repl, mk_repl_snap_t *snap, uint64_t *offset) {
+    mk_t *mk = repl->mk;
+    int ret = 0;
+    mk_lock_all(mk, 0);
+    pthread_mutex_lock(&repl->mu);
+    *offset = repl->offset;
+    pthread_mutex_unlock(&repl->mu);
+
+    if (mk->lsm != NULL) {
+        ret = mk_lsm_scan(mk, mk_repl_snap_add, snap);
+        mk_unlock_all(mk);
+        return ret;
+    }
+    mk_snapshot_t *view = mk_snapshot_begin_locked(mk);
+    mk_unlock_all(mk);
+    if (view == NULL) return -1;
+    ret = mk_snapshot_foreach(view, mk_repl_snap_add, snap);
+    mk_snapshot_end(view);
+    return ret;
+}
+
+// 发送线程的参数
+typedef struct {
+    mk_repl_t *repl;
+    mk_repl_peer_t *peer;
+} mk_repl_peer_arg_t;
+
+// 主节点为每个从节点运行的发送线程：握手，必要时发送快照，然后持续发送复制日志
+static void *mk_repl_peer_main(void *arg) {
+    mk_repl_t *repl = ((mk_repl_peer_arg_t *)arg)->repl;
+    mk_repl_peer_t *peer = ((mk_repl_peer_arg_t *)arg)->peer;
+    free(arg);
+
+    mk_repl_reader_t *r = malloc(sizeof(mk_repl_reader_t));
+    char *chunk = malloc(MK_REPL_CHUNK);
+    char line[128], replid[64];
+    unsigned long long want = 0;
+    uint64_t offset = 0;
+    int ok = (r != NULL && chunk != NULL);
+
+    if (ok) {
+        r->fd = peer->fd;
+        r->pos = r->end = 0;
+        ok = mk_repl_read_line(r, line, sizeof(line)) == 0 &&
+             sscanf(line, "PSYNC %63s %llu", replid, &want) == 2;
+    }
+
+    if (ok) {
+        pthread_mutex_lock(&repl->mu);
+        int partial = strcmp(replid, repl->replid) == 0 &&
+                      want >= repl->backlog_start && want <= repl->offset;
+        if (partial) repl->partial_syncs++;
+        else repl->full_syncs++;
+        pthread_mutex_unlock(&repl->mu);
+
+        if (partial) {
+            offset = want;
+            ok = mk_repl_send_all(peer->fd, "+CONTINUE\n", 10) == 0;
+        } else {
+            mk_repl_snap_t snap = {NULL, 0, 0};
+            ok = mk_repl_snapshot(repl, &snap, &offset) == 0;
+            if (ok) {
+                int n = snprintf(line, sizeof(line), "+FULLRESYNC %s %llu\n$%zu\n",
+                                 repl->replid, (unsigned long long)offset, snap.len);
+                ok = mk_repl_send_all(peer->fd, line, (size_t)n) == 0 &&
+                     mk_repl_send_all(peer->fd, snap.buf, snap.len) == 0;
+            }
+            free(snap.buf);
+        }
+    }
+
+    // 持续发送复制日志
+    while (ok) {
+        pthread_mutex_lock(&repl->mu);
+        while (!repl->stopping && offset == repl->offset) {
+            pthread_cond_wait(&repl->cond, &repl->mu);
+        }
+        if (repl->stopping) {
+            pthread_mutex_unlock(&repl->mu);
+            break;
+        }
+        if (offset < repl->backlog_start) {
+            // 落后太多，需要的数据已被覆盖，断开后从节点会重新全量同步
+            pthread_mutex_unlock(&repl->mu);
+            fprintf(stderr, "从节点落后超过积压缓冲区，断开连接 ❌\n");
+            break;
+        }
+        size_t pos = (size_t)(offset % repl->backlog_size);
+        size_t n = (size_t)(repl->offset - offset);
+        if (n > repl->backlog_size - pos) n = repl->backlog_size - pos;
+        if (n > MK_REPL_CHUNK) n = MK_REPL_CHUNK;
+        memcpy(chunk, repl->backlog + pos, n);
+        pthread_mutex_unlock(&repl->mu);
+
+        if (mk_repl_send_all(peer->fd, chunk, n) != 0) break;
+        offset += n;
+    }
+
+    free(chunk);
+    free(r);
+    pthread_mutex_lock(&repl->mu);
+    shutdown(peer->fd, SHUT_RDWR);
+    peer->done = 1;
+    repl->followers--;
+    pthread_mutex_unlock(&repl->mu);
+    return NULL;
+}
+
+// 回收已经退出的发送线程（调用方持有repl->mu）
+static void mk_repl_reap_peers(mk_repl_t *repl, int all) {
+    mk_repl_peer_t **pp = &repl->peers;
+    while (*pp != NULL) {
+        mk_repl_peer_t *peer = *pp;
+        if (!all && !peer->done) {
+            pp = &peer->next;
+            continue;
+        }
+        *pp = peer->next;
+        pthread_mutex_unlock(&repl->mu);
+        pthread_join(peer->tid, NULL);
+        close(peer->fd);
+        free(peer);
+        pthread_mutex_lock(&repl->mu);
+    }
+}
+
+// 主节点的监听线程：接受从节点连接并为其启动发送线程
+static void *mk_repl_accept_main(void *arg) {
+    mk_repl_t *repl = arg;
+    while (1) {
+        int fd = accept(repl->listen_fd, NULL, NULL);
+        pthread_mutex_lock(&repl->mu);
+        if (repl->stopping) {
+            pthread_mutex_unlock(&repl->mu);
+            if (fd >= 0) close(fd);
+            break;
+        }
+        mk_repl_reap_peers(repl, 0);
+        if (fd < 0) {
+            pthread_mutex_unlock(&repl->mu);
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("mk_repl accept失败");
+            break;
+        }
+
+        mk_repl_peer_t *peer = calloc(1, sizeof(mk_repl_peer_t));
+        mk_repl_peer_arg_t *parg = malloc(sizeof(mk_repl_peer_arg_t));
+        if (peer == NULL || parg == NULL) {
+            pthread_mutex_unlock(&repl->mu);
+            free(peer);
+            free(parg);
+            close(fd);
+            continue;
+        }
+        peer->fd = fd;
+        parg->repl = repl;
+        parg->peer = peer;
+        if (pthread_create(&peer->tid, NULL, mk_repl_peer_main, parg) != 0) {
+            pthread_mutex_unlock(&repl->mu);
+            free(peer);
+            free(parg);
+            close(fd);
+            continue;
+        }
+        peer->next = repl->peers;
+        repl->peers = peer;
+        repl->followers++;
+        pthread_mutex_unlock(&repl->mu);
+    }
+    return NULL;
+}
+
+// 作为主节点在addr上等待从节点连接，backlog_size为积压缓冲区大小（0使用默认值，不能小于64KB）
+int mk_repl_leader_start(mk_t *mk, const char *addr, size_t backlog_size) {
+    if (mk == NULL || addr == NULL) {
+        fprintf(stderr, "mk_repl_leader_start 无效的参数 ❌\n");
+        return -1;
+    }
+    mk_repl_t *repl = mk_repl_get(mk);
+    if (repl == NULL) {
+        perror("mk_repl_leader_start 内存分配失败");
+        return -1;
+    }
+    if (repl->role != MK_REPL_NONE) {
+        fprintf(stderr, "复制已在运行，请先停止 ❌\n");
+        return -1;
+    }
+
+    if (backlog_size == 0) backlog_size = MK_REPL_BACKLOG_DEFAULT;
+    if (backlog_size < MK_REPL_BACKLOG_MIN) {
+        fprintf(stderr, "积压缓冲区不能小于 %d 字节 ❌\n", MK_REPL_BACKLOG_MIN);
+        return -1;
+    }
+
+    char unix_path[108];
+    int fd = mk_net_listen(addr, unix_path);
+    if (fd < 0) return -1;
+
+    char *backlog = malloc(backlog_size);
+    if (backlog == NULL) {
+        perror("mk_repl_leader_start 内存分配失败");
+        close(fd);
+        return -1;
+    }
+
+    // 停止期间的写操作没有记录，重新开始时使用新的复制ID，从节点会全量同步
+    mk_lock_all(mk, 1);
+    pthread_mutex_lock(&repl->mu);
+    free(repl->backlog);
+    repl->backlog = backlog;
+    repl->backlog_size = backlog_size;
+    repl->backlog_start = repl->offset;
+    mk_repl_gen_id(repl->replid);
+    repl->listen_fd = fd;
+    strcpy(repl->unix_path, unix_path);
+    repl->stopping = 0;
+    repl->role = MK_REPL_LEADER;
+    pthread_mutex_unlock(&repl->mu);
+    mk_unlock_all(mk);
+
+    if (pthread_create(&repl->accept_tid, NULL, mk_repl_accept_main, repl) != 0) {
+        perror("mk_repl_leader_start 创建线程失败");
+        pthread_mutex_lock(&repl->mu);
+        repl->role = MK_REPL_NONE;
+        repl->listen_fd = -1;
+        pthread_mutex_unlock(&repl->mu);
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+// 在停止前等待ms毫秒，被停止唤醒时返回-1（调用方持有repl->mu）
+static int mk_repl_wait_ms(mk_repl_t *repl, int ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    while (!repl->stopping) {
+        if (pthread_cond_timedwait(&repl->cond, &repl->mu, &ts) == ETIMEDOUT) break;
+    }
+    return repl->stopping ? -1 : 0;
+}
+
+// 从流中读取并应用一条记录，返回记录长度，连接断开或数据损坏返回0
+static size_t mk_repl_apply_record(mk_repl_t *repl, mk_repl_reader_t *r, char **buf, size_t *cap) {
+    char hdr[MK_REPL_HDR_LEN];
+    uint32_t klen, vlen;
+    if (mk_repl_read_exact(r, hdr, sizeof(hdr)) != 0) return 0;
+    memcpy(&klen, hdr + 1, 4);
+    memcpy(&vlen, hdr + 5, 4);
+
+    size_t need = (size_t)klen + 1 + vlen + 1;
+    if (need > *cap) {
+        char *grown = realloc(*buf, need);
+        if (grown == NULL) return 0;
+        *buf = grown;
+        *cap = need;
+    }
+    char *key = *buf;
+    char *value = *buf + klen + 1;
+    if (mk_repl_read_exact(r, key, klen) != 0 || mk_repl_read_exact(r, value, vlen) != 0) return 0;
+    key[klen] = '\0';
+    value[vlen] = '\0';
+    if (mk_apply(repl->mk, hdr[0], key, value, vlen) != 0) {
+        fprintf(stderr, "应用复制记录失败: %s ❌\n", key);
+    }
+    return MK_REPL_HDR_LEN + (size_t)klen + vlen;
+}
+
+// 与主节点完成一次连接：握手、可能的全量同步、持续应用复制日志，直到连接断开
+static void mk_repl_follow_once(mk_repl_t *repl, int fd) {
+    mk_repl_reader_t *r = malloc(sizeof(mk_repl_reader_t));
+    char *buf = NULL;
+    size_t cap = 0;
+    char line[160], replid[64];
+    unsigned long long offset = 0;
+    size_t snap_len = 0;
+    if (r == NULL) return;
+    r->fd = fd;
+    r->pos = r->end = 0;
+
+    pthread_mutex_lock(&repl->mu);
+    int n = snprintf(line, sizeof(line), "PSYNC %s %llu\n",
+                     repl->replid[0] ? repl->replid : "?", (unsigned long long)repl->offset);
+    pthread_mutex_unlock(&repl->mu);
+    if (mk_repl_send_all(fd, line, (size_t)n) != 0 || mk_repl_read_line(r, line, sizeof(line)) != 0) {
+        free(r);
+        return;
+    }
+
+    if (strcmp(line, "+CONTINUE") == 0) {
+        pthread_mutex_lock(&repl->mu);
+        repl->partial_syncs++;
+        repl->link_up = 1;
+        pthread_mutex_unlock(&repl->mu);
+    } else if (sscanf(line, "+FULLRESYNC %63s %llu", replid, &offset) == 2 &&
+               mk_repl_read_line(r, line, sizeof(line)) == 0 && sscanf(line, "$%zu", &snap_len) == 1) {
+        // 丢弃本地数据，载入主节点的快照；先清除复制ID和偏移，
+        // 快照没有完整载入就断开时，重连后不会用旧的复制位置续传到残缺的数据上
+        pthread_mutex_lock(&repl->mu);
+        repl->replid[0] = '\0';
+        repl->offset = 0;
+        pthread_mutex_unlock(&repl->mu);
+        mk_lock_all(repl->mk, 1);
+        mk_clear_memtable(repl->mk);
+        mk_unlock_all(repl->mk);
+        while (snap_len > 0) {
+            size_t len = mk_repl_apply_record(repl, r, &buf, &cap);
+            if (len == 0 || len > snap_len) {
+                free(buf);
+                free(r);
+                return;
+            }
+            snap_len -= len;
+        }
+        // 最后一条快照记录应用之后才记下新的复制位置
+        pthread_mutex_lock(&repl->mu);
+        strcpy(repl->replid, replid);
+        repl->offset = offset;
+        repl->full_syncs++;
+        repl->link_up = 1;
+        pthread_mutex_unlock(&repl->mu);
+    } else {
+        fprintf(stderr, "主节点回复无效: %s ❌\n", line);
+        free(r);
+        return;
+    }
+
+    // 持续应用复制日志
+    while (1) {
+        size_t len = mk_repl_apply_record(repl, r, &buf, &cap);
+        if (len == 0) break;
+        pthread_mutex_lock(&repl->mu);
+        repl->offset += len;
+        pthread_mutex_unlock(&repl->mu);
+    }
+    free(buf);
+    free(r);
+}
+
+// 从节点线程：连接主节点，断开后按指数退避自动重连
+static void *mk_repl_follow_main(void *arg) {
+    mk_repl_t *repl = arg;
+    int backoff = 50;
+    while (1) {
+        pthread_mutex_lock(&repl->mu);
+        if (repl->stopping) {
+            pthread_mutex_unlock(&repl->mu);
+            break;
+        }
+        pthread_mutex_unlock(&repl->mu);
+
+        struct sockaddr_storage ss;
+        socklen_t sslen;
+        int family = mk_net_parse_addr(repl->leader_addr, &ss, &sslen);
+        int fd = family < 0 ? -1 : socket(family, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&ss, sslen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+
+        if (fd >= 0) {
+            pthread_mutex_lock(&repl->mu);
+            int stopping = repl->stopping;
+            if (!stopping) repl->link_fd = fd;
+            pthread_mutex_unlock(&repl->mu);
+            if (!stopping) {
+                mk_repl_follow_once(repl, fd);
+                backoff = 50;
+            }
+            pthread_mutex_lock(&repl->mu);
+            repl->link_fd = -1;
+            repl->link_up = 0;
+            pthread_mutex_unlock(&repl->mu);
+            close(fd);
+        }
+
+        pthread_mutex_lock(&repl->mu);
+        int stop = mk_repl_wait_ms(repl, backoff);
+        pthread_mutex_unlock(&repl->mu);
+        if (stop != 0) break;
+        if (backoff < MK_REPL_RETRY_MAX_MS) backoff *= 2;
+    }
+    return NULL;
+}
+
+// 作为从节点连接addr上的主节点，在后台线程中持续同步
+// 之前同步过同一个主节点时，从上次的偏移断点续传
+int mk_repl_follow(mk_t *mk, const char *addr) {
+    if (mk == NULL || addr == NULL) {
+        fprintf(stderr, "mk_repl_follow 无效的参数 ❌\n");
+        return -1;
+    }
+    if (mk->lsm != NULL) {
+        // 全量同步只能清空内存表，无法删除磁盘层中多余的key
+        fprintf(stderr, "开启磁盘层时不能作为从节点 ❌\n");
+        return -1;
+    }
+    if (mk->wal != NULL) {
+        // 全量同步清空内存表的操作不会记入写日志
+        fprintf(stderr, "开启写日志时不能作为从节点 ❌\n");
+        return -1;
+    }
+    mk_repl_t *repl = mk_repl_get(mk);
+    char *leader_addr = strdup(addr);
+    if (repl == NULL || leader_addr == NULL) {
+        free(leader_addr);
+        perror("mk_repl_follow 内存分配失败");
+        return -1;
+    }
+    pthread_mutex_lock(&repl->mu);
+    if (repl->role != MK_REPL_NONE) {
+        pthread_mutex_unlock(&repl->mu);
+        free(leader_addr);
+        fprintf(stderr, "复制已在运行，请先停止 ❌\n");
+        return -1;
+    }
+    free(repl->leader_addr);
+    repl->leader_addr = leader_addr;
+    repl->stopping = 0;
+    repl->role = MK_REPL_FOLLOWER;
+    pthread_mutex_unlock(&repl->mu);
+
+    if (pthread_create(&repl->follow_tid, NULL, mk_repl_follow_main, repl) != 0) {
+        perror("mk_repl_follow 创建线程失败");
+        pthread_mutex_lock(&repl->mu);
+        repl->role = MK_REPL_NONE;
+        pthread_mutex_unlock(&repl->mu);
+        return -1;
+    }
+    return 0;
+}
+
+// 停止复制，等待后台线程退出；复制ID和偏移保留下来，再次follow时可以断点续传
+int mk_repl_stop(mk_t *mk) {
+    if (mk == NULL || mk->repl == NULL) return 0;
+    mk_repl_t *repl = mk->repl;
+
+    pthread_mutex_lock(&repl->mu);
+    int role = repl->role;
+    if (role == MK_REPL_NONE) {
+        pthread_mutex_unlock(&repl->mu);
+        return 0;
+    }
+    repl->stopping = 1;
+    if (repl->listen_fd >= 0) shutdown(repl->listen_fd, SHUT_RDWR);// 唤醒accept
+    if (repl->link_fd >= 0) shutdown(repl->link_fd, SHUT_RDWR);// 唤醒read
+    for (mk_repl_peer_t *peer = repl->peers; peer != NULL; peer = peer->next) {
+        shutdown(peer->fd, SHUT_RDWR);
+    }
+    pthread_cond_broadcast(&repl->cond);
+    pthread_mutex_unlock(&repl->mu);
+
+    if (role == MK_REPL_LEADER) {
+        pthread_join(repl->accept_tid, NULL);
+        pthread_mutex_lock(&repl->mu);
+        mk_repl_reap_peers(repl, 1);
+        pthread_mutex_unlock(&repl->mu);
+        close(repl->listen_fd);
+        if (repl->unix_path[0] != '\0') unlink(repl->unix_path);
+    } else {
+        pthread_join(repl->follow_tid, NULL);
+    }
+
+    pthread_mutex_lock(&repl->mu);
+    repl->listen_fd = -1;
+    repl->role = MK_REPL_NONE;
+    pthread_mutex_unlock(&repl->mu);
+    return 0;
+}
+
+// 获取复制状态
+int mk_repl_info(const mk_t *mk, mk_repl_info_t *info) {
+    if (mk == NULL || info == NULL) {
+        fprintf(stderr, "mk_repl_info 无效的参数 ❌\n");
+        return -1;
+    }
+    memset(info, 0, sizeof(*info));
+    mk_repl_t *repl = mk->repl;
+    if (repl == NULL) return 0;
+
+    pthread_mutex_lock(&repl->mu);
+    info->role = repl->role;
+    strcpy(info->replid, repl->replid);
+    info->offset = repl->offset;
+    info->backlog_start = repl->backlog_start;
+    info->followers = repl->followers;
+    info->link_up = repl->link_up;
+    info->full_syncs = repl->full_syncs;
+    info->partial_syncs = repl->partial_syncs;
+    pthread_mutex_unlock(&repl->mu);
+    return 0;
+}
+
+// 停止复制并释放资源
+void mk_repl_free(mk_t *mk) {
+    if (mk == NULL || mk->repl == NULL) return;
+    mk_repl_stop(mk);
+    mk_repl_t *repl = mk->repl;
+    mk->repl = NULL;
+    pthread_mutex_destroy(&repl->mu);
+    pthread_cond_destroy(&repl->cond);
+    free(repl->backlog);
+    free(repl->leader_addr);
+    free(repl);
+}
@@ -0,0 +1,584 @@
+#include "../include/minikv.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 网络服务
+// 一个后台线程用poll驱动所有连接。请求和回复使用RESP格式（Redis协议的子集）：
+//   请求：*<参数个数>\r\n，之后每个参数为 $<长度>\r\n<字节>\r\n
+//   回复：+OK / -ERR <信息> / :<整数> / $<长度>\r\n<字节>\r\n / $-1（不存在）/ *<个数>（MGET、EXEC）
+// 客户端可以不等回复连续发送请求（流水线），服务端按顺序执行一次读到的所有请求，回复合并后写出。
+// 支持的命令：PING、GET、PUT（SET）、DEL、INCRBY、MGET、MSET、MULTI、EXEC、DISCARD
+// MULTI之后的PUT/SET/DEL回复+QUEUED并加入连接的批量写，EXEC时原子地提交；MSET也作为一个批量写提交
+
+#define MK_SERVER_READ_CHUNK 65536               // 每次读取的字节数
+#define MK_SERVER_READ_ROUNDS 16                 // 每次poll唤醒最多读取的次数（其余留到下一轮，保证各连接公平）
+#define MK_SERVER_OUT_HIGH (4 * 1024 * 1024)     // 待发送的回复超过该值时暂停读取该连接
+#define MK_SERVER_MAX_ARGS (1024 * 1024)         // 单个请求最多的参数个数
+#define MK_SERVER_MAX_BULK (512 * 1024 * 1024)   // 单个参数的最大字节数
+
+// 一个客户端连接
+typedef struct {
+    int fd;
+    char *in;                          // 已读到、尚未执行的请求
+    size_t in_len, in_cap;
+    char *out;                         // 待发送的回复，out[out_pos, out_len)尚未发出
+    size_t out_len, out_pos, out_cap;
+    int closing;                       // 连接已断开或协议错误，本轮结束后关闭
+    mk_batch_t *multi;                 // MULTI之后排队的写操作，不在事务中时为NULL
+    size_t queued;                     // 排队的命令数
+    int multi_err;                     // 排队时有命令出错，EXEC时放弃整个事务
+} mk_conn_t;
+
+struct mk_server {
+    mk_t *mk;
+    int listen_fd;
+    int wake[2];                       // 停止时写入wake[1]唤醒poll
+    char unix_path[108];               // 监听unix套接字时的路径，停止时删除
+    pthread_t tid;
+    mk_conn_t **conns;
+    size_t nconns, conns_cap;
+    char **argv;                       // 当前请求的参数（指向连接的输入缓冲区），只在服务线程中使用
+    size_t *lens;
+    size_t args_cap;
+    char *val;                         // GET读取value的缓冲区
+    size_t val_cap;
+    mk_batch_t *mset;                  // MSET使用的批量写（复用缓冲区）
+};
+
+// 命令表项，arity > 0 表示参数个数（含命令名）必须相等，< 0 表示至少-arity个
+typedef struct {
+    const char *name;
+    void (*fn)(mk_server_t *srv, mk_conn_t *c, size_t argc);
+    int arity;
+} mk_server_cmd_t;
+
+// 保证输出缓冲区还能追加n字节
+static int mk_conn_reserve(mk_conn_t *c, size_t n) {
+    if (c->out_len + n <= c->out_cap) return 0;
+    // 已发出的部分先移走
+    if (c->out_pos > 0) {
+        memmove(c->out, c->out + c->out_pos, c->out_len - c->out_pos);
+        c->out_len -= c->out_pos;
+        c->out_pos = 0;
+        if (c->out_len + n <= c->out_cap) return 0;
+    }
+    size_t cap = c->out_cap ? c->out_cap : 4096;
+    while (cap < c->out_len + n) cap *= 2;
+    char *grown = realloc(c->out, cap);
+    if (grown == NULL) return -1;
+    c->out = grown;
+    c->out_cap = cap;
+    return 0;
+}
+
+// 追加回复字节，内存不足时关闭连接
+static void mk_conn_add(mk_conn_t *c, const void *data, size_t n) {
+    if (mk_conn_reserve(c, n) != 0) {
+        c->closing = 1;
+        return;
+    }
+    memcpy(c->out + c->out_len, data, n);
+    c->out_len += n;
+}
+
+// 追加一行回复（前缀 + 文本 + \r\n）
+static void mk_conn_line(mk_conn_t *c, char prefix, const char *text) {
+    char line[128];
+    int n = snprintf(line, sizeof(line), "%c%s\r\n", prefix, text);
+    mk_conn_add(c, line, (size_t)n);
+}
+
+// 追加整数回复
+static void mk_conn_int(mk_conn_t *c, int64_t v) {
+    char num[24];
+    mk_ll2str(num, v);
+    mk_conn_line(c, ':', num);
+}
+
+// 追加字符串回复
+static void mk_conn_bulk(mk_conn_t *c, const char *data, size_t len) {
+    char hdr[32];
+    int n = snprintf(hdr, sizeof(hdr), "$%zu\r\n", len);
+    if (mk_conn_reserve(c, (size_t)n + len + 2) != 0) {
+        c->closing = 1;
+        return;
+    }
+    mk_conn_add(c, hdr, (size_t)n);
+    mk_conn_add(c, data, len);
+    mk_conn_add(c, "\r\n", 2);
+}
+
+// 读取key并追加为字符串回复，不存在时回复$-1
+static void mk_server_reply_value(mk_server_t *srv, mk_conn_t *c, const char *key) {
+    while (1) {
+        size_t len = SIZE_MAX;// 不存在时mk_get_buf不会修改len
+        if (mk_get_buf(srv->mk, key, srv->val, srv->val_cap, &len) == 0) {
+            mk_conn_bulk(c, srv->val, len);
+            return;
+        }
+        if (len == SIZE_MAX) {
+            mk_conn_add(c, "$-1\r\n", 5);
+            return;
+        }
+        // 缓冲区不够，按需扩大后重新读取
+        char *grown = realloc(srv->val, len + 1);
+        if (grown == NULL) {
+            mk_conn_line(c, '-', "ERR out of memory");
+            return;
+        }
+        srv->val = grown;
+        srv->val_cap = len + 1;
+    }
+}
+
+// PING
+static void mk_server_ping(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    (void)srv; (void)argc;
+    mk_conn_line(c, '+', "PONG");
+}
+
+// GET key
+static void mk_server_get(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    (void)argc;
+    mk_server_reply_value(srv, c, srv->argv[1]);
+}
+
+// PUT key value
+static void mk_server_put(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    (void)argc;
+    if (mk_apply(srv->mk, MK_OP_PUT, srv->argv[1], srv->argv[2], srv->lens[2]) == 0) mk_conn_line(c, '+', "OK");
+    else mk_conn_line(c, '-', "ERR put failed");
+}
+
+// DEL key：回复删除的key数（1或0）
+static void mk_server_del(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    (void)argc;
+    int n = mk_del_checked(srv->mk, srv->argv[1]);
+    if (n >= 0) mk_conn_int(c, n);
+    else mk_conn_line(c, '-', "ERR del failed");
+}
+
+// INCRBY key n
+static void mk_server_incrby(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    (void)argc;
+    int64_t delta = 0, result = 0;
+    if (!mk_str2ll(srv->argv[2], srv->lens[2], &delta)) {
+        mk_conn_line(c, '-', "ERR value is not an integer");
+    } else if (mk_incrby(srv->mk, srv->argv[1], delta, &result) != 0) {
+        mk_conn_line(c, '-', "ERR value is not an integer or out of range");
+    } else {
+        mk_conn_int(c, result);
+    }
+}
+
+// MGET key [key ...]
+static void mk_server_mget(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    char hdr[32];
+    int n = snprintf(hdr, sizeof(hdr), "*%zu\r\n", argc - 1);
+    mk_conn_add(c, hdr, (size_t)n);
+    for (size_t i = 1; i < argc; i++) mk_server_reply_value(srv, c, srv->argv[i]);
+}
+
+// MSET key value [key value ...]（作为一个批量写原子地写入，有key不合法时全部不写入）
+static void mk_server_mset(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    if (argc % 2 == 0) {
+        mk_conn_line(c, '-', "ERR wrong number of arguments");
+        return;
+    }
+    if (srv->mset == NULL && (srv->mset = mk_batch_create()) == NULL) {
+        mk_conn_line(c, '-', "ERR out of memory");
+        return;
+    }
+    mk_batch_clear(srv->mset);
+    for (size_t i = 1; i < argc; i += 2) {
+        if (mk_batch_put(srv->mset, srv->argv[i], srv->argv[i + 1], srv->lens[i + 1]) != 0) {
+            mk_conn_line(c, '-', "ERR put failed");
+            return;
+        }
+    }
+    if (mk_batch_commit(srv->mk, srv->mset) == 0) mk_conn_line(c, '+', "OK");
+    else mk_conn_line(c, '-', "ERR put failed");
+}
+
+// MULTI 开始事务
+static void mk_server_multi(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    (void)srv; (void)argc;
+    if (c->multi != NULL) {
+        mk_conn_line(c, '-', "ERR MULTI calls can not be nested");
+        return;
+    }
+    if ((c->multi = mk_batch_create()) == NULL) {
+        mk_conn_line(c, '-', "ERR out of memory");
+        return;
+    }
+    c->queued = 0;
+    c->multi_err = 0;
+    mk_conn_line(c, '+', "OK");
+}
+
+// 结束事务，丢弃排队的操作
+static void mk_conn_multi_end(mk_conn_t *c) {
+    mk_batch_free(c->multi);
+    c->multi = NULL;
+    c->queued = 0;
+    c->multi_err = 0;
+}
+
+// EXEC 原子地提交排队的写操作，回复每个命令的结果
+static void mk_server_exec_multi(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    (void)argc;
+    if (c->multi == NULL) {
+        mk_conn_line(c, '-', "ERR EXEC without MULTI");
+    } else if (c->multi_err) {
+        mk_conn_line(c, '-', "EXECABORT Transaction discarded because of previous errors.");
+    } else if (mk_batch_commit(srv->mk, c->multi) != 0) {
+        mk_conn_line(c, '-', "ERR exec failed");
+    } else {
+        char hdr[32];
+        int n = snprintf(hdr, sizeof(hdr), "*%zu\r\n", c->queued);
+        mk_conn_add(c, hdr, (size_t)n);
+        for (size_t i = 0; i < c->queued; i++) mk_conn_add(c, "+OK\r\n", 5);
+    }
+    mk_conn_multi_end(c);
+}
+
+// DISCARD 放弃事务
+static void mk_server_discard(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    (void)srv; (void)argc;
+    if (c->multi == NULL) {
+        mk_conn_line(c, '-', "ERR DISCARD without MULTI");
+        return;
+    }
+    mk_conn_multi_end(c);
+    mk_conn_line(c, '+', "OK");
+}
+
+// 事务中的命令：PUT/SET/DEL加入批量写并回复+QUEUED，其他命令拒绝并使之后的EXEC失败
+// 返回0表示不是排队的命令（MULTI/EXEC/DISCARD），照常执行
+static int mk_server_queue(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    const char *name = srv->argv[0];
+    if (strcasecmp(name, "MULTI") == 0 || strcasecmp(name, "EXEC") == 0 || strcasecmp(name, "DISCARD") == 0) return 0;
+    int ret;
+    if ((strcasecmp(name, "PUT") == 0 || strcasecmp(name, "SET") == 0) && argc == 3) {
+        ret = mk_batch_put(c->multi, srv->argv[1], srv->argv[2], srv->lens[2]);
+    } else if (strcasecmp(name, "DEL") == 0 && argc == 2) {
+        ret = mk_batch_del(c->multi, srv->argv[1]);
+    } else {
+        mk_conn_line(c, '-', "ERR only PUT/SET/DEL can be queued in MULTI");
+        c->multi_err = 1;
+        return 1;
+    }
+    if (ret != 0) {
+        mk_conn_line(c, '-', "ERR invalid key");
+        c->multi_err = 1;
+        return 1;
+    }
+    c->queued++;
+    mk_conn_line(c, '+', "QUEUED");
+    return 1;
+}
+
+// 命令表
+static const mk_server_cmd_t mk_server_cmds[] = {
+    {"GET",    mk_server_get,    2},
+    {"PUT",    mk_server_put,    3},
+    {"SET",    mk_server_put,    3},
+    {"DEL",    mk_server_del,    2},
+    {"INCRBY", mk_server_incrby, 3},
+    {"MGET",   mk_server_mget,   -2},
+    {"MSET",   mk_server_mset,   -3},
+    {"PING",   mk_server_ping,   1},
+    {"MULTI",  mk_server_multi,  1},
+    {"EXEC",   mk_server_exec_multi, 1},
+    {"DISCARD", mk_server_discard, 1},
+};
+
+// 执行一个请求
+static void mk_server_exec(mk_server_t *srv, mk_conn_t *c, size_t argc) {
+    if (c->multi != NULL && mk_server_queue(srv, c, argc)) return;
+    for (size_t i = 0; i < sizeof(mk_server_cmds) / sizeof(mk_server_cmds[0]); i++) {
+        const mk_server_cmd_t *cmd = &mk_server_cmds[i];
+        if (strcasecmp(cmd->name, srv->argv[0]) != 0) continue;
+        if ((cmd->arity > 0 && argc != (size_t)cmd->arity) || (cmd->arity < 0 && argc < (size_t)-cmd->arity)) {
+            mk_conn_line(c, '-', "ERR wrong number of arguments");
+        } else {
+            cmd->fn(srv, c, argc);
+        }
+        return;
+    }
+    mk_conn_line(c, '-', "ERR unknown command");
+}
+
+// 解析"<前缀><十进制数>\r\n"，成功返回1，数据不完整返回0，格式错误返回-1
+static int mk_server_parse_num(const char *p, const char *end, char prefix, long long max, long long *out, const char **next) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    if (nl == NULL) return (end - p > 32) ? -1 : 0;
+    if (*p != prefix || nl - p < 3 || nl[-1] != '\r') return -1;
+    long long v = 0;
+    for (const char *d = p + 1; d < nl - 1; d++) {
+        if (*d < '0' || *d > '9' || v > max) return -1;
+        v = v * 10 + (*d - '0');
+    }
+    if (v > max) return -1;
+    *out = v;
+    *next = nl + 1;
+    return 1;
+}
+
+// 从buf中解析一个完整请求，参数写入srv->argv/lens（每个参数末尾补'\0'）
+// 返回消耗的字节数，数据不完整返回0，格式错误返回-1
+static long mk_server_parse(mk_server_t *srv, char *buf, size_t len, size_t *argc) {
+    const char *end = buf + len, *p = buf;
+    long long n = 0, blen = 0;
+    int r = mk_server_parse_num(p, end, '*', MK_SERVER_MAX_ARGS, &n, &p);
+    if (r <= 0) return r;
+    if (n == 0) return -1;
+    if ((size_t)n > srv->args_cap) {
+        char **argv = realloc(srv->argv, (size_t)n * sizeof(char *));
+        if (argv != NULL) srv->argv = argv;
+        size_t *lens = realloc(srv->lens, (size_t)n * sizeof(size_t));
+        if (lens != NULL) srv->lens = lens;
+        if (argv == NULL || lens == NULL) return -1;
+        srv->args_cap = (size_t)n;
+    }
+    for (long long i = 0; i < n; i++) {
+        r = mk_server_parse_num(p, end, '$', MK_SERVER_MAX_BULK, &blen, &p);
+        if (r <= 0) return r;
+        if (end - p < blen + 2) return 0;
+        if (p[blen] != '\r' || p[blen + 1] != '\n') return -1;
+        srv->argv[i] = (char *)p;
+        srv->lens[i] = (size_t)blen;
+        p += blen + 2;
+    }
+    // 整个请求都已读到后再把参数后的'\r'改成'\0'，不完整时缓冲区保持原样
+    for (long long i = 0; i < n; i++) srv->argv[i][srv->lens[i]] = '\0';
+    *argc = (size_t)n;
+    return (long)(p - buf);
+}
+
+// 执行输入缓冲区中所有完整的请求（回复积压过多时暂停，等发送后继续）
+static void mk_conn_process(mk_server_t *srv, mk_conn_t *c) {
+    size_t pos = 0;
+    while (!c->closing && pos < c->in_len && c->out_len - c->out_pos < MK_SERVER_OUT_HIGH) {
+        size_t argc = 0;
+        long used = mk_server_parse(srv, c->in + pos, c->in_len - pos, &argc);
+        if (used == 0) break;
+        if (used < 0) {
+            mk_conn_line(c, '-', "ERR protocol error");
+            c->closing = 1;
+            break;
+        }
+        mk_server_exec(srv, c, argc);
+        pos += (size_t)used;
+    }
+    memmove(c->in, c->in + pos, c->in_len - pos);
+    c->in_len -= pos;
+}
+
+// 读取连接上可读的数据并执行其中的请求
+static void mk_conn_read(mk_server_t *srv, mk_conn_t *c) {
+    for (int round = 0; round < MK_SERVER_READ_ROUNDS && !c->closing; round++) {
+        if (c->in_cap - c->in_len < MK_SERVER_READ_CHUNK) {
+            char *grown = realloc(c->in, c->in_cap + MK_SERVER_READ_CHUNK);
+            if (grown == NULL) {
+                c->closing = 1;
+                break;
+            }
+            c->in = grown;
+            c->in_cap += MK_SERVER_READ_CHUNK;
+        }
+        ssize_t n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+            if ((size_t)n < MK_SERVER_READ_CHUNK) break;// 已经读空
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        c->closing = 1;// 对端关闭或出错
+    }
+    mk_conn_process(srv, c);
+}
+
+// 发送待发送的回复，直到发完或套接字写满
+static void mk_conn_write(mk_conn_t *c) {
+    while (c->out_pos < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_pos, c->out_len - c->out_pos, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->out_pos += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        c->closing = 1;
+        return;
+    }
+    c->out_pos = c->out_len = 0;
+}
+
+// 关闭并释放连接
+static void mk_conn_free(mk_conn_t *c) {
+    close(c->fd);
+    mk_batch_free(c->multi);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+// 接受所有等待中的连接
+static void mk_server_accept(mk_server_t *srv) {
+    while (1) {
+        int fd = accept(srv->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("mk_server accept失败");
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        mk_conn_t *c = calloc(1, sizeof(mk_conn_t));
+        if (c != NULL && srv->nconns == srv->conns_cap) {
+            size_t cap = srv->conns_cap ? srv->conns_cap * 2 : 16;
+            mk_conn_t **grown = realloc(srv->conns, cap * sizeof(mk_conn_t *));
+            if (grown == NULL) {
+                free(c);
+                c = NULL;
+            } else {
+                srv->conns = grown;
+                srv->conns_cap = cap;
+            }
+        }
+        if (c == NULL) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        srv->conns[srv->nconns++] = c;
+    }
+}
+
+// 服务线程：poll所有连接，读取并执行请求，写出回复
+static void *mk_server_main(void *arg) {
+    mk_server_t *srv = arg;
+    struct pollfd *pfds = NULL;
+    size_t pfds_cap = 0;
+    while (1) {
+        size_t n = srv->nconns;
+        if (n + 2 > pfds_cap) {
+            struct pollfd *grown = realloc(pfds, (n + 2) * sizeof(struct pollfd));
+            if (grown == NULL) {
+                perror("mk_server 内存分配失败");
+                break;
+            }
+            pfds = grown;
+            pfds_cap = n + 2;
+        }
+        pfds[0].fd = srv->wake[0];
+        pfds[0].events = POLLIN;
+        pfds[1].fd = srv->listen_fd;
+        pfds[1].events = POLLIN;
+        for (size_t i = 0; i < n; i++) {
+            mk_conn_t *c = srv->conns[i];
+            pfds[i + 2].fd = c->fd;
+            // 回复积压过多时不再读取，等客户端收走回复
+            pfds[i + 2].events = (c->out_len - c->out_pos < MK_SERVER_OUT_HIGH ? POLLIN : 0) |
+                                 (c->out_pos < c->out_len ? POLLOUT : 0);
+        }
+        if (poll(pfds, n + 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("mk_server poll失败");
+            break;
+        }
+        if (pfds[0].revents) break;// 停止
+
+        for (size_t i = 0; i < n; i++) {
+            mk_conn_t *c = srv->conns[i];
+            short rev = pfds[i + 2].revents;
+            if (rev & (POLLIN | POLLHUP | POLLERR)) mk_conn_read(srv, c);
+            if (rev & POLLOUT) {
+                mk_conn_write(c);
+                // 回复发出后继续执行暂停的请求
+                if (c->in_len > 0) mk_conn_process(srv, c);
+            }
+            if (c->out_pos < c->out_len) mk_conn_write(c);// 这一批的回复合并写出
+        }
+        // 移除已关闭的连接
+        size_t kept = 0;
+        for (size_t i = 0; i < srv->nconns; i++) {
+            if (srv->conns[i]->closing) mk_conn_free(srv->conns[i]);
+            else srv->conns[kept++] = srv->conns[i];
+        }
+        srv->nconns = kept;
+        if (pfds[1].revents & POLLIN) mk_server_accept(srv);
+    }
+    free(pfds);
+    return NULL;
+}
+
+// 在addr（"unix:/path"、包含'/'的路径或"host:port"）上提供网络服务，由后台线程处理所有连接
+int mk_server_start(mk_t *mk, const char *addr) {
+    if (mk == NULL || addr == NULL) {
+        fprintf(stderr, "mk_server_start 无效的参数 ❌\n");
+        return -1;
+    }
+    if (mk->server != NULL) {
+        fprintf(stderr, "服务已在运行，请先停止 ❌\n");
+        return -1;
+    }
+    mk_server_t *srv = calloc(1, sizeof(mk_server_t));
+    if (srv == NULL || (srv->val = malloc(4096)) == NULL) {
+        perror("mk_server_start 内存分配失败");
+        free(srv);
+        return -1;
+    }
+    srv->mk = mk;
+    srv->val_cap = 4096;
+    srv->listen_fd = mk_net_listen(addr, srv->unix_path);
+    if (srv->listen_fd < 0 || pipe(srv->wake) != 0) {
+        if (srv->listen_fd >= 0) {
+            perror("mk_server_start pipe失败");
+            close(srv->listen_fd);
+        }
+        free(srv->val);
+        free(srv);
+        return -1;
+    }
+    fcntl(srv->listen_fd, F_SETFL, fcntl(srv->listen_fd, F_GETFL) | O_NONBLOCK);
+    if (pthread_create(&srv->tid, NULL, mk_server_main, srv) != 0) {
+        perror("mk_server_start 创建线程失败");
+        close(srv->listen_fd);
+        close(srv->wake[0]);
+        close(srv->wake[1]);
+        free(srv->val);
+        free(srv);
+        return -1;
+    }
+    mk->server = srv;
+    return 0;
+}
+
+// 停止网络服务，关闭所有连接
+int mk_server_stop(mk_t *mk) {
+    if (mk == NULL || mk->server == NULL) return 0;
+    mk_server_t *srv = mk->server;
+    if (write(srv->wake[1], "x", 1) != 1) perror("mk_server_stop 唤醒失败");
+    pthread_join(srv->tid, NULL);
+    mk->server = NULL;
+
+    for (size_t i = 0; i < srv->nconns; i++) mk_conn_free(srv->conns[i]);
+    close(srv->listen_fd);
+    if (srv->unix_path[0] != '\0') unlink(srv->unix_path);
+    close(srv->wake[0]);
+    close(srv->wake[1]);
+    free(srv->conns);
+    free(srv->argv);
+    free(srv->lens);
+    free(srv->val);
+    mk_batch_free(srv->mset);
+    free(srv);
+    return 0;
+}
@@ -0,0 +1,633 @@
+#include "../include/minikv.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+// 命令行工具：交互模式和批量（管道）模式共用同一张命令表
+
+#define MK_CMD_MAX_ARGS 8                  // 每条命令最多的参数个数（含命令名）
+#define MK_CMD_SLOTS 64                    // 命令查找表的槽位数（2的幂，大于命令数的两倍）
+#define MK_BATCH_BLOCK (64 * 1024)         // 批量模式每次从标准输入读取的字节数
+#define MK_BATCH_OUT (256 * 1024)          // 批量模式标准输出缓冲区大小
+
+// 命令执行上下文
+typedef struct {
+    mk_t *mk;
+    int batch;                             // 批量模式：不输出提示和逐条的成功信息
+    mk_batch_t *multi;                     // multi之后排队的put/del，不在事务中时为NULL
+    int multi_err;                         // 排队时有命令出错，exec时放弃整个事务
+} mk_shell_t;
+
+// 命令表项
+typedef struct {
+    const char *name;
+    int (*fn)(mk_shell_t *sh, int argc, char **argv);// 返回1表示退出
+    int min_args;                          // 最少参数个数（含命令名），不足时打印用法
+    int rest;                              // 最后一个参数是否保留该行剩余部分（可含空格）
+    int max_args;                          // 最多参数个数（含命令名），多余的忽略
+    int allowed_in_multi;                  // 事务（multi之后）中是否允许执行
+    const char *usage;
+} mk_cmd_t;
+
+// 成功信息只在交互模式下输出
+#define MK_SHELL_OK(sh, ...) do { if (!(sh)->batch) printf(__VA_ARGS__); } while (0)
+
+// quit / exit 退出工具
+static int mk_cmd_quit(mk_shell_t *sh, int argc, char **argv) {
+    (void)sh; (void)argc; (void)argv;
+    return 1;
+}
+
+// help 打印帮助信息
+static int mk_cmd_help(mk_shell_t *sh, int argc, char **argv) {
+    (void)sh; (void)argc; (void)argv;
+    printf("Commands:\n");
+    printf("  get <key>          - Get value by key\n");
+    printf("  put <key> <value>  - Set key-value pair\n");
+    printf("  del <key>          - Delete key\n");
+    printf("  multi | exec | discard - Queue puts/dels after multi, apply them atomically on exec\n");
+    printf("  incr|decr <key>    - Add/subtract 1 to the integer value of key\n");
+    printf("  incrby|decrby <key> <n> - Add/subtract n to the integer value of key\n");
+    printf("  save <file>        - Save MiniKV data to file\n");
+    printf("  load <file>        - Load MiniKV data from file\n");
+    printf("  list [-asc|-desc]  - List all keys\n");
+    printf("  memory usage <key> - Show memory used by key\n");
+    printf("  memory stats       - Show memory used by MiniKV\n");
+    printf("  memory bigkeys [n] - Estimate the n biggest keys by sampling\n");
+    printf("  hotkeys [n]        - Show the n most accessed keys\n");
+    printf("  hotkeys on <rate> [k] | hotkeys off - Sample 1 of rate gets/puts and track k hot keys\n");
+    printf("  slowlog get [n]    - Show the n most recent slow operations\n");
+    printf("  slowlog threshold [us] | slowlog len | slowlog reset - Configure (0 = off) / count / clear the slow log\n");
+    printf("  compress threshold <bytes> - Compress values not smaller than bytes (0 = off)\n");
+    printf("  compress stats     - Show compression ratio and CPU cost\n");
+    printf("  lsm open <dir> <memtable_bytes> - Enable the on-disk tier\n");
+    printf("  lsm flush|compact|stats - Flush memtable / merge tables / show stats\n");
+    printf("  vlog open <dir> <threshold> - Store values not smaller than threshold bytes in a value log\n");
+    printf("  vlog gc|stats      - Reclaim value log space now / show value log stats\n");
+    printf("  wal open <dir> [checkpoint_bytes] - Recover from dir and log all writes there\n");
+    printf("  wal checkpoint|sync|stats - Take a checkpoint now / fsync the log / show log stats\n");
+    printf("  repl leader <addr> [backlog_bytes] - Accept followers on addr (unix:/path or host:port)\n");
+    printf("  repl follow <addr> - Replicate from the leader at addr\n");
+    printf("  repl stop|info     - Stop replication / show replication state\n");
+    printf("  server start <addr> | server stop - Serve clients over the network (RESP protocol)\n");
+    printf("  shm start <path> | shm stop - Serve same-host clients through shared memory (handshake on unix socket path)\n");
+    printf("  help               - Show this help\n");
+    printf("  quit / exit        - Exit program\n");
+    return 0;
+}
+
+// put 设置key和value（事务中加入排队）
+static int mk_cmd_put(mk_shell_t *sh, int argc, char **argv) {
+    (void)argc;
+    if (sh->multi != NULL) {
+        if (mk_batch_put(sh->multi, argv[1], argv[2], strlen(argv[2])) == 0) MK_SHELL_OK(sh, "QUEUED\n");
+        else sh->multi_err = 1;
+        return 0;
+    }
+    if (mk_put(sh->mk, argv[1], argv[2]) == 0) MK_SHELL_OK(sh, "OK\n");
+    return 0;
+}
+
+// get 获取指定key对应的value，不存在时输出空行
+static int mk_cmd_get(mk_shell_t *sh, int argc, char **argv) {
+    (void)argc;
+    const char *val = mk_get(sh->mk, argv[1]);
+    printf("%s\n", val ? val : "");
+    return 0;
+}
+
+// del 删除指定key（事务中加入排队）
+static int mk_cmd_del(mk_shell_t *sh, int argc, char **argv) {
+    (void)argc;
+    if (sh->multi != NULL) {
+        if (mk_batch_del(sh->multi, argv[1]) == 0) MK_SHELL_OK(sh, "QUEUED\n");
+        else sh->multi_err = 1;
+        return 0;
+    }
+    if (mk_del(sh->mk, argv[1]) == 0) MK_SHELL_OK(sh, "%s 删除成功 ✅\n", argv[1]);
+    return 0;
+}
+
+// multi 开始事务
+static int mk_cmd_multi(mk_shell_t *sh, int argc, char **argv) {
+    (void)argc; (void)argv;
+    if (sh->multi != NULL) {
+        printf("multi 不能嵌套 ❌\n");
+        return 0;
+    }
+    sh->multi = mk_batch_create();
+    sh->multi_err = 0;
+    if (sh->multi != NULL) MK_SHELL_OK(sh, "OK\n");
+    return 0;
+}
+
+// exec 原子地应用排队的put/del；discard 放弃排队的操作
+static int mk_cmd_exec(mk_shell_t *sh, int argc, char **argv) {
+    (void)argc;
+    if (sh->multi == NULL) {
+        printf("%s 之前没有 multi ❌\n", argv[0]);
+        return 0;
+    }
+    if (argv[0][0] == 'd') {
+        MK_SHELL_OK(sh, "OK\n");
+    } else if (sh->multi_err) {
+        printf("排队时有命令出错，事务已放弃 ❌\n");
+    } else if (mk_batch_commit(sh->mk, sh->multi) == 0) {
+        MK_SHELL_OK(sh, "OK (%zu)\n", mk_batch_count(sh->multi));
+    }
+    mk_batch_free(sh->multi);
+    sh->multi = NULL;
+    return 0;
+}
+
+// incr / decr / incrby / decrby 原子地增减整数值，输出结果
+static int mk_cmd_incr(mk_shell_t *sh, int argc, char **argv) {
+    int by = (argv[0][4] == 'b');
+    int64_t delta = 1, result = 0;
+    if (by && (argc < 3 || !mk_str2ll(argv[2], strlen(argv[2]), &delta))) {
+        printf("Usage: %s <key> <n>\n", argv[0]);
+        return 0;
+    }
+    int ret = (argv[0][0] == 'i') ? mk_incrby(sh->mk, argv[1], delta, &result)
+                                  : mk_decrby(sh->mk, argv[1], delta, &result);
+    if (ret == 0) printf("%lld\n", (long long)result);
+    return 0;
+}
+
+// save 保存当前Hash表中数据到文件
+static int mk_cmd_save(mk_shell_t *sh, int argc, char **argv) {
+    (void)argc;
+    if (mk_save(sh->mk, argv[1]) == 0) MK_SHELL_OK(sh, "成功将信息保存到%s中\n", argv[1]);
+    return 0;
+}
+
+// load 从文件中加载数据到Hash表
+static int mk_cmd_load(mk_shell_t *sh, int argc, char **argv) {
+    (void)argc;
+    if (mk_load(sh->mk, argv[1]) == 0) MK_SHELL_OK(sh, "已从%s中加载信息\n", argv[1]);
+    return 0;
+}
+
+// list 打印Hash表中所有键值对
+static int mk_cmd_list(mk_shell_t *sh, int argc, char **argv) {
+    if (argc == 1) {
+        mk_print(sh->mk);// 没有参数，使用默认打印
+    } else if (strcmp(argv[1], "-asc") == 0) {
+        mk_asc_print(sh->mk);
+    } else if (strcmp(argv[1], "-desc") == 0) {
+        mk_desc_print(sh->mk);
+    } else {
+        printf("未知的list命令参数: %s\n", argv[1]);
+        printf("Usage: list [-asc|-desc]\n");
+    }
+    return 0;
+}
+
+// memory 查看内存占用
+static int mk_cmd_memory(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    if (argc >= 3 && strcmp(argv[1], "usage") == 0) {
+        size_t bytes = mk_key_memory_usage(mk, argv[2]);
+        if (bytes > 0) {
+            printf("%zu\n", bytes);
+        } else {
+            printf("\n");
+        }
+    } else if (argc >= 2 && strcmp(argv[1], "stats") == 0) {
+        printf("used_memory: %zu\n", mk_memory_usage(mk));
+        printf("keys: %zu\n", mk_count(mk));
+    } else if (argc >= 2 && strcmp(argv[1], "bigkeys") == 0) {
+        size_t n = (argc >= 3) ? strtoul(argv[2], NULL, 10) : 10;
+        if (n == 0 || n > 100) n = 10;
+        mk_bigkey_t big[100];
+        size_t found = mk_memory_bigkeys(mk, MK_BIGKEYS_SAMPLES, big, n);
+        for (size_t i = 0; i < found; i++) {
+            printf("%zu) %s %zu\n", i + 1, big[i].key, big[i].bytes);
+        }
+    } else {
+        printf("Usage: memory usage <key> | memory stats | memory bigkeys [n]\n");
+    }
+    return 0;
+}
+
+// hotkeys 开关和查看热点key统计
+static int mk_cmd_hotkeys(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    if (argc >= 2 && strcmp(argv[1], "on") == 0) {
+        if (argc < 3) {
+            printf("Usage: hotkeys on <rate> [k]\n");
+            return 0;
+        }
+        size_t k = (argc >= 4) ? strtoul(argv[3], NULL, 10) : 10;
+        if (mk_hotkeys_enable(mk, (uint32_t)strtoul(argv[2], NULL, 10), k) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (argc >= 2 && strcmp(argv[1], "off") == 0) {
+        if (mk_hotkeys_enable(mk, 0, 0) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else {
+        size_t n = (argc >= 2) ? strtoul(argv[1], NULL, 10) : 10;
+        if (n == 0 || n > MK_HOT_TOPK_MAX) n = 10;
+        mk_hotkey_t hot[MK_HOT_TOPK_MAX];
+        size_t found = mk_hotkeys(mk, hot, n);
+        for (size_t i = 0; i < found; i++) {
+            printf("%zu) %s %llu\n", i + 1, hot[i].key, (unsigned long long)hot[i].count);
+        }
+    }
+    return 0;
+}
+
+// slowlog 配置和查看慢操作日志
+static int mk_cmd_slowlog(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    const char *sub = (argc >= 2) ? argv[1] : "";
+    if (strcmp(sub, "get") == 0) {
+        size_t n = (argc >= 3) ? strtoul(argv[2], NULL, 10) : 10;
+        if (n == 0 || n > MK_SLOWLOG_LEN) n = 10;
+        mk_slowlog_entry_t entries[MK_SLOWLOG_LEN];
+        size_t found = mk_slowlog_get(mk, entries, n);
+        for (size_t i = 0; i < found; i++) {
+            printf("%zu) id=%llu time=%llu duration_us=%llu %s %s\n", i + 1,
+                   (unsigned long long)entries[i].id, (unsigned long long)(entries[i].timestamp_us / 1000000),
+                   (unsigned long long)entries[i].duration_us, entries[i].cmd, entries[i].key);
+        }
+    } else if (strcmp(sub, "threshold") == 0) {
+        if (argc >= 3) {
+            if (mk_slowlog_set(mk, strtoull(argv[2], NULL, 10)) == 0) MK_SHELL_OK(sh, "OK\n");
+        } else {
+            printf("slowlog_threshold_us: %llu\n", (unsigned long long)(MK_ATOMIC_LOAD(mk->slowlog_ns) / 1000));
+        }
+    } else if (strcmp(sub, "len") == 0) {
+        printf("%zu\n", mk_slowlog_len(mk));
+    } else if (strcmp(sub, "reset") == 0) {
+        mk_slowlog_reset(mk);
+        MK_SHELL_OK(sh, "OK\n");
+    } else {
+        printf("Usage: slowlog get [n] | slowlog threshold [us] | slowlog len | slowlog reset\n");
+    }
+    return 0;
+}
+
+// compress 配置和查看value压缩
+static int mk_cmd_compress(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    if (argc >= 2 && strcmp(argv[1], "threshold") == 0) {
+        if (argc >= 3) {
+            mk_set_compress_threshold(mk, strtoul(argv[2], NULL, 10));
+            MK_SHELL_OK(sh, "OK\n");
+        } else {
+            printf("compress_threshold: %zu\n", mk->compress_threshold);
+        }
+    } else if (argc >= 2 && strcmp(argv[1], "stats") == 0) {
+        mk_compress_stats_t st;
+        mk_compress_stats(mk, &st);
+        printf("compress_threshold: %zu\n", mk->compress_threshold);
+        printf("compressed_values: %zu\n", st.compressed_values);
+        printf("raw_bytes: %llu\n", (unsigned long long)st.raw_bytes);
+        printf("stored_bytes: %llu\n", (unsigned long long)st.stored_bytes);
+        printf("compress_ratio: %.2f\n", st.stored_bytes ? (double)st.raw_bytes / st.stored_bytes : 1.0);
+        printf("compress_calls: %llu (incompressible: %llu)\n",
+               (unsigned long long)st.compress_calls, (unsigned long long)st.incompressible);
+        printf("compress_us: %llu\n", (unsigned long long)(st.compress_ns / 1000));
+        printf("decompress_calls: %llu\n", (unsigned long long)st.decompress_calls);
+        printf("decompress_us: %llu\n", (unsigned long long)(st.decompress_ns / 1000));
+    } else {
+        printf("Usage: compress threshold <bytes> | compress stats\n");
+    }
+    return 0;
+}
+
+// lsm 管理磁盘层
+static int mk_cmd_lsm(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    const char *sub = (argc >= 2) ? argv[1] : "";
+    if (strcmp(sub, "open") == 0) {
+        if (argc >= 4) {
+            if (mk_lsm_open(mk, argv[2], strtoul(argv[3], NULL, 10)) == 0) MK_SHELL_OK(sh, "OK\n");
+        } else {
+            printf("Usage: lsm open <dir> <memtable_bytes>\n");
+        }
+    } else if (strcmp(sub, "flush") == 0) {
+        if (mk_lsm_flush(mk) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "compact") == 0) {
+        if (mk_lsm_compact(mk) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "stats") == 0) {
+        mk_lsm_stats_t st;
+        if (mk_lsm_stats(mk, &st) == 0) {
+            printf("l0_tables: %zu\n", st.l0_tables);
+            printf("l1_tables: %zu\n", st.l1_tables);
+            printf("disk_entries: %llu\n", (unsigned long long)st.disk_entries);
+            printf("disk_bytes: %llu\n", (unsigned long long)st.disk_bytes);
+            printf("lookups: %llu\n", (unsigned long long)st.lookups);
+            printf("bloom_negatives: %llu\n", (unsigned long long)st.bloom_negatives);
+            printf("block_reads: %llu\n", (unsigned long long)st.block_reads);
+            printf("flushes: %llu\n", (unsigned long long)st.flushes);
+            printf("compactions: %llu\n", (unsigned long long)st.compactions);
+        }
+    } else {
+        printf("Usage: lsm open <dir> <memtable_bytes> | lsm flush | lsm compact | lsm stats\n");
+    }
+    return 0;
+}
+
+// repl 管理主从复制
+static int mk_cmd_repl(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    const char *sub = (argc >= 2) ? argv[1] : "";
+    if (strcmp(sub, "leader") == 0 && argc >= 3) {
+        size_t backlog = (argc >= 4) ? strtoul(argv[3], NULL, 10) : 0;
+        if (mk_repl_leader_start(mk, argv[2], backlog) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "follow") == 0 && argc >= 3) {
+        if (mk_repl_follow(mk, argv[2]) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "stop") == 0) {
+        if (mk_repl_stop(mk) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "info") == 0) {
+        mk_repl_info_t info;
+        mk_repl_info(mk, &info);
+        const char *roles[] = {"none", "leader", "follower"};
+        printf("role: %s\n", roles[info.role]);
+        printf("replid: %s\n", info.replid);
+        printf("offset: %llu\n", (unsigned long long)info.offset);
+        if (info.role == MK_REPL_LEADER) {
+            printf("backlog_start: %llu\n", (unsigned long long)info.backlog_start);
+            printf("followers: %zu\n", info.followers);
+        } else if (info.role == MK_REPL_FOLLOWER) {
+            printf("link: %s\n", info.link_up ? "up" : "down");
+        }
+        printf("full_syncs: %llu\n", (unsigned long long)info.full_syncs);
+        printf("partial_syncs: %llu\n", (unsigned long long)info.partial_syncs);
+    } else {
+        printf("Usage: repl leader <addr> [backlog_bytes] | repl follow <addr> | repl stop | repl info\n");
+    }
+    return 0;
+}
+
+// vlog 管理值日志
+static int mk_cmd_vlog(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    const char *sub = (argc >= 2) ? argv[1] : "";
+    if (strcmp(sub, "open") == 0 && argc >= 4) {
+        if (mk_vlog_open(mk, argv[2], strtoul(argv[3], NULL, 10), 0) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "gc") == 0) {
+        if (mk_vlog_gc(mk) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "stats") == 0) {
+        mk_vlog_stats_t st;
+        if (mk_vlog_stats(mk, &st) == 0) {
+            printf("segments: %zu\n", st.segments);
+            printf("file_bytes: %llu\n", (unsigned long long)st.file_bytes);
+            printf("live_bytes: %llu\n", (unsigned long long)st.live_bytes);
+            printf("dead_bytes: %llu\n", (unsigned long long)st.dead_bytes);
+            printf("gc_segments: %llu\n", (unsigned long long)st.gc_segments);
+            printf("gc_moved_bytes: %llu\n", (unsigned long long)st.gc_moved_bytes);
+        }
+    } else {
+        printf("Usage: vlog open <dir> <threshold> | vlog gc | vlog stats\n");
+    }
+    return 0;
+}
+
+// wal 管理写日志与检查点
+static int mk_cmd_wal(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    const char *sub = (argc >= 2) ? argv[1] : "";
+    if (strcmp(sub, "open") == 0 && argc >= 3) {
+        size_t bytes = (argc >= 4) ? strtoul(argv[3], NULL, 10) : 0;
+        if (mk_wal_open(mk, argv[2], bytes) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "checkpoint") == 0) {
+        if (mk_checkpoint(mk) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "sync") == 0) {
+        if (mk_wal_sync(mk) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (strcmp(sub, "stats") == 0) {
+        mk_wal_stats_t st;
+        if (mk_wal_stats(mk, &st) == 0) {
+            printf("position: %llu\n", (unsigned long long)st.position);
+            printf("synced: %llu\n", (unsigned long long)st.synced);
+            printf("checkpoint_pos: %llu\n", (unsigned long long)st.checkpoint_pos);
+            printf("checkpoints: %llu\n", (unsigned long long)st.checkpoints);
+            printf("checkpoint_ms: %llu\n", (unsigned long long)st.checkpoint_ms);
+            printf("errors: %llu\n", (unsigned long long)st.errors);
+            printf("loaded_keys: %llu\n", (unsigned long long)st.loaded_keys);
+            printf("replayed_records: %llu\n", (unsigned long long)st.replayed_records);
+            printf("skipped_checkpoints: %llu\n", (unsigned long long)st.skipped_checkpoints);
+            printf("recovery_ms: %llu\n", (unsigned long long)st.recovery_ms);
+            printf("recovery_threads: %llu\n", (unsigned long long)st.recovery_threads);
+        }
+    } else {
+        printf("Usage: wal open <dir> [checkpoint_bytes] | wal checkpoint | wal sync | wal stats\n");
+    }
+    return 0;
+}
+
+// server 开关网络服务
+static int mk_cmd_server(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    if (argc >= 3 && strcmp(argv[1], "start") == 0) {
+        if (mk_server_start(mk, argv[2]) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (argc >= 2 && strcmp(argv[1], "stop") == 0) {
+        if (mk_server_stop(mk) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else {
+        printf("Usage: server start <addr> | server stop\n");
+    }
+    return 0;
+}
+
+// shm 开关共享内存传输
+static int mk_cmd_shm(mk_shell_t *sh, int argc, char **argv) {
+    mk_t *mk = sh->mk;
+    if (argc >= 3 && strcmp(argv[1], "start") == 0) {
+        if (mk_shm_start(mk, argv[2]) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else if (argc >= 2 && strcmp(argv[1], "stop") == 0) {
+        if (mk_shm_stop(mk) == 0) MK_SHELL_OK(sh, "OK\n");
+    } else {
+        printf("Usage: shm start <path> | shm stop\n");
+    }
+    return 0;
+}
+
+// 命令表
+static const mk_cmd_t mk_commands[] = {
+    {"quit",     mk_cmd_quit,     1, 0, 1, 1, "quit"},
+    {"exit",     mk_cmd_quit,     1, 0, 1, 1, "exit"},
+    {"help",     mk_cmd_help,     1, 0, 1, 0, "help"},
+    {"put",      mk_cmd_put,      3, 1, 3, 1, "put <key> <value>"},
+    {"get",      mk_cmd_get,      2, 0, 2, 0, "get <key>"},
+    {"del",      mk_cmd_del,      2, 0, 2, 1, "del <key>"},
+    {"multi",    mk_cmd_multi,    1, 0, 1, 1, "multi"},
+    {"exec",     mk_cmd_exec,     1, 0, 1, 1, "exec"},
+    {"discard",  mk_cmd_exec,     1, 0, 1, 1, "discard"},
+    {"incr",     mk_cmd_incr,     2, 0, 2, 0, "incr <key>"},
+    {"decr",     mk_cmd_incr,     2, 0, 2, 0, "decr <key>"},
+    {"incrby",   mk_cmd_incr,     3, 0, 3, 0, "incrby <key> <n>"},
+    {"decrby",   mk_cmd_incr,     3, 0, 3, 0, "decrby <key> <n>"},
+    {"save",     mk_cmd_save,     2, 0, 2, 0, "save <file>"},
+    {"load",     mk_cmd_load,     2, 0, 2, 0, "load <file>"},
+    {"list",     mk_cmd_list,     1, 0, 2, 0, "list [-asc|-desc]"},
+    {"memory",   mk_cmd_memory,   1, 0, 3, 0, "memory usage <key> | memory stats | memory bigkeys [n]"},
+    {"hotkeys",  mk_cmd_hotkeys,  1, 0, 4, 0, "hotkeys [n] | hotkeys on <rate> [k] | hotkeys off"},
+    {"slowlog",  mk_cmd_slowlog,  1, 0, 3, 0, "slowlog get [n] | slowlog threshold [us] | slowlog len | slowlog reset"},
+    {"compress", mk_cmd_compress, 1, 0, 3, 0, "compress threshold <bytes> | compress stats"},
+    {"lsm",      mk_cmd_lsm,      1, 0, 4, 0, "lsm open <dir> <memtable_bytes> | lsm flush | lsm compact | lsm stats"},
+    {"vlog",     mk_cmd_vlog,     1, 0, 4, 0, "vlog open <dir> <threshold> | vlog gc | vlog stats"},
+    {"wal",      mk_cmd_wal,      1, 0, 4, 0, "wal open <dir> [checkpoint_bytes] | wal checkpoint | wal sync | wal stats"},
+    {"server",   mk_cmd_server,   1, 0, 3, 0, "server start <addr> | server stop"},
+    {"shm",      mk_cmd_shm,      1, 0, 3, 0, "shm start <path> | shm stop"},
+    {"repl",     mk_cmd_repl,     1, 0, 4, 0, "repl leader <addr> [backlog_bytes] | repl follow <addr> | repl stop | repl info"},
+};
+#define MK_CMD_COUNT (sizeof(mk_commands) / sizeof(mk_commands[0]))
+
+// 命令名的开放寻址查找表，保存命令表下标+1（0表示空槽），首次使用时构建
+static unsigned char mk_cmd_slots[MK_CMD_SLOTS];
+static pthread_once_t mk_cmd_once = PTHREAD_ONCE_INIT;
+
+// 构建命令查找表
+static void mk_cmd_build(void) {
+    for (size_t i = 0; i < MK_CMD_COUNT; i++) {
+        size_t slot = mk_hash(mk_commands[i].name) % MK_CMD_SLOTS;
+        while (mk_cmd_slots[slot] != 0) slot = (slot + 1) % MK_CMD_SLOTS;
+        mk_cmd_slots[slot] = (unsigned char)(i + 1);
+    }
+}
+
+// 按命令名查找命令，不存在返回NULL
+static const mk_cmd_t *mk_cmd_lookup(const char *name) {
+    pthread_once(&mk_cmd_once, mk_cmd_build);
+    size_t slot = mk_hash(name) % MK_CMD_SLOTS;
+    while (mk_cmd_slots[slot] != 0) {
+        const mk_cmd_t *cmd = &mk_commands[mk_cmd_slots[slot] - 1];
+        if (strcmp(cmd->name, name) == 0) return cmd;
+        slot = (slot + 1) % MK_CMD_SLOTS;
+    }
+    return NULL;
+}
+
+// 执行一行命令（会修改line），返回1表示退出
+static int mk_shell_exec(mk_shell_t *sh, char *line) {
+    char *argv[MK_CMD_MAX_ARGS];
+    char *save = NULL;
+
+    //分割出要执行的命令，忽略空命令
+    argv[0] = strtok_r(line, " ", &save);
+    if (argv[0] == NULL) return 0;
+
+    const mk_cmd_t *cmd = mk_cmd_lookup(argv[0]);
+    if (cmd == NULL) {
+        printf("未知的命令: %s\n", argv[0]);
+        if (sh->multi != NULL) sh->multi_err = 1;
+        return 0;
+    }
+
+    int argc = 1;
+    while (argc < cmd->max_args) {
+        if (cmd->rest && argc == cmd->max_args - 1) {
+            // 最后一个参数取该行剩余部分，去除前导空格
+            char *tail = strtok_r(NULL, "", &save);
+            while (tail != NULL && *tail == ' ') tail++;
+            if (tail == NULL || *tail == '\0') break;
+            argv[argc++] = tail;
+            break;
+        }
+        char *tok = strtok_r(NULL, " ", &save);
+        if (tok == NULL) break;
+        argv[argc++] = tok;
+    }
+
+    if (argc < cmd->min_args) {
+        printf("Usage: %s\n", cmd->usage);
+        if (sh->multi != NULL) sh->multi_err = 1;
+        return 0;
+    }
+    // 事务中只能排队put/del
+    if (sh->multi != NULL && !cmd->allowed_in_multi) {
+        printf("事务中只能使用 put/del，请先 exec 或 discard ❌\n");
+        sh->multi_err = 1;
+        return 0;
+    }
+    return cmd->fn(sh, argc, argv);
+}
+
+// 启动函数（交互模式）
+int start_minikv(void) {
+    mk_shell_t sh = {mk_create(), 0, NULL, 0};
+    if (sh.mk == NULL) {
+        fprintf(stderr, "Failed to initialize MiniKV\n");
+        return 1;
+    }
+
+    printf("MiniKV Interactive Shell\n");
+    printf("Type 'help' for commands.\n");
+
+    char line[MAX_CMD_LEN];
+    while (1) {
+        printf("minikv> ");
+        //从标准输入中读取一行命令
+        if (fgets(line, sizeof(line), stdin) == NULL) {
+            break; // EOF
+        }
+
+        // 去除行尾换行符
+        line[strcspn(line, "\n")] = 0;
+
+        //输入quit或exit退出工具
+        if (mk_shell_exec(&sh, line) != 0) break;
+    }
+
+    mk_batch_free(sh.multi);
+    mk_destroy(sh.mk);
+    printf("Bye.\n");
+    return 0;
+}
+
+// 批量模式启动：不输出提示和逐条的成功信息，按块读取标准输入，
+// 每读入一块执行其中所有完整的行，这一批的回复只在最后写出一次；行长不受MAX_CMD_LEN限制
+int start_minikv_batch(void) {
+    static char out_buf[MK_BATCH_OUT];// 程序退出时stdio还会使用，不能放在栈上
+    mk_shell_t sh = {mk_create(), 1, NULL, 0};
+    size_t cap = MK_BATCH_BLOCK, have = 0;
+    char *buf = malloc(cap + 1);
+    if (sh.mk == NULL || buf == NULL) {
+        fprintf(stderr, "Failed to initialize MiniKV\n");
+        mk_destroy(sh.mk);
+        free(buf);
+        return 1;
+    }
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+    int quit = 0;
+    while (!quit) {
+        if (have == cap) {
+            // 一行比缓冲区还长，扩大缓冲区
+            char *grown = realloc(buf, cap * 2 + 1);
+            if (grown == NULL) {
+                perror("start_minikv_batch 内存分配失败");
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(STDIN_FILENO, buf + have, cap - have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            // 输入结束，执行最后一行（没有换行符）
+            if (n < 0) perror("start_minikv_batch 读取失败");
+            buf[have] = '\0';
+            if (have > 0) mk_shell_exec(&sh, buf);
+            break;
+        }
+        have += (size_t)n;
+
+        char *start = buf;
+        char *end = buf + have;
+        char *nl;
+        while (!quit && (nl = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+            *nl = '\0';
+            quit = mk_shell_exec(&sh, start);
+            start = nl + 1;
+        }
+        have = (size_t)(end - start);
+        memmove(buf, start, have);
+        fflush(stdout);// 这一批的回复一次写出
+    }
+
+    fflush(stdout);
+    free(buf);
+    mk_batch_free(sh.multi);
+    mk_destroy(sh.mk);
+    return 0;
+}
@@ -0,0 +1,573 @@
+#define _GNU_SOURCE// memfd_create
+#include "../include/minikv.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// 共享内存传输（同一台机器上的客户端）
+// 客户端创建一段共享内存（memfd），通过unix套接字把文件描述符传给服务端，之后的请求和回复都不经过套接字：
+//   请求环：客户端写、服务端读；回复环：服务端写、客户端读。两个环都是无锁的单生产者单消费者环，
+//   生产者和消费者只通过原子读写head/tail同步。
+//   PUT的value写在请求value区，GET的value由服务端直接复制到回复value区，客户端拿到的是指向该区域的指针。
+// 消费者没有数据时先自旋一小段时间，仍然没有才在futex上睡眠；生产者只在对方睡眠时才调用futex唤醒，
+// 连续请求时不进入内核。套接字只用于传递描述符和发现对方退出。
+// 每个客户端连接同时只有一个请求在处理，GET返回的指针在该连接的下一次调用前有效。
+
+#define MK_SHM_MAGIC "MKSHM01"
+#define MK_SHM_RING_SIZE (64 * 1024)             // 每个环的数据区字节数（2的幂）
+#define MK_SHM_VALUE_DEFAULT (1024 * 1024)       // 默认的value区大小
+#define MK_SHM_SPIN 20000                        // 睡眠前自旋检查的次数（多核）
+#define MK_SHM_YIELD 16                          // 单核时睡眠前让出CPU的次数（自旋只会占住对方需要的CPU）
+#define MK_SHM_SLEEP_MS 100                      // 每次睡眠的最长时间，醒来后检查对方是否退出
+
+// 操作和回复状态
+#define MK_SHM_GET 1
+#define MK_SHM_PUT 2
+#define MK_SHM_DEL 3
+#define MK_SHM_OK 0
+#define MK_SHM_NOTFOUND 1
+#define MK_SHM_ERR 2
+
+// 单生产者单消费者环，head/tail为累计字节数，各占一个缓存行
+typedef struct {
+    uint64_t head;                     // 消费者已读到的位置
+    char pad1[56];
+    uint64_t tail;                     // 生产者已写到的位置
+    char pad2[56];
+    uint32_t sleeping;                 // 消费者正在（或准备）睡眠
+    uint32_t wake;                     // futex字，生产者唤醒消费者时加1
+    char pad3[56];
+    char data[MK_SHM_RING_SIZE];
+} mk_shm_ring_t;
+
+// 环中的一条消息（8字节对齐，len为0表示跳到数据区开头）
+typedef struct {
+    uint32_t len;                      // 消息总字节数
+    uint32_t op;                       // 请求：MK_SHM_GET/PUT/DEL；回复：MK_SHM_OK/NOTFOUND/ERR
+    uint64_t vlen;                     // value长度（PUT的请求value、GET的回复value）
+    uint32_t klen;                     // key长度（不含'\0'）
+    uint32_t reserved;
+    char key[];                        // key '\0'
+} mk_shm_msg_t;
+
+// 共享内存开头的描述信息（由客户端填写，服务端检查）
+typedef struct {
+    char magic[8];
+    uint64_t size;                     // 共享内存总字节数
+    uint64_t value_cap;                // 每个value区的字节数
+    mk_shm_ring_t req;                 // 请求环
+    mk_shm_ring_t rep;                 // 回复环
+    char values[];                     // 请求value区、回复value区
+} mk_shm_seg_t;
+
+// 服务端的一个客户端连接
+typedef struct mk_shm_conn {
+    struct mk_shm_server *srv;
+    int sock;                          // 与客户端的unix套接字，客户端退出时挂断
+    mk_shm_seg_t *seg;
+    size_t size;
+    size_t value_cap;                  // 接受连接时检查过的value区大小（不再从共享内存中读取）
+    pthread_t tid;
+    int done;                          // 处理线程已退出（原子操作）
+    struct mk_shm_conn *next;
+} mk_shm_conn_t;
+
+struct mk_shm_server {
+    mk_t *mk;
+    int listen_fd;
+    int wake[2];                       // 停止时写入wake[1]唤醒接受连接的线程
+    char unix_path[108];
+    pthread_t tid;                     // 接受连接的线程
+    int stop;                          // 正在停止（原子操作）
+    mk_shm_conn_t *conns;              // 所有连接，只在接受连接的线程和停止时访问
+};
+
+struct mk_shm_client {
+    int sock;
+    mk_shm_seg_t *seg;
+    size_t size;
+    size_t value_cap;                  // value区大小
+    char *msg;                         // 组装请求的缓冲区
+};
+
+// 自旋等待时让出流水线
+static inline void mk_shm_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// futex系统调用（共享内存在不同进程中的地址不同，不能用FUTEX_PRIVATE_FLAG）
+static void mk_shm_futex_wait(uint32_t *addr, uint32_t val, int timeout_ms) {
+    struct timespec ts = {timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000};
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void mk_shm_futex_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+// 消息长度（按8字节对齐）
+static size_t mk_shm_msg_size(size_t klen) {
+    return (sizeof(mk_shm_msg_t) + klen + 1 + 7) & ~(size_t)7;
+}
+
+// 写入一条消息并在消费者睡眠时唤醒它，环满返回-1
+static int mk_shm_push(mk_shm_ring_t *r, const mk_shm_msg_t *msg) {
+    uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+    uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    size_t pos = tail % MK_SHM_RING_SIZE;
+    size_t need = msg->len;
+    if (pos + msg->len > MK_SHM_RING_SIZE) need += MK_SHM_RING_SIZE - pos;// 末尾放不下，从头开始
+    if (MK_SHM_RING_SIZE - (tail - head) < need) return -1;
+    if (pos + msg->len > MK_SHM_RING_SIZE) {
+        ((mk_shm_msg_t *)(r->data + pos))->len = 0;
+        tail += MK_SHM_RING_SIZE - pos;
+        pos = 0;
+    }
+    memcpy(r->data + pos, msg, msg->len);
+    // 与消费者的“先标记睡眠再检查tail”配对（都用seq_cst），保证不会错过唤醒
+    __atomic_store_n(&r->tail, tail + msg->len, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->sleeping, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&r->wake, 1, __ATOMIC_SEQ_CST);
+        mk_shm_futex_wake(&r->wake);
+    }
+    return 0;
+}
+
+// 取出下一条消息（不移动head，处理完后调用mk_shm_pop），没有消息返回NULL
+static const mk_shm_msg_t *mk_shm_peek(mk_shm_ring_t *r) {
+    uint64_t head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    while (head != __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)) {
+        size_t pos = head % MK_SHM_RING_SIZE;
+        const mk_shm_msg_t *msg = (const mk_shm_msg_t *)(r->data + pos);
+        if (msg->len != 0) return msg;
+        head += MK_SHM_RING_SIZE - pos;
+        __atomic_store_n(&r->head, head, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+// 消息处理完后移动head，len为消息长度（使用读出时检查过的值）
+static void mk_shm_pop(mk_shm_ring_t *r, size_t len) {
+    __atomic_store_n(&r->head, __atomic_load_n(&r->head, __ATOMIC_RELAXED) + len, __ATOMIC_RELEASE);
+}
+
+static pthread_once_t mk_shm_once = PTHREAD_ONCE_INIT;
+static int mk_shm_multicore;// 是否有多个CPU
+
+static void mk_shm_detect_cpus(void) {
+    mk_shm_multicore = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+}
+
+// 等待环中有消息：先自旋（单核时让出CPU），再在futex上睡眠；超时返回-1（调用方检查对方是否还在）
+static int mk_shm_wait(mk_shm_ring_t *r) {
+    uint64_t head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    pthread_once(&mk_shm_once, mk_shm_detect_cpus);
+    int spins = mk_shm_multicore ? MK_SHM_SPIN : MK_SHM_YIELD;
+    for (int i = 0; i < spins; i++) {
+        if (__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) != head) return 0;
+        if (mk_shm_multicore) mk_shm_pause();
+        else sched_yield();
+    }
+    uint32_t w = __atomic_load_n(&r->wake, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&r->sleeping, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->tail, __ATOMIC_SEQ_CST) == head) mk_shm_futex_wait(&r->wake, w, MK_SHM_SLEEP_MS);
+    __atomic_store_n(&r->sleeping, 0, __ATOMIC_RELAXED);
+    return __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) != head ? 0 : -1;
+}
+
+// 套接字对端是否已关闭
+static int mk_shm_hangup(int sock) {
+    struct pollfd pfd = {sock, POLLIN, 0};
+    if (poll(&pfd, 1, 0) <= 0) return 0;
+    char c;
+    return (pfd.revents & (POLLHUP | POLLERR)) || recv(sock, &c, 1, MSG_DONTWAIT) == 0;
+}
+
+// 执行一条请求，回复写入reply
+// hdr是从共享内存复制出来的消息头：客户端随时可能改写共享内存，检查过的长度不能再从共享内存读
+static void mk_shm_execute(mk_shm_conn_t *c, const mk_shm_msg_t *hdr, const mk_shm_msg_t *req, mk_shm_msg_t *reply) {
+    char *req_val = c->seg->values;
+    char *rep_val = c->seg->values + c->value_cap;
+    char key[MAX_CMD_LEN + 1];
+    reply->op = MK_SHM_ERR;
+    reply->vlen = 0;
+    if (hdr->klen > MAX_CMD_LEN || hdr->len < mk_shm_msg_size(hdr->klen)) return;
+    memcpy(key, req->key, hdr->klen);
+    key[hdr->klen] = '\0';
+
+    switch (hdr->op) {
+    case MK_SHM_GET: {
+        size_t len = 0;
+        if (mk_get_buf(c->srv->mk, key, rep_val, c->value_cap, &len) == 0) {
+            reply->op = MK_SHM_OK;
+            reply->vlen = len;
+        } else if (len == 0 || len + 1 <= c->value_cap) {
+            reply->op = MK_SHM_NOTFOUND;
+        }
+        break;
+    }
+    case MK_SHM_PUT:
+        if (hdr->vlen < c->value_cap && mk_apply(c->srv->mk, MK_OP_PUT, key, req_val, hdr->vlen) == 0) reply->op = MK_SHM_OK;
+        break;
+    case MK_SHM_DEL: {
+        int n = mk_del_checked(c->srv->mk, key);
+        if (n >= 0) reply->op = (n > 0) ? MK_SHM_OK : MK_SHM_NOTFOUND;
+        break;
+    }
+    }
+}
+
+// 一个客户端连接的处理线程
+static void *mk_shm_conn_main(void *arg) {
+    mk_shm_conn_t *c = arg;
+    uint64_t buf[8] = {0};// 回复不带key
+    mk_shm_msg_t *reply = (mk_shm_msg_t *)buf;
+    reply->len = (uint32_t)mk_shm_msg_size(0);
+    while (!__atomic_load_n(&c->srv->stop, __ATOMIC_ACQUIRE)) {
+        const mk_shm_msg_t *req = mk_shm_peek(&c->seg->req);
+        if (req == NULL) {
+            if (mk_shm_wait(&c->seg->req) != 0 && mk_shm_hangup(c->sock)) break;
+            continue;
+        }
+        // 消息头复制出来再检查；消息必须完整地位于环的数据区内，否则断开连接
+        mk_shm_msg_t hdr;
+        memcpy(&hdr, req, sizeof(hdr));
+        size_t pos = (size_t)((const char *)req - c->seg->req.data);
+        if (hdr.len % 8 != 0 || hdr.len < sizeof(mk_shm_msg_t) || pos + hdr.len > MK_SHM_RING_SIZE) break;
+        mk_shm_execute(c, &hdr, req, reply);
+        mk_shm_pop(&c->seg->req, hdr.len);
+        // 客户端每次只发一个请求，回复环不会满
+        if (mk_shm_push(&c->seg->rep, reply) != 0) break;
+    }
+    __atomic_store_n(&c->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// 释放一个连接（处理线程已退出）
+static void mk_shm_conn_free(mk_shm_conn_t *c) {
+    pthread_join(c->tid, NULL);
+    munmap(c->seg, c->size);
+    close(c->sock);
+    free(c);
+}
+
+// 接受一个客户端：收到共享内存的描述符后映射并启动处理线程
+static void mk_shm_accept(mk_shm_server_t *srv) {
+    int sock = accept(srv->listen_fd, NULL, NULL);
+    if (sock < 0) return;
+    // 客户端连接后立即发送描述符，最多等待1秒
+    struct timeval tv = {1, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    char byte;
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = {&byte, 1};
+    struct msghdr mh = {0};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = cbuf;
+    mh.msg_controllen = sizeof(cbuf);
+    int fd = -1;
+    if (recvmsg(sock, &mh, MSG_CMSG_CLOEXEC) == 1) {
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+        if (cm != NULL && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS) memcpy(&fd, CMSG_DATA(cm), sizeof(int));
+    }
+
+    mk_shm_conn_t *c = NULL;
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(mk_shm_seg_t) && (c = calloc(1, sizeof(mk_shm_conn_t))) != NULL) {
+        c->size = (size_t)st.st_size;
+        c->seg = mmap(NULL, c->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        // value区大小只在这里读一次，检查后保存在连接中
+        if (c->seg != MAP_FAILED) c->value_cap = c->seg->value_cap;
+        if (c->seg == MAP_FAILED || memcmp(c->seg->magic, MK_SHM_MAGIC, sizeof(c->seg->magic)) != 0 ||
+            c->seg->size != c->size || c->value_cap > (c->size - sizeof(mk_shm_seg_t)) / 2) {
+            if (c->seg != MAP_FAILED) munmap(c->seg, c->size);
+            free(c);
+            c = NULL;
+        }
+    }
+    if (fd >= 0) close(fd);// 映射后不再需要描述符
+    if (c != NULL) {
+        c->srv = srv;
+        c->sock = sock;
+        if (pthread_create(&c->tid, NULL, mk_shm_conn_main, c) != 0) {
+            perror("mk_shm 创建线程失败");
+            munmap(c->seg, c->size);
+            free(c);
+            c = NULL;
+        }
+    }
+    if (c == NULL) {
+        fprintf(stderr, "mk_shm 拒绝了无效的共享内存连接 ❌\n");
+        close(sock);
+        return;
+    }
+    byte = 1;
+    if (send(sock, &byte, 1, MSG_NOSIGNAL) != 1) {
+        // 客户端已离开，处理线程会在下次超时时发现
+    }
+    c->next = srv->conns;
+    srv->conns = c;
+}
+
+// 接受连接的线程：同时回收处理线程已退出的连接
+static void *mk_shm_main(void *arg) {
+    mk_shm_server_t *srv = arg;
+    while (1) {
+        struct pollfd pfds[2] = {{srv->wake[0], POLLIN, 0}, {srv->listen_fd, POLLIN, 0}};
+        int n = poll(pfds, 2, MK_SHM_SLEEP_MS * 10);
+        if (n < 0 && errno != EINTR) {
+            perror("mk_shm poll失败");
+            break;
+        }
+        if (n > 0 && pfds[0].revents) break;// 停止
+        mk_shm_conn_t **link = &srv->conns;
+        while (*link != NULL) {
+            mk_shm_conn_t *c = *link;
+            if (__atomic_load_n(&c->done, __ATOMIC_ACQUIRE)) {
+                *link = c->next;
+                mk_shm_conn_free(c);
+            } else {
+                link = &c->next;
+            }
+        }
+        if (n > 0 && (pfds[1].revents & POLLIN)) mk_shm_accept(srv);
+    }
+    return NULL;
+}
+
+// 在unix套接字path上接受共享内存客户端
+int mk_shm_start(mk_t *mk, const char *path) {
+    if (mk == NULL || path == NULL) {
+        fprintf(stderr, "mk_shm_start 无效的参数 ❌\n");
+        return -1;
+    }
+    if (mk->shm != NULL) {
+        fprintf(stderr, "共享内存服务已在运行，请先停止 ❌\n");
+        return -1;
+    }
+    char addr[sizeof(((struct sockaddr_un *)0)->sun_path) + 8];
+    if (strlen(path) >= sizeof(((struct sockaddr_un *)0)->sun_path)) {
+        fprintf(stderr, "mk_shm_start 路径过长 ❌\n");
+        return -1;
+    }
+    snprintf(addr, sizeof(addr), "unix:%s", path);
+    mk_shm_server_t *srv = calloc(1, sizeof(mk_shm_server_t));
+    if (srv == NULL) {
+        perror("mk_shm_start 内存分配失败");
+        return -1;
+    }
+    srv->mk = mk;
+    srv->listen_fd = mk_net_listen(addr, srv->unix_path);
+    if (srv->listen_fd < 0 || pipe(srv->wake) != 0) {
+        if (srv->listen_fd >= 0) {
+            perror("mk_shm_start pipe失败");
+            close(srv->listen_fd);
+        }
+        free(srv);
+        return -1;
+    }
+    if (pthread_create(&srv->tid, NULL, mk_shm_main, srv) != 0) {
+        perror("mk_shm_start 创建线程失败");
+        close(srv->listen_fd);
+        close(srv->wake[0]);
+        close(srv->wake[1]);
+        free(srv);
+        return -1;
+    }
+    mk->shm = srv;
+    return 0;
+}
+
+// 停止共享内存服务，断开所有客户端
+int mk_shm_stop(mk_t *mk) {
+    if (mk == NULL || mk->shm == NULL) return 0;
+    mk_shm_server_t *srv = mk->shm;
+    __atomic_store_n(&srv->stop, 1, __ATOMIC_RELEASE);
+    if (write(srv->wake[1], "x", 1) != 1) perror("mk_shm_stop 唤醒失败");
+    pthread_join(srv->tid, NULL);
+    mk->shm = NULL;
+
+    // 处理线程最多睡眠MK_SHM_SLEEP_MS，唤醒后看到stop退出
+    while (srv->conns != NULL) {
+        mk_shm_conn_t *c = srv->conns;
+        srv->conns = c->next;
+        __atomic_add_fetch(&c->seg->req.wake, 1, __ATOMIC_SEQ_CST);
+        mk_shm_futex_wake(&c->seg->req.wake);
+        mk_shm_conn_free(c);
+    }
+    close(srv->listen_fd);
+    if (srv->unix_path[0] != '\0') unlink(srv->unix_path);
+    close(srv->wake[0]);
+    close(srv->wake[1]);
+    free(srv);
+    return 0;
+}
+
+// 连接path上的共享内存服务，value_cap为单个value的最大字节数（0表示使用默认值1MB）
+mk_shm_client_t *mk_shm_connect(const char *path, size_t value_cap) {
+    if (path == NULL) {
+        fprintf(stderr, "mk_shm_connect 无效的参数 ❌\n");
+        return NULL;
+    }
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa.sun_path)) {
+        fprintf(stderr, "mk_shm_connect 路径过长 ❌\n");
+        return NULL;
+    }
+    strcpy(sa.sun_path, path);
+    if (value_cap == 0) value_cap = MK_SHM_VALUE_DEFAULT;
+    value_cap = (value_cap + 1 + 63) & ~(size_t)63;// 末尾补'\0'
+
+    mk_shm_client_t *c = calloc(1, sizeof(mk_shm_client_t));
+    if (c == NULL || (c->msg = malloc(mk_shm_msg_size(MAX_CMD_LEN))) == NULL) {
+        perror("mk_shm_connect 内存分配失败");
+        free(c);
+        return NULL;
+    }
+    c->size = sizeof(mk_shm_seg_t) + 2 * value_cap;
+    c->sock = -1;
+    int fd = memfd_create("minikv-shm", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, (off_t)c->size) != 0) {
+        perror("mk_shm_connect 创建共享内存失败");
+        goto fail;
+    }
+    c->seg = mmap(NULL, c->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (c->seg == MAP_FAILED) {
+        c->seg = NULL;
+        perror("mk_shm_connect 映射共享内存失败");
+        goto fail;
+    }
+    memcpy(c->seg->magic, MK_SHM_MAGIC, sizeof(c->seg->magic));
+    c->seg->size = c->size;
+    c->seg->value_cap = value_cap;
+    c->value_cap = value_cap;
+
+    c->sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c->sock < 0 || connect(c->sock, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        perror("mk_shm_connect 连接失败");
+        goto fail;
+    }
+    // 把描述符传给服务端，等服务端映射完成后的确认
+    char byte = 0;
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    memset(cbuf, 0, sizeof(cbuf));
+    struct iovec iov = {&byte, 1};
+    struct msghdr mh = {0};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = cbuf;
+    mh.msg_controllen = sizeof(cbuf);
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+    if (sendmsg(c->sock, &mh, MSG_NOSIGNAL) != 1 || recv(c->sock, &byte, 1, 0) != 1 || byte != 1) {
+        fprintf(stderr, "mk_shm_connect 服务端拒绝连接 ❌\n");
+        goto fail;
+    }
+    close(fd);
+    return c;
+
+fail:
+    if (fd >= 0) close(fd);
+    if (c->sock >= 0) close(c->sock);
+    if (c->seg != NULL) munmap(c->seg, c->size);
+    free(c->msg);
+    free(c);
+    return NULL;
+}
+
+// 关闭连接（服务端发现套接字挂断后回收）
+void mk_shm_close(mk_shm_client_t *c) {
+    if (c == NULL) return;
+    close(c->sock);
+    munmap(c->seg, c->size);
+    free(c->msg);
+    free(c);
+}
+
+// 发送一个请求并等待回复，返回回复状态，服务端已退出返回-1
+static int mk_shm_call(mk_shm_client_t *c, uint32_t op, const char *key, size_t *vlen) {
+    size_t klen = strlen(key);
+    if (klen > MAX_CMD_LEN) {
+        fprintf(stderr, "mk_shm key过长 ❌\n");
+        return -1;
+    }
+    mk_shm_msg_t *req = (mk_shm_msg_t *)c->msg;
+    req->len = (uint32_t)mk_shm_msg_size(klen);
+    req->op = op;
+    req->vlen = *vlen;
+    req->klen = (uint32_t)klen;
+    memcpy(req->key, key, klen + 1);
+    if (mk_shm_push(&c->seg->req, req) != 0) return -1;
+
+    const mk_shm_msg_t *reply;
+    while ((reply = mk_shm_peek(&c->seg->rep)) == NULL) {
+        if (mk_shm_wait(&c->seg->rep) != 0 && mk_shm_hangup(c->sock)) {
+            fprintf(stderr, "mk_shm 服务端已断开 ❌\n");
+            return -1;
+        }
+    }
+    int status = (int)reply->op;
+    *vlen = reply->vlen;
+    mk_shm_pop(&c->seg->rep, reply->len);
+    return status;
+}
+
+// 查询key，value指向共享内存中的回复value区（不复制，到该连接的下一次调用前有效）
+// key不存在或出错返回-1
+int mk_shm_get(mk_shm_client_t *c, const char *key, const void **value, size_t *len) {
+    if (c == NULL || key == NULL || value == NULL || len == NULL) {
+        fprintf(stderr, "mk_shm_get 无效的参数 ❌\n");
+        return -1;
+    }
+    size_t vlen = 0;
+    if (mk_shm_call(c, MK_SHM_GET, key, &vlen) != MK_SHM_OK) return -1;
+    *value = c->seg->values + c->value_cap;
+    *len = vlen;
+    return 0;
+}
+
+// 写入键值对，value先复制到请求value区（长度需小于连接时的value_cap）
+int mk_shm_put(mk_shm_client_t *c, const char *key, const void *data, size_t len) {
+    if (c == NULL || key == NULL || (data == NULL && len > 0)) {
+        fprintf(stderr, "mk_shm_put 无效的参数 ❌\n");
+        return -1;
+    }
+    if (len >= c->value_cap) {
+        fprintf(stderr, "mk_shm_put value超过连接的value_cap ❌\n");
+        return -1;
+    }
+    memcpy(c->seg->values, data, len);
+    return mk_shm_call(c, MK_SHM_PUT, key, &len) == MK_SHM_OK ? 0 : -1;
+}
+
+// 删除key，key不存在返回1
+int mk_shm_del(mk_shm_client_t *c, const char *key) {
+    if (c == NULL || key == NULL) {
+        fprintf(stderr, "mk_shm_del 无效的参数 ❌\n");
+        return -1;
+    }
+    size_t len = 0;
+    int op = mk_shm_call(c, MK_SHM_DEL, key, &len);
+    if (op == MK_SHM_OK) return 0;
+    return (op == MK_SHM_NOTFOUND) ? 1 : -1;
+}
@@ -0,0 +1,136 @@
+#include "../include/minikv.h"
+#include <string.h>
+#include <time.h>
+
+// 慢操作日志
+// 耗时超过阈值的操作写入固定大小的环形缓冲区，写入和读取都不加锁：
+// 写入方用原子加法领取一个递增的编号，编号对应的槽位用序号锁（seqlock）保护，
+// 读取方发现槽位正在被改写或已被更新的记录覆盖时跳过它。
+// 槽位中的字段都按8字节整数原子读写（写入用release、读取用acquire，保证与序号的先后顺序），
+// 读写并发时不会出现数据竞争。
+
+#define MK_SLOWLOG_KEY_WORDS (MK_SLOWLOG_KEY_LEN / 8)
+
+typedef struct {
+    uint64_t seq;                      // 奇数：正在写入；偶数：写入完成（2*id+2）
+    uint64_t id;                       // 记录编号
+    uint64_t timestamp_us;             // 操作开始时间（Unix时间，微秒）
+    uint64_t duration_us;              // 耗时（微秒）
+    const char *cmd;                   // 操作名（静态字符串）
+    uint64_t key[MK_SLOWLOG_KEY_WORDS];// key（过长时截断，按8字节分块原子写入）
+} mk_slow_slot_t;
+
+struct mk_slowlog {
+    uint64_t next;                     // 最近一条记录的编号（从1开始）
+    uint64_t reset_id;                 // 编号不大于它的记录已被清空
+    mk_slow_slot_t slots[MK_SLOWLOG_LEN];
+};
+
+// 设置慢操作阈值（微秒），0表示关闭；首次开启时创建环形缓冲区
+int mk_slowlog_set(mk_t *mk, uint64_t threshold_us) {
+    if (mk == NULL) {
+        fprintf(stderr, "mk_slowlog_set 无效的参数 ❌\n");
+        return -1;
+    }
+    if (threshold_us > 0 && __atomic_load_n(&mk->slowlog, __ATOMIC_ACQUIRE) == NULL) {
+        mk_slowlog_t *log = calloc(1, sizeof(mk_slowlog_t));
+        if (log == NULL) {
+            perror("mk_slowlog_set 内存分配失败");
+            return -1;
+        }
+        // 缓冲区创建后直到销毁Hash表才释放；并发开启时只保留一个
+        mk_slowlog_t *expected = NULL;
+        if (!__atomic_compare_exchange_n(&mk->slowlog, &expected, log, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+            free(log);
+        }
+    }
+    MK_ATOMIC_STORE(mk->slowlog_ns, threshold_us * 1000);
+    return 0;
+}
+
+// 记录一次慢操作（由mk_slowlog_end在耗时超过阈值时调用）
+void mk_slowlog_record(const mk_t *mk, const char *cmd, const char *key, uint64_t duration_ns) {
+    mk_slowlog_t *log = __atomic_load_n(&mk->slowlog, __ATOMIC_ACQUIRE);
+    if (log == NULL) return;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t now_us = (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+    uint64_t words[MK_SLOWLOG_KEY_WORDS] = {0};
+    if (key != NULL) {
+        size_t klen = strnlen(key, MK_SLOWLOG_KEY_LEN - 1);
+        memcpy(words, key, klen);
+    }
+
+    uint64_t id = MK_ATOMIC_ADD(log->next, 1);
+    mk_slow_slot_t *slot = &log->slots[id % MK_SLOWLOG_LEN];
+    __atomic_store_n(&slot->seq, 2 * id + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->id, id, __ATOMIC_RELEASE);
+    __atomic_store_n(&slot->timestamp_us, now_us - duration_ns / 1000, __ATOMIC_RELEASE);
+    __atomic_store_n(&slot->duration_us, duration_ns / 1000, __ATOMIC_RELEASE);
+    __atomic_store_n(&slot->cmd, cmd, __ATOMIC_RELEASE);
+    for (int i = 0; i < MK_SLOWLOG_KEY_WORDS; i++) __atomic_store_n(&slot->key[i], words[i], __ATOMIC_RELEASE);
+    __atomic_store_n(&slot->seq, 2 * id + 2, __ATOMIC_RELEASE);
+}
+
+// 读出编号为id的记录，槽位正在改写或已被覆盖时返回-1
+static int mk_slowlog_read(mk_slowlog_t *log, uint64_t id, mk_slowlog_entry_t *out) {
+    mk_slow_slot_t *slot = &log->slots[id % MK_SLOWLOG_LEN];
+    uint64_t words[MK_SLOWLOG_KEY_WORDS];
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq != 2 * id + 2) return -1;
+    out->id = __atomic_load_n(&slot->id, __ATOMIC_ACQUIRE);
+    out->timestamp_us = __atomic_load_n(&slot->timestamp_us, __ATOMIC_ACQUIRE);
+    out->duration_us = __atomic_load_n(&slot->duration_us, __ATOMIC_ACQUIRE);
+    const char *cmd = __atomic_load_n(&slot->cmd, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < MK_SLOWLOG_KEY_WORDS; i++) words[i] = __atomic_load_n(&slot->key[i], __ATOMIC_ACQUIRE);
+    // 读取期间槽位被改写时序号会变化
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq || out->id != id) return -1;
+
+    snprintf(out->cmd, sizeof(out->cmd), "%s", cmd);
+    memcpy(out->key, words, sizeof(out->key));
+    out->key[sizeof(out->key) - 1] = '\0';
+    return 0;
+}
+
+// 获取最近的n条慢操作记录（新的在前），返回条数
+size_t mk_slowlog_get(const mk_t *mk, mk_slowlog_entry_t *out, size_t n) {
+    if (mk == NULL || (out == NULL && n > 0)) {
+        fprintf(stderr, "mk_slowlog_get 无效的参数 ❌\n");
+        return 0;
+    }
+    mk_slowlog_t *log = __atomic_load_n(&mk->slowlog, __ATOMIC_ACQUIRE);
+    if (log == NULL) return 0;
+
+    uint64_t last = MK_ATOMIC_LOAD(log->next);
+    uint64_t first = MK_ATOMIC_LOAD(log->reset_id) + 1;
+    if (last >= MK_SLOWLOG_LEN && last - MK_SLOWLOG_LEN + 1 > first) first = last - MK_SLOWLOG_LEN + 1;
+    size_t found = 0;
+    for (uint64_t id = last; id >= first && id > 0 && found < n; id--) {
+        if (mk_slowlog_read(log, id, &out[found]) == 0) found++;
+    }
+    return found;
+}
+
+// 当前保存的慢操作记录条数
+size_t mk_slowlog_len(const mk_t *mk) {
+    if (mk == NULL) return 0;
+    mk_slowlog_t *log = __atomic_load_n(&mk->slowlog, __ATOMIC_ACQUIRE);
+    if (log == NULL) return 0;
+    uint64_t n = MK_ATOMIC_LOAD(log->next) - MK_ATOMIC_LOAD(log->reset_id);
+    return n < MK_SLOWLOG_LEN ? (size_t)n : MK_SLOWLOG_LEN;
+}
+
+// 清空慢操作记录（只记下清空时的编号，不影响并发写入）
+void mk_slowlog_reset(mk_t *mk) {
+    if (mk == NULL) return;
+    mk_slowlog_t *log = __atomic_load_n(&mk->slowlog, __ATOMIC_ACQUIRE);
+    if (log == NULL) return;
+    MK_ATOMIC_STORE(log->reset_id, MK_ATOMIC_LOAD(log->next));
+}
+
+// 释放慢操作日志（销毁Hash表时调用）
+void mk_slowlog_free(mk_t *mk) {
+    free(mk->slowlog);
+    mk->slowlog = NULL;
+}
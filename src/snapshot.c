@@ -0,0 +1,129 @@
+#include "../include/minikv.h"
+#include <string.h>
+
+// MVCC只读快照
+// 每次写操作在分段锁内取一个递增的全局序号作为新版本号。快照记下开始时的序号s，
+// 只看版本号不大于s的数据；写操作覆盖或删除一个快照可能看到的版本时，
+// 旧版本被挂到节点的旧版本链上，直到没有快照需要时再回收。
+
+struct mk_snapshot {
+    mk_t *mk;
+    uint64_t seq;                      // 快照开始时的全局序号
+    struct mk_snapshot *prev, *next;   // 活动快照链表（按开始顺序）
+};
+
+// 节点在序号seq时可见的版本，不存在或已删除时返回NULL
+const mk_node_t *mk_node_visible(const mk_node_t *node, uint64_t seq) {
+    for (const mk_node_t *v = node; v != NULL; v = v->older) {
+        if (v->version <= seq) return (v->flags & MK_NODE_TOMBSTONE) ? NULL : v;
+    }
+    return NULL;
+}
+
+// 创建当前时刻的只读快照，之后的写操作对快照不可见，也不会被快照阻塞
+// 开启磁盘层时不支持（刷盘会整体清空内存表）
+mk_snapshot_t *mk_snapshot_begin(const mk_t *cmk) {
+    if (cmk == NULL) {
+        fprintf(stderr, "mk_snapshot_begin 无效的参数 ❌\n");
+        return NULL;
+    }
+    // 快照登记信息写入const表：表对象本身总是由mk_create在堆上创建的
+    mk_t *mk = (mk_t *)cmk;
+    if (mk->lsm != NULL) {
+        fprintf(stderr, "mk_snapshot_begin 开启磁盘层时不支持快照 ❌\n");
+        return NULL;
+    }
+    mk_lock_all(mk, 0);
+    mk_snapshot_t *snap = mk_snapshot_begin_locked(mk);
+    mk_unlock_all(mk);
+    return snap;
+}
+
+// 创建快照（调用方持有全部读锁，且未开启磁盘层），调用方可以在同一临界区内读取与快照对应的其他状态
+// 持有全部读锁时没有进行中的写操作：已取到序号的写入都已完成，登记后的写入都能看到本快照
+mk_snapshot_t *mk_snapshot_begin_locked(mk_t *mk) {
+    mk_snapshot_t *snap = calloc(1, sizeof(mk_snapshot_t));
+    if (snap == NULL) {
+        perror("mk_snapshot_begin 内存分配失败");
+        return NULL;
+    }
+    snap->mk = mk;
+
+    pthread_mutex_lock(&mk->snap_mu);
+    snap->seq = MK_ATOMIC_LOAD(mk->seq);
+    mk_snapshot_t **pp = &mk->snaps;
+    while (*pp != NULL) {
+        snap->prev = *pp;
+        pp = &(*pp)->next;
+    }
+    *pp = snap;
+    if (mk->snap_count == 0) MK_ATOMIC_STORE(mk->snap_oldest, snap->seq);
+    MK_ATOMIC_STORE(mk->snap_newest, snap->seq);
+    MK_ATOMIC_ADD(mk->snap_count, 1);
+    pthread_mutex_unlock(&mk->snap_mu);
+    return snap;
+}
+
+// 在快照中查询key，len返回value长度
+// 返回的指针在快照结束前有效（压缩存储的value放在线程局部缓冲区，同一线程下次取值前有效）
+const char *mk_snapshot_get(const mk_snapshot_t *snap, const char *key, size_t *len) {
+    if (snap == NULL || key == NULL) return NULL;
+    char *validKey = mk_trim(key);
+    if (validKey == NULL) return NULL;
+
+    const mk_t *mk = snap->mk;
+    size_t idx = mk_hash(validKey);
+    const char *value = NULL;
+    pthread_rwlock_rdlock(mk_stripe(mk, idx));
+    const mk_node_t *v = mk_node_visible(mk_bucket_find(mk, idx, validKey), snap->seq);
+    if (v != NULL) value = mk_node_value(mk, v, len);
+    pthread_rwlock_unlock(mk_stripe(mk, idx));
+    free(validKey);
+    return value;
+}
+
+// 按哈希桶顺序遍历快照中的所有键值对，cb返回非0时提前结束并返回该值
+// 每个桶只在回调期间持有所在分段的读锁，不会阻塞其他分段的写操作
+int mk_snapshot_foreach(const mk_snapshot_t *snap, int (*cb)(const char *key, size_t klen, const char *value, size_t vlen, void *ctx), void *ctx) {
+    if (snap == NULL || cb == NULL) {
+        fprintf(stderr, "mk_snapshot_foreach 无效的参数 ❌\n");
+        return -1;
+    }
+    const mk_t *mk = snap->mk;
+    int ret = 0;
+    for (size_t i = 0; i < MK_HASH_SIZE && ret == 0; i++) {
+        pthread_rwlock_rdlock(mk_stripe(mk, i));
+        for (const mk_node_t *node = mk->buckets[i]; node != NULL && ret == 0; node = node->next) {
+            const mk_node_t *v = mk_node_visible(node, snap->seq);
+            if (v == NULL) continue;
+            size_t vlen = 0;
+            const char *value = mk_node_value(mk, v, &vlen);
+            ret = (value == NULL) ? -1 : cb(node->key, strlen(node->key), value, vlen, ctx);
+        }
+        pthread_rwlock_unlock(mk_stripe(mk, i));
+    }
+    return ret;
+}
+
+// 结束快照；最老的快照结束时回收不再需要的旧版本
+void mk_snapshot_end(mk_snapshot_t *snap) {
+    if (snap == NULL) return;
+    mk_t *mk = snap->mk;
+
+    pthread_mutex_lock(&mk->snap_mu);
+    int was_oldest = (snap->prev == NULL);
+    if (snap->prev != NULL) snap->prev->next = snap->next;
+    else mk->snaps = snap->next;
+    if (snap->next != NULL) snap->next->prev = snap->prev;
+
+    mk_snapshot_t *tail = mk->snaps;
+    while (tail != NULL && tail->next != NULL) tail = tail->next;
+    // release：写操作看到快照已结束后才会释放本快照读到过的value
+    __atomic_store_n(&mk->snap_oldest, mk->snaps != NULL ? mk->snaps->seq : 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&mk->snap_newest, tail != NULL ? tail->seq : 0, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&mk->snap_count, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&mk->snap_mu);
+    free(snap);
+
+    if (was_oldest && MK_ATOMIC_LOAD(mk->old_versions) > 0) mk_mvcc_gc(mk);
+}
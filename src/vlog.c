@@ -0,0 +1,413 @@
+#include "../include/minikv.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 值日志（key-value分离）
+// 不小于阈值的value不放在节点里，而是追加到值日志中，节点只保存记录的位置（vlog_off）和长度：
+// 覆盖大value时不再释放和重新分配大块内存，快照保留旧版本时也只复制节点。
+// 值日志由若干个段组成，每段是一个映射到内存的文件（创建后立即删除文件名，进程退出即回收），
+// 大value的内存由操作系统按需换入换出。
+// 值日志不持久化：重启后无法重新打开旧段，节点中的位置也随进程失效。
+// 持久化由WAL、快照和磁盘层负责，它们写入的都是解码后的完整value。只有最新的段（活动段）接受追加，写满后封存。
+// 覆盖或删除使记录失效，后台回收线程把无效数据过半的封存段中仍有效的记录搬到活动段，然后释放整个段。
+// 位置编码：高位为段在段表中的下标，低MK_VLOG_POS_BITS位为段内偏移。
+
+#define MK_VLOG_POS_BITS 40
+#define MK_VLOG_POS_MASK ((1ull << MK_VLOG_POS_BITS) - 1)
+
+// 一条记录：头部、key '\0'、value '\0'，按8字节对齐
+typedef struct {
+    uint32_t klen;
+    uint32_t reserved;
+    uint64_t vlen;
+} mk_vlog_rec_t;
+
+// 一个段
+typedef struct {
+    char *base;                        // 映射的起始地址
+    size_t size;                       // 段大小
+    uint64_t used;                     // 已分配到的位置（受vlog->mu保护，封存后不再变化）
+    uint64_t writers;                  // 已分配空间、尚未复制完或尚未挂到节点上的追加数（原子操作）
+    uint64_t live;                     // 有效记录的字节数（原子操作）
+    uint64_t dead;                     // 失效记录的字节数（原子操作）
+    int sealed;                        // 已封存（原子操作）
+} mk_vlog_seg_t;
+
+struct mk_vlog {
+    char *dir;                         // 段文件所在目录
+    size_t threshold;                  // value不小于该字节数时写入值日志
+    size_t seg_size;                   // 段的默认大小
+    pthread_mutex_t mu;                // 保护段表的修改和活动段的空间分配
+    mk_vlog_seg_t *segs[MK_VLOG_MAX_SEGMENTS];// 段表（读取时原子读取）
+    size_t active;                     // 活动段的下标，没有时为MK_VLOG_MAX_SEGMENTS
+    uint64_t next_file;                // 下一个段文件的编号
+    pthread_mutex_t gc_run;            // 保证同一时间只有一个回收在进行
+    pthread_mutex_t gc_mu;             // 后台回收线程的等待锁
+    pthread_cond_t gc_cond;
+    pthread_t gc_thread;
+    int gc_stop;                       // 通知后台线程退出
+    uint64_t gc_runs;                  // 回收的段数（原子操作）
+    uint64_t gc_moved;                 // 回收时搬移的字节数（原子操作）
+};
+
+// 记录占用的字节数
+static size_t mk_vlog_rec_size(size_t klen, size_t vlen) {
+    return (sizeof(mk_vlog_rec_t) + klen + 1 + vlen + 1 + 7) & ~(size_t)7;
+}
+
+// 位置对应的记录（调用方保证记录仍然有效）
+static mk_vlog_rec_t *mk_vlog_rec(const mk_vlog_t *v, uint64_t off) {
+    mk_vlog_seg_t *seg = __atomic_load_n(&((mk_vlog_t *)v)->segs[off >> MK_VLOG_POS_BITS], __ATOMIC_ACQUIRE);
+    return (mk_vlog_rec_t *)(seg->base + (off & MK_VLOG_POS_MASK));
+}
+
+// 新建一个段并设为活动段（调用方持有v->mu），段表已满返回-1
+static int mk_vlog_seg_new(mk_vlog_t *v, size_t size) {
+    size_t slot = 0;
+    while (slot < MK_VLOG_MAX_SEGMENTS && v->segs[slot] != NULL) slot++;
+    if (slot == MK_VLOG_MAX_SEGMENTS) {
+        fprintf(stderr, "mk_vlog 段数达到上限 ❌\n");
+        return -1;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size = (size + page - 1) / page * page;
+
+    size_t plen = strlen(v->dir) + 32;
+    char *path = malloc(plen);
+    mk_vlog_seg_t *seg = calloc(1, sizeof(mk_vlog_seg_t));
+    if (path == NULL || seg == NULL) {
+        perror("mk_vlog 内存分配失败");
+        free(path);
+        free(seg);
+        return -1;
+    }
+    snprintf(path, plen, "%s/vlog-%llu.log", v->dir, (unsigned long long)v->next_file++);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0 || ftruncate(fd, (off_t)size) != 0) {
+        perror("mk_vlog 创建段文件失败");
+        if (fd >= 0) close(fd);
+        unlink(path);
+        free(path);
+        free(seg);
+        return -1;
+    }
+    seg->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // 映射建立后文件名已无用，进程退出时文件随映射一起回收
+    unlink(path);
+    close(fd);
+    free(path);
+    if (seg->base == MAP_FAILED) {
+        perror("mk_vlog 映射段文件失败");
+        free(seg);
+        return -1;
+    }
+    seg->size = size;
+    __atomic_store_n(&v->segs[slot], seg, __ATOMIC_RELEASE);
+    v->active = slot;
+    return 0;
+}
+
+// 唤醒后台回收线程
+static void mk_vlog_wake_gc(mk_vlog_t *v) {
+    pthread_mutex_lock(&v->gc_mu);
+    pthread_cond_signal(&v->gc_cond);
+    pthread_mutex_unlock(&v->gc_mu);
+}
+
+// 封存活动段（调用方持有v->mu），封存时无效数据已过半则唤醒后台回收
+static void mk_vlog_seal(mk_vlog_t *v) {
+    if (v->active == MK_VLOG_MAX_SEGMENTS) return;
+    mk_vlog_seg_t *seg = v->segs[v->active];
+    __atomic_store_n(&seg->sealed, 1, __ATOMIC_RELEASE);
+    v->active = MK_VLOG_MAX_SEGMENTS;
+    if (MK_ATOMIC_LOAD(seg->dead) * 2 >= seg->used) mk_vlog_wake_gc(v);
+}
+
+// 追加一条记录，off返回记录的位置；pin为1时复制完仍占住段（由mk_vlog_unpin释放），回收会等待
+static int mk_vlog_write(mk_vlog_t *v, const char *key, size_t klen, const void *data, size_t len, int pin, uint64_t *off) {
+    size_t rec = mk_vlog_rec_size(klen, len);
+    pthread_mutex_lock(&v->mu);
+    mk_vlog_seg_t *seg = (v->active == MK_VLOG_MAX_SEGMENTS) ? NULL : v->segs[v->active];
+    if (seg == NULL || seg->used + rec > seg->size) {
+        mk_vlog_seal(v);
+        if (mk_vlog_seg_new(v, rec > v->seg_size ? rec : v->seg_size) != 0) {
+            pthread_mutex_unlock(&v->mu);
+            return -1;
+        }
+        seg = v->segs[v->active];
+    }
+    uint64_t pos = seg->used;
+    seg->used += rec;
+    *off = ((uint64_t)v->active << MK_VLOG_POS_BITS) | pos;
+    MK_ATOMIC_ADD(seg->writers, 1);
+    MK_ATOMIC_ADD(seg->live, rec);
+    pthread_mutex_unlock(&v->mu);
+
+    // 各个追加写入不同的区间，复制不需要持锁
+    mk_vlog_rec_t *r = (mk_vlog_rec_t *)(seg->base + pos);
+    r->klen = (uint32_t)klen;
+    r->vlen = len;
+    char *p = (char *)(r + 1);
+    memcpy(p, key, klen);
+    p[klen] = '\0';
+    if (len > 0) memcpy(p + klen + 1, data, len);
+    p[klen + 1 + len] = '\0';
+    if (!pin) __atomic_sub_fetch(&seg->writers, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// 把value追加到值日志（在分段锁外调用），off返回记录的位置
+// 记录挂到节点上之前没有节点引用它，回收会把它当作无效数据：追加后段保持占住，
+// 调用方在分段写锁下挂到节点上（或调用mk_vlog_release放弃）之后调用mk_vlog_unpin
+int mk_vlog_append(mk_t *mk, const char *validKey, const void *data, size_t len, uint64_t *off) {
+    return mk_vlog_write(mk->vlog, validKey, strlen(validKey), data, len, 1, off);
+}
+
+// 释放mk_vlog_append占住的段
+void mk_vlog_unpin(const mk_t *mk, uint64_t off) {
+    mk_vlog_seg_t *seg = __atomic_load_n(&mk->vlog->segs[off >> MK_VLOG_POS_BITS], __ATOMIC_ACQUIRE);
+    __atomic_sub_fetch(&seg->writers, 1, __ATOMIC_RELEASE);
+}
+
+// 位置off处记录的value（调用方持有引用该记录的节点所在分段的锁），末尾有'\0'
+const char *mk_vlog_value(const mk_t *mk, uint64_t off) {
+    mk_vlog_rec_t *r = mk_vlog_rec(mk->vlog, off);
+    return (const char *)(r + 1) + r->klen + 1;
+}
+
+// 标记位置off处的记录失效（调用方持有引用该记录的节点所在分段的写锁）
+void mk_vlog_release(const mk_t *mk, uint64_t off) {
+    mk_vlog_t *v = mk->vlog;
+    mk_vlog_seg_t *seg = __atomic_load_n(&v->segs[off >> MK_VLOG_POS_BITS], __ATOMIC_ACQUIRE);
+    mk_vlog_rec_t *r = (mk_vlog_rec_t *)(seg->base + (off & MK_VLOG_POS_MASK));
+    size_t rec = mk_vlog_rec_size(r->klen, r->vlen);
+    MK_ATOMIC_SUB(seg->live, rec);
+    uint64_t dead = MK_ATOMIC_ADD(seg->dead, rec);
+    // 封存段的无效数据刚好过半时唤醒后台回收（封存后used不再变化）
+    if (__atomic_load_n(&seg->sealed, __ATOMIC_ACQUIRE) && dead * 2 >= seg->used && (dead - rec) * 2 < seg->used) {
+        mk_vlog_wake_gc(v);
+    }
+}
+
+// 在节点及其旧版本中找引用位置off的版本（调用方持有分段锁）
+static mk_node_t *mk_vlog_owner(mk_node_t *node, uint64_t off) {
+    for (mk_node_t *v = node; v != NULL; v = v->older) {
+        if (v->enc == MK_ENC_VLOG && v->vlog_off == off) return v;
+    }
+    return NULL;
+}
+
+// 回收一个封存段：仍有效的记录搬到活动段，然后释放整个段
+static void mk_vlog_gc_segment(mk_t *mk, size_t slot) {
+    mk_vlog_t *v = mk->vlog;
+    mk_vlog_seg_t *seg = v->segs[slot];
+    // 等待封存前已分配空间的追加复制完成、并挂到节点上（之后才能按节点判断记录是否有效）
+    while (__atomic_load_n(&seg->writers, __ATOMIC_ACQUIRE) > 0) sched_yield();
+
+    uint64_t pos = 0;
+    while (pos < seg->used) {
+        mk_vlog_rec_t *r = (mk_vlog_rec_t *)(seg->base + pos);
+        const char *key = (const char *)(r + 1);
+        size_t rec = mk_vlog_rec_size(r->klen, r->vlen);
+        uint64_t off = ((uint64_t)slot << MK_VLOG_POS_BITS) | pos;
+        size_t idx = mk_hash(key);
+
+        // 先在读锁下判断是否有效，有效时在锁外复制一份，再在写锁下确认并切换位置
+        pthread_rwlock_rdlock(mk_stripe(mk, idx));
+        int live = mk_vlog_owner(mk_bucket_find(mk, idx, key), off) != NULL;
+        pthread_rwlock_unlock(mk_stripe(mk, idx));
+        uint64_t moved = 0;
+        if (live && mk_vlog_write(v, key, r->klen, key + r->klen + 1, r->vlen, 0, &moved) == 0) {
+            pthread_rwlock_wrlock(mk_stripe(mk, idx));
+            mk_node_t *owner = mk_vlog_owner(mk_bucket_find(mk, idx, key), off);
+            if (owner != NULL) {
+                owner->vlog_off = moved;
+                mk_vlog_release(mk, off);
+                MK_ATOMIC_ADD(v->gc_moved, rec);
+            } else {
+                mk_vlog_release(mk, moved);// 复制期间已被覆盖
+            }
+            pthread_rwlock_unlock(mk_stripe(mk, idx));
+        } else if (live) {
+            return;// 活动段分配失败，保留该段
+        }
+        pos += rec;
+    }
+
+    // 所有引用都已切换到别的段
+    pthread_mutex_lock(&v->mu);
+    __atomic_store_n(&v->segs[slot], NULL, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&v->mu);
+    munmap(seg->base, seg->size);
+    free(seg);
+    MK_ATOMIC_ADD(v->gc_runs, 1);
+}
+
+// 回收无效数据比例不低于一半（all为1时只要有无效数据，且先封存含无效数据的活动段）的封存段，返回回收的段数
+static size_t mk_vlog_collect(mk_t *mk, int all) {
+    mk_vlog_t *v = mk->vlog;
+    size_t done = 0;
+    pthread_mutex_lock(&v->gc_run);
+    if (all) {
+        // 持有gc_run后再判断：进行中的回收搬运记录时可能在活动段中留下无效数据
+        pthread_mutex_lock(&v->mu);
+        if (v->active != MK_VLOG_MAX_SEGMENTS && MK_ATOMIC_LOAD(v->segs[v->active]->dead) > 0) mk_vlog_seal(v);
+        pthread_mutex_unlock(&v->mu);
+    }
+    for (size_t slot = 0; slot < MK_VLOG_MAX_SEGMENTS; slot++) {
+        pthread_mutex_lock(&v->mu);
+        mk_vlog_seg_t *seg = v->segs[slot];
+        int pick = seg != NULL && seg->sealed;
+        if (pick) {
+            uint64_t dead = MK_ATOMIC_LOAD(seg->dead);
+            pick = all ? dead > 0 : dead * 2 >= seg->used;
+        }
+        pthread_mutex_unlock(&v->mu);
+        if (pick) {
+            mk_vlog_gc_segment(mk, slot);
+            done++;
+        }
+    }
+    pthread_mutex_unlock(&v->gc_run);
+    return done;
+}
+
+// 后台回收线程：有封存段的无效数据过半时回收
+static void *mk_vlog_gc_main(void *arg) {
+    mk_t *mk = arg;
+    mk_vlog_t *v = mk->vlog;
+    pthread_mutex_lock(&v->gc_mu);
+    while (!v->gc_stop) {
+        pthread_mutex_unlock(&v->gc_mu);
+        mk_vlog_collect(mk, 0);
+        pthread_mutex_lock(&v->gc_mu);
+        if (!v->gc_stop) pthread_cond_wait(&v->gc_cond, &v->gc_mu);
+    }
+    pthread_mutex_unlock(&v->gc_mu);
+    return NULL;
+}
+
+// 开启值日志：value不小于threshold字节时写入dir下的值日志，每段segment_size字节（0为默认64MB）
+int mk_vlog_open(mk_t *mk, const char *dir, size_t threshold, size_t segment_size) {
+    if (mk == NULL || dir == NULL || threshold == 0) {
+        fprintf(stderr, "mk_vlog_open 无效的参数 ❌\n");
+        return -1;
+    }
+    if (mk->vlog != NULL) {
+        fprintf(stderr, "值日志已开启 ❌\n");
+        return -1;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror("mk_vlog_open 创建目录失败");
+        return -1;
+    }
+    mk_vlog_t *v = calloc(1, sizeof(mk_vlog_t));
+    if (v == NULL || (v->dir = strdup(dir)) == NULL) {
+        perror("mk_vlog_open 内存分配失败");
+        free(v);
+        return -1;
+    }
+    v->threshold = threshold;
+    v->seg_size = segment_size ? segment_size : MK_VLOG_SEGMENT_SIZE;
+    v->active = MK_VLOG_MAX_SEGMENTS;
+    v->next_file = 1;
+    pthread_mutex_init(&v->mu, NULL);
+    pthread_mutex_init(&v->gc_run, NULL);
+    pthread_mutex_init(&v->gc_mu, NULL);
+    pthread_cond_init(&v->gc_cond, NULL);
+    __atomic_store_n(&mk->vlog, v, __ATOMIC_RELEASE);
+    if (pthread_create(&v->gc_thread, NULL, mk_vlog_gc_main, mk) != 0) {
+        perror("mk_vlog_open 创建线程失败");
+        __atomic_store_n(&mk->vlog, NULL, __ATOMIC_RELEASE);
+        pthread_mutex_destroy(&v->mu);
+        pthread_mutex_destroy(&v->gc_run);
+        pthread_mutex_destroy(&v->gc_mu);
+        pthread_cond_destroy(&v->gc_cond);
+        free(v->dir);
+        free(v);
+        return -1;
+    }
+    return 0;
+}
+
+// value是否应写入值日志
+int mk_vlog_wants(const mk_t *mk, size_t len) {
+    mk_vlog_t *v = __atomic_load_n(&mk->vlog, __ATOMIC_ACQUIRE);
+    return v != NULL && len >= v->threshold;
+}
+
+// 立即回收所有含无效数据的段（包括活动段：先封存再回收）
+int mk_vlog_gc(mk_t *mk) {
+    if (mk == NULL || mk->vlog == NULL) {
+        fprintf(stderr, "mk_vlog_gc 未开启值日志 ❌\n");
+        return -1;
+    }
+    mk_vlog_collect(mk, 1);
+    return 0;
+}
+
+// 暂停回收（刷盘时内存表的节点暂时摘出哈希桶，回收会把它们引用的记录当成无效），返回是否已暂停
+int mk_vlog_pause_gc(const mk_t *mk) {
+    mk_vlog_t *v = __atomic_load_n(&mk->vlog, __ATOMIC_ACQUIRE);
+    if (v == NULL) return 0;
+    pthread_mutex_lock(&v->gc_run);
+    return 1;
+}
+
+// 恢复mk_vlog_pause_gc暂停的回收
+void mk_vlog_resume_gc(const mk_t *mk) {
+    pthread_mutex_unlock(&mk->vlog->gc_run);
+}
+
+// 获取值日志统计
+int mk_vlog_stats(const mk_t *mk, mk_vlog_stats_t *stats) {
+    if (mk == NULL || stats == NULL || mk->vlog == NULL) {
+        fprintf(stderr, "mk_vlog_stats 未开启值日志 ❌\n");
+        return -1;
+    }
+    mk_vlog_t *v = mk->vlog;
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&v->mu);
+    for (size_t slot = 0; slot < MK_VLOG_MAX_SEGMENTS; slot++) {
+        mk_vlog_seg_t *seg = v->segs[slot];
+        if (seg == NULL) continue;
+        stats->segments++;
+        stats->file_bytes += seg->size;
+        stats->live_bytes += MK_ATOMIC_LOAD(seg->live);
+        stats->dead_bytes += MK_ATOMIC_LOAD(seg->dead);
+    }
+    pthread_mutex_unlock(&v->mu);
+    stats->gc_segments = MK_ATOMIC_LOAD(v->gc_runs);
+    stats->gc_moved_bytes = MK_ATOMIC_LOAD(v->gc_moved);
+    return 0;
+}
+
+// 停止后台回收并释放所有段（销毁Hash表时调用，之后不能再读取值日志中的value）
+void mk_vlog_free(mk_t *mk) {
+    mk_vlog_t *v = mk->vlog;
+    if (v == NULL) return;
+    pthread_mutex_lock(&v->gc_mu);
+    v->gc_stop = 1;
+    pthread_cond_signal(&v->gc_cond);
+    pthread_mutex_unlock(&v->gc_mu);
+    pthread_join(v->gc_thread, NULL);
+
+    for (size_t slot = 0; slot < MK_VLOG_MAX_SEGMENTS; slot++) {
+        mk_vlog_seg_t *seg = v->segs[slot];
+        if (seg == NULL) continue;
+        munmap(seg->base, seg->size);
+        free(seg);
+    }
+    pthread_mutex_destroy(&v->mu);
+    pthread_mutex_destroy(&v->gc_run);
+    pthread_mutex_destroy(&v->gc_mu);
+    pthread_cond_destroy(&v->gc_cond);
+    free(v->dir);
+    free(v);
+    mk->vlog = NULL;
+}
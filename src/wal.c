@@ -0,0 +1,833 @@
+#include "../include/minikv.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// 写日志与检查点
+// 每次写操作在持有分段写锁时追加一条记录到写日志（与生效顺序一致），后台线程每秒写出并落盘一次。
+// 写日志按字节位置编号，分成若干段文件 wal-<起始位置>.log，每次做检查点时切换到新段。
+// 检查点 checkpoint-<位置>.ckpt 保存某一时刻的全部键值对，并记录做检查点前的日志位置P：
+// 启动时载入最新的完好检查点，再从P开始重放日志尾部。检查点和日志记录都是"写入完整value"，
+// 重放已经包含在检查点中的记录不会改变结果，所以检查点不需要与P严格对应同一时刻。
+// 检查点按key所在的分段分成MK_WAL_PARTS个分区，每个分区单独校验；载入和重放都按分区并行，
+// 同一个key的记录总在同一个分区里按日志顺序应用，各线程也不会争用同一把分段锁。
+//
+// 日志记录：[u32 校验][u8 op][u32 klen][u32 vlen][key]['\0'][value]，校验覆盖校验字段之后的所有字节；
+// 批量写是一条op为MK_OP_BATCH、key为空的记录，value为依次排列的各个操作
+// 检查点：mk_ckpt_hdr_t，然后依次是各分区的数据，分区内的记录为 [u32 klen][u32 vlen][key]['\0'][value]
+
+#define MK_WAL_PARTS MK_LOCK_STRIPES       // 检查点分区数（与分段锁一一对应）
+#define MK_WAL_HDR_LEN MK_BATCH_OP_HDR     // 日志记录头长度（与批量写中操作的头相同）
+#define MK_WAL_BUF_SIZE (64 * 1024)        // 日志写缓冲区大小
+#define MK_WAL_SYNC_MS 1000                // 后台线程落盘间隔
+#define MK_WAL_CKPT_KEEP 2                 // 保留的检查点个数（最新的损坏时退回上一个）
+#define MK_CKPT_MAGIC "MKCKPT1"
+
+// 检查点中一个分区的位置
+typedef struct {
+    uint64_t offset;                   // 分区数据在文件中的起始位置
+    uint64_t len;                      // 分区数据长度
+    uint64_t count;                    // 记录数
+    uint64_t check;                    // 分区数据的校验和
+} mk_ckpt_part_t;
+
+// 检查点文件头
+typedef struct {
+    char magic[8];
+    uint64_t wal_pos;                  // 检查点开始前的日志位置，从这里开始重放
+    uint32_t parts;                    // 分区数
+    uint32_t reserved;
+    mk_ckpt_part_t part[MK_WAL_PARTS];
+    uint64_t check;                    // 以上字段的校验和
+} mk_ckpt_hdr_t;
+
+struct mk_wal {
+    char *dir;                         // 日志和检查点所在目录
+    size_t ckpt_bytes;                 // 日志比上个检查点多出该字节数时自动做检查点，0表示不自动
+    pthread_mutex_t mu;                // 保护以下写缓冲区、当前段和位置
+    pthread_cond_t cond;               // 唤醒后台线程（需要做检查点 / 停止）
+    int fd;                            // 当前段
+    uint64_t seg_start;                // 当前段的起始位置
+    uint64_t pos;                      // 下一条记录的位置
+    char *buf;                         // 写缓冲区
+    size_t len;
+    size_t cap;
+    uint64_t synced;                   // 已写出并落盘到的位置
+    int stop;                          // 通知后台线程退出
+    pthread_mutex_t ckpt_mu;           // 保证同一时间只有一个检查点或落盘在使用当前段
+    pthread_t bg_thread;
+    mk_wal_stats_t stats;              // 统计（后台线程更新的字段用原子操作读写）
+};
+
+// 生成目录下的文件路径，name为格式串，包含一个位置编号
+static char *mk_wal_path(const char *dir, const char *name, uint64_t pos) {
+    size_t n = strlen(dir) + 64;
+    char *path = malloc(n);
+    if (path == NULL) return NULL;
+    int off = snprintf(path, n, "%s/", dir);
+    snprintf(path + off, n - (size_t)off, name, (unsigned long long)pos);
+    return path;
+}
+
+// 落盘目录本身（新建、重命名、删除的文件名）
+static void mk_wal_sync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+static int mk_wal_cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// 列出目录下"prefix<位置>suffix"的文件，返回升序排列的位置（调用方释放）
+static int mk_wal_list(const char *dir, const char *prefix, const char *suffix, uint64_t **out, size_t *n) {
+    *out = NULL;
+    *n = 0;
+    DIR *dp = opendir(dir);
+    if (dp == NULL) return -1;
+    size_t cap = 0, plen = strlen(prefix), slen = strlen(suffix);
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if (len <= plen + slen || strncmp(de->d_name, prefix, plen) != 0 || strcmp(de->d_name + len - slen, suffix) != 0) continue;
+        char *end = NULL;
+        uint64_t pos = strtoull(de->d_name + plen, &end, 10);
+        if (end != de->d_name + len - slen) continue;
+        if (*n == cap) {
+            cap = cap ? cap * 2 : 16;
+            uint64_t *grown = realloc(*out, cap * sizeof(uint64_t));
+            if (grown == NULL) {
+                closedir(dp);
+                free(*out);
+                *out = NULL;
+                return -1;
+            }
+            *out = grown;
+        }
+        (*out)[(*n)++] = pos;
+    }
+    closedir(dp);
+    if (*n > 0) qsort(*out, *n, sizeof(uint64_t), mk_wal_cmp_u64);
+    return 0;
+}
+
+// 把数据全部写到fd
+static int mk_wal_write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// 写出写缓冲区（调用方持有w->mu）
+static int mk_wal_flush_locked(mk_wal_t *w) {
+    if (w->len == 0) return 0;
+    int ret = mk_wal_write_all(w->fd, w->buf, w->len);
+    if (ret != 0) {
+        perror("mk_wal 写入日志失败");
+        MK_ATOMIC_ADD(w->stats.errors, 1);
+    }
+    w->len = 0;
+    return ret;
+}
+
+// 打开从start开始的日志段用于追加（调用方持有w->mu或尚未启用写日志），调用方随后落盘目录
+static int mk_wal_seg_open(mk_wal_t *w, uint64_t start) {
+    char *path = mk_wal_path(w->dir, "wal-%020llu.log", start);
+    if (path == NULL) return -1;
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    free(path);
+    if (fd < 0) {
+        perror("mk_wal 打开日志段失败");
+        return -1;
+    }
+    w->fd = fd;
+    w->seg_start = start;
+    return 0;
+}
+
+// 写操作在获取分段写锁之前调用：为一条记录预留足够大的写缓冲区，持锁追加时不会因内存不足丢掉已生效的写入
+// value超过记录长度字段能表示的范围或内存不足时返回-1，写操作应当失败
+int mk_wal_reserve(mk_t *mk, size_t klen, size_t len) {
+    mk_wal_t *w = mk->wal;
+    if (len > UINT32_MAX) {
+        fprintf(stderr, "mk_wal value超过4GB，无法写入日志 ❌\n");
+        return -1;
+    }
+    size_t rec = MK_WAL_HDR_LEN + klen + 1 + len;
+    if (rec <= MK_WAL_BUF_SIZE) return 0;// 缓冲区不会小于初始大小
+    int ret = 0;
+    pthread_mutex_lock(&w->mu);
+    if (rec > w->cap) {
+        mk_wal_flush_locked(w);
+        char *grown = realloc(w->buf, rec);
+        if (grown == NULL) {
+            perror("mk_wal 内存分配失败");
+            ret = -1;
+        } else {
+            w->buf = grown;
+            w->cap = rec;
+        }
+    }
+    pthread_mutex_unlock(&w->mu);
+    return ret;
+}
+
+// 追加一条写操作记录（调用方持有key所在分段的写锁，并已调用mk_wal_reserve）
+void mk_wal_feed(mk_t *mk, int op, const char *key, const void *data, size_t len) {
+    mk_wal_t *w = mk->wal;
+    size_t klen = strlen(key);
+    size_t rec = MK_WAL_HDR_LEN + klen + 1 + len;
+    pthread_mutex_lock(&w->mu);
+    if (w->len + rec > w->cap) {
+        mk_wal_flush_locked(w);
+        if (rec > w->cap) {
+            // 放不进缓冲区的大记录：扩大缓冲区（只在没有预留时发生）
+            char *grown = realloc(w->buf, rec);
+            if (grown == NULL) {
+                pthread_mutex_unlock(&w->mu);
+                perror("mk_wal 内存分配失败");
+                MK_ATOMIC_ADD(w->stats.errors, 1);
+                return;
+            }
+            w->buf = grown;
+            w->cap = rec;
+        }
+    }
+    char *p = w->buf + w->len;
+    uint8_t op8 = (uint8_t)op;
+    uint32_t k32 = (uint32_t)klen, v32 = (uint32_t)len;
+    memcpy(p + 4, &op8, 1);
+    memcpy(p + 5, &k32, 4);
+    memcpy(p + 9, &v32, 4);
+    memcpy(p + MK_WAL_HDR_LEN, key, klen + 1);
+    if (len > 0) memcpy(p + MK_WAL_HDR_LEN + klen + 1, data, len);
+    uint32_t check = (uint32_t)mk_hash64(p + 4, rec - 4);
+    memcpy(p, &check, 4);
+    w->len += rec;
+    w->pos += rec;
+    // 日志比上个检查点多出ckpt_bytes时唤醒后台线程做检查点
+    uint64_t since = w->pos - MK_ATOMIC_LOAD(w->stats.checkpoint_pos);
+    if (w->ckpt_bytes > 0 && since >= w->ckpt_bytes && since - rec < w->ckpt_bytes) pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->mu);
+}
+
+// 写出缓冲区并落盘当前段（调用方持有w->ckpt_mu，保证fd不被切换）
+static int mk_wal_sync_locked(mk_wal_t *w) {
+    pthread_mutex_lock(&w->mu);
+    int ret = mk_wal_flush_locked(w);
+    int fd = w->fd;
+    uint64_t pos = w->pos;
+    int clean = (w->synced == pos);
+    pthread_mutex_unlock(&w->mu);
+    if (clean) return ret;
+    if (fdatasync(fd) == 0) {
+        pthread_mutex_lock(&w->mu);
+        if (w->synced < pos) w->synced = pos;
+        pthread_mutex_unlock(&w->mu);
+    } else {
+        perror("mk_wal 日志落盘失败");
+        MK_ATOMIC_ADD(w->stats.errors, 1);
+        ret = -1;
+    }
+    return ret;
+}
+
+// 立即写出并落盘写日志
+int mk_wal_sync(mk_t *mk) {
+    if (mk == NULL || mk->wal == NULL) {
+        fprintf(stderr, "mk_wal_sync 未开启写日志 ❌\n");
+        return -1;
+    }
+    mk_wal_t *w = mk->wal;
+    pthread_mutex_lock(&w->ckpt_mu);
+    int ret = mk_wal_sync_locked(w);
+    pthread_mutex_unlock(&w->ckpt_mu);
+    return ret;
+}
+
+// 做检查点时收集的分区数据
+typedef struct {
+    mk_sink_t sink[MK_WAL_PARTS];
+    uint64_t count[MK_WAL_PARTS];
+} mk_ckpt_build_t;
+
+// mk_foreach回调：把一条键值对追加到所属分区
+static int mk_ckpt_collect(const char *key, size_t klen, const char *value, size_t vlen, void *ctx) {
+    mk_ckpt_build_t *b = ctx;
+    size_t p = mk_hash(key) % MK_WAL_PARTS;
+    uint32_t lens[2] = {(uint32_t)klen, (uint32_t)vlen};
+    mk_sink_write(&b->sink[p], lens, sizeof(lens));
+    mk_sink_write(&b->sink[p], key, klen + 1);
+    b->count[p]++;
+    return mk_sink_write(&b->sink[p], value, vlen);
+}
+
+// 写出一个检查点文件（先写临时文件，落盘后改名）
+static int mk_ckpt_write(const mk_t *mk, mk_wal_t *w, uint64_t wal_pos) {
+    mk_ckpt_build_t b;
+    memset(&b, 0, sizeof(b));
+    for (int i = 0; i < MK_WAL_PARTS; i++) mk_sink_mem(&b.sink[i]);
+    // 收集期间写操作照常进行；检查点生效前日志必须落盘到收集结束之后，
+    // 否则崩溃后检查点中较新的值会被日志里更早的记录覆盖
+    int ret = mk_foreach(mk, mk_ckpt_collect, &b);
+    if (ret == 0) ret = mk_wal_sync_locked(w);
+
+    mk_ckpt_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MK_CKPT_MAGIC, sizeof(hdr.magic));
+    hdr.wal_pos = wal_pos;
+    hdr.parts = MK_WAL_PARTS;
+    uint64_t off = sizeof(hdr);
+    for (int i = 0; i < MK_WAL_PARTS; i++) {
+        hdr.part[i].offset = off;
+        hdr.part[i].len = b.sink[i].len;
+        hdr.part[i].count = b.count[i];
+        hdr.part[i].check = mk_hash64(b.sink[i].buf ? b.sink[i].buf : "", b.sink[i].len);
+        off += b.sink[i].len;
+    }
+    hdr.check = mk_hash64((const char *)&hdr, offsetof(mk_ckpt_hdr_t, check));
+
+    char *tmp = mk_wal_path(w->dir, "checkpoint.tmp", 0);
+    char *path = mk_wal_path(w->dir, "checkpoint-%020llu.ckpt", wal_pos);
+    int fd = (ret == 0 && tmp != NULL && path != NULL) ? open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    if (fd < 0) {
+        if (ret == 0) perror("mk_checkpoint 创建检查点文件失败");
+        ret = -1;
+    } else {
+        ret = mk_wal_write_all(fd, (const char *)&hdr, sizeof(hdr));
+        for (int i = 0; i < MK_WAL_PARTS && ret == 0; i++) ret = mk_wal_write_all(fd, b.sink[i].buf, b.sink[i].len);
+        if (ret == 0) ret = fsync(fd);
+        if (close(fd) != 0) ret = -1;
+        if (ret == 0) ret = rename(tmp, path);
+        if (ret != 0) {
+            perror("mk_checkpoint 写入检查点失败");
+            unlink(tmp);
+        } else {
+            mk_wal_sync_dir(w->dir);
+        }
+    }
+    for (int i = 0; i < MK_WAL_PARTS; i++) mk_sink_free(&b.sink[i]);
+    free(tmp);
+    free(path);
+    return ret;
+}
+
+// 删除多余的旧检查点，以及所有保留的检查点都不再需要的日志段
+static void mk_ckpt_cleanup(mk_wal_t *w) {
+    uint64_t *ckpts = NULL, *segs = NULL;
+    size_t nc = 0, ns = 0;
+    if (mk_wal_list(w->dir, "checkpoint-", ".ckpt", &ckpts, &nc) != 0) return;
+    for (size_t i = 0; i + MK_WAL_CKPT_KEEP < nc; i++) {
+        char *path = mk_wal_path(w->dir, "checkpoint-%020llu.ckpt", ckpts[i]);
+        if (path != NULL) unlink(path);
+        free(path);
+    }
+    // 最老的保留检查点之前的日志只在所有检查点都损坏时才需要，保留的检查点不足时不删除
+    if (nc >= MK_WAL_CKPT_KEEP && mk_wal_list(w->dir, "wal-", ".log", &segs, &ns) == 0) {
+        uint64_t keep_from = ckpts[nc - MK_WAL_CKPT_KEEP];
+        for (size_t i = 0; i + 1 < ns && segs[i + 1] <= keep_from; i++) {
+            char *path = mk_wal_path(w->dir, "wal-%020llu.log", segs[i]);
+            if (path != NULL) unlink(path);
+            free(path);
+        }
+    }
+    free(ckpts);
+    free(segs);
+}
+
+// 做检查点（调用方持有w->ckpt_mu）
+static int mk_checkpoint_locked(mk_t *mk, mk_wal_t *w) {
+    uint64_t start = mk_now_ns();
+    // 持锁只切换到新段，之后的记录都在新段中；写操作持有分段锁时要取w->mu，
+    // 旧段的落盘和目录的落盘在释放w->mu之后进行，不阻塞写操作
+    pthread_mutex_lock(&w->mu);
+    mk_wal_flush_locked(w);
+    uint64_t wal_pos = w->pos;
+    int old_fd = -1;
+    if (w->pos != w->seg_start) {
+        old_fd = w->fd;
+        if (mk_wal_seg_open(w, w->pos) != 0) {
+            pthread_mutex_unlock(&w->mu);
+            return -1;
+        }
+    }
+    pthread_mutex_unlock(&w->mu);
+    if (old_fd >= 0) {
+        mk_wal_sync_dir(w->dir);
+        if (fdatasync(old_fd) != 0) MK_ATOMIC_ADD(w->stats.errors, 1);
+        close(old_fd);
+    }
+
+    int ret = mk_ckpt_write(mk, w, wal_pos);
+    if (ret == 0) {
+        MK_ATOMIC_STORE(w->stats.checkpoint_pos, wal_pos);
+        MK_ATOMIC_ADD(w->stats.checkpoints, 1);
+        MK_ATOMIC_STORE(w->stats.checkpoint_ms, (mk_now_ns() - start) / 1000000);
+        mk_ckpt_cleanup(w);
+    }
+    return ret;
+}
+
+// 立即做一个检查点
+int mk_checkpoint(mk_t *mk) {
+    if (mk == NULL || mk->wal == NULL) {
+        fprintf(stderr, "mk_checkpoint 未开启写日志 ❌\n");
+        return -1;
+    }
+    mk_wal_t *w = mk->wal;
+    pthread_mutex_lock(&w->ckpt_mu);
+    int ret = mk_checkpoint_locked(mk, w);
+    pthread_mutex_unlock(&w->ckpt_mu);
+    return ret;
+}
+
+// ---------------- 启动恢复 ----------------
+
+// 恢复时的一个分区
+typedef struct {
+    const char *data;                  // 检查点中的分区数据
+    uint64_t len;
+    uint64_t count;
+    uint64_t check;
+    const char **recs;                 // 需要重放的日志记录（按日志顺序）
+    size_t nrecs;
+    size_t cap;
+} mk_wal_part_t;
+
+#define MK_WAL_STAGE_VERIFY 0// 校验检查点分区
+#define MK_WAL_STAGE_LOAD 1// 载入检查点分区
+#define MK_WAL_STAGE_REPLAY 2// 重放日志
+
+// 一个恢复线程处理的分区：first, first + step, ...
+typedef struct {
+    mk_t *mk;
+    mk_wal_part_t *parts;
+    int stage;
+    size_t first;
+    size_t step;
+    size_t failed;                     // 出错的分区数
+    uint64_t done;                     // 处理的记录数
+    pthread_t tid;
+} mk_wal_job_t;
+
+// 校验检查点分区：校验和相符，且记录恰好铺满分区数据
+static int mk_wal_part_verify(const mk_wal_part_t *part) {
+    if (mk_hash64(part->data, part->len) != part->check) return -1;
+    uint64_t off = 0, n = 0;
+    while (off < part->len) {
+        uint32_t lens[2];
+        if (part->len - off < sizeof(lens)) return -1;
+        memcpy(lens, part->data + off, sizeof(lens));
+        uint64_t rec = sizeof(lens) + (uint64_t)lens[0] + 1 + lens[1];
+        if (rec > part->len - off || part->data[off + sizeof(lens) + lens[0]] != '\0') return -1;
+        off += rec;
+        n++;
+    }
+    return (n == part->count) ? 0 : -1;
+}
+
+// 载入检查点分区中的所有键值对（已校验）
+static int mk_wal_part_load(mk_t *mk, const mk_wal_part_t *part, uint64_t *done) {
+    int ret = 0;
+    uint64_t off = 0;
+    while (off < part->len) {
+        uint32_t lens[2];
+        memcpy(lens, part->data + off, sizeof(lens));
+        const char *key = part->data + off + sizeof(lens);
+        if (mk_put_bin(mk, key, key + lens[0] + 1, lens[1]) != 0) ret = -1;
+        else (*done)++;
+        off += sizeof(lens) + (uint64_t)lens[0] + 1 + lens[1];
+    }
+    return ret;
+}
+
+// 按日志顺序重放分区中的记录（已校验）
+static int mk_wal_part_replay(mk_t *mk, const mk_wal_part_t *part, uint64_t *done) {
+    int ret = 0;
+    for (size_t i = 0; i < part->nrecs; i++) {
+        const char *rec = part->recs[i];
+        uint32_t klen, vlen;
+        memcpy(&klen, rec + 5, 4);
+        memcpy(&vlen, rec + 9, 4);
+        const char *key = rec + MK_WAL_HDR_LEN;
+        if (mk_apply(mk, (unsigned char)rec[4], key, key + klen + 1, vlen) != 0) ret = -1;
+        else (*done)++;
+    }
+    return ret;
+}
+
+// 恢复线程：依次处理分配到的分区
+static void *mk_wal_job_main(void *arg) {
+    mk_wal_job_t *job = arg;
+    for (size_t p = job->first; p < MK_WAL_PARTS; p += job->step) {
+        int ret;
+        if (job->stage == MK_WAL_STAGE_VERIFY) ret = mk_wal_part_verify(&job->parts[p]);
+        else if (job->stage == MK_WAL_STAGE_LOAD) ret = mk_wal_part_load(job->mk, &job->parts[p], &job->done);
+        else ret = mk_wal_part_replay(job->mk, &job->parts[p], &job->done);
+        if (ret != 0) job->failed++;
+    }
+    return NULL;
+}
+
+// 用nthreads个线程并行处理所有分区，返回出错的分区数，done累加处理的记录数
+static size_t mk_wal_run(mk_t *mk, mk_wal_part_t *parts, int stage, size_t nthreads, uint64_t *done) {
+    mk_wal_job_t jobs[MK_WAL_PARTS];
+    int started[MK_WAL_PARTS] = {0};
+    for (size_t t = 0; t < nthreads; t++) {
+        jobs[t] = (mk_wal_job_t){mk, parts, stage, t, nthreads, 0, 0, 0};
+        if (t > 0) started[t] = (pthread_create(&jobs[t].tid, NULL, mk_wal_job_main, &jobs[t]) == 0);
+    }
+    // 第一份在当前线程处理，创建线程失败的也在当前线程处理
+    for (size_t t = 0; t < nthreads; t++) {
+        if (!started[t]) mk_wal_job_main(&jobs[t]);
+    }
+    size_t failed = 0;
+    for (size_t t = 0; t < nthreads; t++) {
+        if (started[t]) pthread_join(jobs[t].tid, NULL);
+        failed += jobs[t].failed;
+        if (done != NULL) *done += jobs[t].done;
+    }
+    return failed;
+}
+
+// 载入一个检查点：成功返回0并通过wal_pos返回重放起点，文件损坏返回1（未修改表），载入出错返回-1
+static int mk_wal_load_ckpt(mk_t *mk, mk_wal_t *w, const char *path, size_t nthreads, uint64_t *wal_pos) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size < sizeof(mk_ckpt_hdr_t)) {
+        close(fd);
+        return 1;
+    }
+    const char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return 1;
+
+    mk_ckpt_hdr_t hdr;
+    memcpy(&hdr, base, sizeof(hdr));
+    int ret = 1;
+    mk_wal_part_t parts[MK_WAL_PARTS];
+    memset(parts, 0, sizeof(parts));
+    if (memcmp(hdr.magic, MK_CKPT_MAGIC, sizeof(hdr.magic)) == 0 && hdr.parts == MK_WAL_PARTS &&
+        hdr.check == mk_hash64((const char *)&hdr, offsetof(mk_ckpt_hdr_t, check))) {
+        ret = 0;
+        for (int i = 0; i < MK_WAL_PARTS; i++) {
+            const mk_ckpt_part_t *cp = &hdr.part[i];
+            if (cp->offset > size || cp->len > size - cp->offset) ret = 1;
+            else parts[i] = (mk_wal_part_t){base + cp->offset, cp->len, cp->count, cp->check, NULL, 0, 0};
+        }
+    }
+    // 先并行校验全部分区，都完好才开始载入，损坏的检查点不会修改表
+    if (ret == 0 && mk_wal_run(mk, parts, MK_WAL_STAGE_VERIFY, nthreads, NULL) > 0) ret = 1;
+    if (ret == 0 && mk_wal_run(mk, parts, MK_WAL_STAGE_LOAD, nthreads, &w->stats.loaded_keys) > 0) {
+        fprintf(stderr, "mk_wal_open 载入检查点 %s 失败 ❌\n", path);
+        ret = -1;
+    }
+    if (ret == 0) *wal_pos = hdr.wal_pos;
+    munmap((void *)base, size);
+    return ret;
+}
+
+// 读出整个文件
+static char *mk_wal_read_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    char *buf = malloc((size_t)st.st_size + 1);
+    size_t got = 0;
+    while (buf != NULL && got < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + got, (size_t)st.st_size - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(fd);
+    *size = got;
+    return buf;
+}
+
+// 把一条日志记录加入所属分区
+static int mk_wal_part_add(mk_wal_part_t *part, const char *rec) {
+    if (part->nrecs == part->cap) {
+        size_t ncap = part->cap ? part->cap * 2 : 1024;
+        const char **grown = realloc(part->recs, ncap * sizeof(char *));
+        if (grown == NULL) return -1;
+        part->recs = grown;
+        part->cap = ncap;
+    }
+    part->recs[part->nrecs++] = rec;
+    return 0;
+}
+
+// 把一条日志记录分到所属分区；批量写记录拆成各个操作（格式与日志记录相同）分到各自的分区，
+// 整条记录通过校验后才会拆分，所以批量写要么全部重放，要么全部丢弃
+static int mk_wal_bucket(mk_wal_part_t *parts, const char *rec) {
+    if ((unsigned char)rec[4] != MK_OP_BATCH) return mk_wal_part_add(&parts[mk_hash(rec + MK_WAL_HDR_LEN) % MK_WAL_PARTS], rec);
+    uint32_t klen, vlen;
+    memcpy(&klen, rec + 5, 4);
+    memcpy(&vlen, rec + 9, 4);
+    const char *p = rec + MK_WAL_HDR_LEN + klen + 1, *end = p + vlen;
+    while (end - p >= MK_BATCH_OP_HDR) {
+        uint32_t k, v;
+        memcpy(&k, p + 5, 4);
+        memcpy(&v, p + 9, 4);
+        size_t sub = MK_BATCH_OP_HDR + (size_t)k + 1 + v;
+        if (sub > (size_t)(end - p) || p[MK_BATCH_OP_HDR + k] != '\0') break;
+        if (mk_wal_part_add(&parts[mk_hash(p + MK_BATCH_OP_HDR) % MK_WAL_PARTS], p) != 0) return -1;
+        p += sub;
+    }
+    return (p == end) ? 0 : -1;
+}
+
+// 从位置from开始并行重放日志，seg_start/end返回最后一段的起始位置和有效末尾
+// 遇到不完整或校验失败的记录（写到一半时崩溃）时截断该段并删除之后的段
+static int mk_wal_replay(mk_t *mk, mk_wal_t *w, uint64_t from, size_t nthreads, uint64_t *seg_start, uint64_t *end) {
+    uint64_t *segs = NULL;
+    size_t ns = 0;
+    *seg_start = *end = from;
+    if (mk_wal_list(w->dir, "wal-", ".log", &segs, &ns) != 0) return -1;
+    size_t first = 0;
+    while (first + 1 < ns && segs[first + 1] <= from) first++;
+    if (ns > 0 && segs[first] > from) {
+        fprintf(stderr, "mk_wal_open 日志缺少位置%llu之后的部分记录 ❌\n", (unsigned long long)from);
+        from = segs[first];
+    }
+
+    mk_wal_part_t parts[MK_WAL_PARTS];
+    memset(parts, 0, sizeof(parts));
+    char **bufs = calloc(ns > 0 ? ns : 1, sizeof(char *));
+    int ret = (bufs == NULL) ? -1 : 0;
+    for (size_t j = first; j < ns && ret == 0; j++) {
+        char *path = mk_wal_path(w->dir, "wal-%020llu.log", segs[j]);
+        size_t size = 0;
+        bufs[j] = (path == NULL) ? NULL : mk_wal_read_file(path, &size);
+        if (bufs[j] == NULL) {
+            perror("mk_wal_open 读取日志失败");
+            free(path);
+            ret = -1;
+            break;
+        }
+        uint64_t off = (j == first && from > segs[j]) ? from - segs[j] : 0;
+        if (off > size) off = size;
+        while (ret == 0 && size - off >= MK_WAL_HDR_LEN) {
+            const char *rec = bufs[j] + off;
+            uint32_t check, klen, vlen;
+            memcpy(&check, rec, 4);
+            memcpy(&klen, rec + 5, 4);
+            memcpy(&vlen, rec + 9, 4);
+            uint64_t len = MK_WAL_HDR_LEN + (uint64_t)klen + 1 + vlen;
+            if (len > size - off || (uint32_t)mk_hash64(rec + 4, len - 4) != check) break;
+            if (mk_wal_bucket(parts, rec) != 0) ret = -1;
+            off += len;
+        }
+        *seg_start = segs[j];
+        *end = segs[j] + off;
+        if (ret == 0 && off < size) {
+            // 崩溃时写了一半的记录：截断，之后的段不再可信
+            fprintf(stderr, "mk_wal_open 日志在位置%llu处不完整，丢弃之后的内容 ❌\n", (unsigned long long)*end);
+            if (truncate(path, (off_t)off) != 0) ret = -1;
+            for (size_t k = j + 1; k < ns; k++) {
+                char *later = mk_wal_path(w->dir, "wal-%020llu.log", segs[k]);
+                if (later != NULL) unlink(later);
+                free(later);
+            }
+            ns = j + 1;
+        }
+        free(path);
+    }
+    if (ret == 0 && mk_wal_run(mk, parts, MK_WAL_STAGE_REPLAY, nthreads, &w->stats.replayed_records) > 0) {
+        fprintf(stderr, "mk_wal_open 重放日志失败 ❌\n");
+        ret = -1;
+    }
+    for (int i = 0; i < MK_WAL_PARTS; i++) free(parts[i].recs);
+    for (size_t j = 0; bufs != NULL && j < ns; j++) free(bufs[j]);
+    free(bufs);
+    free(segs);
+    return ret;
+}
+
+// 启动恢复：载入最新的完好检查点，再从它记录的位置重放日志，然后打开日志末尾继续追加
+static int mk_wal_recover(mk_t *mk, mk_wal_t *w) {
+    uint64_t start = mk_now_ns();
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nthreads = (ncpu < 1) ? 1 : (ncpu > MK_WAL_PARTS ? MK_WAL_PARTS : (size_t)ncpu);
+    w->stats.recovery_threads = nthreads;
+
+    uint64_t *ckpts = NULL;
+    size_t nc = 0;
+    if (mk_wal_list(w->dir, "checkpoint-", ".ckpt", &ckpts, &nc) != 0) return -1;
+    uint64_t from = 0;
+    int ret = 1;
+    for (size_t i = nc; i > 0 && ret == 1; i--) {
+        char *path = mk_wal_path(w->dir, "checkpoint-%020llu.ckpt", ckpts[i - 1]);
+        ret = (path == NULL) ? -1 : mk_wal_load_ckpt(mk, w, path, nthreads, &from);
+        if (ret == 1) {
+            fprintf(stderr, "检查点 %s 已损坏，跳过 ❌\n", path);
+            w->stats.skipped_checkpoints++;
+        }
+        free(path);
+    }
+    free(ckpts);
+    if (ret < 0) return -1;
+    if (ret == 1) from = 0;// 没有完好的检查点，从头重放
+
+    uint64_t seg_start = 0, end = 0;
+    if (mk_wal_replay(mk, w, from, nthreads, &seg_start, &end) != 0) return -1;
+    // 日志比检查点短（日志文件丢失）时从检查点的位置开新段，保证位置不回退
+    if (end < from) seg_start = end = from;
+    if (mk_wal_seg_open(w, seg_start) != 0) return -1;
+    mk_wal_sync_dir(w->dir);
+    w->pos = w->synced = end;
+    w->stats.checkpoint_pos = from;
+    w->stats.recovery_ms = (mk_now_ns() - start) / 1000000;
+    return 0;
+}
+
+// 后台线程：每MK_WAL_SYNC_MS写出并落盘一次，日志增长到阈值时做检查点
+static void *mk_wal_bg_main(void *arg) {
+    mk_t *mk = arg;
+    mk_wal_t *w = mk->wal;
+    pthread_mutex_lock(&w->mu);
+    while (!w->stop) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += MK_WAL_SYNC_MS / 1000;
+        ts.tv_nsec += (long)(MK_WAL_SYNC_MS % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&w->cond, &w->mu, &ts);
+        if (w->stop) break;
+        int due = w->ckpt_bytes > 0 && w->pos - MK_ATOMIC_LOAD(w->stats.checkpoint_pos) >= w->ckpt_bytes;
+        pthread_mutex_unlock(&w->mu);
+
+        pthread_mutex_lock(&w->ckpt_mu);
+        if (due) mk_checkpoint_locked(mk, w);
+        else mk_wal_sync_locked(w);
+        pthread_mutex_unlock(&w->ckpt_mu);
+        pthread_mutex_lock(&w->mu);
+    }
+    pthread_mutex_unlock(&w->mu);
+    return NULL;
+}
+
+// 释放写日志结构（不关闭段）
+static void mk_wal_destroy(mk_wal_t *w) {
+    pthread_mutex_destroy(&w->mu);
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->ckpt_mu);
+    free(w->buf);
+    free(w->dir);
+    free(w);
+}
+
+// 开启写日志：先从dir中的检查点和日志恢复数据，之后的写操作都记入日志
+// 应在启动时、写入数据之前调用；checkpoint_bytes为自动做检查点的日志增长量（0表示只手动做）
+int mk_wal_open(mk_t *mk, const char *dir, size_t checkpoint_bytes) {
+    if (mk == NULL || dir == NULL) {
+        fprintf(stderr, "mk_wal_open 无效的参数 ❌\n");
+        return -1;
+    }
+    if (mk->wal != NULL) {
+        fprintf(stderr, "写日志已开启 ❌\n");
+        return -1;
+    }
+    mk_repl_info_t info;
+    if (mk_repl_info(mk, &info) == 0 && info.role == MK_REPL_FOLLOWER) {
+        // 全量同步直接清空内存表，无法记入日志
+        fprintf(stderr, "从节点不能开启写日志 ❌\n");
+        return -1;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror("mk_wal_open 创建目录失败");
+        return -1;
+    }
+    mk_wal_t *w = calloc(1, sizeof(mk_wal_t));
+    if (w == NULL || (w->dir = strdup(dir)) == NULL || (w->buf = malloc(MK_WAL_BUF_SIZE)) == NULL) {
+        perror("mk_wal_open 内存分配失败");
+        if (w != NULL) free(w->dir);
+        free(w);
+        return -1;
+    }
+    w->cap = MK_WAL_BUF_SIZE;
+    w->ckpt_bytes = checkpoint_bytes;
+    w->fd = -1;
+    pthread_mutex_init(&w->mu, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    pthread_mutex_init(&w->ckpt_mu, NULL);
+
+    // 恢复期间还没有挂上写日志，载入和重放的写操作不会再次记入日志
+    if (mk_wal_recover(mk, w) != 0) {
+        if (w->fd >= 0) close(w->fd);
+        mk_wal_destroy(w);
+        return -1;
+    }
+    mk->wal = w;
+    if (pthread_create(&w->bg_thread, NULL, mk_wal_bg_main, mk) != 0) {
+        perror("mk_wal_open 创建线程失败");
+        mk->wal = NULL;
+        close(w->fd);
+        mk_wal_destroy(w);
+        return -1;
+    }
+    return 0;
+}
+
+// 获取写日志统计
+int mk_wal_stats(const mk_t *mk, mk_wal_stats_t *stats) {
+    if (mk == NULL || stats == NULL || mk->wal == NULL) {
+        fprintf(stderr, "mk_wal_stats 未开启写日志 ❌\n");
+        return -1;
+    }
+    mk_wal_t *w = mk->wal;
+    pthread_mutex_lock(&w->mu);
+    *stats = w->stats;
+    stats->position = w->pos;
+    stats->synced = w->synced;
+    pthread_mutex_unlock(&w->mu);
+    stats->checkpoint_pos = MK_ATOMIC_LOAD(w->stats.checkpoint_pos);
+    stats->checkpoints = MK_ATOMIC_LOAD(w->stats.checkpoints);
+    stats->checkpoint_ms = MK_ATOMIC_LOAD(w->stats.checkpoint_ms);
+    stats->errors = MK_ATOMIC_LOAD(w->stats.errors);
+    return 0;
+}
+
+// 停止后台线程，写出并落盘剩余的日志后关闭（销毁Hash表时调用，此时已没有写操作）
+void mk_wal_free(mk_t *mk) {
+    mk_wal_t *w = mk->wal;
+    if (w == NULL) return;
+    pthread_mutex_lock(&w->mu);
+    w->stop = 1;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->mu);
+    pthread_join(w->bg_thread, NULL);
+
+    pthread_mutex_lock(&w->ckpt_mu);
+    mk_wal_sync_locked(w);
+    pthread_mutex_unlock(&w->ckpt_mu);
+    close(w->fd);
+    mk->wal = NULL;
+    mk_wal_destroy(w);
+}
@@ -2,7 +2,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <dirent.h>
+#include <unistd.h>
 #include "minikv.h"
+#include "minikv_client.h"
+#include <poll.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <errno.h>
 
 // 测试结构体
 static mk_t *mk = NULL;
@@ -237,6 +244,1656 @@ void test_hash_collision(void) {
     CU_ASSERT_EQUAL(mk_count(mk), 10);
 }
 
+// 测试内存统计接口
+void test_mk_memory_usage(void) {
+    mk_t *m = mk_create();
+    CU_ASSERT_PTR_NOT_NULL(m);
+    size_t base = mk_memory_usage(m);
+    CU_ASSERT(base >= sizeof(mk_t));
+
+    // 新增key后内存增加，且单个key的占用不小于key+value的长度
+    CU_ASSERT_EQUAL(mk_put(m, "small", "v"), 0);
+    CU_ASSERT(mk_memory_usage(m) > base);
+    CU_ASSERT(mk_key_memory_usage(m, "small") >= sizeof(mk_node_t) + strlen("small") + 1);
+    CU_ASSERT_EQUAL(mk_key_memory_usage(m, "missing"), 0);
+
+    // 覆盖为更大的value后内存随之增加
+    size_t before = mk_memory_usage(m);
+    char big[1000];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    CU_ASSERT_EQUAL(mk_put(m, "big", big), 0);
+    CU_ASSERT(mk_memory_usage(m) >= before + sizeof(big));
+
+    // 全量扫描时最大的key排在第一位
+    mk_bigkey_t top[2];
+    CU_ASSERT_EQUAL(mk_memory_bigkeys(m, 0, top, 2), 2);
+    CU_ASSERT_STRING_EQUAL(top[0].key, "big");
+    CU_ASSERT_STRING_EQUAL(top[1].key, "small");
+    CU_ASSERT(top[0].bytes > top[1].bytes);
+
+    // 删除全部key后回到初始值
+    mk_del(m, "small");
+    mk_del(m, "big");
+    CU_ASSERT_EQUAL(mk_memory_usage(m), base);
+    mk_destroy(m);
+}
+
+// 测试二进制value的存取与保存/加载
+void test_mk_binary_value(void) {
+    mk_t *m = mk_create();
+    const char blob[] = {'a', '\0', '\n', 'b', ' ', '\r', (char)0xff};
+    const void *data = NULL;
+    size_t len = 0;
+
+    CU_ASSERT_EQUAL(mk_put_bin(m, "blob", blob, sizeof(blob)), 0);
+    CU_ASSERT_EQUAL(mk_put(m, "text", "hello world"), 0);
+    CU_ASSERT_EQUAL(mk_get_bin(m, "blob", &data, &len), 0);
+    CU_ASSERT_EQUAL(len, sizeof(blob));
+    CU_ASSERT(memcmp(data, blob, sizeof(blob)) == 0);
+    CU_ASSERT_EQUAL(mk_get_bin(m, "text", &data, &len), 0);
+    CU_ASSERT_EQUAL(len, strlen("hello world"));
+    CU_ASSERT_EQUAL(mk_get_bin(m, "missing", &data, &len), -1);
+
+    // 保存后重新加载，二进制内容保持不变
+    CU_ASSERT_EQUAL(mk_save(m, "tests/test_save.txt"), 0);
+    mk_destroy(m);
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_load(m, "tests/test_save.txt"), 0);
+    CU_ASSERT_EQUAL(mk_count(m), 2);
+    CU_ASSERT_EQUAL(mk_get_bin(m, "blob", &data, &len), 0);
+    CU_ASSERT_EQUAL(len, sizeof(blob));
+    CU_ASSERT(memcmp(data, blob, sizeof(blob)) == 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "text"), "hello world");
+
+    // 长度非法或超过文件剩余字节数的二进制记录被拒绝
+    const char *bad[] = {
+        "k:=18446744073709551615\nabc\n",
+        "k:=99999999999999999999\nabc\n",
+        "k:=-1\nabc\n",
+        "k:= 3\nabc\n",
+        "k:=4\nabc\n",
+        "k:=3x\nabc\n",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        FILE *fp = fopen("tests/test_save.txt", "w");
+        fputs(bad[i], fp);
+        fclose(fp);
+        CU_ASSERT_EQUAL(mk_load(m, "tests/test_save.txt"), -1);
+    }
+    FILE *fp = fopen("tests/test_save.txt", "w");
+    fputs("k:=3\nabc\n", fp);
+    fclose(fp);
+    CU_ASSERT_EQUAL(mk_load(m, "tests/test_save.txt"), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "k"), "abc");
+    mk_destroy(m);
+}
+
+// 测试大value的透明压缩
+void test_mk_compress(void) {
+    mk_t *m = mk_create();
+    char doc[8192];
+    size_t pos = 0;
+    while (pos + 64 < sizeof(doc)) {
+        pos += snprintf(doc + pos, sizeof(doc) - pos, "{\"id\":%zu,\"name\":\"minikv\",\"tags\":[\"a\",\"b\"]},", pos);
+    }
+
+    CU_ASSERT_EQUAL(mk_set_compress_threshold(m, 1024), 0);
+    CU_ASSERT_EQUAL(mk_put(m, "doc", doc), 0);
+    CU_ASSERT_EQUAL(mk_put(m, "short", "not compressed"), 0);
+
+    // 压缩后内存占用明显小于原文
+    CU_ASSERT(mk_key_memory_usage(m, "doc") < pos / 2);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "doc"), doc);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "short"), "not compressed");
+
+    // 复制到调用方缓冲区
+    char buf[8192];
+    size_t len = 0;
+    CU_ASSERT_EQUAL(mk_get_buf(m, "doc", buf, sizeof(buf), &len), 0);
+    CU_ASSERT_EQUAL(len, pos);
+    CU_ASSERT(memcmp(buf, doc, pos) == 0);
+    CU_ASSERT_EQUAL(mk_get_buf(m, "doc", buf, 16, &len), -1);
+    CU_ASSERT_EQUAL(len, pos);
+
+    mk_compress_stats_t st;
+    CU_ASSERT_EQUAL(mk_compress_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.compressed_values, 1);
+    CU_ASSERT_EQUAL(st.raw_bytes, pos);
+    CU_ASSERT(st.stored_bytes * 4 <= st.raw_bytes);
+    CU_ASSERT(st.decompress_calls >= 2);
+
+    // 保存的是原文，加载后内容一致
+    CU_ASSERT_EQUAL(mk_save(m, "tests/test_save.txt"), 0);
+    mk_t *loaded = mk_create();
+    CU_ASSERT_EQUAL(mk_load(loaded, "tests/test_save.txt"), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(loaded, "doc"), doc);
+    mk_destroy(loaded);
+
+    // 删除后统计归零
+    mk_del(m, "doc");
+    CU_ASSERT_EQUAL(mk_compress_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.compressed_values, 0);
+    CU_ASSERT_EQUAL(st.stored_bytes, 0);
+    mk_destroy(m);
+}
+
+// 测试LZ压缩算法的往返正确性
+void test_mk_lz_roundtrip(void) {
+    unsigned char in[5000], packed[6000], out[5000];
+    unsigned int seed = 7;
+    for (size_t i = 0; i < sizeof(in); i++) {
+        // 前半部分重复度高，后半部分是伪随机字节
+        in[i] = (i < 2500) ? (unsigned char)("abcabcabd"[i % 9]) : (unsigned char)((seed = seed * 1103515245 + 12345) >> 16);
+    }
+    size_t clen = mk_lz_compress(in, sizeof(in), packed, sizeof(packed));
+    CU_ASSERT(clen > 0);
+    CU_ASSERT_EQUAL(mk_lz_decompress(packed, clen, out, sizeof(out)), sizeof(in));
+    CU_ASSERT(memcmp(in, out, sizeof(in)) == 0);
+
+    // 输出空间不足时返回0
+    CU_ASSERT_EQUAL(mk_lz_compress(in + 2500, 2500, packed, 2000), 0);
+}
+
+// 删除测试目录下的所有文件
+static void remove_dir_files(const char *dir) {
+    DIR *dp = opendir(dir);
+    if (dp == NULL) return;
+    struct dirent *de;
+    char path[512];
+    while ((de = readdir(dp)) != NULL) {
+        if (de->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        unlink(path);
+    }
+    closedir(dp);
+    rmdir(dir);
+}
+
+// 测试磁盘层：刷盘、合并、删除标记和重新打开
+void test_mk_lsm(void) {
+    const char *dir = "tests/test_lsm";
+    char key[32], value[64];
+    remove_dir_files(dir);
+
+    mk_t *m = mk_create();
+    CU_ASSERT_EQUAL(mk_lsm_open(m, dir, 16 * 1024), 0);
+    for (int i = 0; i < 3000; i++) {
+        snprintf(key, sizeof(key), "key%05d", i);
+        snprintf(value, sizeof(value), "value-%d", i);
+        CU_ASSERT_EQUAL(mk_put(m, key, value), 0);
+    }
+    // 覆盖一部分已经刷到磁盘上的key
+    CU_ASSERT_EQUAL(mk_put(m, "key00010", "updated"), 0);
+
+    mk_lsm_stats_t st;
+    CU_ASSERT_EQUAL(mk_lsm_stats(m, &st), 0);
+    CU_ASSERT(st.flushes > 0);
+    CU_ASSERT(mk_count(m) < 3000);// 只有最近写入的部分留在内存表中
+
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "key00000"), "value-0");
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "key00010"), "updated");
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "key02999"), "value-2999");
+    CU_ASSERT_PTR_NULL(mk_get(m, "no_such_key"));
+    CU_ASSERT_EQUAL(mk_lsm_stats(m, &st), 0);
+    CU_ASSERT(st.bloom_negatives > 0);
+
+    // 删除磁盘上的key
+    CU_ASSERT_EQUAL(mk_del(m, "key00001"), 0);
+    CU_ASSERT_PTR_NULL(mk_get(m, "key00001"));
+    CU_ASSERT_EQUAL(mk_del(m, "key00001"), -1);
+    CU_ASSERT_EQUAL(mk_lsm_flush(m), 0);
+    CU_ASSERT_EQUAL(mk_lsm_compact(m), 0);
+    CU_ASSERT_EQUAL(mk_lsm_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.l0_tables, 0);
+    CU_ASSERT_EQUAL(st.l1_tables, 1);
+    CU_ASSERT_EQUAL(st.disk_entries, 2999);
+    CU_ASSERT_PTR_NULL(mk_get(m, "key00001"));
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "key01500"), "value-1500");
+
+    // 合并后的保存结果包含全部有效键值对
+    CU_ASSERT_EQUAL(mk_save(m, "tests/test_save.txt"), 0);
+    mk_destroy(m);
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_load(m, "tests/test_save.txt"), 0);
+    CU_ASSERT_EQUAL(mk_count(m), 2999);
+    mk_destroy(m);
+
+    // 重新打开目录，数据仍然可读
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_lsm_open(m, dir, 16 * 1024), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "key00010"), "updated");
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "key02000"), "value-2000");
+    CU_ASSERT_PTR_NULL(mk_get(m, "key00001"));
+
+    // 读取输入表失败时合并中止：不安装新表，参与合并的表都保留
+    CU_ASSERT_EQUAL(mk_put(m, "extra", "1"), 0);
+    CU_ASSERT_EQUAL(mk_lsm_flush(m), 0);
+    int tables = 0;
+    DIR *dp = opendir(dir);
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        if (strstr(de->d_name, ".sst") == NULL) continue;
+        tables++;
+        if (strncmp(de->d_name, "L1-", 3) == 0) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+            CU_ASSERT_EQUAL(truncate(path, 0), 0);
+        }
+    }
+    closedir(dp);
+    CU_ASSERT_EQUAL(tables, 2);
+    CU_ASSERT_EQUAL(mk_lsm_compact(m), -1);
+    CU_ASSERT_EQUAL(mk_lsm_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.l0_tables, 1);
+    CU_ASSERT_EQUAL(st.l1_tables, 1);
+    int left = 0;
+    dp = opendir(dir);
+    while ((de = readdir(dp)) != NULL) left += strstr(de->d_name, ".sst") != NULL;
+    closedir(dp);
+    CU_ASSERT_EQUAL(left, 2);
+    mk_destroy(m);
+    remove_dir_files(dir);
+}
+
+// 等待从节点应用到主节点的偏移，最多等5秒
+static int wait_repl_offset(mk_t *leader, mk_t *follower) {
+    mk_repl_info_t li, fi;
+    for (int i = 0; i < 500; i++) {
+        mk_repl_info(leader, &li);
+        mk_repl_info(follower, &fi);
+        if (fi.link_up && fi.offset == li.offset) return 0;
+        usleep(10000);
+    }
+    return -1;
+}
+
+// 测试主从复制：全量同步、持续同步、断开后断点续传
+void test_mk_replication(void) {
+    const char *addr = "unix:tests/test_repl.sock";
+    char key[32], value[64];
+    mk_t *leader = mk_create();
+    mk_t *follower = mk_create();
+    for (int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(value, sizeof(value), "value-%d", i);
+        mk_put(leader, key, value);
+    }
+    CU_ASSERT_EQUAL(mk_repl_leader_start(leader, addr, 1024), -1);// 积压缓冲区太小
+    CU_ASSERT_EQUAL(mk_repl_leader_start(leader, addr, 64 * 1024), 0);
+    CU_ASSERT_EQUAL(mk_put(follower, "stale", "x"), 0);// 全量同步时会被丢弃
+
+    // 全量同步
+    CU_ASSERT_EQUAL(mk_repl_follow(follower, addr), 0);
+    CU_ASSERT_EQUAL(wait_repl_offset(leader, follower), 0);
+    CU_ASSERT_EQUAL(mk_count(follower), 100);
+    CU_ASSERT_STRING_EQUAL(mk_get(follower, "key42"), "value-42");
+    CU_ASSERT_PTR_NULL(mk_get(follower, "stale"));
+
+    // 持续同步写入和删除，包括二进制value
+    CU_ASSERT_EQUAL(mk_put(leader, "key1", "changed"), 0);
+    CU_ASSERT_EQUAL(mk_del(leader, "key2"), 0);
+    CU_ASSERT_EQUAL(mk_put_bin(leader, "bin", "a\0b", 3), 0);
+    CU_ASSERT_EQUAL(wait_repl_offset(leader, follower), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(follower, "key1"), "changed");
+    CU_ASSERT_PTR_NULL(mk_get(follower, "key2"));
+    const void *data = NULL;
+    size_t len = 0;
+    CU_ASSERT_EQUAL(mk_get_bin(follower, "bin", &data, &len), 0);
+    CU_ASSERT_EQUAL(len, 3);
+    CU_ASSERT_EQUAL(memcmp(data, "a\0b", 3), 0);
+
+    // 从节点断开期间主节点继续写入，重新连接后只补发缺少的部分
+    CU_ASSERT_EQUAL(mk_repl_stop(follower), 0);
+    CU_ASSERT_EQUAL(mk_put(leader, "key3", "while-offline"), 0);
+    CU_ASSERT_EQUAL(mk_repl_follow(follower, addr), 0);
+    CU_ASSERT_EQUAL(wait_repl_offset(leader, follower), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(follower, "key3"), "while-offline");
+
+    // 比积压缓冲区还大的记录：缓冲区扩容后照常续传，从节点不需要重新全量同步
+    size_t big_len = 200 * 1024;
+    char *big = malloc(big_len);
+    memset(big, 'b', big_len);
+    CU_ASSERT_EQUAL(mk_put_bin(leader, "big", big, big_len), 0);
+    CU_ASSERT_EQUAL(mk_put(leader, "after-big", "1"), 0);
+    CU_ASSERT_EQUAL(wait_repl_offset(leader, follower), 0);
+    CU_ASSERT_EQUAL(mk_get_bin(follower, "big", &data, &len), 0);
+    CU_ASSERT_EQUAL(len, big_len);
+    CU_ASSERT_EQUAL(memcmp(data, big, big_len), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(follower, "after-big"), "1");
+    free(big);
+
+    mk_repl_info_t info;
+    CU_ASSERT_EQUAL(mk_repl_info(leader, &info), 0);
+    CU_ASSERT_EQUAL(info.role, MK_REPL_LEADER);
+    CU_ASSERT_EQUAL(info.full_syncs, 1);
+    CU_ASSERT_EQUAL(info.partial_syncs, 1);
+    CU_ASSERT(info.followers >= 1);// 旧连接可能还没有检测到断开
+    CU_ASSERT_EQUAL(mk_repl_info(follower, &info), 0);
+    CU_ASSERT_EQUAL(info.role, MK_REPL_FOLLOWER);
+    CU_ASSERT_EQUAL(info.partial_syncs, 1);
+
+    mk_destroy(follower);
+    mk_destroy(leader);
+    CU_ASSERT_NOT_EQUAL(access("tests/test_repl.sock", F_OK), 0);
+}
+
+// mk_snapshot_foreach回调：统计键值对数量
+static int count_emit(const char *key, size_t klen, const char *value, size_t vlen, void *ctx) {
+    (void)key; (void)klen; (void)value; (void)vlen;
+    (*(int *)ctx)++;
+    return 0;
+}
+
+// 并发写线程：依次把x和y写成同一个递增的值
+static void *counter_writer(void *arg) {
+    mk_t *m = arg;
+    char buf[32];
+    for (int i = 1; i <= 2000; i++) {
+        snprintf(buf, sizeof(buf), "%d", i);
+        mk_put(m, "x", buf);
+        mk_put(m, "y", buf);
+    }
+    return NULL;
+}
+
+// 测试MVCC快照：快照看到开始时刻的数据，旧版本在快照结束后回收
+void test_mk_snapshot(void) {
+    mk_t *m = mk_create();
+    mk_put(m, "a", "1");
+    mk_put(m, "b", "2");
+    mk_put(m, "c", "3");
+
+    mk_snapshot_t *snap = mk_snapshot_begin(m);
+    CU_ASSERT_PTR_NOT_NULL(snap);
+    mk_put(m, "a", "10");
+    mk_del(m, "b");
+    mk_put(m, "d", "4");
+    CU_ASSERT_STRING_EQUAL(mk_snapshot_get(snap, "a", NULL), "1");
+    CU_ASSERT_STRING_EQUAL(mk_snapshot_get(snap, "b", NULL), "2");
+    CU_ASSERT_PTR_NULL(mk_snapshot_get(snap, "d", NULL));
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "a"), "10");
+    CU_ASSERT_PTR_NULL(mk_get(m, "b"));
+    int n = 0;
+    CU_ASSERT_EQUAL(mk_snapshot_foreach(snap, count_emit, &n), 0);
+    CU_ASSERT_EQUAL(n, 3);
+
+    // 第二个快照看到第一次修改之后的数据
+    mk_snapshot_t *snap2 = mk_snapshot_begin(m);
+    mk_put(m, "a", "100");
+    CU_ASSERT_STRING_EQUAL(mk_snapshot_get(snap2, "a", NULL), "10");
+    CU_ASSERT_STRING_EQUAL(mk_snapshot_get(snap, "a", NULL), "1");
+    CU_ASSERT(m->old_versions > 0);
+    size_t mem_with_versions = mk_memory_usage(m);
+    mk_snapshot_end(snap);
+    CU_ASSERT_STRING_EQUAL(mk_snapshot_get(snap2, "a", NULL), "10");
+    mk_snapshot_end(snap2);
+
+    // 全部快照结束后旧版本和删除标记都被回收
+    CU_ASSERT_EQUAL(m->old_versions, 0);
+    CU_ASSERT_EQUAL(mk_count(m), 3);
+    CU_ASSERT(mk_memory_usage(m) < mem_with_versions);
+    CU_ASSERT_PTR_NULL(m->buckets[mk_hash("b")]);
+
+    // 并发写入时快照看到的是写入顺序的一个前缀：y <= x <= y+1
+    mk_put(m, "x", "0");
+    mk_put(m, "y", "0");
+    pthread_t tid;
+    pthread_create(&tid, NULL, counter_writer, m);
+    for (int i = 0; i < 200; i++) {
+        mk_snapshot_t *s = mk_snapshot_begin(m);
+        int x = atoi(mk_snapshot_get(s, "x", NULL));
+        int y = atoi(mk_snapshot_get(s, "y", NULL));
+        CU_ASSERT(y <= x && x <= y + 1);
+        mk_snapshot_end(s);
+    }
+    pthread_join(tid, NULL);
+    CU_ASSERT_EQUAL(m->old_versions, 0);
+    mk_destroy(m);
+}
+
+// 并发计数线程：对counter加1000次
+static void *incr_worker(void *arg) {
+    for (int i = 0; i < 1000; i++) mk_incrby(arg, "counter", 1, NULL);
+    return NULL;
+}
+
+// 测试整数编码和原子增减
+void test_mk_incrby(void) {
+    mk_t *m = mk_create();
+    int64_t v = 0;
+
+    // 规范形式的整数以int64存储，读出的字符串不变
+    CU_ASSERT_EQUAL(mk_put(m, "n", "10"), 0);
+    CU_ASSERT_EQUAL(mk_find_node(m, "n")->enc, MK_ENC_INT);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "n"), "10");
+
+    // 整数编码只保存int64，不分配value缓冲区，占用的内存与空字符串相同；读出时再格式化
+    CU_ASSERT_EQUAL(mk_put(m, "a", "-9000000000000000000"), 0);
+    CU_ASSERT_EQUAL(mk_put(m, "b", ""), 0);
+    CU_ASSERT_PTR_NULL(mk_find_node(m, "a")->value);
+    CU_ASSERT(mk_key_memory_usage(m, "a") <= mk_key_memory_usage(m, "b"));
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "a"), "-9000000000000000000");
+    CU_ASSERT_EQUAL(mk_incrby(m, "a", 9000000000000000042, NULL), 0);
+    CU_ASSERT_PTR_NULL(mk_find_node(m, "a")->value);
+    char digits[MK_INT_BUF];
+    size_t len = 0;
+    CU_ASSERT_EQUAL(mk_get_buf(m, "a", digits, sizeof(digits), &len), 0);
+    CU_ASSERT_EQUAL(len, 2);
+    CU_ASSERT_STRING_EQUAL(digits, "42");
+    CU_ASSERT_EQUAL(mk_get_buf(m, "a", digits, 2, &len), -1);// 放不下末尾的'\0'
+    CU_ASSERT_EQUAL(mk_del(m, "a"), 0);
+    CU_ASSERT_EQUAL(mk_del(m, "b"), 0);
+    CU_ASSERT_EQUAL(mk_put(m, "zero", "007"), 0);// 非规范形式按字符串存储
+    CU_ASSERT_EQUAL(mk_find_node(m, "zero")->enc, MK_ENC_RAW);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "zero"), "007");
+
+    // 原地增减，不改变内存占用
+    size_t mem = mk_memory_usage(m);
+    CU_ASSERT_EQUAL(mk_incrby(m, "n", 5, &v), 0);
+    CU_ASSERT_EQUAL(v, 15);
+    CU_ASSERT_EQUAL(mk_decrby(m, "n", 20, &v), 0);
+    CU_ASSERT_EQUAL(v, -5);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "n"), "-5");
+    CU_ASSERT_EQUAL(mk_memory_usage(m), mem);
+
+    // 不存在的key从0开始；删除后重新计数
+    CU_ASSERT_EQUAL(mk_incrby(m, "fresh", 1, &v), 0);
+    CU_ASSERT_EQUAL(v, 1);
+    CU_ASSERT_EQUAL(mk_count(m), 3);
+
+    // 字符串形式的整数转换为整数编码；非整数和溢出时报错且不修改
+    CU_ASSERT_EQUAL(mk_put(m, "s", "hello"), 0);
+    CU_ASSERT_EQUAL(mk_incrby(m, "s", 1, &v), -1);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "s"), "hello");
+    CU_ASSERT_EQUAL(mk_incrby(m, "zero", 1, &v), -1);
+    CU_ASSERT_EQUAL(mk_put(m, "max", "9223372036854775807"), 0);
+    CU_ASSERT_EQUAL(mk_incrby(m, "max", 1, &v), -1);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "max"), "9223372036854775807");
+    CU_ASSERT_EQUAL(mk_put(m, "min", "-9223372036854775808"), 0);
+    CU_ASSERT_EQUAL(mk_find_node(m, "min")->enc, MK_ENC_INT);
+    CU_ASSERT_EQUAL(mk_decrby(m, "min", 1, &v), -1);
+
+    // 保存后重新加载仍为整数
+    CU_ASSERT_EQUAL(mk_save(m, "tests/test_save.txt"), 0);
+    mk_t *loaded = mk_create();
+    CU_ASSERT_EQUAL(mk_load(loaded, "tests/test_save.txt"), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(loaded, "n"), "-5");
+    CU_ASSERT_EQUAL(mk_find_node(loaded, "n")->enc, MK_ENC_INT);
+    mk_destroy(loaded);
+
+    // 快照看到增减前的值
+    mk_snapshot_t *snap = mk_snapshot_begin(m);
+    CU_ASSERT_EQUAL(mk_incrby(m, "n", 100, &v), 0);
+    CU_ASSERT_STRING_EQUAL(mk_snapshot_get(snap, "n", NULL), "-5");
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "n"), "95");
+    mk_snapshot_end(snap);
+
+    // 多线程并发加1不丢失更新
+    pthread_t tids[4];
+    for (int i = 0; i < 4; i++) pthread_create(&tids[i], NULL, incr_worker, m);
+    for (int i = 0; i < 4; i++) pthread_join(tids[i], NULL);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "counter"), "4000");
+    mk_destroy(m);
+}
+
+// 并发读线程：读取hot 2000次
+static void *hot_reader(void *arg) {
+    for (int i = 0; i < 2000; i++) mk_get(arg, "hot");
+    return NULL;
+}
+
+// 测试热点key统计
+void test_mk_hotkeys(void) {
+    mk_t *m = mk_create();
+    mk_hotkey_t hot[10];
+
+    // 未开启时没有结果，参数非法时报错
+    CU_ASSERT_EQUAL(mk_hotkeys(m, hot, 10), 0);
+    CU_ASSERT_EQUAL(mk_hotkeys_enable(m, 1, 0), -1);
+    CU_ASSERT_EQUAL(mk_hotkeys_enable(m, 1, MK_HOT_TOPK_MAX + 1), -1);
+
+    // 每次都采样：按访问次数降序，冷key不在前k名
+    CU_ASSERT_EQUAL(mk_hotkeys_enable(m, 1, 3), 0);
+    char key[32];
+    for (int i = 0; i < 50; i++) {
+        snprintf(key, sizeof(key), "cold%d", i);
+        mk_put(m, key, "v");
+    }
+    mk_put(m, "hot", "1");
+    mk_put(m, "warm", "1");
+    for (int i = 0; i < 1000; i++) mk_get(m, "hot");
+    for (int i = 0; i < 500; i++) mk_get(m, "warm");
+    CU_ASSERT_EQUAL(mk_hotkeys(m, hot, 10), 3);
+    CU_ASSERT_STRING_EQUAL(hot[0].key, "hot");
+    CU_ASSERT(hot[0].count >= 1001);// count-min估计值只会偏大
+    CU_ASSERT_STRING_EQUAL(hot[1].key, "warm");
+    CU_ASSERT(hot[1].count >= 501);
+    CU_ASSERT_EQUAL(mk_hotkeys(m, hot, 1), 1);
+
+    // 抽样时计数按采样间隔放大
+    CU_ASSERT_EQUAL(mk_hotkeys_enable(m, 4, 10), 0);
+    for (int i = 0; i < 4000; i++) mk_get(m, "warm");
+    CU_ASSERT_EQUAL(mk_hotkeys(m, hot, 10), 1);
+    CU_ASSERT(hot[0].count >= 3996 && hot[0].count <= 4004);
+
+    // 多线程读取时统计不丢失
+    CU_ASSERT_EQUAL(mk_hotkeys_enable(m, 1, 10), 0);
+    pthread_t tids[4];
+    for (int i = 0; i < 4; i++) pthread_create(&tids[i], NULL, hot_reader, m);
+    for (int i = 0; i < 4; i++) pthread_join(tids[i], NULL);
+    CU_ASSERT_EQUAL(mk_hotkeys(m, hot, 10), 1);
+    CU_ASSERT_STRING_EQUAL(hot[0].key, "hot");
+    CU_ASSERT(hot[0].count >= 8000);
+
+    // 自增的每次访问都计入，包括新建key的第一次
+    for (int i = 0; i < 10; i++) mk_incrby(m, "ctr", 1, NULL);
+    CU_ASSERT_EQUAL(mk_hotkeys(m, hot, 10), 2);
+    CU_ASSERT_STRING_EQUAL(hot[1].key, "ctr");
+    CU_ASSERT(hot[1].count >= 10);
+
+    // 关闭后不再统计
+    CU_ASSERT_EQUAL(mk_hotkeys_enable(m, 0, 0), 0);
+    CU_ASSERT_PTR_NULL(m->hot);
+    CU_ASSERT_EQUAL(mk_hotkeys(m, hot, 10), 0);
+    mk_destroy(m);
+}
+
+// 并发写线程：持续写入并读取慢操作日志
+static void *slow_writer(void *arg) {
+    mk_slowlog_entry_t entries[8];
+    for (int i = 0; i < 500; i++) {
+        mk_put(arg, "slow", "v");
+        mk_slowlog_get(arg, entries, 8);
+    }
+    return NULL;
+}
+
+// 测试慢操作日志
+void test_mk_slowlog(void) {
+    mk_t *m = mk_create();
+    mk_slowlog_entry_t entries[MK_SLOWLOG_LEN];
+
+    // 默认关闭，不记录
+    mk_put(m, "a", "1");
+    CU_ASSERT_EQUAL(mk_slowlog_len(m), 0);
+    CU_ASSERT_EQUAL(mk_slowlog_get(m, entries, 10), 0);
+
+    // 阈值1微秒：保存几千个键值对一定会被记录，记录包含操作名、文件路径和耗时
+    char key[32];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        mk_put(m, key, "value");
+    }
+    CU_ASSERT_EQUAL(mk_slowlog_set(m, 1), 0);
+    CU_ASSERT_EQUAL(mk_save(m, "tests/test_save.txt"), 0);
+    size_t n = mk_slowlog_get(m, entries, 1);
+    CU_ASSERT_EQUAL(n, 1);
+    CU_ASSERT_STRING_EQUAL(entries[0].cmd, "save");
+    CU_ASSERT_STRING_EQUAL(entries[0].key, "tests/test_save.txt");
+    CU_ASSERT(entries[0].duration_us >= 1);
+    CU_ASSERT(entries[0].timestamp_us > 0);
+    uint64_t save_id = entries[0].id;
+
+    // 过长的key被截断；新的记录在前
+    char long_key[200];
+    memset(long_key, 'x', sizeof(long_key) - 1);
+    long_key[sizeof(long_key) - 1] = '\0';
+    CU_ASSERT_EQUAL(mk_load(m, "tests/test_save.txt"), 0);
+    n = mk_slowlog_get(m, entries, MK_SLOWLOG_LEN);
+    CU_ASSERT(n >= 2);
+    CU_ASSERT_STRING_EQUAL(entries[0].cmd, "load");
+    CU_ASSERT(entries[0].id > save_id);
+    mk_slowlog_record(m, "put", long_key, 5000);
+    CU_ASSERT_EQUAL(mk_slowlog_get(m, entries, 1), 1);
+    CU_ASSERT_EQUAL(strlen(entries[0].key), MK_SLOWLOG_KEY_LEN - 1);
+    CU_ASSERT_EQUAL(entries[0].duration_us, 5);
+
+    // 环形缓冲区只保留最近的MK_SLOWLOG_LEN条；清空后重新计数
+    for (int i = 0; i < 2 * MK_SLOWLOG_LEN; i++) mk_slowlog_record(m, "get", "k", 1000);
+    CU_ASSERT_EQUAL(mk_slowlog_len(m), MK_SLOWLOG_LEN);
+    CU_ASSERT_EQUAL(mk_slowlog_get(m, entries, MK_SLOWLOG_LEN), MK_SLOWLOG_LEN);
+    mk_slowlog_reset(m);
+    CU_ASSERT_EQUAL(mk_slowlog_len(m), 0);
+    CU_ASSERT_EQUAL(mk_slowlog_get(m, entries, 10), 0);
+
+    // 关闭后不再记录
+    CU_ASSERT_EQUAL(mk_slowlog_set(m, 0), 0);
+    mk_save(m, "tests/test_save.txt");
+    CU_ASSERT_EQUAL(mk_slowlog_len(m), 0);
+
+    // 多线程同时写入和读取
+    mk_slowlog_set(m, 1);
+    pthread_t tids[4];
+    for (int i = 0; i < 4; i++) pthread_create(&tids[i], NULL, slow_writer, m);
+    for (int i = 0; i < 4; i++) pthread_join(tids[i], NULL);
+    n = mk_slowlog_get(m, entries, MK_SLOWLOG_LEN);
+    for (size_t i = 1; i < n; i++) CU_ASSERT(entries[i].id < entries[i - 1].id);
+    mk_destroy(m);
+}
+
+// 客户端回调：检查GET的回复是否为 "v<序号>"
+static int client_matched = 0;
+static void client_check_get(mkc_t *c, const mkc_reply_t *reply, void *ctx) {
+    (void)c;
+    char expect[32];
+    snprintf(expect, sizeof(expect), "v%d", (int)(intptr_t)ctx);
+    if (reply->type == MKC_REPLY_STRING && strcmp(reply->str, expect) == 0) client_matched++;
+}
+
+// 客户端回调：统计OK回复
+static void client_count_ok(mkc_t *c, const mkc_reply_t *reply, void *ctx) {
+    (void)c;
+    if (reply->type == MKC_REPLY_STATUS && strcmp(reply->str, "OK") == 0) (*(int *)ctx)++;
+}
+
+// 测试网络服务和异步客户端（含本机回环吞吐量）
+void test_mk_client(void) {
+    const char *addr = "unix:tests/test_client.sock";
+    mk_t *m = mk_create();
+    CU_ASSERT_EQUAL(mk_server_start(m, addr), 0);
+    CU_ASSERT_EQUAL(mk_server_start(m, addr), -1);// 已在运行
+    mkc_t *c = mkc_connect(addr);
+    CU_ASSERT_PTR_NOT_NULL(c);
+    if (c == NULL) {
+        mk_destroy(m);
+        return;
+    }
+
+    // 流水线：不等回复连续发送，由调用方的poll循环驱动
+    const int n = 20000;
+    char key[32], val[32];
+    int ok = 0;
+    uint64_t start = mk_now_ns();
+    for (int i = 0; i < n; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "v%d", i);
+        mkc_put(c, key, val, strlen(val), client_count_ok, &ok);
+    }
+    while (mkc_pending(c) > 0) {
+        struct pollfd pfd = {mkc_fd(c), mkc_events(c), 0};
+        CU_ASSERT(poll(&pfd, 1, 5000) > 0);
+        if (mkc_process(c, pfd.revents) != 0) break;
+    }
+    CU_ASSERT_EQUAL(ok, n);
+    CU_ASSERT_EQUAL(mk_count(m), (size_t)n);
+    for (int i = 0; i < n; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        mkc_get(c, key, client_check_get, (void *)(intptr_t)i);
+    }
+    CU_ASSERT_EQUAL(mkc_wait(c, 5000), 0);
+    CU_ASSERT_EQUAL(client_matched, n);
+    double ms = (mk_now_ns() - start) / 1e6;
+    printf("\n  loopback: %d requests in %.1f ms (%.0f req/s)\n", 2 * n, ms, 2 * n / (ms / 1000));
+
+    // future风格；批量读写；整数、不存在的key、二进制value和错误回复
+    const char *keys[] = {"a", "b", "missing"};
+    const void *vals[] = {"1", "x\0y"};
+    size_t lens[] = {1, 3};
+    mkc_future_t fset = {0}, fget = {0}, fincr = {0}, fnil = {0}, ferr = {0};
+    mkc_future_t fdel = {0}, fdel_again = {0}, fdel_bad = {0};
+    mkc_mset(c, 2, keys, vals, lens, mkc_future_cb, &fset);
+    mkc_mget(c, 3, keys, mkc_future_cb, &fget);
+    mkc_incrby(c, "a", 41, mkc_future_cb, &fincr);
+    mkc_get(c, "missing", mkc_future_cb, &fnil);
+    const char *bad[] = {"NOPE", "x"};
+    mkc_command(c, 2, bad, NULL, mkc_future_cb, &ferr);
+    mkc_del(c, " k0 ", mkc_future_cb, &fdel);// key两边的空白被去除
+    mkc_del(c, "k0", mkc_future_cb, &fdel_again);
+    mkc_del(c, "bad key", mkc_future_cb, &fdel_bad);
+    CU_ASSERT_EQUAL(mkc_wait(c, 5000), 0);
+    CU_ASSERT(fset.done && fget.done && fincr.done && fnil.done && ferr.done);
+    CU_ASSERT_EQUAL(fset.reply.type, MKC_REPLY_STATUS);
+    CU_ASSERT_EQUAL(fget.reply.type, MKC_REPLY_ARRAY);
+    CU_ASSERT_EQUAL(fget.reply.elements, 3);
+    if (fget.reply.elements == 3) {
+        CU_ASSERT_STRING_EQUAL(fget.reply.element[0].str, "1");
+        CU_ASSERT_EQUAL(fget.reply.element[1].len, 3);
+        CU_ASSERT(memcmp(fget.reply.element[1].str, "x\0y", 3) == 0);
+        CU_ASSERT_EQUAL(fget.reply.element[2].type, MKC_REPLY_NIL);
+    }
+    CU_ASSERT_EQUAL(fincr.reply.type, MKC_REPLY_INTEGER);
+    CU_ASSERT_EQUAL(fincr.reply.integer, 42);
+    CU_ASSERT_EQUAL(fnil.reply.type, MKC_REPLY_NIL);
+    CU_ASSERT_EQUAL(ferr.reply.type, MKC_REPLY_ERROR);
+    CU_ASSERT_EQUAL(fdel.reply.type, MKC_REPLY_INTEGER);
+    CU_ASSERT_EQUAL(fdel.reply.integer, 1);
+    CU_ASSERT_EQUAL(fdel_again.reply.type, MKC_REPLY_INTEGER);
+    CU_ASSERT_EQUAL(fdel_again.reply.integer, 0);
+    CU_ASSERT_EQUAL(fdel_bad.reply.type, MKC_REPLY_ERROR);
+    CU_ASSERT_PTR_NULL(mk_get(m, "k0"));
+    mkc_future_free(&fdel);
+    mkc_future_free(&fdel_again);
+    mkc_future_free(&fdel_bad);
+    mkc_future_free(&fset);
+    mkc_future_free(&fget);
+    mkc_future_free(&fincr);
+    mkc_future_free(&fnil);
+    mkc_future_free(&ferr);
+
+    // 服务停止后，未完成的请求以错误回复结束
+    CU_ASSERT_EQUAL(mk_server_stop(m), 0);
+    mkc_future_t lost = {0};
+    mkc_get(c, "a", mkc_future_cb, &lost);
+    CU_ASSERT_EQUAL(mkc_wait(c, 5000), -1);
+    CU_ASSERT(lost.done);
+    CU_ASSERT_EQUAL(lost.reply.type, MKC_REPLY_ERROR);
+    mkc_future_free(&lost);
+    mkc_close(c);
+    CU_ASSERT_PTR_NULL(mkc_connect(addr));
+    mk_destroy(m);
+}
+
+// 测试映射文件中的共享Hash表（多进程读写、重启后直接使用）
+void test_mk_mmap(void) {
+    const char *path = "tests/test_mmap.db";
+    unlink(path);
+    mk_mmap_t *m = mk_mmap_open(path, 4 * 1024 * 1024);
+    CU_ASSERT_PTR_NOT_NULL(m);
+    if (m == NULL) return;
+    char key[32], val[64], buf[64];
+    size_t len = 0;
+
+    // 子进程和父进程同时写入不同的key
+    pid_t pid = fork();
+    if (pid == 0) {
+        mk_mmap_t *cm = mk_mmap_open(path, 0);
+        int bad = (cm == NULL);
+        for (int i = 0; i < 2000 && !bad; i++) {
+            snprintf(key, sizeof(key), "child%d", i);
+            snprintf(val, sizeof(val), "c%d", i);
+            bad = mk_mmap_put(cm, key, val, strlen(val)) != 0;
+        }
+        if (cm != NULL) mk_mmap_close(cm);
+        _exit(bad);
+    }
+    for (int i = 0; i < 2000; i++) {
+        snprintf(key, sizeof(key), "parent%d", i);
+        snprintf(val, sizeof(val), "p%d", i);
+        CU_ASSERT_EQUAL(mk_mmap_put(m, key, val, strlen(val)), 0);
+    }
+    int status = -1;
+    CU_ASSERT_EQUAL(waitpid(pid, &status, 0), pid);
+    CU_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CU_ASSERT_EQUAL(mk_mmap_count(m), 4000);
+    CU_ASSERT_EQUAL(mk_mmap_get(m, "child1999", buf, sizeof(buf), &len), 0);
+    CU_ASSERT_STRING_EQUAL(buf, "c1999");
+
+    // 覆盖（更长的value换新块）、二进制value、删除、空间不足
+    CU_ASSERT_EQUAL(mk_mmap_put(m, "parent0", "a much longer value than before", 31), 0);
+    CU_ASSERT_EQUAL(mk_mmap_put(m, "bin", "x\0y", 3), 0);
+    CU_ASSERT_EQUAL(mk_mmap_del(m, "child0"), 0);
+    CU_ASSERT_EQUAL(mk_mmap_del(m, "child0"), -1);
+    CU_ASSERT_EQUAL(mk_mmap_get(m, "parent0", buf, 8, &len), -1);// buf不够
+    CU_ASSERT_EQUAL(len, 31);
+    char *huge = calloc(1, 8 * 1024 * 1024);
+    CU_ASSERT_EQUAL(mk_mmap_put(m, "huge", huge, 8 * 1024 * 1024), -1);
+    free(huge);
+    CU_ASSERT_EQUAL(mk_mmap_put(m, "bad key", "v", 1), -1);
+    mk_mmap_stats_t st;
+    CU_ASSERT_EQUAL(mk_mmap_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.count, 4000);
+    CU_ASSERT(st.used > 0 && st.used + st.free <= st.capacity);
+    CU_ASSERT_EQUAL(mk_mmap_sync(m), 0);
+    CU_ASSERT_EQUAL(mk_mmap_close(m), 0);
+
+    // 重新打开后不需要加载即可查询
+    m = mk_mmap_open(path, 0);
+    CU_ASSERT_PTR_NOT_NULL(m);
+    if (m == NULL) return;
+    CU_ASSERT_EQUAL(mk_mmap_count(m), 4000);
+    CU_ASSERT_EQUAL(mk_mmap_get(m, "parent0", buf, sizeof(buf), &len), 0);
+    CU_ASSERT_STRING_EQUAL(buf, "a much longer value than before");
+    CU_ASSERT_EQUAL(mk_mmap_get(m, "bin", buf, sizeof(buf), &len), 0);
+    CU_ASSERT_EQUAL(len, 3);
+    CU_ASSERT(memcmp(buf, "x\0y", 3) == 0);
+    CU_ASSERT_EQUAL(mk_mmap_get(m, "child0", buf, sizeof(buf), &len), -1);
+    CU_ASSERT_EQUAL(mk_mmap_get(m, "parent1999", buf, sizeof(buf), &len), 0);
+    CU_ASSERT_STRING_EQUAL(buf, "p1999");
+    CU_ASSERT_EQUAL(mk_mmap_close(m), 0);
+
+    // 不是映射文件时打开失败
+    CU_ASSERT_PTR_NULL(mk_mmap_open("tests/test_data.txt", 0));
+    unlink(path);
+}
+
+// 测试共享内存传输（含与进程内查询的延迟对比）
+void test_mk_shm(void) {
+    const char *path = "tests/test_shm.sock";
+    mk_t *m = mk_create();
+    CU_ASSERT_EQUAL(mk_shm_start(m, path), 0);
+    CU_ASSERT_EQUAL(mk_shm_start(m, path), -1);// 已在运行
+    mk_shm_client_t *c = mk_shm_connect(path, 4096);
+    CU_ASSERT_PTR_NOT_NULL(c);
+    if (c == NULL) {
+        mk_destroy(m);
+        return;
+    }
+
+    char key[32], val[32];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "v%d", i);
+        CU_ASSERT_EQUAL(mk_shm_put(c, key, val, strlen(val)), 0);
+    }
+    CU_ASSERT_EQUAL(mk_count(m), 1000);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "k999"), "v999");
+
+    // GET返回指向共享内存的指针
+    const void *v = NULL;
+    size_t len = 0;
+    int matched = 0;
+    uint64_t start = mk_now_ns();
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "v%d", i);
+        if (mk_shm_get(c, key, &v, &len) == 0 && len == strlen(val) && memcmp(v, val, len) == 0) matched++;
+    }
+    uint64_t shm_ns = mk_now_ns() - start;
+    CU_ASSERT_EQUAL(matched, 1000);
+    char buf[32];
+    start = mk_now_ns();
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        mk_get_buf(m, key, buf, sizeof(buf), &len);
+    }
+    uint64_t local_ns = mk_now_ns() - start;
+    printf("\n  shm get: %.2f us/op, in-process get: %.2f us/op\n", shm_ns / 1000.0 / 1000, local_ns / 1000.0 / 1000);
+
+    // 二进制value、不存在的key、删除、超过value_cap
+    CU_ASSERT_EQUAL(mk_shm_put(c, "bin", "x\0y", 3), 0);
+    CU_ASSERT_EQUAL(mk_shm_get(c, "bin", &v, &len), 0);
+    CU_ASSERT_EQUAL(len, 3);
+    CU_ASSERT(memcmp(v, "x\0y", 3) == 0);
+    CU_ASSERT_EQUAL(mk_shm_get(c, "missing", &v, &len), -1);
+    CU_ASSERT_EQUAL(mk_shm_del(c, "k0"), 0);
+    CU_ASSERT_EQUAL(mk_shm_get(c, "k0", &v, &len), -1);
+    CU_ASSERT_EQUAL(mk_shm_del(c, "k0"), 1);
+    CU_ASSERT_EQUAL(mk_shm_del(c, " k1 "), 0);// key两边的空白被去除
+    CU_ASSERT_PTR_NULL(mk_get(m, "k1"));
+    CU_ASSERT_EQUAL(mk_shm_del(c, "bad key"), -1);
+    char *big = calloc(1, 8192);
+    CU_ASSERT_EQUAL(mk_shm_put(c, "big", big, 8192), -1);
+    CU_ASSERT_EQUAL(mk_put_bin(m, "big", big, 8192), 0);
+    CU_ASSERT_EQUAL(mk_shm_get(c, "big", &v, &len), -1);// 放不进回复value区
+    free(big);
+    CU_ASSERT_EQUAL(mk_shm_put(c, "bad key", "v", 1), -1);
+
+    // 服务停止后请求失败
+    CU_ASSERT_EQUAL(mk_shm_stop(m), 0);
+    CU_ASSERT_EQUAL(mk_shm_get(c, "k1", &v, &len), -1);
+    mk_shm_close(c);
+    CU_ASSERT_PTR_NULL(mk_shm_connect(path, 0));
+    mk_destroy(m);
+}
+
+// 反复覆盖大value，使后台回收线程不断搬移记录
+static void *vlog_writer(void *arg) {
+    mk_t *m = arg;
+    char key[32];
+    char *val = malloc(2048);
+    for (int round = 0; round < 50; round++) {
+        memset(val, 'a' + round % 26, 2048);
+        for (int i = 0; i < 20; i++) {
+            snprintf(key, sizeof(key), "hot%d", i);
+            mk_put_bin(m, key, val, 2048);
+        }
+    }
+    free(val);
+    return NULL;
+}
+
+// 测试值日志（大value与key分离存储及回收）
+void test_mk_vlog(void) {
+    mk_t *m = mk_create();
+    CU_ASSERT_EQUAL(mk_vlog_gc(m), -1);// 未开启
+    CU_ASSERT_EQUAL(mk_vlog_open(m, "tests/test_vlog", 1024, 64 * 1024), 0);
+    CU_ASSERT_EQUAL(mk_vlog_open(m, "tests/test_vlog", 1024, 0), -1);// 已开启
+
+    // 小value仍存在节点中，大value写入值日志
+    char key[32];
+    char *val = malloc(4096);
+    CU_ASSERT_EQUAL(mk_put(m, "small", "abc"), 0);
+    for (int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "big%d", i);
+        memset(val, 'a' + i % 26, 4096);
+        CU_ASSERT_EQUAL(mk_put_bin(m, key, val, 4096), 0);
+    }
+    mk_vlog_stats_t st;
+    CU_ASSERT_EQUAL(mk_vlog_stats(m, &st), 0);
+    CU_ASSERT(st.segments >= 6);
+    CU_ASSERT_EQUAL(st.dead_bytes, 0);
+    const void *data = NULL;
+    size_t len = 0;
+    CU_ASSERT_EQUAL(mk_get_bin(m, "big7", &data, &len), 0);
+    CU_ASSERT_EQUAL(len, 4096);
+    CU_ASSERT(((const char *)data)[0] == 'h' && ((const char *)data)[4095] == 'h');
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "small"), "abc");
+
+    // 快照开始后覆盖：旧值保留在值日志中
+    mk_snapshot_t *snap = mk_snapshot_begin(m);
+    for (int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "big%d", i);
+        memset(val, 'A' + i % 26, 4096);
+        CU_ASSERT_EQUAL(mk_put_bin(m, key, val, 4096), 0);
+    }
+    CU_ASSERT_EQUAL(mk_vlog_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.dead_bytes, 0);
+
+    // 快照结束后旧值失效，回收后空间减少、value不变
+    mk_snapshot_end(snap);
+    CU_ASSERT_EQUAL(mk_del(m, "big99"), 0);
+    CU_ASSERT_EQUAL(mk_vlog_stats(m, &st), 0);
+    CU_ASSERT(st.dead_bytes > 0);
+    uint64_t before = st.file_bytes;
+    CU_ASSERT_EQUAL(mk_vlog_gc(m), 0);
+    CU_ASSERT_EQUAL(mk_vlog_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.dead_bytes, 0);
+    CU_ASSERT(st.gc_segments > 0);
+    CU_ASSERT(st.file_bytes < before);
+    int matched = 0;
+    char buf[4097];
+    for (int i = 0; i < 99; i++) {
+        snprintf(key, sizeof(key), "big%d", i);
+        if (mk_get_buf(m, key, buf, sizeof(buf), &len) == 0 && len == 4096 &&
+            buf[0] == 'A' + i % 26 && buf[4095] == 'A' + i % 26) matched++;
+    }
+    CU_ASSERT_EQUAL(matched, 99);
+    CU_ASSERT_PTR_NULL(mk_get(m, "big99"));
+
+    // 大value的整数不按整数编码，incrby仍然可用
+    memset(val, '0', 4096);
+    val[4095] = '7';
+    CU_ASSERT_EQUAL(mk_put_bin(m, "num", val, 4096), 0);
+    int64_t n = 0;
+    CU_ASSERT_EQUAL(mk_incrby(m, "num", 1, &n), -1);// 非规范形式
+    CU_ASSERT_EQUAL(mk_put_bin(m, "num", val + 4095, 1), 0);
+    CU_ASSERT_EQUAL(mk_incrby(m, "num", 1, &n), 0);
+    CU_ASSERT_EQUAL(n, 8);
+
+    // 并发覆盖与读取：读到的value总是某一次完整写入的内容
+    memset(val, 'a', 2048);
+    for (int i = 0; i < 20; i++) {
+        snprintf(key, sizeof(key), "hot%d", i);
+        CU_ASSERT_EQUAL(mk_put_bin(m, key, val, 2048), 0);
+    }
+    pthread_t tid;
+    pthread_create(&tid, NULL, vlog_writer, m);
+    int torn = 0;
+    for (int round = 0; round < 200; round++) {
+        snprintf(key, sizeof(key), "hot%d", round % 20);
+        if (mk_get_buf(m, key, buf, sizeof(buf), &len) != 0 || len != 2048 || memcmp(buf, buf + 1, 2047) != 0) torn++;
+    }
+    pthread_join(tid, NULL);
+    CU_ASSERT_EQUAL(torn, 0);
+    CU_ASSERT_EQUAL(mk_vlog_stats(m, &st), 0);
+    CU_ASSERT(st.gc_segments > 0);
+    free(val);
+    mk_destroy(m);
+}
+
+// 值日志回收线程的停止标志
+static int vlog_gc_stop;
+
+// 不停地立即回收值日志，直到vlog_gc_stop置1
+static void *vlog_gc_loop(void *arg) {
+    mk_t *m = arg;
+    while (!__atomic_load_n(&vlog_gc_stop, __ATOMIC_ACQUIRE)) mk_vlog_gc(m);
+    return NULL;
+}
+
+// 大value写入线程：反复覆盖自己的40个key，每个value由同一个字符组成
+static void *vlog_gc_writer(void *arg) {
+    mk_t *m = ((void **)arg)[0];
+    long id = (long)((void **)arg)[1];
+    char key[32], val[600];
+    for (int i = 0; i < 3000; i++) {
+        snprintf(key, sizeof(key), "w%ld_%d", id, i % 40);
+        memset(val, 'a' + i % 26, sizeof(val));
+        mk_put_bin(m, key, val, sizeof(val));
+    }
+    return NULL;
+}
+
+// 测试值日志回收与大value写入并发：追加后、挂到节点前的记录所在的段不会被回收
+void test_mk_vlog_gc_concurrent(void) {
+    mk_t *m = mk_create();
+    CU_ASSERT_EQUAL(mk_vlog_open(m, "tests/test_vlog", 512, 64 * 1024), 0);
+    __atomic_store_n(&vlog_gc_stop, 0, __ATOMIC_RELEASE);
+    pthread_t gc, writers[3];
+    void *args[3][2];
+    pthread_create(&gc, NULL, vlog_gc_loop, m);
+    for (long i = 0; i < 3; i++) {
+        args[i][0] = m;
+        args[i][1] = (void *)i;
+        pthread_create(&writers[i], NULL, vlog_gc_writer, args[i]);
+    }
+    for (int i = 0; i < 3; i++) pthread_join(writers[i], NULL);
+    __atomic_store_n(&vlog_gc_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(gc, NULL);
+
+    // 每个key都是最后一次写入的完整内容
+    int matched = 0;
+    char key[32], buf[601];
+    size_t len = 0;
+    for (long t = 0; t < 3; t++) {
+        for (int k = 0; k < 40; k++) {
+            snprintf(key, sizeof(key), "w%ld_%d", t, k);
+            char want = (char)('a' + (2960 + k) % 26);
+            if (mk_get_buf(m, key, buf, sizeof(buf), &len) == 0 && len == 600 && buf[0] == want &&
+                memcmp(buf, buf + 1, 599) == 0) matched++;
+        }
+    }
+    CU_ASSERT_EQUAL(matched, 120);
+    CU_ASSERT_EQUAL(mk_vlog_gc(m), 0);
+    mk_vlog_stats_t st;
+    CU_ASSERT_EQUAL(mk_vlog_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.dead_bytes, 0);
+    mk_destroy(m);
+}
+
+// mk_foreach回调：计数，数到limit时提前结束
+static int count_until(const char *key, size_t klen, const char *value, size_t vlen, void *ctx) {
+    (void)value;
+    int *n = ctx;
+    if (strlen(key) != klen || vlen == 0) return -1;
+    return ++n[0] == n[1] ? 2 : 0;
+}
+
+// 测试遍历和流式导出
+void test_mk_export(void) {
+    mk_t *m = mk_create();
+    char key[32], val[32];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "key%04d", i);
+        snprintf(val, sizeof(val), "v%d", i);
+        CU_ASSERT_EQUAL(mk_put(m, key, val), 0);
+    }
+    CU_ASSERT_EQUAL(mk_put_bin(m, "bin", "a\nb\0c", 5), 0);
+
+    // 遍历全部；回调返回非0时提前结束并返回该值
+    int n[2] = {0, -1};
+    CU_ASSERT_EQUAL(mk_foreach(m, count_until, n), 0);
+    CU_ASSERT_EQUAL(n[0], 1001);
+    n[0] = 0;
+    n[1] = 10;
+    CU_ASSERT_EQUAL(mk_foreach(m, count_until, n), 2);
+    CU_ASSERT_EQUAL(n[0], 10);
+    CU_ASSERT_EQUAL(mk_foreach(m, NULL, NULL), -1);
+
+    // 升序导出到内存
+    mk_sink_t sink;
+    CU_ASSERT_EQUAL(mk_sink_mem(&sink), 0);
+    CU_ASSERT_EQUAL(mk_export_sorted(m, &sink, 0), 0);
+    CU_ASSERT(sink.len > 0);
+    CU_ASSERT(memcmp(sink.buf, "bin:=5\na\nb\0c\nkey0000=v0\nkey0001=v1\n", 35) == 0);
+    CU_ASSERT(memcmp(sink.buf + sink.len - 13, "key0999=v999\n", 13) == 0);
+    size_t asc_len = sink.len;
+    mk_sink_free(&sink);
+
+    // 降序导出
+    CU_ASSERT_EQUAL(mk_sink_mem(&sink), 0);
+    CU_ASSERT_EQUAL(mk_export_sorted(m, &sink, 1), 0);
+    CU_ASSERT_EQUAL(sink.len, asc_len);
+    CU_ASSERT(memcmp(sink.buf, "key0999=v999\nkey0998=v998\n", 26) == 0);
+    mk_sink_free(&sink);
+
+    // 导出到文件后可以直接加载
+    const char *path = "tests/test_save.txt";
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CU_ASSERT(fd >= 0);
+    CU_ASSERT_EQUAL(mk_sink_fd(&sink, fd), 0);
+    CU_ASSERT_EQUAL(mk_export(m, &sink), 0);
+    mk_sink_free(&sink);
+    close(fd);
+    mk_t *loaded = mk_create();
+    CU_ASSERT_EQUAL(mk_load(loaded, path), 0);
+    CU_ASSERT_EQUAL(mk_count(loaded), 1001);
+    CU_ASSERT_STRING_EQUAL(mk_get(loaded, "key0500"), "v500");
+    const void *data = NULL;
+    size_t len = 0;
+    CU_ASSERT_EQUAL(mk_get_bin(loaded, "bin", &data, &len), 0);
+    CU_ASSERT_EQUAL(len, 5);
+    CU_ASSERT(memcmp(data, "a\nb\0c", 5) == 0);
+    mk_destroy(loaded);
+
+    // 写入出错后导出失败
+    fd = open("/dev/full", O_WRONLY);
+    if (fd >= 0) {
+        CU_ASSERT_EQUAL(mk_sink_fd(&sink, fd), 0);
+        CU_ASSERT_EQUAL(mk_export(m, &sink), -1);
+        CU_ASSERT_EQUAL(sink.error, 1);
+        mk_sink_free(&sink);
+        close(fd);
+    }
+    mk_destroy(m);
+}
+
+// 乐观并发计数线程：读取版本号后用mk_cas加1，版本不符时重试
+static void *cas_worker(void *arg) {
+    mk_t *m = arg;
+    char buf[32];
+    size_t len = 0;
+    uint64_t version = 0;
+    for (int i = 0; i < 1000; i++) {
+        int ret = 1;
+        while (ret == 1) {
+            long n = 0;
+            if (mk_get_versioned(m, "cas", buf, sizeof(buf), &len, &version) == 0) n = atol(buf);
+            snprintf(buf, sizeof(buf), "%ld", n + 1);
+            ret = mk_cas(m, "cas", version, buf, strlen(buf));
+        }
+    }
+    return NULL;
+}
+
+// 测试版本号、比较并写入和条件写入
+void test_mk_cas(void) {
+    const char *dir = "tests/test_lsm";
+    remove_dir_files(dir);
+    mk_t *m = mk_create();
+    char buf[32];
+    size_t len = 0;
+    uint64_t v1 = 0, v2 = 0;
+
+    // 不存在的key版本号为0，写入后版本号递增
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k", buf, sizeof(buf), &len, &v1), -1);
+    CU_ASSERT_EQUAL(v1, 0);
+    CU_ASSERT_EQUAL(mk_put(m, "k", "a"), 0);
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k", buf, sizeof(buf), &len, &v1), 0);
+    CU_ASSERT_STRING_EQUAL(buf, "a");
+    CU_ASSERT(v1 > 0);
+    CU_ASSERT_EQUAL(mk_incrby(m, "other", 1, NULL), 0);
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k", buf, sizeof(buf), &len, &v2), 0);
+    CU_ASSERT_EQUAL(v1, v2);// 其他key的写入不影响
+
+    // 版本号相符才写入
+    CU_ASSERT_EQUAL(mk_cas(m, "k", v1, "b", 1), 0);
+    CU_ASSERT_EQUAL(mk_cas(m, "k", v1, "c", 1), 1);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "k"), "b");
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k", buf, sizeof(buf), &len, &v2), 0);
+    CU_ASSERT(v2 > v1);
+    CU_ASSERT_EQUAL(mk_cas(m, "new", 0, "n", 1), 0);// 0表示要求不存在
+    CU_ASSERT_EQUAL(mk_cas(m, "new", 0, "n", 1), 1);
+    CU_ASSERT_EQUAL(mk_cas(m, "bad key", 0, "n", 1), -1);
+
+    // 条件写入；删除后视为不存在
+    CU_ASSERT_EQUAL(mk_put_if_absent(m, "k", "x", 1), 1);
+    CU_ASSERT_EQUAL(mk_put_if_present(m, "missing", "x", 1), 1);
+    CU_ASSERT_PTR_NULL(mk_get(m, "missing"));
+    CU_ASSERT_EQUAL(mk_put_if_present(m, "k", "x", 1), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "k"), "x");
+    CU_ASSERT_EQUAL(mk_del(m, "k"), 0);
+    CU_ASSERT_EQUAL(mk_put_if_present(m, "k", "y", 1), 1);
+    CU_ASSERT_EQUAL(mk_put_if_absent(m, "k", "y", 1), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "k"), "y");
+
+    // 刷盘后只在磁盘层中的key仍有版本号，刷盘前读到的旧版本号不会误判为相符
+    CU_ASSERT_EQUAL(mk_lsm_open(m, dir, 1024 * 1024), 0);
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k", buf, sizeof(buf), &len, &v1), 0);
+    CU_ASSERT_EQUAL(mk_put(m, "k", "z"), 0);
+    CU_ASSERT_EQUAL(mk_lsm_flush(m), 0);
+    CU_ASSERT_PTR_NULL(mk_find_node(m, "k"));
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k", buf, sizeof(buf), &len, &v2), 0);
+    CU_ASSERT_STRING_EQUAL(buf, "z");
+    CU_ASSERT(v2 > v1);
+    CU_ASSERT_EQUAL(mk_cas(m, "k", v1, "w", 1), 1);
+    CU_ASSERT_EQUAL(mk_put_if_absent(m, "k", "w", 1), 1);
+    CU_ASSERT_EQUAL(mk_cas(m, "k", v2, "w", 1), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "k"), "w");
+
+    // 版本号随记录写入磁盘表，之后的刷盘和合并不改变未修改的key的版本号
+    uint64_t v3 = 0;
+    CU_ASSERT_EQUAL(mk_put(m, "k2", "a"), 0);
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k2", buf, sizeof(buf), &len, &v1), 0);
+    CU_ASSERT_EQUAL(mk_lsm_flush(m), 0);
+    CU_ASSERT_EQUAL(mk_put(m, "k3", "b"), 0);
+    CU_ASSERT_EQUAL(mk_lsm_flush(m), 0);
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k3", buf, sizeof(buf), &len, &v3), 0);
+    CU_ASSERT_EQUAL(mk_lsm_compact(m), 0);
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k2", buf, sizeof(buf), &len, &v2), 0);
+    CU_ASSERT_EQUAL(v1, v2);
+    CU_ASSERT_EQUAL(mk_cas(m, "k2", v1, "b", 1), 0);
+    mk_destroy(m);
+
+    // 重新打开后版本号仍然有效，新的写入取更大的版本号
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_lsm_open(m, dir, 1024 * 1024), 0);
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k3", buf, sizeof(buf), &len, &v2), 0);
+    CU_ASSERT_EQUAL(v2, v3);
+    CU_ASSERT_EQUAL(mk_put(m, "k4", "c"), 0);
+    CU_ASSERT_EQUAL(mk_get_versioned(m, "k4", buf, sizeof(buf), &len, &v1), 0);
+    CU_ASSERT(v1 > v3);
+    CU_ASSERT_EQUAL(mk_cas(m, "k3", v3, "d", 1), 0);
+    CU_ASSERT_EQUAL(mk_cas(m, "k3", v3, "e", 1), 1);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "k3"), "d");
+    mk_destroy(m);
+    remove_dir_files(dir);
+
+    // 多线程用mk_cas并发加1不丢失更新
+    m = mk_create();
+    pthread_t tids[4];
+    for (int i = 0; i < 4; i++) pthread_create(&tids[i], NULL, cas_worker, m);
+    for (int i = 0; i < 4; i++) pthread_join(tids[i], NULL);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "cas"), "4000");
+    mk_destroy(m);
+}
+
+// 找出目录下名字以prefix开头、按名字排序最大的文件（检查点和日志段的名字中位置补零，最大即最新）
+static int newest_file(const char *dir, const char *prefix, char *path, size_t cap) {
+    DIR *dp = opendir(dir);
+    if (dp == NULL) return -1;
+    struct dirent *de;
+    char best[256] = "";
+    while ((de = readdir(dp)) != NULL) {
+        if (strncmp(de->d_name, prefix, strlen(prefix)) == 0 && strcmp(de->d_name, best) > 0) {
+            snprintf(best, sizeof(best), "%s", de->d_name);
+        }
+    }
+    closedir(dp);
+    if (best[0] == '\0') return -1;
+    snprintf(path, cap, "%s/%s", dir, best);
+    return 0;
+}
+
+// 内存分配失败注入：测试程序链接时用--wrap把malloc/calloc/realloc换成下面的函数
+// alloc_fail_countdown倒数到0的那一次分配返回NULL，只影响设置了倒数的线程
+static __thread int alloc_fail_countdown;
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size) {
+    if (alloc_fail_countdown > 0 && --alloc_fail_countdown == 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return __real_malloc(size);
+}
+void *__wrap_calloc(size_t n, size_t size) {
+    if (alloc_fail_countdown > 0 && --alloc_fail_countdown == 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return __real_calloc(n, size);
+}
+void *__wrap_realloc(void *ptr, size_t size) {
+    if (alloc_fail_countdown > 0 && --alloc_fail_countdown == 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return __real_realloc(ptr, size);
+}
+
+// 测试写日志：检查点之后只重放日志尾部，损坏的检查点被跳过，日志末尾写了一半的记录被丢弃
+void test_mk_wal(void) {
+    const char *dir = "tests/test_wal";
+    char key[32], path[512];
+    remove_dir_files(dir);
+
+    mk_t *m = mk_create();
+    CU_ASSERT_EQUAL(mk_checkpoint(m), -1);// 未开启
+    CU_ASSERT_EQUAL(mk_wal_open(m, dir, 0), 0);
+    CU_ASSERT_EQUAL(mk_wal_open(m, dir, 0), -1);// 已开启
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        CU_ASSERT_EQUAL(mk_put(m, key, key), 0);
+    }
+    CU_ASSERT_EQUAL(mk_incrby(m, "counter", 5, NULL), 0);
+    CU_ASSERT_EQUAL(mk_del(m, "key0"), 0);
+    CU_ASSERT_EQUAL(mk_checkpoint(m), 0);
+    for (int i = 200; i < 300; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        CU_ASSERT_EQUAL(mk_put(m, key, key), 0);
+    }
+    CU_ASSERT_EQUAL(mk_put_bin(m, "key1", "new\0bin", 7), 0);
+    CU_ASSERT_EQUAL(mk_del(m, "key2"), 0);
+    mk_destroy(m);
+
+    // 载入检查点，只重放检查点之后的102条记录
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_wal_open(m, dir, 0), 0);
+    mk_wal_stats_t st;
+    CU_ASSERT_EQUAL(mk_wal_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.loaded_keys, 200);
+    CU_ASSERT_EQUAL(st.replayed_records, 102);
+    CU_ASSERT_EQUAL(st.skipped_checkpoints, 0);
+    CU_ASSERT(st.recovery_threads >= 1);
+    CU_ASSERT_EQUAL(mk_count(m), 299);
+    CU_ASSERT_PTR_NULL(mk_get(m, "key0"));
+    CU_ASSERT_PTR_NULL(mk_get(m, "key2"));
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "key299"), "key299");
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "counter"), "5");
+    const void *data = NULL;
+    size_t len = 0;
+    CU_ASSERT_EQUAL(mk_get_bin(m, "key1", &data, &len), 0);
+    CU_ASSERT(len == 7 && memcmp(data, "new\0bin", 7) == 0);
+    CU_ASSERT_EQUAL(mk_put(m, "after", "x"), 0);
+    CU_ASSERT_EQUAL(mk_checkpoint(m), 0);
+    mk_destroy(m);
+
+    // 破坏最新检查点的分区数据：跳过它，退回上一个检查点并重放更长的日志
+    CU_ASSERT_EQUAL(newest_file(dir, "checkpoint-", path, sizeof(path)), 0);
+    FILE *fp = fopen(path, "r+b");
+    CU_ASSERT_PTR_NOT_NULL(fp);
+    fseek(fp, -1, SEEK_END);
+    int c = fgetc(fp);
+    fseek(fp, -1, SEEK_END);
+    fputc(c ^ 0xff, fp);
+    fclose(fp);
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_wal_open(m, dir, 0), 0);
+    CU_ASSERT_EQUAL(mk_wal_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.skipped_checkpoints, 1);
+    CU_ASSERT_EQUAL(st.replayed_records, 103);
+    CU_ASSERT_EQUAL(mk_count(m), 300);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "after"), "x");
+    mk_destroy(m);
+
+    // 日志末尾有写了一半的记录：丢弃后继续在有效末尾追加
+    CU_ASSERT_EQUAL(newest_file(dir, "wal-", path, sizeof(path)), 0);
+    int fd = open(path, O_WRONLY | O_APPEND);
+    CU_ASSERT(fd >= 0);
+    CU_ASSERT_EQUAL(write(fd, "torn", 4), 4);
+    close(fd);
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_wal_open(m, dir, 0), 0);
+    CU_ASSERT_EQUAL(mk_count(m), 300);
+    CU_ASSERT_EQUAL(mk_put(m, "tail", "t"), 0);
+    mk_destroy(m);
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_wal_open(m, dir, 0), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "tail"), "t");
+    CU_ASSERT_EQUAL(mk_count(m), 301);
+
+    // 大记录扩大日志缓冲区失败时写操作失败，不会生效之后又在恢复时丢失
+    // 依次让第k次分配失败；每次的value都更大，都需要扩大缓冲区
+    size_t big_len = 200 * 1024;
+    char *big = malloc(big_len + 64 * 1024);
+    memset(big, 'w', big_len + 64 * 1024);
+    CU_ASSERT_EQUAL(mk_put_bin(m, "huge", big, (size_t)UINT32_MAX + 1), -1);// 超过记录长度字段
+    int put_ret[40];
+    for (int k = 1; k < 40; k++) {
+        snprintf(key, sizeof(key), "big%d", k);
+        alloc_fail_countdown = k;
+        put_ret[k] = mk_put_bin(m, key, big, big_len + (size_t)k * 1024);
+        alloc_fail_countdown = 0;
+        if (put_ret[k] != 0) CU_ASSERT_PTR_NULL(mk_get(m, key));
+    }
+    mk_destroy(m);
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_wal_open(m, dir, 0), 0);
+    for (int k = 1; k < 40; k++) {
+        snprintf(key, sizeof(key), "big%d", k);
+        if (put_ret[k] == 0) {
+            CU_ASSERT_EQUAL(mk_get_bin(m, key, &data, &len), 0);
+            CU_ASSERT_EQUAL(len, big_len + (size_t)k * 1024);
+        } else {
+            CU_ASSERT_PTR_NULL(mk_get(m, key));
+        }
+    }
+    free(big);
+    mk_destroy(m);
+    remove_dir_files(dir);
+}
+
+// 批量写线程：每次提交把x和y设为同一个值
+static void *batch_worker(void *arg) {
+    mk_t *m = arg;
+    mk_batch_t *b = mk_batch_create();
+    char buf[32];
+    for (int i = 1; i <= 2000; i++) {
+        snprintf(buf, sizeof(buf), "%d", i);
+        mk_batch_clear(b);
+        mk_batch_put(b, "x", buf, strlen(buf));
+        mk_batch_put(b, "y", buf, strlen(buf));
+        mk_batch_commit(m, b);
+    }
+    mk_batch_free(b);
+    return NULL;
+}
+
+// 测试批量写：提前校验、原子可见、作为一条记录写入写日志
+void test_mk_batch(void) {
+    const char *dir = "tests/test_wal";
+    remove_dir_files(dir);
+    mk_t *m = mk_create();
+    CU_ASSERT_EQUAL(mk_wal_open(m, dir, 0), 0);
+    CU_ASSERT_EQUAL(mk_put(m, "c", "old"), 0);
+
+    mk_batch_t *b = mk_batch_create();
+    CU_ASSERT_PTR_NOT_NULL(b);
+    CU_ASSERT_EQUAL(mk_batch_put(b, " a ", "1", 1), 0);
+    CU_ASSERT_EQUAL(mk_batch_put(b, "b", "bin\0v", 5), 0);
+    CU_ASSERT_EQUAL(mk_batch_del(b, "c"), 0);
+    CU_ASSERT_EQUAL(mk_batch_del(b, "missing"), 0);// 提交时不存在视为成功
+    CU_ASSERT_EQUAL(mk_batch_put(b, "a", "2", 1), 0);// 同一个key按顺序应用
+    CU_ASSERT_EQUAL(mk_batch_put(b, "bad key", "x", 1), -1);// 不合法的key在加入时就被拒绝
+    CU_ASSERT_EQUAL(mk_batch_count(b), 5);
+    CU_ASSERT_EQUAL(mk_batch_commit(m, b), 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "a"), "2");
+    CU_ASSERT_PTR_NULL(mk_get(m, "c"));
+    CU_ASSERT_EQUAL(mk_count(m), 2);
+    mk_batch_free(b);
+    CU_ASSERT_EQUAL(mk_batch_apply(m, "garbage", 7), -1);// 格式错误时不应用
+    CU_ASSERT_EQUAL(mk_count(m), 2);
+
+    // 重启后整个批量写从一条日志记录中重放
+    mk_destroy(m);
+    m = mk_create();
+    CU_ASSERT_EQUAL(mk_wal_open(m, dir, 0), 0);
+    mk_wal_stats_t st;
+    CU_ASSERT_EQUAL(mk_wal_stats(m, &st), 0);
+    CU_ASSERT_EQUAL(st.replayed_records, 6);// put c + 批量写中的5个操作
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "a"), "2");
+    CU_ASSERT_PTR_NULL(mk_get(m, "c"));
+    const void *data = NULL;
+    size_t len = 0;
+    CU_ASSERT_EQUAL(mk_get_bin(m, "b", &data, &len), 0);
+    CU_ASSERT(len == 5 && memcmp(data, "bin\0v", 5) == 0);
+    mk_destroy(m);
+    remove_dir_files(dir);
+
+    // 并发提交时快照总是看到x和y相同
+    m = mk_create();
+    pthread_t tid;
+    pthread_create(&tid, NULL, batch_worker, m);
+    int mismatch = 0;
+    for (int i = 0; i < 2000; i++) {
+        mk_snapshot_t *snap = mk_snapshot_begin(m);
+        size_t xl = 0, yl = 0;
+        const char *x = mk_snapshot_get(snap, "x", &xl);
+        char xv[32] = "";
+        if (x != NULL) snprintf(xv, sizeof(xv), "%.*s", (int)xl, x);
+        const char *y = mk_snapshot_get(snap, "y", &yl);
+        if ((x == NULL) != (y == NULL) || (y != NULL && (xl != yl || memcmp(xv, y, yl) != 0))) mismatch++;
+        mk_snapshot_end(snap);
+    }
+    pthread_join(tid, NULL);
+    CU_ASSERT_EQUAL(mismatch, 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "x"), "2000");
+    mk_destroy(m);
+}
+
+// 测试批量写在任何一次内存分配失败时都不会只应用一部分
+void test_mk_batch_oom(void) {
+    mk_t *m = mk_create();
+    CU_ASSERT_EQUAL(mk_put(m, "a", "old-a"), 0);
+    CU_ASSERT_EQUAL(mk_put(m, "d", "old-d"), 0);
+    mk_snapshot_t *snap = mk_snapshot_begin(m);// 覆盖和删除时需要为快照保留旧版本
+    mk_batch_t *b = mk_batch_create();
+    CU_ASSERT_EQUAL(mk_batch_put(b, "a", "new-a", 5), 0);
+    CU_ASSERT_EQUAL(mk_batch_put(b, "n", "123", 3), 0);
+    CU_ASSERT_EQUAL(mk_batch_del(b, "d"), 0);
+    CU_ASSERT_EQUAL(mk_batch_put(b, "e", "new-e", 5), 0);
+
+    // 依次让第1、2、3……次分配失败，直到提交成功
+    int failures = 0;
+    for (int k = 1; k < 100; k++) {
+        size_t mem = mk_memory_usage(m);
+        alloc_fail_countdown = k;
+        int ret = mk_batch_commit(m, b);
+        alloc_fail_countdown = 0;
+        if (ret == 0) break;
+        failures++;
+        CU_ASSERT_STRING_EQUAL(mk_get(m, "a"), "old-a");
+        CU_ASSERT_STRING_EQUAL(mk_get(m, "d"), "old-d");
+        CU_ASSERT_PTR_NULL(mk_get(m, "n"));
+        CU_ASSERT_PTR_NULL(mk_get(m, "e"));
+        CU_ASSERT_EQUAL(mk_count(m), 2);
+        CU_ASSERT_EQUAL(mk_memory_usage(m), mem);
+    }
+    CU_ASSERT(failures > 0);
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "a"), "new-a");
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "n"), "123");
+    CU_ASSERT_PTR_NULL(mk_get(m, "d"));
+    CU_ASSERT_STRING_EQUAL(mk_get(m, "e"), "new-e");
+    CU_ASSERT_STRING_EQUAL(mk_snapshot_get(snap, "d", NULL), "old-d");
+    mk_snapshot_end(snap);
+    mk_batch_free(b);
+    mk_destroy(m);
+}
+
+// 刷盘期间另一个线程反复读取已写入的key
+static void *lsm_reader_main(void *arg) {
+    mk_t *m = arg;
+    char key[32], want[32];
+    long missing = 0;
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 100; i++) {
+            snprintf(key, sizeof(key), "stable%03d", i);
+            snprintf(want, sizeof(want), "v%d", i);
+            const char *v = mk_get(m, key);
+            if (v == NULL || strcmp(v, want) != 0) missing++;
+        }
+    }
+    return (void *)missing;
+}
+
+// 测试刷盘：写盘在分段锁外进行，期间的查找仍能看到正在刷盘的数据；写盘失败时数据放回内存表
+void test_mk_lsm_flush(void) {
+    const char *dir = "tests/test_lsm_flush";
+    char key[32], value[32];
+    remove_dir_files(dir);
+
+    mk_t *m = mk_create();
+    CU_ASSERT_EQUAL(mk_lsm_open(m, dir, 1024 * 1024), 0);
+    for (int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "stable%03d", i);
+        snprintf(value, sizeof(value), "v%d", i);
+        CU_ASSERT_EQUAL(mk_put(m, key, value), 0);
+    }
+    CU_ASSERT_EQUAL(mk_put(m, "gone", "x"), 0);
+    CU_ASSERT_EQUAL(mk_lsm_flush(m), 0);
+    CU_ASSERT_EQUAL(mk_del(m, "gone"), 0);// 内存表中的删除标记
+    CU_ASSERT_EQUAL(mk_put(m, "stable000", "v0"), 0);
+
+    // 依次让第1、2、3……次分配失败，直到刷盘成功；失败时内存表保持原样
+    int failures = 0;
+    for (int k = 1; k < 100; k++) {
+        size_t mem = mk_memory_usage(m);
+        alloc_fail_countdown = k;
+        int ret = mk_lsm_flush(m);
+        alloc_fail_countdown = 0;
+        if (ret == 0) break;
+        failures++;
+        CU_ASSERT_EQUAL(mk_count(m), 1);
+        CU_ASSERT_EQUAL(mk_memory_usage(m), mem);
+        CU_ASSERT_PTR_NULL(mk_get(m, "gone"));
+        CU_ASSERT_STRING_EQUAL(mk_get(m, "stable000"), "v0");
+    }
+    CU_ASSERT(failures > 0);
+    CU_ASSERT_EQUAL(mk_count(m), 0);
+    CU_ASSERT_PTR_NULL(mk_get(m, "gone"));
+
+    // 一边刷盘一边读取
+    pthread_t reader;
+    CU_ASSERT_EQUAL(pthread_create(&reader, NULL, lsm_reader_main, m), 0);
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < 100; i++) {
+            snprintf(key, sizeof(key), "stable%03d", (i + round) % 100);
+            snprintf(value, sizeof(value), "v%d", (i + round) % 100);
+            CU_ASSERT_EQUAL(mk_put(m, key, value), 0);
+        }
+        CU_ASSERT_EQUAL(mk_lsm_flush(m), 0);
+    }
+    void *missing = NULL;
+    pthread_join(reader, &missing);
+    CU_ASSERT_PTR_NULL(missing);
+
+    // value长度用u32记录，0xffffffff表示删除标记，这样长的value不能写入
+    CU_ASSERT_EQUAL(mk_put_bin(m, "huge", value, (size_t)UINT32_MAX), -1);
+    mk_batch_t *b = mk_batch_create();
+    CU_ASSERT_EQUAL(mk_batch_put(b, "huge", value, (size_t)UINT32_MAX), -1);
+    mk_batch_free(b);
+    CU_ASSERT_PTR_NULL(mk_get(m, "huge"));
+    mk_destroy(m);
+    remove_dir_files(dir);
+}
+
+// 测试批量模式：子进程从文件读取命令，put/del成功不输出，超过一个读取块的长行和没有换行符的最后一行也能执行
+void test_mk_shell_batch(void) {
+    const char *in_path = "tests/test_batch_in.txt";
+    const char *out_path = "tests/test_batch_out.txt";
+    size_t big_len = 70000;// 大于MK_BATCH_BLOCK（64KB）
+    char *big = malloc(big_len + 1);
+    CU_ASSERT_PTR_NOT_NULL(big);
+    if (big == NULL) return;
+    memset(big, 'x', big_len);
+    big[big_len] = '\0';
+
+    FILE *in = fopen(in_path, "w");
+    CU_ASSERT_PTR_NOT_NULL(in);
+    if (in == NULL) {
+        free(big);
+        return;
+    }
+    fprintf(in, "put a 1\nput b hello world\ndel a\nget a\nget b\nfoo bar\n");
+    fprintf(in, "put big %s\nget big\n", big);
+    fprintf(in, "multi\nput c 3\nget c\nexec\nget c\n");
+    fprintf(in, "get b");// 最后一行没有换行符
+    fclose(in);
+
+    fflush(stdout);// 避免子进程重复输出父进程缓冲区中的内容
+    pid_t pid = fork();
+    if (pid == 0) {
+        int in_fd = open(in_path, O_RDONLY);
+        int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (in_fd < 0 || out_fd < 0 || dup2(in_fd, STDIN_FILENO) < 0 || dup2(out_fd, STDOUT_FILENO) < 0) _exit(2);
+        _exit(start_minikv_batch());
+    }
+    int status = -1;
+    CU_ASSERT_EQUAL(waitpid(pid, &status, 0), pid);
+    CU_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    size_t expect_len = big_len + 256;
+    char *expect = malloc(expect_len);
+    char *got = calloc(1, expect_len);
+    if (expect != NULL) snprintf(expect, expect_len,
+             "\n"                                           // get a（已删除）
+             "hello world\n"                                // get b
+             "未知的命令: foo\n"
+             "%s\n"                                         // get big
+             "事务中只能使用 put/del，请先 exec 或 discard ❌\n"
+             "排队时有命令出错，事务已放弃 ❌\n"
+             "\n"                                           // get c（事务被放弃）
+             "hello world\n",                               // 最后一行 get b
+             big);
+    FILE *out = fopen(out_path, "r");
+    CU_ASSERT(expect != NULL && got != NULL && out != NULL);
+    if (expect != NULL && got != NULL && out != NULL) {
+        size_t n = fread(got, 1, expect_len - 1, out);
+        CU_ASSERT_EQUAL(n, strlen(expect));
+        CU_ASSERT_STRING_EQUAL(got, expect);
+    }
+    if (out != NULL) fclose(out);
+
+    free(big);
+    free(expect);
+    free(got);
+    unlink(in_path);
+    unlink(out_path);
+}
+
 // 主函数
 int main() {
     // 初始化CUnit测试注册表
@@ -262,7 +1919,29 @@ int main() {
         NULL == CU_add_test(pSuite, "test_mk_load", test_mk_load) ||
         NULL == CU_add_test(pSuite, "test_mk_save", test_mk_save) ||
         NULL == CU_add_test(pSuite, "test_mk_destroy", test_mk_destroy) ||
-        NULL == CU_add_test(pSuite, "test_hash_collision", test_hash_collision)) {
+        NULL == CU_add_test(pSuite, "test_hash_collision", test_hash_collision) ||
+        NULL == CU_add_test(pSuite, "test_mk_memory_usage", test_mk_memory_usage) ||
+        NULL == CU_add_test(pSuite, "test_mk_binary_value", test_mk_binary_value) ||
+        NULL == CU_add_test(pSuite, "test_mk_compress", test_mk_compress) ||
+        NULL == CU_add_test(pSuite, "test_mk_lz_roundtrip", test_mk_lz_roundtrip) ||
+        NULL == CU_add_test(pSuite, "test_mk_lsm", test_mk_lsm) ||
+        NULL == CU_add_test(pSuite, "test_mk_replication", test_mk_replication) ||
+        NULL == CU_add_test(pSuite, "test_mk_snapshot", test_mk_snapshot) ||
+        NULL == CU_add_test(pSuite, "test_mk_incrby", test_mk_incrby) ||
+        NULL == CU_add_test(pSuite, "test_mk_hotkeys", test_mk_hotkeys) ||
+        NULL == CU_add_test(pSuite, "test_mk_slowlog", test_mk_slowlog) ||
+        NULL == CU_add_test(pSuite, "test_mk_client", test_mk_client) ||
+        NULL == CU_add_test(pSuite, "test_mk_mmap", test_mk_mmap) ||
+        NULL == CU_add_test(pSuite, "test_mk_shm", test_mk_shm) ||
+        NULL == CU_add_test(pSuite, "test_mk_vlog", test_mk_vlog) ||
+        NULL == CU_add_test(pSuite, "test_mk_vlog_gc_concurrent", test_mk_vlog_gc_concurrent) ||
+        NULL == CU_add_test(pSuite, "test_mk_cas", test_mk_cas) ||
+        NULL == CU_add_test(pSuite, "test_mk_export", test_mk_export) ||
+        NULL == CU_add_test(pSuite, "test_mk_wal", test_mk_wal) ||
+        NULL == CU_add_test(pSuite, "test_mk_batch", test_mk_batch) ||
+        NULL == CU_add_test(pSuite, "test_mk_batch_oom", test_mk_batch_oom) ||
+        NULL == CU_add_test(pSuite, "test_mk_lsm_flush", test_mk_lsm_flush) ||
+        NULL == CU_add_test(pSuite, "test_mk_shell_batch", test_mk_shell_batch)) {
         CU_cleanup_registry();
         return CU_get_error();
     }